@@ -0,0 +1,240 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include "adaptive_interval.h"
+
+/*! Temperature resolution of the sensors, steps of it are not a swing */
+static const double RESOLUTION_C = 0.1;
+
+/*! Time for the curvature estimate to decay to 1/e when the curve
+ *  straightens */
+static const double DECAY_MIN = 120;
+
+/*! Days for the hour of day profile to decay to 1/e */
+static const double PROFILE_DAYS = 7;
+
+/*! A curve is off the straight line by at most curvature * interval^2 / 8.
+ *  Aim at half the error budget, as the estimate lags behind the curve. */
+static const double ERROR_SCALE = 4;
+
+static const int MINUTES_PER_DAY = 24 * 60;
+
+
+/*!
+ * @brief
+ *   Parse interval settings of the collector's -i option.
+ *
+ * @param text (IN)
+ *   "min:max:error", for example "1:60:0.2".
+ *
+ * @param settings (OUT)
+ *   Interval settings.
+ *
+ * @return
+ *   True if 1 <= min <= max and error > 0, false otherwise.
+ */
+bool parse_interval_settings(const std::string &text, IntervalSettings &settings)
+{
+    char end = 0;
+
+    if (sscanf(text.c_str(), "%d:%d:%lf%c", &settings.min_min, &settings.max_min, &settings.error_c, &end) != 3)
+    {
+        return false;
+    }
+
+    return (settings.min_min >= 1) && (settings.max_min >= settings.min_min) && (settings.error_c > 0);
+}
+
+
+/*!
+ * @brief
+ *   Start a station at the shortest interval, so that it learns its
+ *   dynamics quickly.
+ *
+ * @param settings (IN)
+ *   Interval settings.
+ *
+ * @param state (OUT)
+ *   Interval controller of the station.
+ */
+void interval_reset(const IntervalSettings &settings, IntervalState &state)
+{
+    state.samples = 0;
+    state.time_s[0] = 0;
+    state.time_s[1] = 0;
+    state.temperature[0] = 0;
+    state.temperature[1] = 0;
+    state.curvature = 0;
+    std::fill(state.profile, state.profile + PROFILE_HOURS, 0.0f);
+    state.interval_min = settings.min_min;
+}
+
+
+/*!
+ * @brief
+ *   Update the interval controller of a station with its new sample and
+ *   pick the station's next interval.
+ *
+ * @param settings (IN)
+ *   Interval settings.
+ *
+ * @param state (IN/OUT)
+ *   Interval controller of the station.
+ *
+ * @param sample (IN)
+ *   New sample of the station. Samples not newer than the last one are
+ *   ignored.
+ */
+void interval_update(const IntervalSettings &settings, IntervalState &state, const Sample &sample)
+{
+    if ((state.samples > 0) && (sample.time_s <= state.time_s[1]))
+    {
+        return;
+    }
+
+    if (state.samples >= 2)
+    {
+        // Change of slope, less what the sensor resolution alone can cause
+        double span0_min = static_cast<double>(state.time_s[1] - state.time_s[0]) / 60;
+        double span1_min = static_cast<double>(sample.time_s - state.time_s[1]) / 60;
+        double slope0 = (state.temperature[1] - state.temperature[0]) / span0_min;
+        double residual = std::fabs(sample.temperature - state.temperature[1] - slope0 * span1_min);
+        double curvature = std::max(residual - RESOLUTION_C, 0.0) / (span1_min * (span0_min + span1_min) / 2);
+        state.curvature = std::max(curvature, state.curvature * exp(-span1_min / DECAY_MIN));
+
+        float forget = static_cast<float>(exp(-span1_min / (PROFILE_DAYS * MINUTES_PER_DAY)));
+
+        for (float &hourly : state.profile)
+        {
+            hourly *= forget;
+        }
+
+        // The slope changed around the middle sample
+        float &hourly = state.profile[(state.time_s[1] / 3600) % PROFILE_HOURS];
+        hourly = std::max(hourly, static_cast<float>(curvature));
+    }
+
+    state.time_s[0] = state.time_s[1];
+    state.temperature[0] = state.temperature[1];
+    state.time_s[1] = sample.time_s;
+    state.temperature[1] = sample.temperature;
+    state.samples++;
+
+    double interval_min = (state.curvature > 0) ? sqrt(ERROR_SCALE * settings.error_c / state.curvature)
+                                                : settings.max_min;
+    interval_min = std::min(interval_min, 2.0 * state.interval_min);
+
+    // Wake up no later than the hours that were busy on the previous days
+    int minute = static_cast<int>((sample.time_s / 60) % MINUTES_PER_DAY);
+    int ahead = 0;
+
+    while (ahead < interval_min)
+    {
+        float hourly = state.profile[((minute + ahead) / 60) % PROFILE_HOURS];
+
+        if (hourly > 0)
+        {
+            interval_min = std::min(interval_min, std::max(static_cast<double>(ahead),
+                                                           sqrt(ERROR_SCALE * settings.error_c / hourly)));
+        }
+
+        ahead += 60 - (minute + ahead) % 60;
+    }
+
+    interval_min = std::max(std::min(interval_min, static_cast<double>(settings.max_min)),
+                            static_cast<double>(settings.min_min));
+    state.interval_min = static_cast<int>(interval_min);
+}
+
+
+/*!
+ * @brief
+ *   Adaptive interval class constructor.
+ *
+ * @param interval_settings (IN)
+ *   Interval bounds and error budget.
+ */
+AdaptiveInterval::AdaptiveInterval(const IntervalSettings &interval_settings) : limits(interval_settings)
+{
+}
+
+
+/*!
+ * @brief
+ *   Update the interval of a station with its new sample.
+ *
+ * @param station_id (IN)
+ *   Station the sample is from.
+ *
+ * @param sample (IN)
+ *   New sample.
+ */
+void AdaptiveInterval::on_sample(const std::string &station_id, const Sample &sample)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = stations.find(station_id);
+
+    if (found == stations.end())
+    {
+        found = stations.emplace(station_id, IntervalState()).first;
+        interval_reset(limits, found->second);
+    }
+
+    interval_update(limits, found->second, sample);
+}
+
+
+/*!
+ * @brief
+ *   Get the measurement interval of a station.
+ *
+ * @param station_id (IN)
+ *   Station ID.
+ *
+ * @param default_min (IN)
+ *   Interval of a station that has not sent samples yet.
+ *
+ * @return
+ *   Interval in minutes.
+ */
+int AdaptiveInterval::interval(const std::string &station_id, int default_min)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = stations.find(station_id);
+
+    return (found != stations.end()) ? found->second.interval_min : default_min;
+}
+
+
+/*!
+ * @brief
+ *   Get interval settings.
+ */
+const IntervalSettings &AdaptiveInterval::settings() const
+{
+    return limits;
+}
@@ -0,0 +1,259 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include "alert_sink.h"
+#include "transport_socket.h"
+
+
+/*!
+ * @brief
+ *   File sink class constructor.
+ *
+ * @param file_path (IN)
+ *   JSON lines file, created if missing.
+ */
+AlertFileSink::AlertFileSink(const std::string &file_path) : path(file_path)
+{
+}
+
+
+/*!
+ * @brief
+ *   Append event to the file. One write per event with O_APPEND keeps
+ *   events of concurrent collectors whole.
+ *
+ * @param json (IN)
+ *   Event.
+ */
+void AlertFileSink::deliver(const std::string &json)
+{
+    std::string line = json + "\n";
+    int fd = open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+
+    if (fd >= 0)
+    {
+        ssize_t written = write(fd, line.data(), line.size());
+        (void)written;
+        close(fd);
+    }
+}
+
+
+/*!
+ * @brief
+ *   Webhook sink class constructor.
+ */
+AlertWebhookSink::AlertWebhookSink() : port(0), stopping(false), delivered_count(0), dropped_count(0)
+{
+}
+
+
+/*!
+ * @brief
+ *   Webhook sink class destructor.
+ *   Stops the delivery thread after it has tried the queued events.
+ */
+AlertWebhookSink::~AlertWebhookSink()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    wake.notify_one();
+
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+}
+
+
+/*!
+ * @brief
+ *   Start delivering to a URL.
+ *
+ * @param url (IN)
+ *   http://host[:port][/path], plain HTTP to a local receiver.
+ *
+ * @return
+ *   True if the URL is valid, false otherwise.
+ */
+bool AlertWebhookSink::open(const std::string &url)
+{
+    static const std::string SCHEME = "http://";
+
+    if (url.compare(0, SCHEME.size(), SCHEME) != 0)
+    {
+        return false;
+    }
+
+    std::string authority = url.substr(SCHEME.size());
+    size_t slash = authority.find('/');
+    path = (slash != std::string::npos) ? authority.substr(slash) : "/";
+    authority = authority.substr(0, slash);
+    size_t colon = authority.find(':');
+    host = authority.substr(0, colon);
+    port = (colon != std::string::npos) ? atoi(authority.c_str() + colon + 1) : 80;
+
+    if (host.empty() || (port <= 0) || (port > 65535))
+    {
+        return false;
+    }
+
+    thread = std::thread([this]() { run(); });
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Queue event for delivery. Drops the oldest event if the queue is full.
+ *
+ * @param json (IN)
+ *   Event.
+ */
+void AlertWebhookSink::deliver(const std::string &json)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (queue.size() >= MAX_QUEUE)
+        {
+            queue.pop_front();
+            dropped_count++;
+        }
+
+        queue.push_back(json);
+    }
+
+    wake.notify_one();
+}
+
+
+/*!
+ * @brief
+ *   Get number of events the receiver accepted.
+ */
+uint64_t AlertWebhookSink::delivered() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return delivered_count;
+}
+
+
+/*!
+ * @brief
+ *   Get number of events given up: queue overflow or MAX_ATTEMPTS failed
+ *   deliveries.
+ */
+uint64_t AlertWebhookSink::dropped() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return dropped_count;
+}
+
+
+/*!
+ * @brief
+ *   Delivery thread: POST queued events one at a time, in order.
+ */
+void AlertWebhookSink::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true)
+    {
+        wake.wait(lock, [this]() { return stopping || !queue.empty(); });
+
+        if (queue.empty())
+        {
+            return;
+        }
+
+        std::string json = queue.front();
+        queue.pop_front();
+        bool posted = false;
+
+        for (int attempt = 0; !posted && (attempt < MAX_ATTEMPTS); attempt++)
+        {
+            lock.unlock();
+            posted = post(json);
+            lock.lock();
+
+            if (!posted && !stopping)
+            {
+                wake.wait_for(lock, std::chrono::milliseconds(RETRY_MS), [this]() { return stopping; });
+            }
+        }
+
+        (posted ? delivered_count : dropped_count)++;
+    }
+}
+
+
+/*!
+ * @brief
+ *   POST one event.
+ *
+ * @param json (IN)
+ *   Event.
+ *
+ * @return
+ *   True if the receiver answered 2xx, false otherwise.
+ */
+bool AlertWebhookSink::post(const std::string &json)
+{
+    TransportStats stats = {};
+    TransportSocket socket(stats);
+    std::string request = "POST " + path + " HTTP/1.1\r\nHost: " + host + "\r\nConnection: close\r\n" +
+                          "Content-Type: application/json\r\nContent-Length: " + std::to_string(json.size()) +
+                          "\r\n\r\n" + json;
+    std::string response;
+
+    if (!socket.open(host, port, false) || !socket.send(request))
+    {
+        return false;
+    }
+
+    while (response.find("\r\n") == std::string::npos)
+    {
+        std::string data;
+
+        if (!socket.receive(data, TIMEOUT_MS))
+        {
+            return false;
+        }
+
+        response += data;
+    }
+
+    // "HTTP/1.1 2xx"
+    return (response.size() > 9) && (response[9] == '2');
+}
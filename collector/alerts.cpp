@@ -0,0 +1,667 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include "alerts.h"
+#include "store.h"
+
+
+/*!
+ * @brief
+ *   Parse a duration: a number with unit s, m or h.
+ *
+ * @param text (IN)
+ *   Duration such as "30m".
+ *
+ * @param duration_s (OUT)
+ *   Duration in seconds.
+ *
+ * @return
+ *   True if a positive whole number with a known unit, false otherwise.
+ */
+static bool parse_duration(const std::string &text, int64_t &duration_s)
+{
+    char *end = nullptr;
+    long long value = strtoll(text.c_str(), &end, 10);
+    std::string unit = end;
+
+    if ((end == text.c_str()) || (value <= 0) || (value > 1000000))
+    {
+        return false;
+    }
+
+    if (unit == "s")
+    {
+        duration_s = value;
+    }
+    else if (unit == "m")
+    {
+        duration_s = value * 60;
+    }
+    else if (unit == "h")
+    {
+        duration_s = value * 3600;
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Check that a rule name can be sent in JSON as is.
+ *
+ * @param name (IN)
+ *   Rule name.
+ *
+ * @return
+ *   True if not empty and only letters, digits, '-' and '_'.
+ */
+static bool valid_rule_name(const std::string &name)
+{
+    if (name.empty() || (name.size() > 64))
+    {
+        return false;
+    }
+
+    for (char c : name)
+    {
+        if (!isalnum(static_cast<unsigned char>(c)) && (c != '-') && (c != '_'))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Parse one rule of alerts.txt, see alerts.h.
+ *
+ * @param line (IN)
+ *   Rule line without comment.
+ *
+ * @param interval_min (IN)
+ *   Measurement interval in minutes for nodata rules.
+ *
+ * @param rule (OUT)
+ *   Parsed rule.
+ *
+ * @return
+ *   True if the line is a valid rule, false otherwise.
+ */
+bool parse_alert_rule(const std::string &line, int interval_min, AlertRule &rule)
+{
+    std::istringstream fields(line);
+    std::string condition;
+    std::string extra;
+
+    if (!(fields >> rule.name >> rule.station >> condition) || !valid_rule_name(rule.name) ||
+        ((rule.station != "*") && !Store::valid_station_id(rule.station)))
+    {
+        return false;
+    }
+
+    rule.field = AlertRule::TEMPERATURE;
+    rule.compare = AlertRule::BELOW;
+    rule.threshold = 0;
+    rule.duration_s = 0;
+
+    if (condition == "nodata")
+    {
+        int intervals = 0;
+        rule.kind = AlertRule::NO_DATA;
+        rule.duration_s = (fields >> intervals) ? static_cast<int64_t>(intervals) * interval_min * 60 : 0;
+
+        return (rule.duration_s > 0) && !(fields >> extra);
+    }
+
+    std::string compare;
+    std::string threshold;
+    rule.kind = AlertRule::THRESHOLD;
+
+    if ((condition == "temperature") || (condition == "humidity"))
+    {
+        rule.field = (condition == "temperature") ? AlertRule::TEMPERATURE : AlertRule::HUMIDITY;
+    }
+    else
+    {
+        return false;
+    }
+
+    if (!(fields >> compare >> threshold))
+    {
+        return false;
+    }
+
+    if (compare == "<")
+    {
+        rule.compare = AlertRule::BELOW;
+    }
+    else if (compare == "<=")
+    {
+        rule.compare = AlertRule::BELOW_OR_EQUAL;
+    }
+    else if (compare == ">")
+    {
+        rule.compare = AlertRule::ABOVE;
+    }
+    else if (compare == ">=")
+    {
+        rule.compare = AlertRule::ABOVE_OR_EQUAL;
+    }
+    else
+    {
+        return false;
+    }
+
+    char *end = nullptr;
+    rule.threshold = strtod(threshold.c_str(), &end);
+
+    if ((*end != 0) || !std::isfinite(rule.threshold))
+    {
+        return false;
+    }
+
+    if (fields >> extra)
+    {
+        std::string duration;
+
+        if ((extra != "for") || !(fields >> duration) || !parse_duration(duration, rule.duration_s))
+        {
+            return false;
+        }
+    }
+
+    return !(fields >> extra);
+}
+
+
+/*!
+ * @brief
+ *   Check whether a sample meets the condition of a threshold rule.
+ */
+static bool condition_met(const AlertRule &rule, double value)
+{
+    switch (rule.compare)
+    {
+        case AlertRule::BELOW:
+            return value < rule.threshold;
+        case AlertRule::BELOW_OR_EQUAL:
+            return value <= rule.threshold;
+        case AlertRule::ABOVE:
+            return value > rule.threshold;
+        default:
+            return value >= rule.threshold;
+    }
+}
+
+
+/*!
+ * @brief
+ *   Alert engine class constructor.
+ */
+AlertEngine::AlertEngine()
+{
+}
+
+
+/*!
+ * @brief
+ *   Alert engine class destructor.
+ */
+AlertEngine::~AlertEngine()
+{
+}
+
+
+/*!
+ * @brief
+ *   Read rules from a file. A missing file has no rules.
+ *
+ * @param rules_path (IN)
+ *   Path of alerts.txt.
+ *
+ * @param interval_min (IN)
+ *   Measurement interval in minutes for nodata rules.
+ *
+ * @param error (OUT)
+ *   The first invalid line if reading fails.
+ *
+ * @return
+ *   True if every line is a rule, a comment or empty, false otherwise.
+ */
+bool AlertEngine::load(const std::string &rules_path, int interval_min, std::string &error)
+{
+    std::ifstream file(rules_path);
+    std::string line;
+    int line_number = 0;
+
+    while (std::getline(file, line))
+    {
+        line_number++;
+        line = line.substr(0, line.find('#'));
+
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+        {
+            continue;
+        }
+
+        AlertRule rule;
+
+        if (!parse_alert_rule(line, interval_min, rule))
+        {
+            error = rules_path + " line " + std::to_string(line_number) + ": " + line;
+            return false;
+        }
+
+        add_rule(rule);
+    }
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Add a rule. Rules are added before samples arrive.
+ *
+ * @param rule (IN)
+ *   Alert rule.
+ */
+void AlertEngine::add_rule(const AlertRule &rule)
+{
+    uint32_t index = static_cast<uint32_t>(rules.size());
+    rules.push_back(rule);
+
+    if (rule.station == "*")
+    {
+        all_station_rules.push_back(index);
+    }
+    else
+    {
+        station_rules[rule.station].push_back(index);
+    }
+}
+
+
+/*!
+ * @brief
+ *   Add a destination for events. Sinks are added before samples arrive
+ *   and must outlive the engine.
+ *
+ * @param sink (IN)
+ *   Alert sink.
+ */
+void AlertEngine::add_sink(AlertSink *sink)
+{
+    sinks.push_back(sink);
+}
+
+
+/*!
+ * @brief
+ *   Watch a station for silence before it sends, for stations already in
+ *   the store when the collector starts.
+ *
+ * @param station_id (IN)
+ *   Station ID.
+ *
+ * @param last_time_s (IN)
+ *   Time of the station's last stored sample.
+ */
+void AlertEngine::track(const std::string &station_id, int64_t last_time_s)
+{
+    AlertShard &shard = shard_of(station_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    StationAlerts &station = find_or_create(shard, station_id);
+    station.last_time_s = last_time_s;
+
+    for (uint32_t slot = 0; slot < station.rules.size(); slot++)
+    {
+        if (rules[station.rules[slot].rule].kind == AlertRule::NO_DATA)
+        {
+            watch_silence(shard, station, slot);
+        }
+    }
+}
+
+
+/*!
+ * @brief
+ *   Evaluate the rules of a station with its new sample.
+ *
+ * @param station_id (IN)
+ *   Station the sample is from.
+ *
+ * @param sample (IN)
+ *   New sample, in time order with the earlier samples of the station.
+ *
+ * @param events (OUT)
+ *   Events are appended.
+ */
+void AlertEngine::on_sample(const std::string &station_id, const Sample &sample, std::vector<AlertEvent> &events)
+{
+    size_t first = events.size();
+
+    if (rules.empty())
+    {
+        return;
+    }
+
+    {
+        AlertShard &shard = shard_of(station_id);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        StationAlerts &station = find_or_create(shard, station_id);
+        station.last_time_s = sample.time_s;
+
+        for (uint32_t slot = 0; slot < station.rules.size(); slot++)
+        {
+            RuleState &state = station.rules[slot];
+            const AlertRule &rule = rules[state.rule];
+
+            if (rule.kind == AlertRule::NO_DATA)
+            {
+                if (state.firing)
+                {
+                    state.firing = false;
+                    events.push_back({rule.name, station_id, false, sample.time_s, NAN});
+                }
+
+                watch_silence(shard, station, slot);
+                continue;
+            }
+
+            double value = (rule.field == AlertRule::TEMPERATURE) ? sample.temperature : sample.humidity;
+
+            if (!condition_met(rule, value))
+            {
+                state.since_s = -1;
+
+                if (state.firing)
+                {
+                    state.firing = false;
+                    events.push_back({rule.name, station_id, false, sample.time_s, value});
+                }
+
+                continue;
+            }
+
+            if (state.since_s < 0)
+            {
+                state.since_s = sample.time_s;
+            }
+
+            if (!state.firing && (sample.time_s - state.since_s >= rule.duration_s))
+            {
+                state.firing = true;
+                events.push_back({rule.name, station_id, true, sample.time_s, value});
+            }
+        }
+    }
+
+    deliver(events, first);
+}
+
+
+/*!
+ * @brief
+ *   Fire nodata rules of stations that have been silent too long. Called
+ *   periodically. Each shard is locked in turn, so ingest into the other
+ *   shards goes on.
+ *
+ * @param now_s (IN)
+ *   Current Unix time in seconds.
+ *
+ * @param events (OUT)
+ *   Events are appended.
+ */
+void AlertEngine::check_silence(int64_t now_s, std::vector<AlertEvent> &events)
+{
+    size_t first = events.size();
+
+    for (AlertShard &shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        for (auto &heap : shard.silence)
+        {
+            const AlertRule &rule = rules[heap.first];
+
+            while (!heap.second.empty() && (heap.second.top().time_s + rule.duration_s <= now_s))
+            {
+                SilenceEntry entry = heap.second.top();
+                heap.second.pop();
+                RuleState &state = entry.station->rules[entry.slot];
+
+                // The station has sent since the entry was queued
+                if (entry.station->last_time_s + rule.duration_s > now_s)
+                {
+                    entry.time_s = entry.station->last_time_s;
+                    heap.second.push(entry);
+                    continue;
+                }
+
+                // The station's next sample resolves the rule and queues it again
+                state.queued = false;
+
+                if (!state.firing)
+                {
+                    state.firing = true;
+                    events.push_back({rule.name, *entry.station->id, true, now_s, NAN});
+                }
+            }
+        }
+    }
+
+    deliver(events, first);
+}
+
+
+/*!
+ * @brief
+ *   Get number of rules.
+ */
+size_t AlertEngine::rule_count() const
+{
+    return rules.size();
+}
+
+
+/*!
+ * @brief
+ *   Get memory used by the per station rule state and silence heaps.
+ */
+size_t AlertEngine::state_bytes() const
+{
+    size_t bytes = 0;
+
+    for (const AlertShard &shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        for (const auto &station : shard.stations)
+        {
+            bytes += sizeof(station) + station.first.capacity() + station.second.rules.capacity() * sizeof(RuleState);
+        }
+
+        for (const auto &heap : shard.silence)
+        {
+            bytes += heap.second.size() * sizeof(SilenceEntry);
+        }
+    }
+
+    return bytes;
+}
+
+
+/*!
+ * @brief
+ *   Format event as JSON.
+ *
+ * @param event (IN)
+ *   Alert event.
+ *
+ * @return
+ *   {"alert":"name","station":"id","state":"firing"|"resolved","time":unix_s[,"value":x.x]}
+ */
+std::string AlertEngine::event_to_json(const AlertEvent &event)
+{
+    char json[256];
+    snprintf(json, sizeof(json), "{\"alert\":\"%s\",\"station\":\"%s\",\"state\":\"%s\",\"time\":%lld",
+             event.rule.c_str(), event.station.c_str(), event.firing ? "firing" : "resolved",
+             static_cast<long long>(event.time_s));
+    std::string text = json;
+
+    if (!std::isnan(event.value))
+    {
+        snprintf(json, sizeof(json), ",\"value\":%.1f", event.value);
+        text += json;
+    }
+
+    return text + "}";
+}
+
+
+/*!
+ * @brief
+ *   Get the shard of a station.
+ *
+ * @param station_id (IN)
+ *   Station ID.
+ */
+AlertEngine::AlertShard &AlertEngine::shard_of(const std::string &station_id)
+{
+    return shards[std::hash<std::string>()(station_id) % SHARDS];
+}
+
+
+/*!
+ * @brief
+ *   Find the rule state of a station, creating it with the rules of the
+ *   station on its first sample. Called with the shard's mutex held.
+ *
+ * @param shard (IN/OUT)
+ *   Shard of the station.
+ *
+ * @param station_id (IN)
+ *   Station ID.
+ *
+ * @return
+ *   Rule state of the station.
+ */
+AlertEngine::StationAlerts &AlertEngine::find_or_create(AlertShard &shard, const std::string &station_id)
+{
+    auto found = shard.stations.find(station_id);
+
+    if (found != shard.stations.end())
+    {
+        return found->second;
+    }
+
+    found = shard.stations.emplace(station_id, StationAlerts()).first;
+    StationAlerts &station = found->second;
+    station.id = &found->first;
+    station.last_time_s = 0;
+
+    for (uint32_t rule : all_station_rules)
+    {
+        station.rules.push_back({rule, false, false, -1});
+    }
+
+    auto specific = station_rules.find(station_id);
+
+    if (specific != station_rules.end())
+    {
+        for (uint32_t rule : specific->second)
+        {
+            station.rules.push_back({rule, false, false, -1});
+        }
+    }
+
+    return station;
+}
+
+
+/*!
+ * @brief
+ *   Queue a nodata rule of a station in the rule's silence heap with the
+ *   station's last sample time, unless it already has an entry there.
+ *   Called with the shard's mutex held.
+ *
+ * @param shard (IN/OUT)
+ *   Shard of the station.
+ *
+ * @param station (IN/OUT)
+ *   Rule state of the station.
+ *
+ * @param slot (IN)
+ *   Index of the nodata rule in the station's rule state.
+ */
+void AlertEngine::watch_silence(AlertShard &shard, StationAlerts &station, uint32_t slot)
+{
+    RuleState &state = station.rules[slot];
+
+    if (!state.queued)
+    {
+        state.queued = true;
+        shard.silence[state.rule].push({&station, slot, station.last_time_s});
+    }
+}
+
+
+/*!
+ * @brief
+ *   Deliver events to the sinks, without the mutex held.
+ *
+ * @param events (IN)
+ *   Events.
+ *
+ * @param first (IN)
+ *   Index of the first event to deliver.
+ */
+void AlertEngine::deliver(const std::vector<AlertEvent> &events, size_t first)
+{
+    for (size_t i = first; i < events.size(); i++)
+    {
+        std::string json = event_to_json(events[i]);
+
+        for (AlertSink *sink : sinks)
+        {
+            sink->deliver(json);
+        }
+    }
+}
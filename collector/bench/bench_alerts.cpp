@@ -0,0 +1,178 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Benchmark of alert rule evaluation on ingest.
+ *
+ * Loads rules for every station and rules per station, feeds the engine
+ * samples of all stations in time order, and reports the time per sample
+ * and per rule evaluation, the rule state size, and the time of a silence
+ * check.
+ *
+ * Usage: bench_alerts [-s stations] [-a rules_for_all] [-r rules_per_station] [-n samples_per_station]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "alerts.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/*! Time between samples of a station */
+static const int64_t SAMPLE_INTERVAL_S = 60;
+
+
+/*!
+ * @brief
+ *   Make the i:th rule: threshold rules with and without duration on both
+ *   fields, and every tenth a nodata rule.
+ */
+static std::string make_rule(size_t i, const std::string &station)
+{
+    static const char *const CONDITIONS[] = {"temperature < 0 for 30m", "temperature > 30", "humidity >= 85 for 2h",
+                                             "humidity < 20 for 10m", "temperature <= -5", "humidity > 95",
+                                             "temperature >= 25 for 1h", "humidity <= 30", "temperature < 2 for 5m"};
+    std::string name = "rule" + std::to_string(i);
+
+    if (i % 10 == 9)
+    {
+        return name + " " + station + " nodata 3";
+    }
+
+    return name + " " + station + " " + CONDITIONS[i % 9];
+}
+
+
+int main(int argc, char *argv[])
+{
+    size_t stations = 2000;
+    size_t all_rules = 20;
+    size_t station_rules = 3;
+    size_t samples = 100;
+    int option;
+
+    while ((option = getopt(argc, argv, "s:a:r:n:")) != -1)
+    {
+        switch (option)
+        {
+            case 's':
+                stations = strtoul(optarg, nullptr, 10);
+                break;
+            case 'a':
+                all_rules = strtoul(optarg, nullptr, 10);
+                break;
+            case 'r':
+                station_rules = strtoul(optarg, nullptr, 10);
+                break;
+            case 'n':
+                samples = strtoul(optarg, nullptr, 10);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-s stations] [-a rules_for_all] [-r rules_per_station] "
+                        "[-n samples_per_station]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if ((stations == 0) || (samples == 0))
+    {
+        fprintf(stderr, "Need 1 or more stations and samples\n");
+        return EXIT_FAILURE;
+    }
+
+    AlertEngine engine;
+    std::vector<std::string> ids;
+    AlertRule rule;
+
+    for (size_t i = 0; i < all_rules; i++)
+    {
+        parse_alert_rule(make_rule(i, "*"), 1, rule);
+        engine.add_rule(rule);
+    }
+
+    for (size_t s = 0; s < stations; s++)
+    {
+        ids.push_back("station" + std::to_string(s));
+
+        for (size_t i = 0; i < station_rules; i++)
+        {
+            parse_alert_rule(make_rule(all_rules + s * station_rules + i, ids.back()), 1, rule);
+            engine.add_rule(rule);
+        }
+    }
+
+    // Temperatures and humidities swing through every threshold
+    std::vector<AlertEvent> events;
+    size_t fired = 0;
+    int64_t time_s = 0;
+    double check_ns = 0;
+    Clock::time_point start = Clock::now();
+
+    for (size_t n = 0; n < samples; n++)
+    {
+        time_s += SAMPLE_INTERVAL_S;
+
+        for (size_t s = 0; s < stations; s++)
+        {
+            Sample sample = {time_s, static_cast<float>((n * 7 + s) % 50) - 10.0f, static_cast<int>((n * 3 + s) % 100),
+                             static_cast<uint32_t>(n)};
+            engine.on_sample(ids[s], sample, events);
+        }
+
+        fired += events.size();
+        events.clear();
+
+        // Stations send every minute, so the checks find no expired entries
+        Clock::time_point check_start = Clock::now();
+        engine.check_silence(time_s, events);
+        check_ns += std::chrono::duration<double, std::nano>(Clock::now() - check_start).count();
+    }
+
+    double elapsed_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() - check_ns;
+    double sample_count = static_cast<double>(stations * samples);
+    size_t evaluations = all_rules + station_rules;
+
+    // All stations fall silent: every nodata rule fires
+    Clock::time_point check_start = Clock::now();
+    engine.check_silence(time_s + 10 * 60 * 3, events);
+    double silence_ms = std::chrono::duration<double, std::milli>(Clock::now() - check_start).count();
+
+    printf("stations %zu\n", stations);
+    printf("rules %zu\n", engine.rule_count());
+    printf("rules_per_sample %zu\n", evaluations);
+    printf("samples %.0f\n", sample_count);
+    printf("events %zu\n", fired);
+    printf("ns_per_sample %.0f\n", elapsed_ns / sample_count);
+    printf("ns_per_rule_evaluation %.1f\n", elapsed_ns / sample_count / static_cast<double>(evaluations));
+    printf("us_per_silence_check %.1f\n", check_ns / static_cast<double>(samples) / 1000);
+    printf("silence_events %zu\n", events.size());
+    printf("silence_check_ms %.2f\n", silence_ms);
+    printf("state_bytes_per_station %.0f\n", static_cast<double>(engine.state_bytes()) / static_cast<double>(stations));
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,209 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Benchmark of the compressed block codec.
+ *
+ * Encodes a synthetic station history into blocks and reports the size per
+ * sample against the legacy raw.html line and the shard log record, and the
+ * encode, decode and block file scan throughput.
+ *
+ * Usage: bench_codec [-n samples] [-s seed]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "codec.h"
+#include "store.h"
+#include "test_client.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/*! Samples per block, as sealed by the store */
+static const size_t BLOCK_SAMPLES = StationShard::CHUNK_SAMPLES;
+
+
+/*!
+ * @brief
+ *   Make samples of a station sampling once a minute with some jitter.
+ */
+static std::vector<Sample> make_samples(size_t count, unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> jitter(-2, 2);
+    std::uniform_int_distribution<int> step(-2, 2);
+    std::vector<Sample> samples(count);
+    int64_t time_s = 1559390400;
+    int temperature_tenths = 215;
+    int humidity = 40;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        time_s += 60 + jitter(random);
+        temperature_tenths += step(random);
+        humidity = std::min(100, std::max(0, humidity + step(random) / 2));
+        samples[i] = {time_s, static_cast<float>(temperature_tenths) / 10, humidity, static_cast<uint32_t>(i + 1)};
+    }
+
+    return samples;
+}
+
+
+/*!
+ * @brief
+ *   Get size of a sample as a raw.html line written by the old collect.php.
+ */
+static size_t raw_html_size(const Sample &sample)
+{
+    char line[160];
+    return static_cast<size_t>(snprintf(line, sizeof(line),
+                                        "<p>2019-06-01 12:00:00&nbsp;&nbsp;&nbsp;&nbsp;Temperature: %.1f &deg;C"
+                                        "&nbsp;&nbsp;&nbsp;&nbsp;Humidity: %d</p>",
+                                        sample.temperature, sample.humidity));
+}
+
+
+int main(int argc, char *argv[])
+{
+    size_t count = 1000000;
+    unsigned seed = 1;
+    int option;
+
+    while ((option = getopt(argc, argv, "n:s:")) != -1)
+    {
+        switch (option)
+        {
+            case 'n':
+                count = strtoul(optarg, nullptr, 10);
+                break;
+            case 's':
+                seed = static_cast<unsigned>(atoi(optarg));
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-n samples] [-s seed]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<Sample> samples = make_samples(count, seed);
+    std::string path = make_test_dir() + "/bench.blk";
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    BlockEncoder encoder;
+    size_t block_bytes = 0;
+    size_t raw_html_bytes = 0;
+    double encode_s = 0.0;
+
+    for (size_t first = 0; first < count; first += BLOCK_SAMPLES)
+    {
+        size_t last = std::min(count, first + BLOCK_SAMPLES);
+        auto start = Clock::now();
+        encoder.clear();
+
+        for (size_t i = first; i < last; i++)
+        {
+            encoder.append(samples[i]);
+        }
+
+        encode_s += std::chrono::duration<double>(Clock::now() - start).count();
+
+        BlockHeader header = {static_cast<uint32_t>(encoder.count()), static_cast<uint32_t>(encoder.bytes().size()),
+                              encoder.first_time(), encoder.last_time()};
+        uint8_t data[BlockHeader::SIZE];
+        header.encode(data);
+
+        if ((write(fd, data, sizeof(data)) != static_cast<ssize_t>(sizeof(data))) ||
+            (write(fd, encoder.bytes().data(), encoder.bytes().size()) !=
+             static_cast<ssize_t>(encoder.bytes().size())))
+        {
+            fprintf(stderr, "Cannot write %s\n", path.c_str());
+            return EXIT_FAILURE;
+        }
+
+        block_bytes += sizeof(data) + encoder.bytes().size();
+    }
+
+    for (const Sample &sample : samples)
+    {
+        raw_html_bytes += raw_html_size(sample);
+    }
+
+    // Scan the whole file with one block in memory at a time
+    BlockScanner scanner(fd, INT64_MIN, INT64_MAX);
+    Sample sample;
+    size_t scanned = 0;
+    int64_t checksum = 0;
+    auto start = Clock::now();
+
+    while (scanner.next(sample))
+    {
+        checksum += sample.humidity;
+        scanned++;
+    }
+
+    double scan_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+    if (scanned != count)
+    {
+        fprintf(stderr, "Scanned %zu of %zu samples\n", scanned, count);
+        return EXIT_FAILURE;
+    }
+
+    // Range scan of the last tenth, skipping older blocks by header
+    BlockScanner range(fd, samples[count - count / 10].time_s, INT64_MAX);
+    size_t in_range = 0;
+    start = Clock::now();
+
+    while (range.next(sample))
+    {
+        in_range++;
+    }
+
+    double range_s = std::chrono::duration<double>(Clock::now() - start).count();
+    close(fd);
+    unlink(path.c_str());
+
+    double samples_count = static_cast<double>(count);
+    double bytes_per_sample = static_cast<double>(block_bytes) / samples_count;
+
+    printf("samples %zu\n", count);
+    printf("block_bytes_per_sample %.2f\n", bytes_per_sample);
+    printf("record_bytes_per_sample %zu\n", StationShard::RECORD_SIZE);
+    printf("raw_html_bytes_per_sample %.1f\n", static_cast<double>(raw_html_bytes) / samples_count);
+    printf("ratio_vs_raw_html %.1f\n", static_cast<double>(raw_html_bytes) / static_cast<double>(block_bytes));
+    printf("ratio_vs_record %.1f\n", static_cast<double>(StationShard::RECORD_SIZE) / bytes_per_sample);
+    printf("encode_samples_per_s %.0f\n", samples_count / encode_s);
+    printf("decode_samples_per_s %.0f\n", samples_count / scan_s);
+    printf("decode_mb_per_s %.1f\n", static_cast<double>(block_bytes) / scan_s / 1e6);
+    printf("range_scan_samples %zu\n", in_range);
+    printf("range_scan_ms %.3f\n", range_s * 1000);
+    printf("checksum %lld\n", static_cast<long long>(checksum));
+
+    return EXIT_SUCCESS;
+}
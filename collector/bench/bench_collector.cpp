@@ -0,0 +1,544 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Benchmark of the collector's query side over loopback HTTP.
+ *
+ * Fills a store with a synthetic fleet history, stations times years of
+ * samples at the given interval, and runs dashboard and analysis requests
+ * against a loopback collector from client threads on keep-alive
+ * connections:
+ *
+ * - last: the last 100 samples of a station.
+ * - range: a day of raw samples of a station.
+ * - rollup: hourly means of all stations over a week.
+ * - graph: a year of a station downsampled to about 500 points.
+ * - export: a month of a station as binary columns.
+ * - mixed: the above in turn.
+ * - mixed_ingest: the mix while a station client posts samples flat out,
+ *   whose latency is reported as ingest.
+ *
+ * Reports per workload the latency percentiles and requests per second as
+ * "key value" lines. With -b the results are checked against a baseline of
+ * "key limit" lines, maximums for latencies and minimums for rates, and
+ * the benchmark fails on a regression, so it can run as a test.
+ *
+ * Usage: bench_collector [-s stations] [-y years] [-i interval_s] [-c clients] [-n requests] [-b baseline]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "test_client.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/*! Seconds of a year of history */
+static const int64_t YEAR_S = 365 * 86400;
+
+/*! Points of a downsampled graph */
+static const int64_t GRAPH_POINTS = 500;
+
+/*! Benchmark settings */
+struct Settings
+{
+    int stations;
+    int years;
+    int interval_s;
+    int clients;
+    int requests;
+};
+
+/*! Latencies and duration of one workload */
+struct WorkloadResult
+{
+    std::vector<double> latencies_us;
+    double elapsed_s;
+    size_t bytes;
+    size_t failures;
+};
+
+
+/*! Keep-alive HTTP client that reads whole responses */
+class BenchClient
+{
+public:
+    BenchClient(int port) : client(port)
+    {
+    }
+
+    /*!
+     * @brief
+     *   Send a request and read its response, with Content-Length or
+     *   chunked body.
+     *
+     * @return
+     *   True if the response status is 200, false otherwise.
+     */
+    bool request(const std::string &method, const std::string &target, const std::string &body, size_t &bytes)
+    {
+        std::string text = method + " " + target + " HTTP/1.1\r\nHost: localhost\r\n";
+
+        if (method == "POST")
+        {
+            text += "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: " +
+                    std::to_string(body.size()) + "\r\n";
+        }
+
+        if (!client.send_text(text + "\r\n" + body))
+        {
+            return false;
+        }
+
+        size_t header_end;
+
+        while ((header_end = buffer.find("\r\n\r\n")) == std::string::npos)
+        {
+            if (!fill())
+            {
+                return false;
+            }
+        }
+
+        bool ok = (buffer.compare(0, 12, "HTTP/1.1 200") == 0);
+        size_t length_at = buffer.find("Content-Length: ");
+        size_t offset = header_end + 4;
+
+        if ((length_at != std::string::npos) && (length_at < header_end))
+        {
+            size_t length = strtoul(buffer.c_str() + length_at + 16, nullptr, 10);
+
+            if (!need(offset + length))
+            {
+                return false;
+            }
+
+            offset += length;
+        }
+        else
+        {
+            // Chunked: size line, data and line break until the last chunk
+            while (true)
+            {
+                size_t line_end;
+
+                while ((line_end = buffer.find("\r\n", offset)) == std::string::npos)
+                {
+                    if (!fill())
+                    {
+                        return false;
+                    }
+                }
+
+                size_t size = strtoul(buffer.c_str() + offset, nullptr, 16);
+                offset = line_end + 2;
+
+                if (!need(offset + size + 2))
+                {
+                    return false;
+                }
+
+                offset += size + 2;
+
+                if (size == 0)
+                {
+                    break;
+                }
+
+                // Drop what is read so that the buffer stays small
+                buffer.erase(0, offset);
+                bytes += offset;
+                offset = 0;
+            }
+        }
+
+        bytes += offset;
+        buffer.erase(0, offset);
+
+        return ok;
+    }
+
+private:
+    bool fill()
+    {
+        char data[65536];
+        ssize_t read_len = recv(client.fd, data, sizeof(data), 0);
+
+        if (read_len <= 0)
+        {
+            return false;
+        }
+
+        buffer.append(data, static_cast<size_t>(read_len));
+        return true;
+    }
+
+    bool need(size_t size)
+    {
+        while (buffer.size() < size)
+        {
+            if (!fill())
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    TestClient client;
+    std::string buffer;
+};
+
+
+/*!
+ * @brief
+ *   Get percentile of sorted values.
+ */
+static double percentile(const std::vector<double> &sorted, double fraction)
+{
+    if (sorted.empty())
+    {
+        return 0.0;
+    }
+
+    size_t index = static_cast<size_t>(fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+
+/*!
+ * @brief
+ *   Get station ID of a station number.
+ */
+static std::string station_id(int station)
+{
+    return "station" + std::to_string(station);
+}
+
+
+/*!
+ * @brief
+ *   Fill the store with samples of every station up to now.
+ *
+ * @return
+ *   Number of samples.
+ */
+static size_t fill_fleet(Store &store, const Settings &settings, int64_t now_s)
+{
+    int64_t count = settings.years * YEAR_S / settings.interval_s;
+    size_t samples = 0;
+
+    for (int station = 0; station < settings.stations; station++)
+    {
+        std::string id = station_id(station);
+
+        for (int64_t i = 0; i < count; i++)
+        {
+            int64_t time_s = now_s - (count - i) * settings.interval_s;
+            int64_t day_s = time_s % 86400;
+            Sample sample = {time_s, 10.0f + station % 10 + (day_s < 43200 ? day_s : 86400 - day_s) / 4320.0f,
+                             static_cast<int>(40 + (i + station) % 40), 0};
+            samples += (store.append(id, sample) == StationShard::APPENDED) ? 1 : 0;
+        }
+    }
+
+    return samples;
+}
+
+
+/*!
+ * @brief
+ *   Get target of a request of a workload.
+ *
+ * @param workload (IN)
+ *   Workload name, "mixed" takes the workloads in turn.
+ *
+ * @param index (IN)
+ *   Number of the request.
+ */
+static std::string workload_target(const std::string &workload, int index, const Settings &settings, int64_t now_s)
+{
+    static const char *const MIX[] = {"last", "range", "rollup", "graph", "export"};
+    std::string kind = (workload.compare(0, 5, "mixed") == 0) ? MIX[index % 5] : workload;
+    std::string station = station_id(index % settings.stations);
+
+    if (kind == "last")
+    {
+        return "/query?station=" + station + "&last=100";
+    }
+
+    if (kind == "range")
+    {
+        return "/query?station=" + station + "&from=" + std::to_string(now_s - 86400);
+    }
+
+    if (kind == "rollup")
+    {
+        return "/query?step=3600&from=" + std::to_string(now_s - 7 * 86400);
+    }
+
+    if (kind == "graph")
+    {
+        int64_t span_s = std::min<int64_t>(YEAR_S, settings.years * YEAR_S);
+        return "/query?station=" + station + "&from=" + std::to_string(now_s - span_s) +
+               "&step=" + std::to_string(span_s / GRAPH_POINTS);
+    }
+
+    return "/export?format=columns&station=" + station + "&from=" + std::to_string(now_s - 30 * 86400);
+}
+
+
+/*!
+ * @brief
+ *   Run a workload from the client threads.
+ *
+ * @param port (IN)
+ *   Collector port.
+ *
+ * @param workload (IN)
+ *   Workload name.
+ *
+ * @param settings (IN)
+ *   Benchmark settings.
+ *
+ * @param now_s (IN)
+ *   End of the history.
+ *
+ * @param ingest (OUT)
+ *   Latencies of posts during the workload, nullptr for no ingest.
+ *
+ * @return
+ *   Latencies of all requests.
+ */
+static WorkloadResult run_workload(int port, const std::string &workload, const Settings &settings, int64_t now_s,
+                                   WorkloadResult *ingest)
+{
+    std::vector<WorkloadResult> results(static_cast<size_t>(settings.clients));
+    std::vector<std::thread> threads;
+    std::atomic<int> running(settings.clients);
+    auto start = Clock::now();
+
+    for (int client = 0; client < settings.clients; client++)
+    {
+        threads.emplace_back([&, client]() {
+            BenchClient http(port);
+            WorkloadResult &result = results[static_cast<size_t>(client)];
+
+            for (int i = 0; i < settings.requests; i++)
+            {
+                std::string target = workload_target(workload, client * settings.requests + i, settings, now_s);
+                auto sent = Clock::now();
+                result.failures += http.request("GET", target, "", result.bytes) ? 0 : 1;
+                result.latencies_us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - sent).count());
+            }
+
+            running--;
+        });
+    }
+
+    if (ingest != nullptr)
+    {
+        // One station posts as fast as it is answered until the clients are done
+        BenchClient http(port);
+        auto ingest_start = Clock::now();
+
+        for (uint32_t sequence = 1; running > 0; sequence++)
+        {
+            std::string body = "Station=" + station_id(static_cast<int>(sequence) % settings.stations) +
+                               "&Temperature=21.5&Humidity=40";
+            auto sent = Clock::now();
+            ingest->failures += http.request("POST", "/collect.php", body, ingest->bytes) ? 0 : 1;
+            ingest->latencies_us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - sent).count());
+        }
+
+        ingest->elapsed_s = std::chrono::duration<double>(Clock::now() - ingest_start).count();
+    }
+
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    WorkloadResult total = {{}, std::chrono::duration<double>(Clock::now() - start).count(), 0, 0};
+
+    for (const WorkloadResult &result : results)
+    {
+        total.latencies_us.insert(total.latencies_us.end(), result.latencies_us.begin(), result.latencies_us.end());
+        total.bytes += result.bytes;
+        total.failures += result.failures;
+    }
+
+    return total;
+}
+
+
+/*!
+ * @brief
+ *   Print the results of a workload and keep them for the baseline check.
+ */
+static void report(const std::string &name, WorkloadResult &result, std::map<std::string, double> &values)
+{
+    std::sort(result.latencies_us.begin(), result.latencies_us.end());
+    values[name + "_p50_us"] = percentile(result.latencies_us, 0.5);
+    values[name + "_p99_us"] = percentile(result.latencies_us, 0.99);
+    values[name + "_p999_us"] = percentile(result.latencies_us, 0.999);
+    values[name + "_max_us"] = result.latencies_us.empty() ? 0.0 : result.latencies_us.back();
+    values[name + "_requests_per_s"] = static_cast<double>(result.latencies_us.size()) / result.elapsed_s;
+    values[name + "_failures"] = static_cast<double>(result.failures);
+
+    for (const char *key : {"_p50_us", "_p99_us", "_p999_us", "_max_us"})
+    {
+        printf("%s%s %.0f\n", name.c_str(), key, values[name + key]);
+    }
+
+    printf("%s_requests_per_s %.1f\n", name.c_str(), values[name + "_requests_per_s"]);
+    printf("%s_mb_per_s %.2f\n", name.c_str(), static_cast<double>(result.bytes) / result.elapsed_s / 1e6);
+    printf("%s_failures %zu\n", name.c_str(), result.failures);
+}
+
+
+/*!
+ * @brief
+ *   Check results against a baseline.
+ *   Each baseline line is "key limit". Keys ending in _per_s are rates and
+ *   the limit is their minimum, other limits are maximums.
+ *
+ * @return
+ *   True if the baseline was read and all results are within it, false
+ *   otherwise.
+ */
+static bool check_baseline(const std::string &path, const std::map<std::string, double> &values)
+{
+    std::ifstream file(path);
+    std::string key;
+    double limit;
+    bool ok = static_cast<bool>(file);
+
+    while (file >> key >> limit)
+    {
+        auto value = values.find(key);
+        bool rate = (key.size() > 6) && (key.compare(key.size() - 6, 6, "_per_s") == 0);
+
+        if (value == values.end())
+        {
+            fprintf(stderr, "Baseline key %s not measured\n", key.c_str());
+            ok = false;
+        }
+        else if (rate ? (value->second < limit) : (value->second > limit))
+        {
+            fprintf(stderr, "Regression %s %.1f, limit %.1f\n", key.c_str(), value->second, limit);
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+
+int main(int argc, char *argv[])
+{
+    Settings settings = {20, 1, 600, 4, 200};
+    std::string baseline;
+    int option;
+
+    while ((option = getopt(argc, argv, "s:y:i:c:n:b:")) != -1)
+    {
+        switch (option)
+        {
+            case 's':
+                settings.stations = atoi(optarg);
+                break;
+            case 'y':
+                settings.years = atoi(optarg);
+                break;
+            case 'i':
+                settings.interval_s = atoi(optarg);
+                break;
+            case 'c':
+                settings.clients = atoi(optarg);
+                break;
+            case 'n':
+                settings.requests = atoi(optarg);
+                break;
+            case 'b':
+                baseline = optarg;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-s stations] [-y years] [-i interval_s] [-c clients] [-n requests] "
+                        "[-b baseline]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if ((settings.stations < 1) || (settings.years < 1) || (settings.interval_s < 1) || (settings.clients < 1) ||
+        (settings.requests < 1))
+    {
+        fprintf(stderr, "Need 1 or more stations, years, interval seconds, clients and requests\n");
+        return EXIT_FAILURE;
+    }
+
+    TestCollector collector(make_test_dir());
+    int64_t now_s = time(nullptr);
+    auto fill_start = Clock::now();
+    size_t samples = fill_fleet(collector.store, settings, now_s);
+    double fill_s = std::chrono::duration<double>(Clock::now() - fill_start).count();
+
+    printf("stations %d\n", settings.stations);
+    printf("years %d\n", settings.years);
+    printf("interval_s %d\n", settings.interval_s);
+    printf("samples %zu\n", samples);
+    printf("fill_samples_per_s %.0f\n", static_cast<double>(samples) / fill_s);
+    printf("clients %d\n", settings.clients);
+    printf("requests_per_client %d\n", settings.requests);
+
+    std::map<std::string, double> values;
+
+    for (const char *workload : {"last", "range", "rollup", "graph", "export", "mixed"})
+    {
+        WorkloadResult result = run_workload(collector.port(), workload, settings, now_s, nullptr);
+        report(workload, result, values);
+    }
+
+    WorkloadResult ingest = {{}, 0.0, 0, 0};
+    WorkloadResult result = run_workload(collector.port(), "mixed_ingest", settings, now_s, &ingest);
+    report("mixed_ingest", result, values);
+    report("ingest", ingest, values);
+
+    if (!baseline.empty() && !check_baseline(baseline, values))
+    {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,165 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Benchmark of the derived metric kernels.
+ *
+ * Computes dew point, absolute humidity and heat index over columns of
+ * random temperatures and humidities in the sensors' range with the
+ * kernels and with the scalar reference functions, and reports per metric
+ * the throughput of both and the largest difference.
+ *
+ * Usage: bench_derived [-n samples] [-r rounds]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include <unistd.h>
+#include "derived.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/*! Kernel over a series */
+typedef void (*Kernel)(const float *temperature, const float *humidity, size_t count, float *result);
+
+/*! Scalar reference of one sample */
+typedef double (*Reference)(double temperature, double humidity);
+
+
+/*!
+ * @brief
+ *   Time a metric with its kernel and its reference and print the results.
+ *
+ * @param name (IN)
+ *   Metric name.
+ *
+ * @param kernel (IN)
+ *   Kernel.
+ *
+ * @param reference (IN)
+ *   Scalar reference.
+ *
+ * @param temperature (IN)
+ *   Temperature column.
+ *
+ * @param humidity (IN)
+ *   Humidity column.
+ *
+ * @param rounds (IN)
+ *   Number of passes over the columns.
+ *
+ * @param relative (IN)
+ *   True to report relative difference, false for absolute.
+ */
+static void run_metric(const char *name, Kernel kernel, Reference reference, const std::vector<float> &temperature,
+                       const std::vector<float> &humidity, int rounds, bool relative)
+{
+    size_t count = temperature.size();
+    std::vector<float> fast(count);
+    std::vector<float> scalar(count);
+
+    auto start = Clock::now();
+
+    for (int round = 0; round < rounds; round++)
+    {
+        kernel(temperature.data(), humidity.data(), count, fast.data());
+    }
+
+    double kernel_s = std::chrono::duration<double>(Clock::now() - start).count();
+    start = Clock::now();
+
+    for (int round = 0; round < rounds; round++)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            scalar[i] = static_cast<float>(reference(temperature[i], humidity[i]));
+        }
+    }
+
+    double reference_s = std::chrono::duration<double>(Clock::now() - start).count();
+    double max_error = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        double exact = reference(temperature[i], humidity[i]);
+        double error = std::fabs(fast[i] - exact);
+        max_error = std::max(max_error, (relative && (exact > 0)) ? error / exact : error);
+    }
+
+    double samples = static_cast<double>(count) * rounds;
+    printf("%s_kernel_msamples_per_s %.1f\n", name, samples / kernel_s / 1e6);
+    printf("%s_reference_msamples_per_s %.1f\n", name, samples / reference_s / 1e6);
+    printf("%s_speedup %.2f\n", name, reference_s / kernel_s);
+    printf("%s_max_%s_error %.3g\n", name, relative ? "relative" : "abs", max_error);
+}
+
+
+int main(int argc, char *argv[])
+{
+    size_t count = 1000000;
+    int rounds = 20;
+    int option;
+
+    while ((option = getopt(argc, argv, "n:r:")) != -1)
+    {
+        switch (option)
+        {
+            case 'n':
+                count = strtoul(optarg, nullptr, 10);
+                break;
+            case 'r':
+                rounds = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-n samples] [-r rounds]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    // DHT22 range: -40 to 80 C, 0 to 100 %
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> temperatures(-40.0f, 80.0f);
+    std::uniform_int_distribution<int> humidities(0, 100);
+    std::vector<float> temperature(count);
+    std::vector<float> humidity(count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        temperature[i] = temperatures(random);
+        humidity[i] = static_cast<float>(humidities(random));
+    }
+
+    printf("samples %zu\n", count);
+    run_metric("dew_point", dew_point_series, dew_point_reference, temperature, humidity, rounds, false);
+    run_metric("absolute_humidity", absolute_humidity_series, absolute_humidity_reference, temperature, humidity,
+               rounds, true);
+    run_metric("heat_index", heat_index_series, heat_index_reference, temperature, humidity, rounds, false);
+
+    return EXIT_SUCCESS;
+}
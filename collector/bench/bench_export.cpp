@@ -0,0 +1,169 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Benchmark of bulk export over loopback.
+ *
+ * Fills a station with a history of samples at one minute intervals and
+ * exports all of it from a loopback collector in each format, reading the
+ * response as fast as the socket delivers it. Reports per format the bytes
+ * and samples per second and the growth of the process' peak resident
+ * memory during the exports, which stays flat as the body is formatted
+ * while the client reads.
+ *
+ * Usage: bench_export [-n samples] [-r repeats]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/resource.h>
+#include <unistd.h>
+#include "test_client.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/*! Sample interval of the history */
+static const int64_t INTERVAL_S = 60;
+
+
+/*!
+ * @brief
+ *   Get peak resident memory of the process.
+ *
+ * @return
+ *   Peak resident memory in kB.
+ */
+static long peak_rss_kb()
+{
+    rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+
+    return usage.ru_maxrss;
+}
+
+
+/*!
+ * @brief
+ *   Export a whole station and discard the response.
+ *
+ * @param port (IN)
+ *   Collector port.
+ *
+ * @param format (IN)
+ *   Value of the format field.
+ *
+ * @param bytes (OUT)
+ *   Bytes received with headers and chunk framing.
+ *
+ * @return
+ *   True if the response was complete, false otherwise.
+ */
+static bool export_once(int port, const char *format, size_t &bytes)
+{
+    TestClient client(port);
+    std::string request = std::string("GET /export?station=attic&format=") + format +
+                          " HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+
+    if (!client.connected || !client.send_text(request))
+    {
+        return false;
+    }
+
+    static char buffer[256 * 1024];
+    std::string tail;
+    ssize_t read_len;
+    bytes = 0;
+
+    while ((read_len = recv(client.fd, buffer, sizeof(buffer), 0)) > 0)
+    {
+        bytes += static_cast<size_t>(read_len);
+        tail.append(buffer, static_cast<size_t>(read_len));
+        tail.erase(0, (tail.size() > 7) ? tail.size() - 7 : 0);
+    }
+
+    return tail == "\r\n0\r\n\r\n";
+}
+
+
+int main(int argc, char *argv[])
+{
+    int samples = 2000000;
+    int repeats = 3;
+    int option;
+
+    while ((option = getopt(argc, argv, "n:r:")) != -1)
+    {
+        switch (option)
+        {
+            case 'n':
+                samples = atoi(optarg);
+                break;
+            case 'r':
+                repeats = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-n samples] [-r repeats]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    TestCollector collector(make_test_dir());
+
+    for (int i = 0; i < samples; i++)
+    {
+        Sample sample = {1559390400 + i * INTERVAL_S, 15.0f + (i % 300) / 10.0f, 30 + i % 60,
+                         static_cast<uint32_t>(i + 1)};
+        collector.store.append("attic", sample);
+    }
+
+    printf("samples %d\n", samples);
+    printf("repeats %d\n", repeats);
+
+    for (const char *format : {"csv", "columns"})
+    {
+        long rss_before_kb = peak_rss_kb();
+        size_t bytes = 0;
+        auto start = Clock::now();
+
+        for (int repeat = 0; repeat < repeats; repeat++)
+        {
+            if (!export_once(collector.port(), format, bytes))
+            {
+                fprintf(stderr, "%s export failed\n", format);
+                return EXIT_FAILURE;
+            }
+        }
+
+        double elapsed_s = std::chrono::duration<double>(Clock::now() - start).count();
+        printf("%s_bytes %zu\n", format, bytes);
+        printf("%s_bytes_per_sample %.2f\n", format, static_cast<double>(bytes) / samples);
+        printf("%s_mb_per_s %.1f\n", format, static_cast<double>(bytes) * repeats / elapsed_s / 1e6);
+        printf("%s_samples_per_s %.0f\n", format, static_cast<double>(samples) * repeats / elapsed_s);
+        printf("%s_peak_rss_growth_kb %ld\n", format, peak_rss_kb() - rss_before_kb);
+    }
+
+    return EXIT_SUCCESS;
+}
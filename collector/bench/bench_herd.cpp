@@ -0,0 +1,266 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+
+/*! @file
+ * Simulation of a station fleet against an overloaded collector.
+ *
+ * All stations are powered on within BOOT_SPREAD_S of each other, as after
+ * a power cut, and the collector answers at most a given number of wakes
+ * per second; the rest time out. Halfway through, the collector is down
+ * for OUTAGE_S. The fleet runs in virtual time with two behaviours:
+ *
+ * - legacy: stations retry a failed upload at once, up to
+ *   NUM_MEASUREMENT_RETRIES times, and keep the phase they were powered on
+ *   in.
+ * - spread: the collector gives each station an upload slot and turns away
+ *   wakes over 80% of its capacity with Retry-After. Stations wait the time
+ *   asked, in deep sleep if longer than RETRY_WAIT_MAX_S, and retry with a
+ *   jittered exponential backoff without it, as weather_main.cpp does.
+ *
+ * Reports for each the peak and 99th percentile of wakes per second
+ * reaching the collector, the peak after the first interval when the
+ * stations have settled, and the wakes that ended without an upload.
+ *
+ * Usage: bench_herd [-n stations] [-c wakes_per_s] [-t hours]
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "upload_schedule.h"
+
+/*! Measurement interval of the stations in seconds */
+static const int INTERVAL_S = 600;
+
+/*! Stations power on within this many seconds of each other */
+static const double BOOT_SPREAD_S = 5;
+
+/*! Time for a station to give up on a request that is not answered */
+static const double TIMEOUT_S = 5;
+
+/*! Time for a station to find the collector down, connection refused */
+static const double REFUSED_S = 0.1;
+
+/*! Length of the collector outage in seconds */
+static const double OUTAGE_S = 120;
+
+/*! Share of the collector capacity admitted by the upload limiter */
+static const double LIMITER_SHARE = 0.8;
+
+/*! Station retry behaviour of weather_main.cpp */
+static const int NUM_MEASUREMENT_RETRIES = 3;
+static const double RETRY_BACKOFF_S = 2;
+static const int RETRY_WAIT_MAX_S = 10;
+
+/*! An upload attempt of a station */
+struct Attempt
+{
+    double time_s;
+    double wake_s;
+    int station;
+    int retry;
+
+    bool operator>(const Attempt &other) const
+    {
+        return time_s > other.time_s;
+    }
+};
+
+/*! Result of one behaviour */
+struct HerdResult
+{
+    int peak_rps;
+    int settled_peak_rps;
+    int p99_rps;
+    size_t uploads;
+    size_t failed;
+};
+
+
+/*!
+ * @brief
+ *   Run the fleet with one behaviour.
+ *
+ * @param stations (IN)
+ *   Number of stations.
+ *
+ * @param capacity (IN)
+ *   Wakes per second the collector answers.
+ *
+ * @param duration_s (IN)
+ *   Length of the run.
+ *
+ * @param spread (IN)
+ *   True for upload slots, Retry-After and backoff, false for legacy.
+ *
+ * @return
+ *   Load and uploads of the run.
+ */
+static HerdResult run_herd(int stations, int capacity, double duration_s, bool spread)
+{
+    std::mt19937 random(1);
+    std::uniform_real_distribution<double> unit(0, 1);
+    UploadSlots slots;
+    UploadLimiter limiter(capacity * LIMITER_SHARE);
+    std::vector<int> arrivals(static_cast<size_t>(duration_s) + 1);
+    std::vector<int> answered(arrivals.size());
+    std::priority_queue<Attempt, std::vector<Attempt>, std::greater<Attempt>> attempts;
+    double outage_start_s = duration_s / 2;
+    HerdResult result = {};
+
+    for (int station = 0; station < stations; station++)
+    {
+        double boot_s = unit(random) * BOOT_SPREAD_S;
+        attempts.push({boot_s, boot_s, station, 0});
+    }
+
+    while (!attempts.empty() && (attempts.top().time_s < duration_s))
+    {
+        Attempt attempt = attempts.top();
+        attempts.pop();
+        size_t second = static_cast<size_t>(attempt.time_s);
+        std::string station_id = "station" + std::to_string(attempt.station);
+        arrivals[second]++;
+
+        int retry_after_s = 0;
+        double failed_after_s = 0;
+        bool down = (attempt.time_s >= outage_start_s) && (attempt.time_s < outage_start_s + OUTAGE_S);
+
+        if (down)
+        {
+            failed_after_s = REFUSED_S;
+        }
+        else if (spread && !limiter.admit(attempt.time_s, retry_after_s))
+        {
+            failed_after_s = REFUSED_S;
+        }
+        else if (answered[second] >= capacity)
+        {
+            failed_after_s = TIMEOUT_S;
+        }
+        else
+        {
+            answered[second]++;
+            result.uploads++;
+            int offset_s = spread ? slots.offset_s(station_id, INTERVAL_S,
+                                                   static_cast<int64_t>(attempt.time_s)) : 0;
+            double next_s = attempt.wake_s + INTERVAL_S + offset_s;
+            attempts.push({next_s, next_s, attempt.station, 0});
+            continue;
+        }
+
+        // A long wait is slept through and starts a new wake
+        if (retry_after_s > RETRY_WAIT_MAX_S)
+        {
+            double next_s = attempt.time_s + failed_after_s + retry_after_s;
+            attempts.push({next_s, next_s, attempt.station, 0});
+            continue;
+        }
+
+        if (attempt.retry + 1 >= NUM_MEASUREMENT_RETRIES)
+        {
+            result.failed++;
+            attempts.push({attempt.wake_s + INTERVAL_S, attempt.wake_s + INTERVAL_S, attempt.station, 0});
+            continue;
+        }
+
+        double wait_s = 0;
+
+        if (spread)
+        {
+            double backoff_s = RETRY_BACKOFF_S * (1 << attempt.retry);
+            wait_s = (retry_after_s > 0) ? retry_after_s : backoff_s * (0.5 + unit(random));
+        }
+
+        attempts.push({attempt.time_s + failed_after_s + wait_s, attempt.wake_s, attempt.station, attempt.retry + 1});
+    }
+
+    result.settled_peak_rps = *std::max_element(arrivals.begin() + std::min<size_t>(INTERVAL_S, arrivals.size() - 1),
+                                                arrivals.end());
+    std::vector<int> sorted = arrivals;
+    std::sort(sorted.begin(), sorted.end());
+    result.peak_rps = sorted.back();
+    result.p99_rps = sorted[sorted.size() * 99 / 100];
+
+    return result;
+}
+
+
+int main(int argc, char *argv[])
+{
+    int stations = 1000;
+    int capacity = 10;
+    double hours = 6;
+    int option;
+
+    while ((option = getopt(argc, argv, "n:c:t:")) != -1)
+    {
+        switch (option)
+        {
+            case 'n':
+                stations = atoi(optarg);
+                break;
+            case 'c':
+                capacity = atoi(optarg);
+                break;
+            case 't':
+                hours = atof(optarg);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-n stations] [-c wakes_per_s] [-t hours]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if ((stations <= 0) || (capacity <= 0) || (hours <= 0))
+    {
+        fprintf(stderr, "Stations, capacity and hours must be positive\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("stations %d\n", stations);
+    printf("interval_s %d\n", INTERVAL_S);
+    printf("capacity_wakes_per_s %d\n", capacity);
+    printf("mean_wakes_per_s %.2f\n", static_cast<double>(stations) / INTERVAL_S);
+
+    for (bool spread : {false, true})
+    {
+        const char *name = spread ? "spread" : "legacy";
+        HerdResult result = run_herd(stations, capacity, hours * 3600, spread);
+        printf("%s_peak_wakes_per_s %d\n", name, result.peak_rps);
+        printf("%s_settled_peak_wakes_per_s %d\n", name, result.settled_peak_rps);
+        printf("%s_p99_wakes_per_s %d\n", name, result.p99_rps);
+        printf("%s_uploads %zu\n", name, result.uploads);
+        printf("%s_failed_wakes %zu\n", name, result.failed);
+    }
+
+    return EXIT_SUCCESS;
+}
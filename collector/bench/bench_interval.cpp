@@ -0,0 +1,404 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Replay of the adaptive measurement interval against fixed intervals.
+ *
+ * Takes a temperature history on a one minute grid, simulated or from a
+ * station in the store, and replays it as a station would upload it: with
+ * the adaptive interval of the collector, and with every fixed interval up
+ * to the maximum. Between uploads the temperature is read as the straight
+ * line between them, as weather.php draws it, and the error against the
+ * history is measured after the first day. Reports the wakes of the
+ * adaptive interval and of the longest fixed interval with no more RMS
+ * error.
+ *
+ * The simulated histories are a week of an outdoor station, with the day
+ * cycle, a fast rise at sunrise, passing fronts and clouds, and of an
+ * indoor station heated in the morning and evening and held by a
+ * thermostat. A station from the store is interpolated between its
+ * samples, so its history has no detail shorter than its own interval.
+ *
+ * Usage: bench_interval [-i min:max:error] [-n days] [-d data_dir -s station]
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "adaptive_interval.h"
+#include "store.h"
+
+/*! Minutes of history before the errors are measured */
+static const size_t WARMUP_MIN = 24 * 60;
+
+/*! Replay result of one interval policy */
+struct Replay
+{
+    size_t wakes;
+    double rms_error;
+    double max_error;
+};
+
+
+/*!
+ * @brief
+ *   Round to the 0.1 degree resolution of the sensors.
+ */
+static float quantize(double temperature)
+{
+    return static_cast<float>(round(temperature * 10) / 10);
+}
+
+
+/*!
+ * @brief
+ *   Simulate an outdoor station: day cycle, sunrise warming, fronts.
+ *
+ * @param days (IN)
+ *   Length of history.
+ *
+ * @return
+ *   Temperature of every minute.
+ */
+static std::vector<float> simulate_outdoor(int days)
+{
+    std::mt19937 random(1);
+    std::normal_distribution<double> front(0.0, 1.0);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<float> history;
+    double weather = 0;
+    double shade = 0;
+    int cloud_minutes = 0;
+
+    for (int minute = 0; minute < days * 24 * 60; minute++)
+    {
+        double hour = (minute % (24 * 60)) / 60.0;
+        double day_cycle = 5 * sin(2 * M_PI * (hour - 9) / 24);
+        double sunrise = 3 / (1 + exp(-(hour - 7) * 3)) - 3 / (1 + exp(-(hour - 19) * 1.5));
+
+        // Fronts move the level by a few degrees over hours
+        weather = 0.9995 * weather + 0.02 * front(random);
+
+        // Clouds passing in daylight shade the sun for minutes at a time
+        if ((cloud_minutes == 0) && (hour > 8) && (hour < 17) && (uniform(random) < 0.01))
+        {
+            cloud_minutes = 5 + static_cast<int>(uniform(random) * 30);
+        }
+
+        cloud_minutes = (cloud_minutes > 0) ? cloud_minutes - 1 : 0;
+        shade += ((cloud_minutes > 0) ? -1.5 - shade : -shade) / 8;
+        history.push_back(static_cast<float>(8 + day_cycle + sunrise + weather + shade));
+    }
+
+    for (float &temperature : history)
+    {
+        temperature = quantize(temperature);
+    }
+
+    return history;
+}
+
+
+/*!
+ * @brief
+ *   Simulate an indoor station: thermostat cycles of the heating in the
+ *   morning and evening, slow cooling with the heating off.
+ *
+ * @param days (IN)
+ *   Length of history.
+ *
+ * @return
+ *   Temperature of every minute.
+ */
+static std::vector<float> simulate_indoor(int days)
+{
+    std::vector<float> history;
+    double temperature = 20;
+    bool heating = false;
+
+    for (int minute = 0; minute < days * 24 * 60; minute++)
+    {
+        double hour = (minute % (24 * 60)) / 60.0;
+        bool heating_hours = ((hour >= 6) && (hour < 9)) || ((hour >= 17) && (hour < 22));
+
+        // Radiators warm the room towards 24 degrees and their thermostat
+        // holds 21.5 within 0.2 degrees; unheated the room cools towards 16
+        heating = heating_hours && (heating ? (temperature < 21.7) : (temperature < 21.3));
+        temperature += heating ? (24 - temperature) / 20 : (16 - temperature) / 300;
+        history.push_back(quantize(temperature));
+    }
+
+    return history;
+}
+
+
+/*!
+ * @brief
+ *   Read a station's history from the store, interpolated to minutes.
+ *
+ * @param data_dir (IN)
+ *   Collector data directory.
+ *
+ * @param station_id (IN)
+ *   Station ID.
+ *
+ * @param history (OUT)
+ *   Temperature of every minute.
+ *
+ * @return
+ *   True if the station has at least two samples, false otherwise.
+ */
+static bool read_station(const std::string &data_dir, const std::string &station_id, std::vector<float> &history)
+{
+    Store store(data_dir + "/stations");
+    StationShard *shard = store.open() ? store.find(station_id) : nullptr;
+
+    if ((shard == nullptr) || (shard->size() < 2))
+    {
+        return false;
+    }
+
+    ShardView view(*shard);
+    int64_t start_s = view.at(0).time_s;
+
+    for (size_t i = 1; i < view.size(); i++)
+    {
+        Sample from = view.at(i - 1);
+        Sample to = view.at(i);
+
+        for (int64_t t = start_s + static_cast<int64_t>(history.size()) * 60; t < to.time_s; t += 60)
+        {
+            double weight = static_cast<double>(t - from.time_s) / static_cast<double>(to.time_s - from.time_s);
+            history.push_back(static_cast<float>(from.temperature + weight * (to.temperature - from.temperature)));
+        }
+    }
+
+    return history.size() >= 2;
+}
+
+
+/*!
+ * @brief
+ *   Measure the error of reading the history as straight lines between
+ *   upload minutes.
+ *
+ * @param history (IN)
+ *   Temperature of every minute.
+ *
+ * @param wakes (IN)
+ *   Upload minutes, increasing, starting at 0.
+ *
+ * @param start (IN)
+ *   First minute measured, earlier wakes and errors are not counted.
+ *
+ * @return
+ *   Wake count and errors.
+ */
+static Replay reconstruct(const std::vector<float> &history, const std::vector<size_t> &wakes, size_t start)
+{
+    Replay replay = {0, 0, 0};
+    double sum = 0;
+
+    for (size_t w = 0; w < wakes.size(); w++)
+    {
+        size_t from = wakes[w];
+        size_t to = (w + 1 < wakes.size()) ? wakes[w + 1] : history.size() - 1;
+        replay.wakes += (from >= start) ? 1 : 0;
+
+        for (size_t minute = std::max(from, start); minute < to; minute++)
+        {
+            double weight = static_cast<double>(minute - from) / static_cast<double>(to - from);
+            double error = std::fabs(history[from] + weight * (history[to] - history[from]) - history[minute]);
+            sum += error * error;
+            replay.max_error = std::max(replay.max_error, error);
+        }
+    }
+
+    replay.rms_error = sqrt(sum / static_cast<double>(history.size() - start));
+
+    return replay;
+}
+
+
+/*!
+ * @brief
+ *   Replay the history with the adaptive interval.
+ */
+static Replay replay_adaptive(const std::vector<float> &history, const IntervalSettings &settings, size_t start)
+{
+    IntervalState state;
+    interval_reset(settings, state);
+    std::vector<size_t> wakes;
+
+    for (size_t minute = 0; minute < history.size(); minute += static_cast<size_t>(state.interval_min))
+    {
+        Sample sample = {static_cast<int64_t>(minute) * 60, history[minute], 0, 0};
+        interval_update(settings, state, sample);
+        wakes.push_back(minute);
+    }
+
+    return reconstruct(history, wakes, start);
+}
+
+
+/*!
+ * @brief
+ *   Replay the history with a fixed interval.
+ */
+static Replay replay_fixed(const std::vector<float> &history, int interval_min, size_t start)
+{
+    std::vector<size_t> wakes;
+
+    for (size_t minute = 0; minute < history.size(); minute += static_cast<size_t>(interval_min))
+    {
+        wakes.push_back(minute);
+    }
+
+    return reconstruct(history, wakes, start);
+}
+
+
+/*!
+ * @brief
+ *   Replay a history and print the results.
+ *
+ * @param name (IN)
+ *   History name, the prefix of the results.
+ *
+ * @param history (IN)
+ *   Temperature of every minute.
+ *
+ * @param settings (IN)
+ *   Adaptive interval settings.
+ */
+static void bench_history(const char *name, const std::vector<float> &history, const IntervalSettings &settings)
+{
+    // The adaptive interval learns the day profile of a station on the
+    // first day, when the history is long enough to leave it out
+    size_t start = (history.size() >= 2 * WARMUP_MIN) ? WARMUP_MIN : 0;
+    Replay adaptive = replay_adaptive(history, settings, start);
+    int equal_interval = 0;
+    Replay fixed = {0, 0, 0};
+
+    for (int interval_min = 1; interval_min <= settings.max_min; interval_min++)
+    {
+        Replay replay = replay_fixed(history, interval_min, start);
+
+        if (replay.rms_error <= adaptive.rms_error)
+        {
+            equal_interval = interval_min;
+            fixed = replay;
+        }
+    }
+
+    printf("%s_minutes %zu\n", name, history.size() - start);
+    printf("%s_adaptive_wakes %zu\n", name, adaptive.wakes);
+    printf("%s_adaptive_rms_error %.3f\n", name, adaptive.rms_error);
+    printf("%s_adaptive_max_error %.2f\n", name, adaptive.max_error);
+    printf("%s_adaptive_mean_interval_min %.1f\n", name,
+           static_cast<double>(history.size() - start) / static_cast<double>(adaptive.wakes));
+
+    if (equal_interval == 0)
+    {
+        printf("%s_fixed_interval_min none\n", name);
+        return;
+    }
+
+    printf("%s_fixed_interval_min %d\n", name, equal_interval);
+    printf("%s_fixed_wakes %zu\n", name, fixed.wakes);
+    printf("%s_fixed_rms_error %.3f\n", name, fixed.rms_error);
+    printf("%s_fixed_max_error %.2f\n", name, fixed.max_error);
+    printf("%s_wakes_saved %.1f %%\n", name,
+           100.0 * (1.0 - static_cast<double>(adaptive.wakes) / static_cast<double>(fixed.wakes)));
+}
+
+
+int main(int argc, char *argv[])
+{
+    IntervalSettings settings = {1, 60, 0.2};
+    int days = 7;
+    std::string data_dir;
+    std::string station_id;
+    int option;
+
+    while ((option = getopt(argc, argv, "i:n:d:s:")) != -1)
+    {
+        switch (option)
+        {
+            case 'i':
+                if (!parse_interval_settings(optarg, settings))
+                {
+                    fprintf(stderr, "Invalid interval settings %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+
+                break;
+            case 'n':
+                days = atoi(optarg);
+                break;
+            case 'd':
+                data_dir = optarg;
+                break;
+            case 's':
+                station_id = optarg;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-i min:max:error] [-n days] [-d data_dir -s station]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    printf("interval_min %d\n", settings.min_min);
+    printf("interval_max %d\n", settings.max_min);
+    printf("error_c %.2f\n", settings.error_c);
+
+    if (!station_id.empty())
+    {
+        std::vector<float> history;
+
+        if (!read_station(data_dir, station_id, history))
+        {
+            fprintf(stderr, "No samples of %s in %s/stations\n", station_id.c_str(), data_dir.c_str());
+            return EXIT_FAILURE;
+        }
+
+        bench_history("station", history, settings);
+        return EXIT_SUCCESS;
+    }
+
+    if (days < 1)
+    {
+        fprintf(stderr, "Need 1 or more days\n");
+        return EXIT_FAILURE;
+    }
+
+    bench_history("outdoor", simulate_outdoor(days), settings);
+    bench_history("indoor", simulate_indoor(days), settings);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,366 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Benchmark of ingest under concurrent dashboard queries.
+ *
+ * Writer threads append samples of a fleet of stations with a history
+ * while query threads run what dashboards ask for: the last samples of a
+ * station, a day of a station's samples and the hourly means of all
+ * stations. Reports the append latency percentiles and the query rate in
+ * three modes:
+ *
+ * - ingest: writers alone.
+ * - snapshot: writers and queries, queries on store snapshots.
+ * - locked: writers and queries sharing one lock, like a store that
+ *   serialises readers and writers.
+ *
+ * Usage: bench_mixed [-s stations] [-d history_days] [-n appends] [-w writers] [-q queries]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "query.h"
+#include "store.h"
+#include "test_client.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/*! Sample interval of the history */
+static const int64_t INTERVAL_S = 60;
+
+/*! Benchmark mode */
+enum Mode
+{
+    INGEST,
+    SNAPSHOT,
+    LOCKED
+};
+
+/*! Benchmark settings */
+struct Settings
+{
+    int stations;
+    int history_days;
+    int appends;
+    int writers;
+    int queries;
+};
+
+/*! Result of one mode */
+struct MixedResult
+{
+    std::vector<double> append_us;
+    double appends_per_s;
+    double queries_per_s;
+};
+
+
+/*!
+ * @brief
+ *   Get percentile of sorted values.
+ */
+static double percentile(const std::vector<double> &sorted, double fraction)
+{
+    if (sorted.empty())
+    {
+        return 0.0;
+    }
+
+    size_t index = static_cast<size_t>(fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+
+/*!
+ * @brief
+ *   Get station ID of a station number.
+ */
+static std::string station_id(int station)
+{
+    return "station" + std::to_string(station);
+}
+
+
+/*!
+ * @brief
+ *   Make sample of a station at a time.
+ */
+static Sample make_sample(int station, int64_t time_s)
+{
+    Sample sample;
+    sample.time_s = time_s;
+    sample.temperature = static_cast<float>(15 + station % 10) + static_cast<float>(time_s % 86400) / 10000;
+    sample.humidity = 40 + static_cast<int>((time_s / INTERVAL_S + station) % 30);
+    sample.sequence = 0;
+
+    return sample;
+}
+
+
+/*!
+ * @brief
+ *   Run one of the dashboard queries.
+ *
+ * @param store (IN)
+ *   Sample store.
+ *
+ * @param settings (IN)
+ *   Benchmark settings.
+ *
+ * @param round (IN)
+ *   Query number, picks the query and station.
+ *
+ * @param end_s (IN)
+ *   End of the history.
+ *
+ * @return
+ *   Number of samples or buckets returned.
+ */
+static size_t run_dashboard_query(const Store &store, const Settings &settings, unsigned round, int64_t end_s)
+{
+    Query query;
+
+    switch (round % 3)
+    {
+        case 0:
+            query.station = station_id(static_cast<int>(round / 3 % static_cast<unsigned>(settings.stations)));
+            query.last = 100;
+            break;
+        case 1:
+            query.station = station_id(static_cast<int>(round / 3 % static_cast<unsigned>(settings.stations)));
+            query.from_s = end_s - 86400;
+            break;
+        default:
+            query.step_s = 3600;
+            query.from_s = end_s - 86400;
+            break;
+    }
+
+    return run_query(store, query).size();
+}
+
+
+/*!
+ * @brief
+ *   Fill a store with the history of the fleet.
+ *
+ * @return
+ *   Time after the last sample of the history.
+ */
+static int64_t fill_history(Store &store, const Settings &settings)
+{
+    int64_t samples = settings.history_days * 86400 / INTERVAL_S;
+
+    for (int station = 0; station < settings.stations; station++)
+    {
+        std::string id = station_id(station);
+
+        for (int64_t i = 0; i < samples; i++)
+        {
+            store.append(id, make_sample(station, i * INTERVAL_S));
+        }
+    }
+
+    return samples * INTERVAL_S;
+}
+
+
+/*!
+ * @brief
+ *   Append new samples with writer threads while query threads run
+ *   dashboard queries until the writers are done.
+ *
+ * @param settings (IN)
+ *   Benchmark settings.
+ *
+ * @param mode (IN)
+ *   Benchmark mode.
+ *
+ * @return
+ *   Append latencies and rates.
+ */
+static MixedResult run_mode(const Settings &settings, Mode mode)
+{
+    Store store(make_test_dir());
+    store.open();
+    int64_t end_s = fill_history(store, settings);
+
+    std::mutex lock;
+    std::atomic<bool> done(false);
+    std::atomic<unsigned> queries(0);
+    std::vector<std::vector<double>> latencies(static_cast<size_t>(settings.writers));
+    std::vector<std::thread> readers;
+    std::vector<std::thread> writers;
+
+    for (int q = 0; (mode != INGEST) && (q < settings.queries); q++)
+    {
+        readers.emplace_back([&, q]()
+        {
+            unsigned round = static_cast<unsigned>(q);
+
+            while (!done.load(std::memory_order_relaxed))
+            {
+                if (mode == LOCKED)
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    run_dashboard_query(store, settings, round, end_s);
+                }
+                else
+                {
+                    run_dashboard_query(store, settings, round, end_s);
+                }
+
+                round += static_cast<unsigned>(settings.queries);
+                queries++;
+            }
+        });
+    }
+
+    auto start = Clock::now();
+
+    for (int w = 0; w < settings.writers; w++)
+    {
+        writers.emplace_back([&, w]()
+        {
+            std::vector<double> &latency = latencies[static_cast<size_t>(w)];
+            latency.reserve(static_cast<size_t>(settings.appends));
+
+            // Each writer appends to its own stations, one new sample per station in turn
+            for (int i = 0; i < settings.appends; i++)
+            {
+                int station = w + (i * settings.writers) % settings.stations;
+                int64_t time_s = end_s + (i * settings.writers / settings.stations) * INTERVAL_S;
+                Sample sample = make_sample(station, time_s);
+                std::string id = station_id(station);
+                auto append_start = Clock::now();
+
+                if (mode == LOCKED)
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    store.append(id, sample);
+                }
+                else
+                {
+                    store.append(id, sample);
+                }
+
+                latency.push_back(std::chrono::duration<double, std::micro>(Clock::now() - append_start).count());
+            }
+        });
+    }
+
+    for (std::thread &writer : writers)
+    {
+        writer.join();
+    }
+
+    double elapsed_s = std::chrono::duration<double>(Clock::now() - start).count();
+    done = true;
+
+    for (std::thread &reader : readers)
+    {
+        reader.join();
+    }
+
+    MixedResult result;
+
+    for (const std::vector<double> &latency : latencies)
+    {
+        result.append_us.insert(result.append_us.end(), latency.begin(), latency.end());
+    }
+
+    std::sort(result.append_us.begin(), result.append_us.end());
+    result.appends_per_s = static_cast<double>(result.append_us.size()) / elapsed_s;
+    result.queries_per_s = queries / elapsed_s;
+
+    return result;
+}
+
+
+int main(int argc, char *argv[])
+{
+    Settings settings = {50, 7, 100000, 2, 4};
+    int option;
+
+    while ((option = getopt(argc, argv, "s:d:n:w:q:")) != -1)
+    {
+        switch (option)
+        {
+            case 's':
+                settings.stations = atoi(optarg);
+                break;
+            case 'd':
+                settings.history_days = atoi(optarg);
+                break;
+            case 'n':
+                settings.appends = atoi(optarg);
+                break;
+            case 'w':
+                settings.writers = atoi(optarg);
+                break;
+            case 'q':
+                settings.queries = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-s stations] [-d history_days] [-n appends] [-w writers] [-q queries]\n",
+                        argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if ((settings.stations < settings.writers) || (settings.writers < 1) || (settings.queries < 1))
+    {
+        fprintf(stderr, "Need at least one writer and query thread, and a station per writer\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("stations %d\n", settings.stations);
+    printf("history_days %d\n", settings.history_days);
+    printf("writers %d\n", settings.writers);
+    printf("query_threads %d\n", settings.queries);
+
+    const char *names[] = {"ingest", "snapshot", "locked"};
+
+    for (Mode mode : {INGEST, SNAPSHOT, LOCKED})
+    {
+        MixedResult result = run_mode(settings, mode);
+        printf("%s_append_us_p50 %.2f\n", names[mode], percentile(result.append_us, 0.50));
+        printf("%s_append_us_p99 %.2f\n", names[mode], percentile(result.append_us, 0.99));
+        printf("%s_append_us_p999 %.2f\n", names[mode], percentile(result.append_us, 0.999));
+        printf("%s_append_us_max %.2f\n", names[mode], result.append_us.empty() ? 0.0 : result.append_us.back());
+        printf("%s_appends_per_s %.0f\n", names[mode], result.appends_per_s);
+        printf("%s_queries_per_s %.0f\n", names[mode], result.queries_per_s);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,201 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Load generator for the dashboard event stream.
+ *
+ * Opens N idle /events subscribers, posts samples and measures how long it
+ * takes until every subscriber has the sample. Runs against an in-process
+ * collector, or against a running one with -p.
+ *
+ * Usage: bench_sse [-c clients] [-n samples] [-p port]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include "test_client.h"
+
+typedef std::chrono::steady_clock Clock;
+
+
+/*!
+ * @brief
+ *   Raise open file limit to the hard limit for thousands of sockets.
+ */
+static void raise_file_limit()
+{
+    rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+}
+
+
+/*!
+ * @brief
+ *   Get percentile of sorted values.
+ */
+static double percentile(const std::vector<double> &sorted, double fraction)
+{
+    if (sorted.empty())
+    {
+        return 0.0;
+    }
+
+    size_t index = static_cast<size_t>(fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+
+int main(int argc, char *argv[])
+{
+    int clients = 1000;
+    int samples = 20;
+    int port = 0;
+    int option;
+
+    while ((option = getopt(argc, argv, "c:n:p:")) != -1)
+    {
+        switch (option)
+        {
+            case 'c':
+                clients = atoi(optarg);
+                break;
+            case 'n':
+                samples = atoi(optarg);
+                break;
+            case 'p':
+                port = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-c clients] [-n samples] [-p port]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    raise_file_limit();
+    std::unique_ptr<TestCollector> local_collector;
+
+    if (port == 0)
+    {
+        local_collector.reset(new TestCollector(make_test_dir()));
+        port = local_collector->port();
+    }
+
+    std::vector<std::unique_ptr<TestClient>> subscribers;
+    int epoll_fd = epoll_create1(0);
+
+    for (int i = 0; i < clients; i++)
+    {
+        subscribers.emplace_back(new TestClient(port));
+        TestClient &client = *subscribers.back();
+
+        if (!client.connected)
+        {
+            fprintf(stderr, "Connection %d failed\n", i);
+            return EXIT_FAILURE;
+        }
+
+        client.send_text("GET /events HTTP/1.1\r\nHost: localhost\r\n\r\n");
+        client.receive_until("retry:");
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u32 = static_cast<uint32_t>(i);
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client.fd, &event);
+    }
+
+    std::vector<double> latencies_ms;
+    size_t event_bytes = 0;
+    auto bench_start = Clock::now();
+
+    for (int n = 0; n < samples; n++)
+    {
+        for (size_t i = 0; i < subscribers.size(); i++)
+        {
+            subscribers[i]->received.clear();
+        }
+
+        auto post_time = Clock::now();
+        http_request(port, "POST", "/collect.php", "Temperature=" + std::to_string(n) + ".0&Humidity=50");
+        int pending = clients;
+
+        while (pending > 0)
+        {
+            epoll_event events[256];
+            int count = epoll_wait(epoll_fd, events, 256, 5000);
+
+            if (count <= 0)
+            {
+                fprintf(stderr, "Timeout, %d subscribers did not get sample %d\n", pending, n);
+                return EXIT_FAILURE;
+            }
+
+            for (int e = 0; e < count; e++)
+            {
+                TestClient &client = *subscribers[events[e].data.u32];
+                char buffer[1024];
+                ssize_t read_len = recv(client.fd, buffer, sizeof(buffer), 0);
+
+                if (read_len <= 0)
+                {
+                    continue;
+                }
+
+                bool had_event = (client.received.find("\n\n") != std::string::npos);
+                client.received.append(buffer, static_cast<size_t>(read_len));
+
+                if (!had_event && (client.received.find("\n\n") != std::string::npos))
+                {
+                    latencies_ms.push_back(std::chrono::duration<double, std::milli>(
+                        Clock::now() - post_time).count());
+                    event_bytes += client.received.size();
+                    pending--;
+                }
+            }
+        }
+    }
+
+    double elapsed_s = std::chrono::duration<double>(Clock::now() - bench_start).count();
+    std::sort(latencies_ms.begin(), latencies_ms.end());
+
+    printf("clients %d\n", clients);
+    printf("samples %d\n", samples);
+    printf("deliveries_per_s %.0f\n", static_cast<double>(latencies_ms.size()) / elapsed_s);
+    printf("bytes_per_client_per_sample %.1f\n",
+           static_cast<double>(event_bytes) / static_cast<double>(latencies_ms.size()));
+    printf("fanout_latency_ms_p50 %.3f\n", percentile(latencies_ms, 0.50));
+    printf("fanout_latency_ms_p99 %.3f\n", percentile(latencies_ms, 0.99));
+    printf("fanout_latency_ms_max %.3f\n", latencies_ms.empty() ? 0.0 : latencies_ms.back());
+
+    close(epoll_fd);
+
+    return EXIT_SUCCESS;
+}
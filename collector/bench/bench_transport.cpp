@@ -0,0 +1,246 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Benchmark of the upload transports.
+ *
+ * Runs wake cycles of a station against a loopback collector with each
+ * transport: connect, get the measurement interval, send a sample and
+ * telemetry, disconnect. Reports per wake the application bytes, packets
+ * and round trips counted by the transport, and an estimate of bytes on
+ * air with the IPv4 and TCP or UDP headers. The HTTP client sends the
+ * request headers of esp_http_client over one keep-alive connection.
+ *
+ * Usage: bench_transport [-n wakes]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include "coap_transport.h"
+#include "mqtt_transport.h"
+#include "test_client.h"
+#include "transport_socket.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/*! IPv4 and TCP headers of a segment without options */
+static const int TCP_HEADER_BYTES = 40;
+
+/*! IPv4 and UDP headers of a datagram */
+static const int UDP_HEADER_BYTES = 28;
+
+/*! Segments without data to open and close a connection: SYN, SYN-ACK,
+ *  ACK, FIN, ACK, FIN, ACK */
+static const int TCP_CONTROL_SEGMENTS = 7;
+
+/*! The peer acknowledges a received segment with a pure ACK when it has
+ *  nothing to send back, about once for every response of the collector */
+static const int TCP_ACKS_PER_RESPONSE = 1;
+
+
+/*! HTTP/1.1 transport like the station's esp_http_client backend */
+class BenchHttpTransport : public Transport
+{
+public:
+    BenchHttpTransport(int server_port) : port(server_port), socket(traffic)
+    {
+    }
+
+    bool open()
+    {
+        return socket.open("127.0.0.1", port, false) && request("GET", "/interval.txt", "", interval_body);
+    }
+
+    void close()
+    {
+        socket.close();
+    }
+
+    bool get_config(std::string &config)
+    {
+        config = interval_body;
+        return !interval_body.empty();
+    }
+
+    bool send(Channel channel, const std::string &data)
+    {
+        std::string body;
+        return request("POST", (channel == TELEMETRY) ? "/telemetry" : "/collect.php", data, body);
+    }
+
+private:
+    bool request(const std::string &method, const std::string &path, const std::string &data, std::string &body)
+    {
+        std::string text = method + " " + path + " HTTP/1.1\r\nUser-Agent: ESP32 HTTP Client/1.0\r\nHost: 127.0.0.1:" +
+                           std::to_string(port) + "\r\n";
+
+        if (method == "POST")
+        {
+            text += "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: " +
+                    std::to_string(data.size()) + "\r\n";
+        }
+
+        if (!socket.send(text + "\r\n" + data))
+        {
+            return false;
+        }
+
+        traffic.round_trips++;
+        std::string response;
+        size_t header_end;
+
+        while ((header_end = response.find("\r\n\r\n")) == std::string::npos)
+        {
+            if (!socket.receive(response, CoapTransport::ACK_TIMEOUT_MS))
+            {
+                return false;
+            }
+        }
+
+        size_t length_at = response.find("Content-Length: ");
+        size_t length = (length_at < header_end) ? strtoul(response.c_str() + length_at + 16, nullptr, 10) : 0;
+
+        while (response.size() < header_end + 4 + length)
+        {
+            if (!socket.receive(response, CoapTransport::ACK_TIMEOUT_MS))
+            {
+                return false;
+            }
+        }
+
+        body = response.substr(header_end + 4, length);
+
+        return response.compare(0, 12, "HTTP/1.1 200") == 0;
+    }
+
+    int port;
+    TransportSocket socket;
+    std::string interval_body;
+};
+
+
+/*!
+ * @brief
+ *   Run wake cycles with a transport and print the cost of one wake.
+ *
+ * @param name (IN)
+ *   Transport name.
+ *
+ * @param transport (IN)
+ *   Transport to a running collector.
+ *
+ * @param wakes (IN)
+ *   Number of wake cycles.
+ *
+ * @param datagram (IN)
+ *   True if the transport sends UDP datagrams, false for TCP.
+ *
+ * @return
+ *   True if every wake uploaded, false otherwise.
+ */
+static bool run_wakes(const char *name, Transport &transport, int wakes, bool datagram)
+{
+    auto start = Clock::now();
+
+    for (int wake = 0; wake < wakes; wake++)
+    {
+        std::string config;
+        char sample[128];
+        snprintf(sample, sizeof(sample), "Station=240ac4123456&Temperature=%.1f&Humidity=%d&Sequence=%d",
+                 20.0 + (wake % 50) / 10.0, 40 + wake % 20, wake);
+        bool uploaded = transport.open() && transport.get_config(config) &&
+                        transport.send(Transport::SAMPLES, sample) &&
+                        transport.send(Transport::TELEMETRY, "Station=240ac4123456&RadioProfile=balanced"
+                                                             "&RadioOnMs=1830&TxPower=15.5&Rssi=-67");
+        transport.close();
+
+        if (!uploaded)
+        {
+            fprintf(stderr, "%s upload %d failed\n", name, wake);
+            return false;
+        }
+    }
+
+    double elapsed_s = std::chrono::duration<double>(Clock::now() - start).count();
+    TransportStats stats = transport.stats();
+    double count = wakes;
+    double bytes = stats.bytes_sent + stats.bytes_received;
+    double packets = stats.packets_sent + stats.packets_received;
+    double on_air = datagram ? bytes + packets * UDP_HEADER_BYTES
+                             : bytes + (packets + wakes * TCP_CONTROL_SEGMENTS +
+                                        stats.packets_received * TCP_ACKS_PER_RESPONSE) * TCP_HEADER_BYTES;
+
+    printf("%s_bytes_sent_per_wake %.1f\n", name, stats.bytes_sent / count);
+    printf("%s_bytes_received_per_wake %.1f\n", name, stats.bytes_received / count);
+    printf("%s_packets_per_wake %.1f\n", name, packets / count);
+    printf("%s_round_trips_per_wake %.1f\n", name, stats.round_trips / count);
+    printf("%s_on_air_bytes_per_wake %.1f\n", name, on_air / count);
+    printf("%s_loopback_ms_per_wake %.3f\n", name, elapsed_s * 1000 / count);
+
+    return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+    int wakes = 1000;
+    int option;
+
+    while ((option = getopt(argc, argv, "n:")) != -1)
+    {
+        switch (option)
+        {
+            case 'n':
+                wakes = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-n wakes]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    std::string dir = make_test_dir();
+    std::ofstream(dir + "/interval.txt") << "10";
+    TestCollector collector(dir);
+    TestListeners listeners(collector.collector);
+
+    BenchHttpTransport http(collector.port());
+    MqttTransport mqtt("127.0.0.1", listeners.mqtt.port(), "240ac4123456");
+    CoapTransport coap("127.0.0.1", listeners.coap.port(), "240ac4123456");
+
+    printf("wakes %d\n", wakes);
+
+    if (!run_wakes("http", http, wakes, false) || !run_wakes("mqtt", mqtt, wakes, false) ||
+        !run_wakes("coap", coap, wakes, true))
+    {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,283 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "coap_listener.h"
+#include "coap_transport.h"
+
+
+/*!
+ * @brief
+ *   CoAP listener class constructor.
+ *
+ * @param message_collector (IN)
+ *   Collector that handles the uploads.
+ */
+CoapListener::CoapListener(Collector &message_collector)
+    : collector(message_collector), fd(-1), bound_port(0), running(false)
+{
+}
+
+
+/*!
+ * @brief
+ *   CoAP listener class destructor.
+ */
+CoapListener::~CoapListener()
+{
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+
+/*!
+ * @brief
+ *   Start listening for stations.
+ *
+ * @param port (IN)
+ *   UDP port, 0 for any free port.
+ *
+ * @param address (IN)
+ *   Local IPv4 address.
+ *
+ * @return
+ *   True if listening, false otherwise.
+ */
+bool CoapListener::listen(int port, const std::string &address)
+{
+    fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+
+    if ((inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1) ||
+        (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0))
+    {
+        close(fd);
+        fd = -1;
+        return false;
+    }
+
+    socklen_t addr_len = sizeof(addr);
+    getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &addr_len);
+    bound_port = ntohs(addr.sin_port);
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Get the UDP port the listener listens on.
+ */
+int CoapListener::port() const
+{
+    return bound_port;
+}
+
+
+/*!
+ * @brief
+ *   Serve requests until stop().
+ */
+void CoapListener::run()
+{
+    running = true;
+
+    while (running)
+    {
+        pollfd poll_fd = {fd, POLLIN, 0};
+
+        if (poll(&poll_fd, 1, POLL_INTERVAL_MS) <= 0)
+        {
+            continue;
+        }
+
+        char buffer[2048];
+        sockaddr_in peer = {};
+        socklen_t peer_len = sizeof(peer);
+        ssize_t read_len = recvfrom(fd, buffer, sizeof(buffer), 0, reinterpret_cast<sockaddr *>(&peer), &peer_len);
+
+        if (read_len > 0)
+        {
+            handle_datagram(peer, std::string(buffer, static_cast<size_t>(read_len)));
+        }
+    }
+}
+
+
+/*!
+ * @brief
+ *   Stop run(). Can be called from any thread.
+ */
+void CoapListener::stop()
+{
+    running = false;
+}
+
+
+/*!
+ * @brief
+ *   Answer one datagram. Only confirmable requests are answered, the
+ *   stations send no other messages.
+ *
+ * @param peer (IN)
+ *   Sender.
+ *
+ * @param data (IN)
+ *   Datagram.
+ */
+void CoapListener::handle_datagram(const sockaddr_in &peer, const std::string &data)
+{
+    CoapMessage request;
+
+    if (!coap_decode(data, request) || (request.type != COAP_CONFIRMABLE) || (request.code == COAP_EMPTY))
+    {
+        return;
+    }
+
+    std::string response;
+
+    for (const Exchange &exchange : recent)
+    {
+        if ((exchange.message_id == request.message_id) && (exchange.peer.sin_port == peer.sin_port) &&
+            (exchange.peer.sin_addr.s_addr == peer.sin_addr.s_addr))
+        {
+            response = exchange.response;
+        }
+    }
+
+    if (response.empty())
+    {
+        response = handle_request(request);
+        recent.push_back({peer, request.message_id, response});
+
+        if (recent.size() > RECENT_RESPONSES)
+        {
+            recent.pop_front();
+        }
+    }
+
+    sendto(fd, response.data(), response.size(), 0, reinterpret_cast<const sockaddr *>(&peer), sizeof(peer));
+}
+
+
+/*!
+ * @brief
+ *   Handle a request with the collector.
+ *
+ * @param request (IN)
+ *   Confirmable request.
+ *
+ * @return
+ *   Encoded ACK with the response.
+ */
+std::string CoapListener::handle_request(const CoapMessage &request)
+{
+    CoapMessage response;
+    response.type = COAP_ACKNOWLEDGEMENT;
+    response.message_id = request.message_id;
+    response.token = request.token;
+    response.max_age = 0;
+    std::string path = (request.uri_path.size() == 1) ? request.uri_path.front() : "";
+
+    if ((request.code == COAP_POST) && (path == CoapTransport::SAMPLES_PATH))
+    {
+        response.code = response_code(collector.handle_message("POST", "/collect.php", request.payload,
+                                                               response.payload), COAP_CHANGED);
+    }
+    else if ((request.code == COAP_POST) && (path == CoapTransport::TELEMETRY_PATH))
+    {
+        response.code = response_code(collector.handle_message("POST", "/telemetry", request.payload,
+                                                               response.payload), COAP_CHANGED);
+    }
+    else if ((request.code == COAP_GET) && (path == CoapTransport::INTERVAL_PATH))
+    {
+        // An overloaded collector tells in Max-Age when to retry
+        std::string query = request.uri_query.empty() ? "" : "?" + request.uri_query.front();
+        int retry_after_s;
+        response.code = response_code(collector.handle_message("GET", "/interval.txt" + query, "", response.payload,
+                                                               retry_after_s), COAP_CONTENT);
+        response.max_age = static_cast<uint32_t>(retry_after_s);
+    }
+    else
+    {
+        response.code = COAP_NOT_FOUND;
+    }
+
+    // Only a GET answers with content, the stations ignore other payloads
+    if (response.code != COAP_CONTENT)
+    {
+        response.payload.clear();
+    }
+
+    return coap_encode(response);
+}
+
+
+/*!
+ * @brief
+ *   Map an HTTP status of the collector to a CoAP response code.
+ *
+ * @param status (IN)
+ *   HTTP status.
+ *
+ * @param success_code (IN)
+ *   Response code for 2xx.
+ *
+ * @return
+ *   CoAP response code.
+ */
+uint8_t CoapListener::response_code(int status, uint8_t success_code)
+{
+    if ((status >= 200) && (status < 300))
+    {
+        return success_code;
+    }
+    else if (status == 404)
+    {
+        return COAP_NOT_FOUND;
+    }
+    else if (status == 503)
+    {
+        return COAP_SERVICE_UNAVAILABLE;
+    }
+    else if (status >= 500)
+    {
+        return COAP_INTERNAL_ERROR;
+    }
+
+    return COAP_BAD_REQUEST;
+}
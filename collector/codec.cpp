@@ -0,0 +1,731 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <cstring>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "codec.h"
+
+
+/*!
+ * @brief
+ *   Map signed value to unsigned so that small magnitudes get small values.
+ */
+static uint64_t zigzag(int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+
+/*!
+ * @brief
+ *   Inverse of zigzag().
+ */
+static int64_t unzigzag(uint64_t value)
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+
+/*!
+ * @brief
+ *   Difference of two values without signed overflow.
+ */
+static int64_t difference(int64_t a, int64_t b)
+{
+    return static_cast<int64_t>(static_cast<uint64_t>(a) - static_cast<uint64_t>(b));
+}
+
+
+/*!
+ * @brief
+ *   Sum of two values without signed overflow.
+ */
+static int64_t sum(int64_t a, int64_t b)
+{
+    return static_cast<int64_t>(static_cast<uint64_t>(a) + static_cast<uint64_t>(b));
+}
+
+
+/*!
+ * @brief
+ *   Write delta-of-delta of times or sequence numbers.
+ *   Control bits: 0 = zero, 10 = 7 bits, 110 = 9 bits, 1110 = 12 bits,
+ *   1111 = 64 bits.
+ */
+static void write_delta_of_delta(BitWriter &writer, int64_t value)
+{
+    uint64_t bits = zigzag(value);
+
+    if (bits == 0)
+    {
+        writer.write(0, 1);
+    }
+    else if (bits < (1u << 7))
+    {
+        writer.write(0x2, 2);
+        writer.write(bits, 7);
+    }
+    else if (bits < (1u << 9))
+    {
+        writer.write(0x6, 3);
+        writer.write(bits, 9);
+    }
+    else if (bits < (1u << 12))
+    {
+        writer.write(0xE, 4);
+        writer.write(bits, 12);
+    }
+    else
+    {
+        writer.write(0xF, 4);
+        writer.write(bits, 64);
+    }
+}
+
+
+/*!
+ * @brief
+ *   Read value written with write_delta_of_delta().
+ */
+static bool read_delta_of_delta(BitReader &reader, int64_t &value)
+{
+    static const int WIDTHS[] = {7, 9, 12, 64};
+    uint64_t bit;
+    int control = 0;
+
+    do
+    {
+        if (!reader.read(1, bit))
+        {
+            return false;
+        }
+    } while ((bit == 1) && (++control < 4));
+
+    uint64_t bits = 0;
+
+    if ((control > 0) && !reader.read(WIDTHS[control - 1], bits))
+    {
+        return false;
+    }
+
+    value = unzigzag(bits);
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Write humidity delta.
+ *   Control bits: 0 = zero, 10 = 3 bits, 110 = 7 bits, 111 = 64 bits.
+ */
+static void write_delta(BitWriter &writer, int64_t value)
+{
+    uint64_t bits = zigzag(value);
+
+    if (bits == 0)
+    {
+        writer.write(0, 1);
+    }
+    else if (bits < (1u << 3))
+    {
+        writer.write(0x2, 2);
+        writer.write(bits, 3);
+    }
+    else if (bits < (1u << 7))
+    {
+        writer.write(0x6, 3);
+        writer.write(bits, 7);
+    }
+    else
+    {
+        writer.write(0x7, 3);
+        writer.write(bits, 64);
+    }
+}
+
+
+/*!
+ * @brief
+ *   Read value written with write_delta().
+ */
+static bool read_delta(BitReader &reader, int64_t &value)
+{
+    static const int WIDTHS[] = {3, 7, 64};
+    uint64_t bit;
+    int control = 0;
+
+    do
+    {
+        if (!reader.read(1, bit))
+        {
+            return false;
+        }
+    } while ((bit == 1) && (++control < 3));
+
+    uint64_t bits = 0;
+
+    if ((control > 0) && !reader.read(WIDTHS[control - 1], bits))
+    {
+        return false;
+    }
+
+    value = unzigzag(bits);
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Get float bits.
+ */
+static uint32_t float_bits(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, 4);
+    return bits;
+}
+
+
+/*!
+ * @brief
+ *   Get float from its bits.
+ */
+static float bits_float(uint32_t bits)
+{
+    float value;
+    memcpy(&value, &bits, 4);
+    return value;
+}
+
+
+/*!
+ * @brief
+ *   Bit writer class constructor.
+ */
+BitWriter::BitWriter()
+{
+    free_bits = 0;
+}
+
+
+/*!
+ * @brief
+ *   Append bits to stream.
+ *
+ * @param bits (IN)
+ *   Value whose lowest count bits are written, most significant first.
+ *
+ * @param count (IN)
+ *   Number of bits, 1-64.
+ */
+void BitWriter::write(uint64_t bits, int count)
+{
+    while (count > 0)
+    {
+        if (free_bits == 0)
+        {
+            buffer.push_back(0);
+            free_bits = 8;
+        }
+
+        int length = (count < free_bits) ? count : free_bits;
+        uint8_t part = static_cast<uint8_t>((bits >> (count - length)) & ((1u << length) - 1));
+        buffer.back() |= static_cast<uint8_t>(part << (free_bits - length));
+        free_bits -= length;
+        count -= length;
+    }
+}
+
+
+/*!
+ * @brief
+ *   Empty stream.
+ */
+void BitWriter::clear()
+{
+    buffer.clear();
+    free_bits = 0;
+}
+
+
+/*!
+ * @brief
+ *   Get written bytes. The last byte is padded with zero bits.
+ */
+const std::vector<uint8_t> &BitWriter::bytes() const
+{
+    return buffer;
+}
+
+
+/*!
+ * @brief
+ *   Bit reader class constructor.
+ *
+ * @param data (IN)
+ *   Bytes written with BitWriter, must outlive the reader.
+ *
+ * @param size (IN)
+ *   Number of bytes.
+ */
+BitReader::BitReader(const uint8_t *data, size_t size) : data(data)
+{
+    size_bits = size * 8;
+    position = 0;
+}
+
+
+/*!
+ * @brief
+ *   Read bits from stream.
+ *
+ * @param count (IN)
+ *   Number of bits, 1-64.
+ *
+ * @param bits (OUT)
+ *   Read bits in the lowest count bits.
+ *
+ * @return
+ *   True if read, false at end of stream.
+ */
+bool BitReader::read(int count, uint64_t &bits)
+{
+    if (static_cast<size_t>(count) > size_bits - position)
+    {
+        return false;
+    }
+
+    bits = 0;
+
+    while (count > 0)
+    {
+        int available = 8 - static_cast<int>(position % 8);
+        int length = (count < available) ? count : available;
+        uint64_t part = (data[position / 8] >> (available - length)) & ((1u << length) - 1);
+        bits = (bits << length) | part;
+        position += static_cast<size_t>(length);
+        count -= length;
+    }
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Block encoder class constructor.
+ */
+BlockEncoder::BlockEncoder()
+{
+    clear();
+}
+
+
+/*!
+ * @brief
+ *   Append sample to block.
+ *
+ * @param sample (IN)
+ *   Sample to append.
+ */
+void BlockEncoder::append(const Sample &sample)
+{
+    uint32_t temperature = float_bits(sample.temperature);
+
+    if (samples == 0)
+    {
+        first_time_s = sample.time_s;
+        writer.write(static_cast<uint64_t>(sample.time_s), 64);
+        writer.write(temperature, 32);
+        writer.write(static_cast<uint32_t>(sample.humidity), 32);
+        writer.write(sample.sequence, 32);
+    }
+    else
+    {
+        int64_t delta = difference(sample.time_s, previous.time_s);
+        write_delta_of_delta(writer, difference(delta, time_delta));
+        time_delta = delta;
+
+        uint32_t xor_bits = temperature ^ float_bits(previous.temperature);
+
+        if (xor_bits == 0)
+        {
+            writer.write(0, 1);
+        }
+        else
+        {
+            int leading = __builtin_clz(xor_bits);
+            int trailing = __builtin_ctz(xor_bits);
+
+            if ((leading_zeros >= 0) && (leading >= leading_zeros) && (trailing >= trailing_zeros))
+            {
+                // Meaningful bits fit in the previous window
+                writer.write(0x2, 2);
+                writer.write(xor_bits >> trailing_zeros, 32 - leading_zeros - trailing_zeros);
+            }
+            else
+            {
+                int length = 32 - leading - trailing;
+                writer.write(0x3, 2);
+                writer.write(static_cast<uint64_t>(leading), 5);
+                writer.write(static_cast<uint64_t>(length - 1), 5);
+                writer.write(xor_bits >> trailing, length);
+                leading_zeros = leading;
+                trailing_zeros = trailing;
+            }
+        }
+
+        write_delta(writer, static_cast<int64_t>(sample.humidity) - previous.humidity);
+
+        delta = static_cast<int64_t>(sample.sequence) - previous.sequence;
+        write_delta_of_delta(writer, delta - sequence_delta);
+        sequence_delta = delta;
+    }
+
+    previous = sample;
+    samples++;
+}
+
+
+/*!
+ * @brief
+ *   Start a new block.
+ */
+void BlockEncoder::clear()
+{
+    writer.clear();
+    samples = 0;
+    first_time_s = 0;
+    previous = Sample();
+    time_delta = 0;
+    sequence_delta = 0;
+    leading_zeros = -1;
+    trailing_zeros = 0;
+}
+
+
+/*!
+ * @brief
+ *   Get number of samples in block.
+ */
+size_t BlockEncoder::count() const
+{
+    return samples;
+}
+
+
+/*!
+ * @brief
+ *   Get time of first sample in block.
+ */
+int64_t BlockEncoder::first_time() const
+{
+    return first_time_s;
+}
+
+
+/*!
+ * @brief
+ *   Get time of last sample in block.
+ */
+int64_t BlockEncoder::last_time() const
+{
+    return previous.time_s;
+}
+
+
+/*!
+ * @brief
+ *   Get encoded block.
+ */
+const std::vector<uint8_t> &BlockEncoder::bytes() const
+{
+    return writer.bytes();
+}
+
+
+/*!
+ * @brief
+ *   Block decoder class constructor.
+ *
+ * @param data (IN)
+ *   Encoded block, must outlive the decoder.
+ *
+ * @param size (IN)
+ *   Size of encoded block in bytes.
+ *
+ * @param count (IN)
+ *   Number of samples in block.
+ */
+BlockDecoder::BlockDecoder(const uint8_t *data, size_t size, size_t count) : reader(data, size)
+{
+    remaining = count;
+    decoded = 0;
+    previous = Sample();
+    time_delta = 0;
+    sequence_delta = 0;
+    leading_zeros = -1;
+    trailing_zeros = 0;
+}
+
+
+/*!
+ * @brief
+ *   Decode next sample.
+ *
+ * @param sample (OUT)
+ *   Decoded sample.
+ *
+ * @return
+ *   True if decoded, false at end of block or if the block is corrupt.
+ */
+bool BlockDecoder::next(Sample &sample)
+{
+    if (remaining == 0)
+    {
+        return false;
+    }
+
+    bool ok;
+
+    if (decoded == 0)
+    {
+        uint64_t time_s = 0;
+        uint64_t temperature = 0;
+        uint64_t humidity = 0;
+        uint64_t sequence = 0;
+        ok = reader.read(64, time_s) && reader.read(32, temperature) && reader.read(32, humidity) &&
+             reader.read(32, sequence);
+        sample.time_s = static_cast<int64_t>(time_s);
+        sample.temperature = bits_float(static_cast<uint32_t>(temperature));
+        sample.humidity = static_cast<int32_t>(humidity);
+        sample.sequence = static_cast<uint32_t>(sequence);
+    }
+    else
+    {
+        int64_t delta_of_delta = 0;
+        ok = read_delta_of_delta(reader, delta_of_delta);
+        time_delta = sum(time_delta, delta_of_delta);
+        sample.time_s = sum(previous.time_s, time_delta);
+
+        uint32_t xor_bits = 0;
+        uint64_t control = 0;
+        ok = ok && reader.read(1, control);
+
+        if (ok && (control == 1))
+        {
+            uint64_t bits = 0;
+            ok = reader.read(1, control);
+
+            if (ok && (control == 1))
+            {
+                uint64_t leading = 0;
+                uint64_t length = 0;
+                ok = reader.read(5, leading) && reader.read(5, length);
+                leading_zeros = static_cast<int>(leading);
+                trailing_zeros = 32 - leading_zeros - static_cast<int>(length + 1);
+            }
+
+            ok = ok && (leading_zeros >= 0) && (trailing_zeros >= 0) &&
+                 reader.read(32 - leading_zeros - trailing_zeros, bits);
+            xor_bits = static_cast<uint32_t>(bits << trailing_zeros);
+        }
+
+        sample.temperature = bits_float(float_bits(previous.temperature) ^ xor_bits);
+
+        int64_t humidity_delta = 0;
+        ok = ok && read_delta(reader, humidity_delta);
+        sample.humidity = static_cast<int>(previous.humidity + humidity_delta);
+
+        int64_t sequence_delta_of_delta = 0;
+        ok = ok && read_delta_of_delta(reader, sequence_delta_of_delta);
+        sequence_delta += sequence_delta_of_delta;
+        sample.sequence = static_cast<uint32_t>(previous.sequence + sequence_delta);
+    }
+
+    if (!ok)
+    {
+        remaining = 0;
+        return false;
+    }
+
+    previous = sample;
+    remaining--;
+    decoded++;
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Encode block header to little endian.
+ *
+ * @param data (OUT)
+ *   SIZE bytes.
+ */
+void BlockHeader::encode(uint8_t *data) const
+{
+    memcpy(data, &count, 4);
+    memcpy(data + 4, &size, 4);
+    memcpy(data + 8, &first_time_s, 8);
+    memcpy(data + 16, &last_time_s, 8);
+}
+
+
+/*!
+ * @brief
+ *   Decode block header.
+ *
+ * @param data (IN)
+ *   SIZE bytes.
+ *
+ * @return
+ *   True if the header is plausible, false otherwise.
+ */
+bool BlockHeader::decode(const uint8_t *data)
+{
+    memcpy(&count, data, 4);
+    memcpy(&size, data + 4, 4);
+    memcpy(&first_time_s, data + 8, 8);
+    memcpy(&last_time_s, data + 16, 8);
+
+    return (count > 0) && (size > 0) && (first_time_s <= last_time_s);
+}
+
+
+/*!
+ * @brief
+ *   Block scanner class constructor.
+ *
+ * @param file_descriptor (IN)
+ *   Block file, read from the start.
+ *
+ * @param from_s (IN)
+ *   First time to return.
+ *
+ * @param to_s (IN)
+ *   Last time to return.
+ */
+BlockScanner::BlockScanner(int file_descriptor, int64_t from_s, int64_t to_s) : decoder(nullptr, 0, 0)
+{
+    fd = file_descriptor;
+    from = from_s;
+    to = to_s;
+    offset = 0;
+
+    struct stat status;
+    file_size = (fstat(fd, &status) == 0) ? static_cast<size_t>(status.st_size) : 0;
+}
+
+
+/*!
+ * @brief
+ *   Get next sample in time range.
+ *   Only one block is in memory at a time.
+ *
+ * @param sample (OUT)
+ *   Next sample.
+ *
+ * @return
+ *   True if found, false at end of file.
+ */
+bool BlockScanner::next(Sample &sample)
+{
+    while (true)
+    {
+        while (decoder.next(sample))
+        {
+            if ((sample.time_s >= from) && (sample.time_s <= to))
+            {
+                return true;
+            }
+        }
+
+        if (!next_block())
+        {
+            return false;
+        }
+    }
+}
+
+
+/*!
+ * @brief
+ *   Get size of the complete blocks scanned so far. After a scan of the
+ *   whole file, anything after this is a partially written block.
+ */
+size_t BlockScanner::valid_size() const
+{
+    return offset;
+}
+
+
+/*!
+ * @brief
+ *   Read next block overlapping the time range.
+ *
+ * @return
+ *   True if read, false at end of file.
+ */
+bool BlockScanner::next_block()
+{
+    while (offset + BlockHeader::SIZE <= file_size)
+    {
+        uint8_t data[BlockHeader::SIZE];
+        BlockHeader header;
+
+        if ((pread(fd, data, sizeof(data), static_cast<off_t>(offset)) != static_cast<ssize_t>(sizeof(data))) ||
+            !header.decode(data) || (offset + BlockHeader::SIZE + header.size > file_size))
+        {
+            return false;
+        }
+
+        size_t payload_offset = offset + BlockHeader::SIZE;
+
+        if ((header.last_time_s < from) || (header.first_time_s > to))
+        {
+            offset = payload_offset + header.size;
+            continue;
+        }
+
+        payload.resize(header.size);
+
+        if (pread(fd, payload.data(), header.size, static_cast<off_t>(payload_offset)) !=
+            static_cast<ssize_t>(header.size))
+        {
+            return false;
+        }
+
+        offset = payload_offset + header.size;
+        decoder = BlockDecoder(payload.data(), payload.size(), header.count);
+
+        return true;
+    }
+
+    return false;
+}
@@ -0,0 +1,857 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "collector.h"
+#include "export.h"
+#include "query.h"
+#include "trend.h"
+
+const char *const Collector::DEFAULT_STATION = "default";
+
+
+/*!
+ * @brief
+ *   Parse a number from a form field.
+ *
+ * @param text (IN)
+ *   Field value.
+ *
+ * @param value (OUT)
+ *   Parsed number.
+ *
+ * @return
+ *   True if the whole field is a finite number, false otherwise.
+ */
+static bool parse_number(const std::string &text, double &value)
+{
+    char *end = nullptr;
+    value = strtod(text.c_str(), &end);
+
+    return !text.empty() && (*end == 0) && std::isfinite(value);
+}
+
+
+/*!
+ * @brief
+ *   Parse a sample sequence number or sequence epoch from a form field.
+ *
+ * @param text (IN)
+ *   Field value.
+ *
+ * @param sequence (OUT)
+ *   Parsed number, 0 if the field is empty.
+ *
+ * @return
+ *   True if the field is empty or a 32-bit unsigned number, false otherwise.
+ */
+static bool parse_sequence(const std::string &text, uint32_t &sequence)
+{
+    sequence = 0;
+
+    if (text.empty())
+    {
+        return true;
+    }
+
+    char *end = nullptr;
+    unsigned long long value = strtoull(text.c_str(), &end, 10);
+
+    if (!isdigit(static_cast<unsigned char>(text[0])) || (*end != 0) || (value > UINT32_MAX))
+    {
+        return false;
+    }
+
+    sequence = static_cast<uint32_t>(value);
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Check that a telemetry field name or value can be stored in JSON as is.
+ *
+ * @param text (IN)
+ *   Field name or value.
+ *
+ * @return
+ *   True if not empty and only letters, digits, '.', '-' and '_'.
+ */
+static bool valid_telemetry_text(const std::string &text)
+{
+    if (text.empty() || (text.size() > 64))
+    {
+        return false;
+    }
+
+    for (char c : text)
+    {
+        if (!isalnum(static_cast<unsigned char>(c)) && (c != '.') && (c != '-') && (c != '_'))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Check that a telemetry value is a plain decimal number, which is also a
+ *   JSON number.
+ *
+ * @param text (IN)
+ *   Field value.
+ *
+ * @return
+ *   True if an optional minus sign, digits and optional decimals.
+ */
+static bool telemetry_number(const std::string &text)
+{
+    size_t i = ((text.size() > 1) && (text[0] == '-')) ? 1 : 0;
+    size_t point = text.find('.');
+
+    if ((point != std::string::npos) && ((point == i) || (point + 1 == text.size())))
+    {
+        return false;
+    }
+
+    for (; i < text.size(); i++)
+    {
+        if (!isdigit(static_cast<unsigned char>(text[i])) && (i != point))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Collector class constructor.
+ *   Registers request, close and heartbeat handlers to the server. The
+ *   heartbeat also checks the stations for silence.
+ *
+ * @param http_server (IN)
+ *   Server to receive requests from.
+ *
+ * @param sample_store (IN)
+ *   Store shared by all collectors.
+ *
+ * @param data_dir (IN)
+ *   Directory of interval.txt and telemetry, normally the web page root.
+ */
+Collector::Collector(HttpServer &http_server, Store &sample_store, const std::string &data_dir)
+    : server(http_server), store(sample_store), hub(http_server), alerts(nullptr), intervals(nullptr),
+      slots(nullptr), limiter(nullptr)
+{
+    interval_path = data_dir + "/interval.txt";
+    telemetry_dir = data_dir + "/telemetry";
+
+    server.set_request_handler(
+        [this](HttpServer::ConnectionId id, const HttpRequest &request, HttpResponse &response)
+        {
+            handle_request(id, request, response);
+        });
+    server.set_close_handler([this](HttpServer::ConnectionId id) { hub.unsubscribe(id); });
+    server.set_timer(HEARTBEAT_INTERVAL_MS,
+                     [this]()
+                     {
+                         hub.heartbeat();
+
+                         if (alerts != nullptr)
+                         {
+                             std::vector<AlertEvent> events;
+                             alerts->check_silence(time(nullptr), events);
+                             publish_alerts(events);
+                         }
+                     });
+}
+
+
+/*!
+ * @brief
+ *   Collector class destructor.
+ */
+Collector::~Collector()
+{
+}
+
+
+/*!
+ * @brief
+ *   Add a collector running in another thread.
+ *   Samples ingested here are pushed to the peer's dashboard clients too.
+ *
+ * @param peer (IN)
+ *   Collector of another event loop.
+ */
+void Collector::add_peer(Collector *peer)
+{
+    peers.push_back(peer);
+}
+
+
+/*!
+ * @brief
+ *   Check new samples against alert rules. Collectors of several threads
+ *   share the engine.
+ *
+ * @param engine (IN)
+ *   Alert engine, nullptr for none.
+ */
+void Collector::set_alerts(AlertEngine *engine)
+{
+    alerts = engine;
+}
+
+
+/*!
+ * @brief
+ *   Give each station a measurement interval from its recent samples
+ *   instead of the interval in interval.txt. Collectors of several threads
+ *   share the intervals.
+ *
+ * @param adaptive (IN)
+ *   Adaptive interval, nullptr for none.
+ */
+void Collector::set_adaptive_interval(AdaptiveInterval *adaptive)
+{
+    intervals = adaptive;
+}
+
+
+/*!
+ * @brief
+ *   Spread the wakes of the stations: give each station an upload phase
+ *   within its interval and turn away wakes over the admitted rate with a
+ *   time to come back. Collectors of several threads share both.
+ *
+ * @param upload_slots (IN)
+ *   Upload slots, nullptr for none.
+ *
+ * @param upload_limiter (IN)
+ *   Upload limiter, nullptr for none.
+ */
+void Collector::set_upload_schedule(UploadSlots *upload_slots, UploadLimiter *upload_limiter)
+{
+    slots = upload_slots;
+    limiter = upload_limiter;
+}
+
+
+/*!
+ * @brief
+ *   Store the new samples of an upload, push them to dashboard clients of
+ *   all collectors and check them against the alert rules.
+ *   The samples are stored together, so a resent upload is neither stored,
+ *   pushed nor checked again, and one that failed is stored whole when
+ *   resent.
+ *
+ * @param station_id (IN)
+ *   Station the samples are from.
+ *
+ * @param samples (IN)
+ *   Received samples in time order, at least one.
+ *
+ * @param epoch (IN)
+ *   Epoch of the station's sequence counter, 0 if not sent.
+ *
+ * @return
+ *   Result of Store::append().
+ */
+StationShard::Result Collector::ingest(const std::string &station_id, const std::vector<Sample> &samples,
+                                       uint32_t epoch)
+{
+    StationShard::Result result = store.append(station_id, samples, epoch);
+
+    if (result != StationShard::APPENDED)
+    {
+        return result;
+    }
+
+    for (const Sample &sample : samples)
+    {
+        publish("sample", sample_to_json(station_id, sample));
+
+        if (alerts != nullptr)
+        {
+            std::vector<AlertEvent> events;
+            alerts->on_sample(station_id, sample, events);
+            publish_alerts(events);
+        }
+
+        if (intervals != nullptr)
+        {
+            intervals->on_sample(station_id, sample);
+        }
+    }
+
+    return result;
+}
+
+
+/*!
+ * @brief
+ *   Push an event to dashboard clients of all collectors.
+ *
+ * @param event (IN)
+ *   Event type.
+ *
+ * @param data (IN)
+ *   Event data as JSON.
+ */
+void Collector::publish(const std::string &event, const std::string &data)
+{
+    uint64_t event_id = SseHub::allocate_event_id();
+    std::string frame = SseHub::format_event(event_id, event, data);
+    hub.publish(event_id, frame);
+
+    for (Collector *peer : peers)
+    {
+        peer->server.post([peer, event_id, frame]() { peer->hub.publish(event_id, frame); });
+    }
+}
+
+
+/*!
+ * @brief
+ *   Push alert events to dashboard clients. The engine has already
+ *   delivered them to its sinks.
+ *
+ * @param events (IN)
+ *   Alert events.
+ */
+void Collector::publish_alerts(const std::vector<AlertEvent> &events)
+{
+    for (const AlertEvent &event : events)
+    {
+        publish("alert", AlertEngine::event_to_json(event));
+    }
+}
+
+
+/*!
+ * @brief
+ *   Get number of connected dashboard clients.
+ */
+size_t Collector::subscriber_count() const
+{
+    return hub.subscriber_count();
+}
+
+
+/*!
+ * @brief
+ *   Handle a request that came in another protocol, from a listener thread.
+ *   The request is handled in the event loop like an HTTP request, so MQTT
+ *   and CoAP uploads are stored and pushed exactly like HTTP ones.
+ *
+ * @param method (IN)
+ *   HTTP method.
+ *
+ * @param path (IN)
+ *   HTTP path with optional query string.
+ *
+ * @param body (IN)
+ *   Request body.
+ *
+ * @param response_body (OUT)
+ *   Response body.
+ *
+ * @return
+ *   HTTP status, 503 if the event loop did not answer in MESSAGE_TIMEOUT_MS.
+ */
+int Collector::handle_message(const std::string &method, const std::string &path, const std::string &body,
+                              std::string &response_body)
+{
+    int retry_after_s;
+
+    return handle_message(method, path, body, response_body, retry_after_s);
+}
+
+
+/*!
+ * @brief
+ *   Handle a message of the MQTT or CoAP listener as an HTTP request and
+ *   get the time to retry a rejected request.
+ *
+ * @param method (IN)
+ *   HTTP method.
+ *
+ * @param path (IN)
+ *   HTTP path with optional query string.
+ *
+ * @param body (IN)
+ *   Request body.
+ *
+ * @param response_body (OUT)
+ *   Response body.
+ *
+ * @param retry_after_s (OUT)
+ *   Retry-After of the response in seconds, 0 if none.
+ *
+ * @return
+ *   HTTP status, 503 if the event loop did not answer in MESSAGE_TIMEOUT_MS.
+ */
+int Collector::handle_message(const std::string &method, const std::string &path, const std::string &body,
+                              std::string &response_body, int &retry_after_s)
+{
+    auto request = std::make_shared<HttpRequest>();
+    size_t query = path.find('?');
+    request->method = method;
+    request->path = path.substr(0, query);
+    request->query = (query != std::string::npos) ? path.substr(query + 1) : "";
+    request->body = body;
+    auto result = std::make_shared<std::promise<HttpResponse>>();
+    std::future<HttpResponse> response = result->get_future();
+
+    server.post(
+        [this, request, result]()
+        {
+            HttpResponse loop_response;
+            handle_request(0, *request, loop_response);
+            result->set_value(loop_response);
+        });
+
+    if (response.wait_for(std::chrono::milliseconds(MESSAGE_TIMEOUT_MS)) != std::future_status::ready)
+    {
+        return 503;
+    }
+
+    HttpResponse answer = response.get();
+    response_body = answer.body;
+    retry_after_s = 0;
+
+    for (const auto &header : answer.headers)
+    {
+        if (header.first == "Retry-After")
+        {
+            retry_after_s = atoi(header.second.c_str());
+        }
+    }
+
+    return answer.status;
+}
+
+
+/*!
+ * @brief
+ *   Format sample as JSON for dashboard clients.
+ *
+ * @param station_id (IN)
+ *   Station the sample is from.
+ *
+ * @param sample (IN)
+ *   Sample to format.
+ *
+ * @return
+ *   {"station":"id","time":unix_s,"temperature":x.x,"humidity":y}
+ */
+std::string Collector::sample_to_json(const std::string &station_id, const Sample &sample)
+{
+    char json[128];
+    snprintf(json, sizeof(json), "{\"station\":\"%s\",\"time\":%lld,\"temperature\":%.1f,\"humidity\":%d}",
+             station_id.c_str(), static_cast<long long>(sample.time_s), sample.temperature, sample.humidity);
+
+    return json;
+}
+
+
+/*!
+ * @brief
+ *   Route request.
+ *   The station uses the same paths as with the PHP server files:
+ *   GET interval.txt and POST collect.php. Stations post their telemetry to
+ *   /telemetry. Dashboards query stations, samples and telemetry and
+ *   subscribe to events, and analysis tools export samples in bulk.
+ */
+void Collector::handle_request(HttpServer::ConnectionId id, const HttpRequest &request, HttpResponse &response)
+{
+    if (request.path == "/collect.php")
+    {
+        handle_collect(request, response);
+    }
+    else if ((request.path == "/interval.txt") && (request.method == "GET"))
+    {
+        handle_interval(request, response);
+    }
+    else if ((request.path == "/events") && (request.method == "GET"))
+    {
+        hub.subscribe(id, request, response);
+    }
+    else if ((request.path == "/query") && (request.method == "GET"))
+    {
+        handle_query(request, response);
+    }
+    else if ((request.path == "/export") && (request.method == "GET"))
+    {
+        handle_export(request, response);
+    }
+    else if ((request.path == "/stations") && (request.method == "GET"))
+    {
+        handle_stations(response);
+    }
+    else if ((request.path == "/telemetry") && (request.method == "POST"))
+    {
+        handle_telemetry_post(request, response);
+    }
+    else if ((request.path == "/telemetry") && (request.method == "GET"))
+    {
+        handle_telemetry_get(request, response);
+    }
+    else
+    {
+        response.status = 404;
+        response.body = http_status_text(404);
+    }
+}
+
+
+/*!
+ * @brief
+ *   Handle sensor data from station.
+ *   Like PHP $_REQUEST, fields are taken from both query string and POST body.
+ *   Stations without Station field are stored as DEFAULT_STATION. The
+ *   optional Sequence field numbers the station's samples; a sample that is
+ *   already stored is acknowledged again but not stored twice. The optional
+ *   Epoch field changes when the station starts its counter again. A window
+ *   posted with TemperatureTrend and HumidityTrend is stored as the samples
+ *   reconstructed from the trends instead of its means, see trend.h, all
+ *   under the sequence number of the post and after the station's last
+ *   stored sample.
+ */
+void Collector::handle_collect(const HttpRequest &request, HttpResponse &response)
+{
+    std::map<std::string, std::string> fields = http_parse_form(request.query);
+
+    for (const auto &field : http_parse_form(request.body))
+    {
+        fields[field.first] = field.second;
+    }
+
+    std::string station_id = (fields.count("Station") > 0) ? fields["Station"] : DEFAULT_STATION;
+    double temperature;
+    double humidity;
+    uint32_t sequence;
+    uint32_t epoch;
+    bool trend = (fields.count("TemperatureTrend") > 0) || (fields.count("HumidityTrend") > 0);
+    std::vector<TrendPoint> temperature_trend;
+    std::vector<TrendPoint> humidity_trend;
+
+    if (!Store::valid_station_id(station_id) || !parse_number(fields["Temperature"], temperature) ||
+        !parse_number(fields["Humidity"], humidity) || !parse_sequence(fields["Sequence"], sequence) ||
+        !parse_sequence(fields["Epoch"], epoch) ||
+        (trend && (!parse_trend(fields["TemperatureTrend"], temperature_trend) ||
+                   !parse_trend(fields["HumidityTrend"], humidity_trend))))
+    {
+        response.status = 400;
+        response.body = http_status_text(400);
+        return;
+    }
+
+    std::vector<Sample> samples;
+
+    if (trend)
+    {
+        // Keep the station's samples in time order after an earlier window
+        StationShard *shard = store.find(station_id);
+        int64_t after_s = ((shard != nullptr) && (shard->size() > 0)) ? shard->at(shard->size() - 1).time_s
+                                                                      : std::numeric_limits<int64_t>::min();
+        samples = trend_samples(temperature_trend, humidity_trend, time(nullptr), after_s, sequence);
+    }
+    else
+    {
+        Sample sample;
+        sample.time_s = time(nullptr);
+        sample.temperature = static_cast<float>(temperature);
+        sample.humidity = static_cast<int>(lround(humidity));
+        sample.sequence = sequence;
+        samples.push_back(sample);
+    }
+
+    StationShard::Result result = ingest(station_id, samples, epoch);
+
+    if (result == StationShard::DUPLICATE)
+    {
+        response.body = "Duplicate";
+    }
+    else if (result == StationShard::FAILED)
+    {
+        response.status = 500;
+        response.body = http_status_text(500);
+    }
+}
+
+
+/*!
+ * @brief
+ *   Serve measurement interval set in weather.php, with the other station
+ *   settings of interval.txt. With an adaptive interval, a station that
+ *   sends its ID in the Station query field gets its own interval in the
+ *   first line instead. With upload slots the station also gets the offset
+ *   of its next wake. A wake over the rate of the upload limiter is turned
+ *   away with 503 and Retry-After before it uploads anything.
+ */
+void Collector::handle_interval(const HttpRequest &request, HttpResponse &response)
+{
+    int retry_after_s;
+    double now_s = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    if ((limiter != nullptr) && !limiter->admit(now_s, retry_after_s))
+    {
+        response.status = 503;
+        response.headers.emplace_back("Retry-After", std::to_string(retry_after_s));
+        response.body = http_status_text(503);
+        return;
+    }
+
+    std::ifstream file(interval_path);
+
+    if (!file)
+    {
+        response.status = 404;
+        response.body = http_status_text(404);
+        return;
+    }
+
+    std::stringstream content;
+    content << file.rdbuf();
+    response.body = content.str();
+    std::string station_id = http_parse_form(request.query)["Station"];
+
+    if (!Store::valid_station_id(station_id))
+    {
+        return;
+    }
+
+    if (intervals != nullptr)
+    {
+        size_t line_end = response.body.find('\n');
+        std::string rest = (line_end != std::string::npos) ? response.body.substr(line_end) : "";
+        int interval_min = intervals->interval(station_id, atoi(response.body.c_str()));
+        response.body = std::to_string(interval_min) + rest;
+    }
+
+    if (slots != nullptr)
+    {
+        int offset_s = slots->offset_s(station_id, atoi(response.body.c_str()) * 60, time(nullptr));
+        response.body += ((response.body.empty() || (response.body.back() == '\n')) ? "" : "\n");
+        response.body += "offset " + std::to_string(offset_s) + "\n";
+    }
+}
+
+
+/*!
+ * @brief
+ *   Answer dashboard query for samples of one station or an aggregate of all
+ *   stations. See parse_query() for the query fields.
+ */
+void Collector::handle_query(const HttpRequest &request, HttpResponse &response)
+{
+    Query query;
+
+    if (!parse_query(http_parse_form(request.query), query))
+    {
+        response.status = 400;
+        response.body = http_status_text(400);
+        return;
+    }
+
+    response.content_type = "application/json";
+    response.body = samples_to_json(run_query(store, query), query.metrics);
+}
+
+
+/*!
+ * @brief
+ *   Export samples of one station in a time range as CSV or binary columns.
+ *   The body is formatted as the client reads it from a snapshot taken now,
+ *   see export.h for the query fields and the formats.
+ */
+void Collector::handle_export(const HttpRequest &request, HttpResponse &response)
+{
+    ExportQuery query;
+
+    if (!parse_export(http_parse_form(request.query), query))
+    {
+        response.status = 400;
+        response.body = http_status_text(400);
+        return;
+    }
+
+    StoreSnapshot snapshot(store, query.station);
+    const ShardView *view = snapshot.find(query.station);
+
+    if (view == nullptr)
+    {
+        response.status = 404;
+        response.body = http_status_text(404);
+        return;
+    }
+
+    ExportStream stream(*view, query);
+    response.content_type = (query.format == EXPORT_CSV) ? "text/csv" : "application/octet-stream";
+    response.source = [stream](std::string &out) mutable { return stream.next(out); };
+}
+
+
+/*!
+ * @brief
+ *   List stations with their sample count and last sequence number as JSON.
+ */
+void Collector::handle_stations(HttpResponse &response)
+{
+    std::string json = "[";
+
+    for (StationShard *shard : store.shards())
+    {
+        json += (json.size() > 1) ? "," : "";
+        json += "{\"station\":\"" + shard->id() + "\",\"samples\":" + std::to_string(shard->size()) +
+                ",\"sequence\":" + std::to_string(shard->last_sequence()) + "}";
+    }
+
+    response.content_type = "application/json";
+    response.body = json + "]";
+}
+
+
+/*!
+ * @brief
+ *   Store telemetry from station.
+ *   Telemetry describes the station rather than the weather, for example
+ *   the radio use of a wake. Fields vary by firmware, so they are not parsed
+ *   but stored with the receive time as one JSON line per post in
+ *   telemetry/<station>.jsonl. Numbers are stored as numbers and other
+ *   values as strings.
+ */
+void Collector::handle_telemetry_post(const HttpRequest &request, HttpResponse &response)
+{
+    std::map<std::string, std::string> fields = http_parse_form(request.body);
+    std::string station_id = (fields.count("Station") > 0) ? fields["Station"] : DEFAULT_STATION;
+    fields.erase("Station");
+    std::string json = "{\"station\":\"" + station_id + "\",\"time\":" + std::to_string(time(nullptr));
+    bool ok = Store::valid_station_id(station_id) && !fields.empty();
+
+    for (const auto &field : fields)
+    {
+        ok = ok && valid_telemetry_text(field.first) && valid_telemetry_text(field.second);
+        json += ",\"" + field.first + "\":";
+        json += telemetry_number(field.second) ? field.second : "\"" + field.second + "\"";
+    }
+
+    if (!ok)
+    {
+        response.status = 400;
+        response.body = http_status_text(400);
+        return;
+    }
+
+    json += "}\n";
+
+    // One write per record with O_APPEND keeps records of concurrent posts whole
+    int fd = -1;
+
+    if ((mkdir(telemetry_dir.c_str(), 0755) == 0) || (errno == EEXIST))
+    {
+        fd = open((telemetry_dir + "/" + station_id + ".jsonl").c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+    }
+
+    if ((fd < 0) || (write(fd, json.data(), json.size()) != static_cast<ssize_t>(json.size())))
+    {
+        response.status = 500;
+        response.body = http_status_text(500);
+    }
+
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+
+/*!
+ * @brief
+ *   Answer dashboard query for the latest telemetry records of a station as
+ *   a JSON array. Query fields: station, last (default and maximum
+ *   MAX_TELEMETRY_RECORDS).
+ */
+void Collector::handle_telemetry_get(const HttpRequest &request, HttpResponse &response)
+{
+    std::map<std::string, std::string> fields = http_parse_form(request.query);
+    double last = MAX_TELEMETRY_RECORDS;
+
+    if (!Store::valid_station_id(fields["station"]) ||
+        ((fields.count("last") > 0) && (!parse_number(fields["last"], last) || (last < 1))))
+    {
+        response.status = 400;
+        response.body = http_status_text(400);
+        return;
+    }
+
+    std::ifstream file(telemetry_dir + "/" + fields["station"] + ".jsonl");
+    std::vector<std::string> records;
+    std::string line;
+    size_t count = (last < MAX_TELEMETRY_RECORDS) ? static_cast<size_t>(last) : MAX_TELEMETRY_RECORDS;
+
+    while (std::getline(file, line))
+    {
+        records.push_back(line);
+
+        if (records.size() > count)
+        {
+            records.erase(records.begin());
+        }
+    }
+
+    std::string json = "[";
+
+    for (const std::string &record : records)
+    {
+        json += (json.size() > 1) ? "," : "";
+        json += record;
+    }
+
+    response.content_type = "application/json";
+    response.body = json + "]";
+}
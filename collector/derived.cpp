@@ -0,0 +1,371 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include "derived.h"
+
+/*! Magnus formula constants over water, Sonntag 1990 */
+static const float MAGNUS_HPA = 6.112f;
+static const float MAGNUS_B = 17.62f;
+static const float MAGNUS_C = 243.12f;
+
+/*! Grams of water vapour per cubic metre per hPa of vapour pressure and
+ *  kelvin: 100 Pa/hPa * 1000 g/kg / 461.5 J/(kg K), the gas constant of
+ *  water vapour, divided by 100 % */
+static const float VAPOUR_G_K_PER_HPA = 2.16685f;
+
+/*! Zero Celsius in kelvin */
+static const float ZERO_CELSIUS_K = 273.15f;
+
+/*! Lowest humidity of dew point, which goes to minus infinity at 0 % */
+static const float DEW_POINT_MIN_HUMIDITY = 1.0f;
+
+static const float LN2 = 0.693147181f;
+static const float LOG2E = 1.44269504f;
+
+/*! log2(1 + t) on [0, 1) with at most 7.4e-6 error, Chebyshev nodes */
+static const float LOG2_C1 = 1.44268147f;
+static const float LOG2_C2 = -0.720358773f;
+static const float LOG2_C3 = 0.468658879f;
+static const float LOG2_C4 = -0.30163801f;
+static const float LOG2_C5 = 0.144471096f;
+static const float LOG2_C6 = -0.033822046f;
+
+/*! 2^t on [0, 1) with at most 1.1e-7 relative error, Chebyshev nodes */
+static const float EXP2_C0 = 0.999999898f;
+static const float EXP2_C1 = 0.69315449f;
+static const float EXP2_C2 = 0.240141818f;
+static const float EXP2_C3 = 0.0558603371f;
+static const float EXP2_C4 = 0.00894959042f;
+static const float EXP2_C5 = 0.00189375406f;
+
+
+/*!
+ * @brief
+ *   Clamp a value to a range with selects, which vectorise unlike the
+ *   references of std::min() and std::max().
+ */
+static inline float clamp(float value, float low, float high)
+{
+    value = (value < low) ? low : value;
+    return (value > high) ? high : value;
+}
+
+
+/*!
+ * @brief
+ *   Approximate base 2 logarithm: the exponent bits plus a polynomial of
+ *   the mantissa.
+ *
+ * @param x (IN)
+ *   Positive normal number.
+ */
+static inline float fast_log2(float x)
+{
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    float exponent = static_cast<float>(static_cast<int32_t>(bits >> 23) - 127);
+    uint32_t mantissa_bits = (bits & 0x007FFFFF) | 0x3F800000;
+    float t;
+    memcpy(&t, &mantissa_bits, sizeof(t));
+    t -= 1.0f;
+
+    float p = LOG2_C6;
+    p = p * t + LOG2_C5;
+    p = p * t + LOG2_C4;
+    p = p * t + LOG2_C3;
+    p = p * t + LOG2_C2;
+    p = p * t + LOG2_C1;
+
+    return exponent + p * t;
+}
+
+
+/*!
+ * @brief
+ *   Approximate power of 2: a polynomial of the fraction scaled by the
+ *   whole part put into the exponent bits.
+ *
+ * @param x (IN)
+ *   Power, clamped to the normal floats [-126, 127].
+ */
+static inline float fast_exp2(float x)
+{
+    x = clamp(x, -126.0f, 127.0f);
+
+    // Floor without a library call: truncation rounds negatives up
+    int32_t whole = static_cast<int32_t>(x);
+    whole -= (x < static_cast<float>(whole)) ? 1 : 0;
+    float t = x - static_cast<float>(whole);
+
+    float p = EXP2_C5;
+    p = p * t + EXP2_C4;
+    p = p * t + EXP2_C3;
+    p = p * t + EXP2_C2;
+    p = p * t + EXP2_C1;
+    p = p * t + EXP2_C0;
+
+    uint32_t bits = static_cast<uint32_t>(whole + 127) << 23;
+    float scale;
+    memcpy(&scale, &bits, sizeof(scale));
+
+    return scale * p;
+}
+
+
+/*!
+ * @brief
+ *   Approximate natural logarithm, as used by the kernels.
+ *
+ * @param x (IN)
+ *   Positive normal number.
+ */
+float derived_log(float x)
+{
+    return fast_log2(x) * LN2;
+}
+
+
+/*!
+ * @brief
+ *   Approximate exponential function, as used by the kernels.
+ *
+ * @param x (IN)
+ *   Power, results beyond the normal floats are clamped.
+ */
+float derived_exp(float x)
+{
+    return fast_exp2(x * LOG2E);
+}
+
+
+/*!
+ * @brief
+ *   Compute dew point series with the Magnus formula.
+ *
+ * @param temperature (IN)
+ *   Temperatures in degrees Celsius.
+ *
+ * @param humidity (IN)
+ *   Relative humidities in percent, clamped to 1-100 %.
+ *
+ * @param count (IN)
+ *   Number of samples.
+ *
+ * @param dew_point (OUT)
+ *   Dew points in degrees Celsius.
+ */
+void dew_point_series(const float *__restrict temperature, const float *__restrict humidity, size_t count,
+                      float *__restrict dew_point)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        float rh = clamp(humidity[i], DEW_POINT_MIN_HUMIDITY, 100.0f);
+        float t = temperature[i];
+        float gamma = fast_log2(rh * 0.01f) * LN2 + MAGNUS_B * t / (MAGNUS_C + t);
+        dew_point[i] = MAGNUS_C * gamma / (MAGNUS_B - gamma);
+    }
+}
+
+
+/*!
+ * @brief
+ *   Compute absolute humidity series from the saturation vapour pressure
+ *   of the Magnus formula.
+ *
+ * @param temperature (IN)
+ *   Temperatures in degrees Celsius.
+ *
+ * @param humidity (IN)
+ *   Relative humidities in percent, clamped to 0-100 %.
+ *
+ * @param count (IN)
+ *   Number of samples.
+ *
+ * @param absolute_humidity (OUT)
+ *   Water vapour in grams per cubic metre.
+ */
+void absolute_humidity_series(const float *__restrict temperature, const float *__restrict humidity, size_t count,
+                              float *__restrict absolute_humidity)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        float rh = clamp(humidity[i], 0.0f, 100.0f);
+        float t = temperature[i];
+        float saturation = MAGNUS_HPA * fast_exp2(MAGNUS_B * t / (MAGNUS_C + t) * LOG2E);
+        absolute_humidity[i] = saturation * rh * VAPOUR_G_K_PER_HPA / (ZERO_CELSIUS_K + t);
+    }
+}
+
+
+/*!
+ * @brief
+ *   Compute heat index series. Both formulas are computed for every sample
+ *   and the result selected, so that the loop has no branches.
+ *
+ * @param temperature (IN)
+ *   Temperatures in degrees Celsius.
+ *
+ * @param humidity (IN)
+ *   Relative humidities in percent, clamped to 0-100 %.
+ *
+ * @param count (IN)
+ *   Number of samples.
+ *
+ * @param heat_index (OUT)
+ *   Heat indices in degrees Celsius.
+ */
+void heat_index_series(const float *__restrict temperature, const float *__restrict humidity, size_t count,
+                       float *__restrict heat_index)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        float rh = clamp(humidity[i], 0.0f, 100.0f);
+        float f = temperature[i] * 1.8f + 32.0f;
+        float simple = 0.5f * (f + 61.0f + (f - 68.0f) * 1.2f + rh * 0.094f);
+        float regression = -42.379f + 2.04901523f * f + 10.14333127f * rh - 0.22475541f * f * rh -
+                           0.00683783f * f * f - 0.05481717f * rh * rh + 0.00122874f * f * f * rh +
+                           0.00085282f * f * rh * rh - 0.00000199f * f * f * rh * rh;
+        float dry = (13.0f - rh) * 0.25f * std::sqrt(clamp(17.0f - std::fabs(f - 95.0f), 0.0f, 17.0f) / 17.0f);
+        float damp = (rh - 85.0f) * 0.1f * (87.0f - f) * 0.2f;
+        // Chained selects, the vectoriser does not take && of float compares
+        dry = (rh < 13.0f) ? dry : 0.0f;
+        dry = (f < 112.0f) ? dry : 0.0f;
+        damp = (rh > 85.0f) ? damp : 0.0f;
+        damp = (f < 87.0f) ? damp : 0.0f;
+        regression += (f > 80.0f) ? damp - dry : 0.0f;
+        float index = ((simple + f) * 0.5f >= 80.0f) ? regression : simple;
+        heat_index[i] = (index - 32.0f) / 1.8f;
+    }
+}
+
+
+/*!
+ * @brief
+ *   Compute dew point with the C library, the reference of
+ *   dew_point_series().
+ */
+double dew_point_reference(double temperature, double humidity)
+{
+    double rh = std::min(std::max(humidity, static_cast<double>(DEW_POINT_MIN_HUMIDITY)), 100.0);
+    double gamma = std::log(rh / 100) + MAGNUS_B * temperature / (MAGNUS_C + temperature);
+
+    return MAGNUS_C * gamma / (MAGNUS_B - gamma);
+}
+
+
+/*!
+ * @brief
+ *   Compute absolute humidity with the C library, the reference of
+ *   absolute_humidity_series().
+ */
+double absolute_humidity_reference(double temperature, double humidity)
+{
+    double rh = std::min(std::max(humidity, 0.0), 100.0);
+    double saturation = MAGNUS_HPA * std::exp(MAGNUS_B * temperature / (MAGNUS_C + temperature));
+
+    return saturation * rh * VAPOUR_G_K_PER_HPA / (ZERO_CELSIUS_K + temperature);
+}
+
+
+/*!
+ * @brief
+ *   Compute heat index one sample at a time, the reference of
+ *   heat_index_series().
+ */
+double heat_index_reference(double temperature, double humidity)
+{
+    double rh = std::min(std::max(humidity, 0.0), 100.0);
+    double f = temperature * 1.8 + 32;
+    double index = 0.5 * (f + 61 + (f - 68) * 1.2 + rh * 0.094);
+
+    if ((index + f) / 2 >= 80)
+    {
+        index = -42.379 + 2.04901523 * f + 10.14333127 * rh - 0.22475541 * f * rh - 0.00683783 * f * f -
+                0.05481717 * rh * rh + 0.00122874 * f * f * rh + 0.00085282 * f * rh * rh -
+                0.00000199 * f * f * rh * rh;
+
+        if ((rh < 13) && (f > 80) && (f < 112))
+        {
+            index -= (13 - rh) / 4 * std::sqrt((17 - std::fabs(f - 95)) / 17);
+        }
+        else if ((rh > 85) && (f > 80) && (f < 87))
+        {
+            index += (rh - 85) / 10 * (87 - f) / 5;
+        }
+    }
+
+    return (index - 32) / 1.8;
+}
+
+
+/*!
+ * @brief
+ *   Parse a comma separated list of metric names: dew_point,
+ *   absolute_humidity and heat_index.
+ *
+ * @param text (IN)
+ *   Metric names.
+ *
+ * @param metrics (OUT)
+ *   DerivedMetric bits.
+ *
+ * @return
+ *   True if all names are known, false otherwise.
+ */
+bool parse_metrics(const std::string &text, unsigned &metrics)
+{
+    metrics = 0;
+    size_t start = 0;
+
+    while (start <= text.size())
+    {
+        size_t end = std::min(text.find(',', start), text.size());
+        std::string name = text.substr(start, end - start);
+
+        if (name == "dew_point")
+        {
+            metrics |= METRIC_DEW_POINT;
+        }
+        else if (name == "absolute_humidity")
+        {
+            metrics |= METRIC_ABSOLUTE_HUMIDITY;
+        }
+        else if (name == "heat_index")
+        {
+            metrics |= METRIC_HEAT_INDEX;
+        }
+        else
+        {
+            return false;
+        }
+
+        start = end + 1;
+    }
+
+    return true;
+}
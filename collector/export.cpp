@@ -0,0 +1,375 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "export.h"
+#include "query.h"
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "Binary export columns are written in host byte order, which must be little endian"
+#endif
+
+const char ExportStream::MAGIC[5] = "WSC1";
+const char ExportStream::CSV_HEADER[] = "time,temperature,humidity,sequence\n";
+
+/*! Longest CSV line: time, temperature, humidity and sequence with signs
+ *  and separators. The longest temperature is -FLT_MAX with one decimal. */
+static const size_t MAX_CSV_LINE = 20 + 1 + 48 + 1 + 11 + 1 + 10 + 1;
+
+/*! Temperatures of this magnitude and over are formatted with printf */
+static const double MAX_FAST_TEMPERATURE = 1e9;
+
+
+/*!
+ * @brief
+ *   Parse export from request fields station, from, to and format, csv
+ *   (default) or columns.
+ *
+ * @param fields (IN)
+ *   Decoded query string fields.
+ *
+ * @param query (OUT)
+ *   Parsed export.
+ *
+ * @return
+ *   True if a valid station is given and all given fields are valid, false
+ *   otherwise.
+ */
+bool parse_export(const std::map<std::string, std::string> &fields, ExportQuery &query)
+{
+    Query range;
+
+    if (!parse_query(fields, range) || range.station.empty())
+    {
+        return false;
+    }
+
+    query.station = range.station;
+    query.from_s = range.from_s;
+    query.to_s = range.to_s;
+    auto format = fields.find("format");
+
+    if ((format == fields.end()) || (format->second == "csv"))
+    {
+        query.format = EXPORT_CSV;
+    }
+    else if (format->second == "columns")
+    {
+        query.format = EXPORT_COLUMNS;
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Constructor.
+ *
+ * @param view (IN)
+ *   Snapshot of the station to export.
+ *
+ * @param query (IN)
+ *   Export time range and format.
+ */
+ExportStream::ExportStream(const ShardView &view, const ExportQuery &query)
+    : view(view), format(query.format), position(view.lower_bound(query.from_s)),
+      end(view.lower_bound(query.to_s)), started(false)
+{
+}
+
+
+/*!
+ * @brief
+ *   Append the next piece of the export: the CSV header or magic with the
+ *   first samples, then up to CHUNK_SAMPLES samples at a time.
+ *
+ * @param out (IN/OUT)
+ *   Buffer to append to.
+ *
+ * @return
+ *   True if more pieces follow, false after the last one.
+ */
+bool ExportStream::next(std::string &out)
+{
+    if (!started)
+    {
+        out += (format == EXPORT_CSV) ? CSV_HEADER : MAGIC;
+        started = true;
+    }
+
+    size_t begin = position;
+    position = std::min(end, position + CHUNK_SAMPLES);
+
+    if (format == EXPORT_CSV)
+    {
+        write_csv(out, begin, position);
+    }
+    else
+    {
+        write_columns(out, begin, position);
+    }
+
+    // Binary columns end with an empty chunk, which is written last
+    return (begin < position) && ((position < end) || (format == EXPORT_COLUMNS));
+}
+
+
+/*!
+ * @brief
+ *   Write decimal integer.
+ *
+ * @return
+ *   End of written digits.
+ */
+static char *write_integer(char *out, int64_t value)
+{
+    char digits[20];
+    size_t count = 0;
+    uint64_t magnitude = (value < 0) ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+
+    if (value < 0)
+    {
+        *out++ = '-';
+    }
+
+    do
+    {
+        digits[count++] = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+
+    while (count > 0)
+    {
+        *out++ = digits[--count];
+    }
+
+    return out;
+}
+
+
+/*!
+ * @brief
+ *   Write CSV lines of samples as "%lld,%.1f,%d,%u" would, without the cost
+ *   of printf.
+ *
+ * @param out (IN/OUT)
+ *   Buffer to append to.
+ *
+ * @param begin (IN)
+ *   Index of first sample.
+ *
+ * @param end (IN)
+ *   Index after last sample.
+ */
+void ExportStream::write_csv(std::string &out, size_t begin, size_t end) const
+{
+    size_t start = out.size();
+    out.resize(start + (end - begin) * MAX_CSV_LINE);
+    char *cursor = &out[start];
+
+    for (size_t i = begin; i < end; i++)
+    {
+        const Sample &sample = view.at(i);
+        cursor = write_integer(cursor, sample.time_s);
+        *cursor++ = ',';
+
+        // Rounding the exact tenths half to even like printf, and keeping the
+        // sign of values that round to zero
+        double magnitude = std::fabs(static_cast<double>(sample.temperature));
+
+        if (magnitude < MAX_FAST_TEMPERATURE)
+        {
+            int64_t tenths = static_cast<int64_t>(std::nearbyint(magnitude * 10.0));
+
+            if (std::signbit(sample.temperature))
+            {
+                *cursor++ = '-';
+            }
+
+            cursor = write_integer(cursor, tenths / 10);
+            *cursor++ = '.';
+            *cursor++ = static_cast<char>('0' + tenths % 10);
+        }
+        else
+        {
+            char text[64];
+            int length = snprintf(text, sizeof(text), "%.1f", sample.temperature);
+            memcpy(cursor, text, static_cast<size_t>(length));
+            cursor += length;
+        }
+
+        *cursor++ = ',';
+        cursor = write_integer(cursor, sample.humidity);
+        *cursor++ = ',';
+        cursor = write_integer(cursor, sample.sequence);
+        *cursor++ = '\n';
+    }
+
+    out.resize(static_cast<size_t>(cursor - out.data()));
+}
+
+
+/*!
+ * @brief
+ *   Write one chunk of binary columns with its statistics, or the empty end
+ *   chunk.
+ *
+ * @param out (IN/OUT)
+ *   Buffer to append to.
+ *
+ * @param begin (IN)
+ *   Index of first sample.
+ *
+ * @param end (IN)
+ *   Index after last sample.
+ */
+void ExportStream::write_columns(std::string &out, size_t begin, size_t end) const
+{
+    size_t count = end - begin;
+    size_t start = out.size();
+    out.resize(start + CHUNK_HEADER_BYTES + count * COLUMN_SAMPLE_BYTES);
+    char *header = &out[start];
+    char *times = header + CHUNK_HEADER_BYTES;
+    char *temperatures = times + count * sizeof(int64_t);
+    char *humidities = temperatures + count * sizeof(float);
+    char *sequences = humidities + count * sizeof(int32_t);
+    ExportChunkStats stats = {static_cast<uint32_t>(count), 0, 0, 0.0f, 0.0f, 0, 0};
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const Sample &sample = view.at(begin + i);
+        int32_t humidity = sample.humidity;
+        memcpy(times + i * sizeof(int64_t), &sample.time_s, sizeof(int64_t));
+        memcpy(temperatures + i * sizeof(float), &sample.temperature, sizeof(float));
+        memcpy(humidities + i * sizeof(int32_t), &humidity, sizeof(int32_t));
+        memcpy(sequences + i * sizeof(uint32_t), &sample.sequence, sizeof(uint32_t));
+
+        if (i == 0)
+        {
+            stats.min_time_s = stats.max_time_s = sample.time_s;
+            stats.min_temperature = stats.max_temperature = sample.temperature;
+            stats.min_humidity = stats.max_humidity = humidity;
+        }
+
+        stats.min_time_s = std::min(stats.min_time_s, sample.time_s);
+        stats.max_time_s = std::max(stats.max_time_s, sample.time_s);
+        stats.min_temperature = std::min(stats.min_temperature, sample.temperature);
+        stats.max_temperature = std::max(stats.max_temperature, sample.temperature);
+        stats.min_humidity = std::min(stats.min_humidity, humidity);
+        stats.max_humidity = std::max(stats.max_humidity, humidity);
+    }
+
+    memcpy(header, &stats.count, 4);
+    memcpy(header + 4, &stats.min_time_s, 8);
+    memcpy(header + 12, &stats.max_time_s, 8);
+    memcpy(header + 20, &stats.min_temperature, 4);
+    memcpy(header + 24, &stats.max_temperature, 4);
+    memcpy(header + 28, &stats.min_humidity, 4);
+    memcpy(header + 32, &stats.max_humidity, 4);
+}
+
+
+/*!
+ * @brief
+ *   Decode binary columns.
+ *
+ * @param data (IN)
+ *   Whole export.
+ *
+ * @param chunks (OUT)
+ *   Statistics of each chunk with samples.
+ *
+ * @param samples (OUT)
+ *   Samples of all chunks.
+ *
+ * @return
+ *   True if the data is a complete export, false otherwise.
+ */
+bool export_decode_columns(const std::string &data, std::vector<ExportChunkStats> &chunks,
+                           std::vector<Sample> &samples)
+{
+    chunks.clear();
+    samples.clear();
+
+    if (data.compare(0, 4, ExportStream::MAGIC) != 0)
+    {
+        return false;
+    }
+
+    size_t offset = 4;
+
+    while (data.size() - offset >= ExportStream::CHUNK_HEADER_BYTES)
+    {
+        const char *header = data.data() + offset;
+        ExportChunkStats stats;
+        memcpy(&stats.count, header, 4);
+        memcpy(&stats.min_time_s, header + 4, 8);
+        memcpy(&stats.max_time_s, header + 12, 8);
+        memcpy(&stats.min_temperature, header + 20, 4);
+        memcpy(&stats.max_temperature, header + 24, 4);
+        memcpy(&stats.min_humidity, header + 28, 4);
+        memcpy(&stats.max_humidity, header + 32, 4);
+        offset += ExportStream::CHUNK_HEADER_BYTES;
+
+        if (stats.count == 0)
+        {
+            return offset == data.size();
+        }
+
+        if ((data.size() - offset) / ExportStream::COLUMN_SAMPLE_BYTES < stats.count)
+        {
+            return false;
+        }
+
+        const char *times = data.data() + offset;
+        const char *temperatures = times + stats.count * sizeof(int64_t);
+        const char *humidities = temperatures + stats.count * sizeof(float);
+        const char *sequences = humidities + stats.count * sizeof(int32_t);
+
+        for (size_t i = 0; i < stats.count; i++)
+        {
+            Sample sample;
+            int32_t humidity;
+            memcpy(&sample.time_s, times + i * sizeof(int64_t), sizeof(int64_t));
+            memcpy(&sample.temperature, temperatures + i * sizeof(float), sizeof(float));
+            memcpy(&humidity, humidities + i * sizeof(int32_t), sizeof(int32_t));
+            memcpy(&sample.sequence, sequences + i * sizeof(uint32_t), sizeof(uint32_t));
+            sample.humidity = humidity;
+            samples.push_back(sample);
+        }
+
+        chunks.push_back(stats);
+        offset += stats.count * ExportStream::COLUMN_SAMPLE_BYTES;
+    }
+
+    return false;
+}
@@ -0,0 +1,325 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+#include "http.h"
+
+
+/*!
+ * @brief
+ *   Get request header value.
+ *
+ * @param name (IN)
+ *   Header name in lower case.
+ *
+ * @return
+ *   Header value or empty string if the header is missing.
+ */
+std::string HttpRequest::header(const std::string &name) const
+{
+    auto it = headers.find(name);
+    return (it != headers.end()) ? it->second : std::string();
+}
+
+
+/*!
+ * @brief
+ *   Check if the client wants to keep the connection open after the response.
+ *
+ * @return
+ *   True for HTTP/1.1 without "Connection: close", false otherwise.
+ */
+bool HttpRequest::keep_alive() const
+{
+    std::string connection = header("connection");
+    std::transform(connection.begin(), connection.end(), connection.begin(), ::tolower);
+
+    if (version == "HTTP/1.0")
+    {
+        return (connection == "keep-alive");
+    }
+
+    return (connection != "close");
+}
+
+
+/*!
+ * @brief
+ *   Parse one HTTP request from the start of a receive buffer.
+ *
+ * @param buffer (IN)
+ *   Received bytes, possibly containing a partial or several requests.
+ *
+ * @param request (OUT)
+ *   Parsed request if COMPLETE is returned.
+ *
+ * @param consumed (OUT)
+ *   Number of bytes of buffer used by the request if COMPLETE is returned.
+ *
+ * @return
+ *   COMPLETE, INCOMPLETE if more data is needed or BAD_REQUEST.
+ */
+HttpParser::Result HttpParser::parse(const std::string &buffer, HttpRequest &request, size_t &consumed)
+{
+    size_t header_end = buffer.find("\r\n\r\n");
+
+    if (header_end == std::string::npos)
+    {
+        return (buffer.size() > MAX_HEADER_SIZE) ? BAD_REQUEST : INCOMPLETE;
+    }
+
+    std::istringstream lines(buffer.substr(0, header_end));
+    std::string line;
+    std::getline(lines, line);
+
+    if (!line.empty() && (line.back() == '\r'))
+    {
+        line.pop_back();
+    }
+
+    std::istringstream request_line(line);
+    std::string target;
+    request = HttpRequest();
+
+    if (!(request_line >> request.method >> target >> request.version) ||
+        (request.version.compare(0, 5, "HTTP/") != 0) || target.empty() || (target[0] != '/'))
+    {
+        return BAD_REQUEST;
+    }
+
+    size_t query_start = target.find('?');
+    request.path = target.substr(0, query_start);
+
+    if (query_start != std::string::npos)
+    {
+        request.query = target.substr(query_start + 1);
+    }
+
+    while (std::getline(lines, line))
+    {
+        if (!line.empty() && (line.back() == '\r'))
+        {
+            line.pop_back();
+        }
+
+        size_t colon = line.find(':');
+
+        if (colon == std::string::npos)
+        {
+            return BAD_REQUEST;
+        }
+
+        std::string name = line.substr(0, colon);
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        size_t value_start = line.find_first_not_of(" \t", colon + 1);
+        request.headers[name] = (value_start == std::string::npos) ? "" : line.substr(value_start);
+    }
+
+    size_t body_length = 0;
+    std::string content_length = request.header("content-length");
+
+    if (!content_length.empty())
+    {
+        char *end = nullptr;
+        unsigned long length = strtoul(content_length.c_str(), &end, 10);
+
+        if ((*end != 0) || (length > MAX_BODY_SIZE))
+        {
+            return BAD_REQUEST;
+        }
+
+        body_length = length;
+    }
+
+    size_t body_start = header_end + 4;
+
+    if (buffer.size() < body_start + body_length)
+    {
+        return INCOMPLETE;
+    }
+
+    request.body = buffer.substr(body_start, body_length);
+    consumed = body_start + body_length;
+
+    return COMPLETE;
+}
+
+
+/*!
+ * @brief
+ *   Get reason phrase for HTTP status code.
+ *
+ * @param status (IN)
+ *   HTTP status code.
+ *
+ * @return
+ *   Reason phrase.
+ */
+std::string http_status_text(int status)
+{
+    switch (status)
+    {
+        case 200: return "OK";
+        case 204: return "No Content";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        default: return "Unknown";
+    }
+}
+
+
+/*!
+ * @brief
+ *   Format response status line, headers and body.
+ *   Streaming responses get no Content-Length and the body is the first chunk
+ *   of the stream.
+ *
+ * @param response (IN)
+ *   Response to format.
+ *
+ * @param keep_alive (IN)
+ *   True to keep the connection open after the response.
+ *
+ * @return
+ *   Response bytes to send.
+ */
+std::string http_format_response(const HttpResponse &response, bool keep_alive)
+{
+    std::ostringstream out;
+    out << "HTTP/1.1 " << response.status << " " << http_status_text(response.status) << "\r\n";
+    out << "Content-Type: " << response.content_type << "\r\n";
+    out << "Access-Control-Allow-Origin: *\r\n";
+
+    for (const auto &header : response.headers)
+    {
+        out << header.first << ": " << header.second << "\r\n";
+    }
+
+    if (response.stream)
+    {
+        out << "Cache-Control: no-cache\r\n";
+        out << "Connection: keep-alive\r\n\r\n";
+    }
+    else if (response.source)
+    {
+        out << "Transfer-Encoding: chunked\r\n";
+        out << "Connection: " << (keep_alive ? "keep-alive" : "close") << "\r\n\r\n";
+    }
+    else
+    {
+        out << "Content-Length: " << response.body.size() << "\r\n";
+        out << "Connection: " << (keep_alive ? "keep-alive" : "close") << "\r\n\r\n";
+    }
+
+    out << response.body;
+
+    return out.str();
+}
+
+
+/*!
+ * @brief
+ *   Decode URL encoded text ("%xx" escapes and '+' for space).
+ *
+ * @param text (IN)
+ *   URL encoded text.
+ *
+ * @return
+ *   Decoded text.
+ */
+std::string http_url_decode(const std::string &text)
+{
+    std::string decoded;
+    decoded.reserve(text.size());
+
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        if ((text[i] == '%') && (i + 2 < text.size()) &&
+            isxdigit(static_cast<unsigned char>(text[i + 1])) &&
+            isxdigit(static_cast<unsigned char>(text[i + 2])))
+        {
+            decoded += static_cast<char>(strtol(text.substr(i + 1, 2).c_str(), nullptr, 16));
+            i += 2;
+        }
+        else if (text[i] == '+')
+        {
+            decoded += ' ';
+        }
+        else
+        {
+            decoded += text[i];
+        }
+    }
+
+    return decoded;
+}
+
+
+/*!
+ * @brief
+ *   Parse "name=value&name=value" form or query string.
+ *
+ * @param text (IN)
+ *   URL encoded form data.
+ *
+ * @return
+ *   Decoded fields by name.
+ */
+std::map<std::string, std::string> http_parse_form(const std::string &text)
+{
+    std::map<std::string, std::string> fields;
+    size_t start = 0;
+
+    while (start < text.size())
+    {
+        size_t end = text.find('&', start);
+
+        if (end == std::string::npos)
+        {
+            end = text.size();
+        }
+
+        std::string field = text.substr(start, end - start);
+        size_t equals = field.find('=');
+
+        if (equals != std::string::npos)
+        {
+            fields[http_url_decode(field.substr(0, equals))] = http_url_decode(field.substr(equals + 1));
+        }
+        else if (!field.empty())
+        {
+            fields[http_url_decode(field)] = "";
+        }
+
+        start = end + 1;
+    }
+
+    return fields;
+}
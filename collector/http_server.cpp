@@ -0,0 +1,714 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <cerrno>
+#include <chrono>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "http_server.h"
+
+/*! epoll user data for the listening socket */
+static const HttpServer::ConnectionId LISTEN_ID = 0;
+
+/*! epoll user data for the stop() wake up event */
+static const HttpServer::ConnectionId WAKE_ID = 1;
+
+/*! Size of socket read buffer */
+static const size_t READ_CHUNK_SIZE = 4096;
+
+
+/*!
+ * @brief
+ *   Get monotonic time in milliseconds.
+ */
+static int64_t monotonic_ms()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+/*!
+ * @brief
+ *   HTTP server class constructor.
+ */
+HttpServer::HttpServer()
+{
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    listen_fd = -1;
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    bound_port = 0;
+    running = true;
+    next_id = WAKE_ID + 1;
+    timer_interval_ms = 0;
+    next_timer_ms = 0;
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = WAKE_ID;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event);
+}
+
+
+/*!
+ * @brief
+ *   HTTP server class destructor.
+ *   Closes all connections.
+ */
+HttpServer::~HttpServer()
+{
+    for (auto &entry : connections)
+    {
+        ::close(entry.second.fd);
+    }
+
+    if (listen_fd >= 0)
+    {
+        ::close(listen_fd);
+    }
+
+    ::close(wake_fd);
+    ::close(epoll_fd);
+}
+
+
+/*!
+ * @brief
+ *   Start listening for connections.
+ *
+ * @param port (IN)
+ *   TCP port, 0 to let the system pick a free port (see port()).
+ *
+ * @param address (IN)
+ *   IPv4 address to bind to.
+ *
+ * @param reuse_port (IN)
+ *   True to share the port with other servers; the kernel spreads the
+ *   connections over them.
+ *
+ * @return
+ *   True if listening, false otherwise.
+ */
+bool HttpServer::listen(int port, const std::string &address, bool reuse_port)
+{
+    listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+    if (listen_fd < 0)
+    {
+        return false;
+    }
+
+    int enable = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    if (reuse_port)
+    {
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable));
+    }
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+
+    if ((inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1) ||
+        (bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) ||
+        (::listen(listen_fd, LISTEN_BACKLOG) != 0))
+    {
+        ::close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+
+    socklen_t addr_len = sizeof(addr);
+    getsockname(listen_fd, reinterpret_cast<sockaddr *>(&addr), &addr_len);
+    bound_port = ntohs(addr.sin_port);
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = LISTEN_ID;
+
+    return (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event) == 0);
+}
+
+
+/*!
+ * @brief
+ *   Get the TCP port the server listens on.
+ */
+int HttpServer::port() const
+{
+    return bound_port;
+}
+
+
+/*!
+ * @brief
+ *   Set handler called for every complete request.
+ *   The handler fills in the response. A response with stream set keeps the
+ *   connection open so that more data can be pushed to it with send().
+ */
+void HttpServer::set_request_handler(RequestHandler handler)
+{
+    request_handler = handler;
+}
+
+
+/*!
+ * @brief
+ *   Set handler called when a connection is closed.
+ */
+void HttpServer::set_close_handler(CloseHandler handler)
+{
+    close_handler = handler;
+}
+
+
+/*!
+ * @brief
+ *   Set handler called periodically from the event loop.
+ *
+ * @param interval_ms (IN)
+ *   Timer interval in milliseconds.
+ *
+ * @param handler (IN)
+ *   Timer handler.
+ */
+void HttpServer::set_timer(int interval_ms, TimerHandler handler)
+{
+    timer_interval_ms = interval_ms;
+    timer_handler = handler;
+    next_timer_ms = monotonic_ms() + interval_ms;
+}
+
+
+/*!
+ * @brief
+ *   Queue data to be sent to a connection.
+ *   A streaming connection whose unsent data grows over MAX_OUTPUT_BUFFER is
+ *   a stalled client and it is closed at the end of the current event loop
+ *   round.
+ *
+ * @param id (IN)
+ *   Connection to send to.
+ *
+ * @param data (IN)
+ *   Data to send.
+ *
+ * @return
+ *   True if data was queued, false if the connection is closed or stalled.
+ */
+bool HttpServer::send(ConnectionId id, const std::string &data)
+{
+    auto it = connections.find(id);
+
+    if ((it == connections.end()) || (it->second.fd < 0))
+    {
+        return false;
+    }
+
+    Connection &connection = it->second;
+
+    if (connection.streaming && (connection.output.size() + data.size() > MAX_OUTPUT_BUFFER))
+    {
+        close(id);
+        return false;
+    }
+
+    connection.output += data;
+    write_connection(id);
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Close a connection at the end of the current event loop round.
+ *   Closing is deferred so that handlers can close connections while
+ *   iterating over them.
+ *
+ * @param id (IN)
+ *   Connection to close.
+ */
+void HttpServer::close(ConnectionId id)
+{
+    auto it = connections.find(id);
+
+    if ((it != connections.end()) && (it->second.fd >= 0))
+    {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, it->second.fd, nullptr);
+        ::close(it->second.fd);
+        it->second.fd = -1;
+        pending_close.push_back(id);
+    }
+}
+
+
+/*!
+ * @brief
+ *   Run a task in the event loop thread. Can be called from any thread.
+ *
+ * @param task (IN)
+ *   Task to run.
+ */
+void HttpServer::post(Task task)
+{
+    {
+        std::lock_guard<std::mutex> lock(task_mutex);
+        tasks.push_back(task);
+    }
+
+    uint64_t value = 1;
+    ssize_t ignored = write(wake_fd, &value, sizeof(value));
+    (void)ignored;
+}
+
+
+/*!
+ * @brief
+ *   Wait for socket events and handle them.
+ *
+ * @param timeout_ms (IN)
+ *   Maximum time to wait for events in milliseconds.
+ */
+void HttpServer::run_once(int timeout_ms)
+{
+    if (timer_handler)
+    {
+        int64_t until_timer = next_timer_ms - monotonic_ms();
+        timeout_ms = (until_timer < timeout_ms) ? static_cast<int>(until_timer < 0 ? 0 : until_timer) : timeout_ms;
+    }
+
+    epoll_event events[MAX_EVENTS];
+    int count = epoll_wait(epoll_fd, events, MAX_EVENTS, timeout_ms);
+
+    for (int i = 0; i < count; i++)
+    {
+        ConnectionId id = events[i].data.u64;
+
+        if (id == LISTEN_ID)
+        {
+            accept_connections();
+        }
+        else if (id == WAKE_ID)
+        {
+            uint64_t value;
+            ssize_t ignored = read(wake_fd, &value, sizeof(value));
+            (void)ignored;
+            run_tasks();
+        }
+        else
+        {
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+            {
+                read_connection(id);
+            }
+
+            // Requests pipelined behind a body source are handled once it is sent
+            if (events[i].events & EPOLLOUT)
+            {
+                write_connection(id);
+                handle_input(id);
+            }
+        }
+    }
+
+    check_timer();
+    close_pending();
+}
+
+
+/*!
+ * @brief
+ *   Run event loop until stop() is called.
+ */
+void HttpServer::run()
+{
+    while (running)
+    {
+        run_once(1000);
+    }
+}
+
+
+/*!
+ * @brief
+ *   Stop event loop. Can be called from another thread or a signal handler.
+ */
+void HttpServer::stop()
+{
+    running = false;
+    uint64_t value = 1;
+    ssize_t ignored = write(wake_fd, &value, sizeof(value));
+    (void)ignored;
+}
+
+
+/*!
+ * @brief
+ *   Get number of open client connections.
+ */
+size_t HttpServer::connection_count() const
+{
+    return connections.size() - pending_close.size();
+}
+
+
+/*!
+ * @brief
+ *   Accept all pending connections from the listening socket.
+ */
+void HttpServer::accept_connections()
+{
+    while (true)
+    {
+        int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+        if (fd < 0)
+        {
+            return;
+        }
+
+        int enable = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+        ConnectionId id = next_id++;
+        Connection &connection = connections[id];
+        connection.fd = fd;
+
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u64 = id;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    }
+}
+
+
+/*!
+ * @brief
+ *   Read available data from a connection and handle complete requests.
+ *
+ * @param id (IN)
+ *   Connection to read from.
+ */
+void HttpServer::read_connection(ConnectionId id)
+{
+    auto it = connections.find(id);
+
+    if ((it == connections.end()) || (it->second.fd < 0))
+    {
+        return;
+    }
+
+    char buffer[READ_CHUNK_SIZE];
+
+    while (true)
+    {
+        ssize_t read_len = recv(it->second.fd, buffer, sizeof(buffer), 0);
+
+        if (read_len > 0)
+        {
+            // Streaming clients have nothing more to say, ignore their input
+            if (!it->second.streaming)
+            {
+                it->second.input.append(buffer, static_cast<size_t>(read_len));
+            }
+        }
+        else if ((read_len < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+        {
+            break;
+        }
+        else if ((read_len < 0) && (errno == EINTR))
+        {
+            continue;
+        }
+        else
+        {
+            close(id);
+            return;
+        }
+    }
+
+    handle_input(id);
+}
+
+
+/*!
+ * @brief
+ *   Parse and handle complete requests in connection input buffer.
+ *
+ * @param id (IN)
+ *   Connection to handle.
+ */
+void HttpServer::handle_input(ConnectionId id)
+{
+    while (true)
+    {
+        auto it = connections.find(id);
+
+        if ((it == connections.end()) || (it->second.fd < 0) || it->second.streaming || it->second.source ||
+            it->second.close_after_write)
+        {
+            return;
+        }
+
+        HttpRequest request;
+        size_t consumed = 0;
+        HttpParser::Result result = HttpParser::parse(it->second.input, request, consumed);
+
+        if (result == HttpParser::INCOMPLETE)
+        {
+            return;
+        }
+
+        HttpResponse response;
+        bool keep_alive = false;
+
+        if (result == HttpParser::BAD_REQUEST)
+        {
+            response.status = 400;
+            response.body = http_status_text(400);
+        }
+        else
+        {
+            it->second.input.erase(0, consumed);
+            keep_alive = request.keep_alive();
+
+            if (request_handler)
+            {
+                request_handler(id, request, response);
+            }
+            else
+            {
+                response.status = 404;
+            }
+        }
+
+        // Handler may have pushed to other connections, look this one up again
+        it = connections.find(id);
+
+        if ((it == connections.end()) || (it->second.fd < 0))
+        {
+            return;
+        }
+
+        it->second.streaming = response.stream;
+        it->second.source = response.source;
+        it->second.close_after_source = !keep_alive;
+        it->second.close_after_write = !response.stream && !response.source && !keep_alive;
+        send(id, http_format_response(response, keep_alive));
+    }
+}
+
+
+/*!
+ * @brief
+ *   Write as much queued data as the socket accepts.
+ *
+ * @param id (IN)
+ *   Connection to write to.
+ */
+void HttpServer::write_connection(ConnectionId id)
+{
+    auto it = connections.find(id);
+
+    if ((it == connections.end()) || (it->second.fd < 0))
+    {
+        return;
+    }
+
+    Connection &connection = it->second;
+    size_t written = 0;
+
+    // A body source is read only as fast as the socket takes its pieces
+    while (true)
+    {
+        if (connection.source && (connection.output.size() - written < SOURCE_LOW_WATER))
+        {
+            connection.output.erase(0, written);
+            written = 0;
+            fill_from_source(connection);
+        }
+
+        if (written == connection.output.size())
+        {
+            break;
+        }
+
+        ssize_t write_len = ::send(connection.fd, connection.output.data() + written,
+                                   connection.output.size() - written, MSG_NOSIGNAL);
+
+        if (write_len > 0)
+        {
+            written += static_cast<size_t>(write_len);
+        }
+        else if ((write_len < 0) && (errno == EINTR))
+        {
+            continue;
+        }
+        else if ((write_len < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+        {
+            break;
+        }
+        else
+        {
+            close(id);
+            return;
+        }
+    }
+
+    connection.output.erase(0, written);
+
+    if (connection.output.empty() && connection.close_after_write)
+    {
+        close(id);
+        return;
+    }
+
+    update_events(id, connection);
+}
+
+
+/*!
+ * @brief
+ *   Append the next piece of a body source to the output as an HTTP chunk,
+ *   and the last chunk when the source is done. The source writes into the
+ *   output buffer behind a chunk size of fixed width, which is filled in
+ *   afterwards, so the piece is not copied.
+ *
+ * @param connection (IN/OUT)
+ *   Connection with a body source.
+ */
+void HttpServer::fill_from_source(Connection &connection)
+{
+    static const char SIZE_PLACEHOLDER[] = "00000000\r\n";
+    const size_t size_digits = 8;
+    size_t header = connection.output.size();
+    connection.output += SIZE_PLACEHOLDER;
+    size_t start = connection.output.size();
+    bool more = connection.source(connection.output);
+    size_t size = connection.output.size() - start;
+
+    if (size == 0)
+    {
+        // A chunk of size 0 would end the body
+        connection.output.resize(header);
+    }
+    else
+    {
+        for (size_t i = 0; i < size_digits; i++)
+        {
+            connection.output[header + size_digits - 1 - i] = "0123456789abcdef"[(size >> (4 * i)) & 0xF];
+        }
+
+        connection.output += "\r\n";
+    }
+
+    if (!more)
+    {
+        connection.output += "0\r\n\r\n";
+        connection.source = nullptr;
+        connection.close_after_write = connection.close_after_source;
+    }
+}
+
+
+/*!
+ * @brief
+ *   Enable write events only while there is unsent data.
+ */
+void HttpServer::update_events(ConnectionId id, Connection &connection)
+{
+    bool want_write = !connection.output.empty() || connection.source;
+
+    if (want_write != connection.want_write)
+    {
+        epoll_event event = {};
+        event.events = want_write ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+        event.data.u64 = id;
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, connection.fd, &event);
+        connection.want_write = want_write;
+    }
+}
+
+
+/*!
+ * @brief
+ *   Remove connections closed during this event loop round.
+ */
+void HttpServer::close_pending()
+{
+    std::vector<ConnectionId> closed;
+    closed.swap(pending_close);
+
+    for (ConnectionId id : closed)
+    {
+        connections.erase(id);
+
+        if (close_handler)
+        {
+            close_handler(id);
+        }
+    }
+}
+
+
+/*!
+ * @brief
+ *   Call timer handler if the timer interval has passed.
+ */
+void HttpServer::check_timer()
+{
+    if (timer_handler && (monotonic_ms() >= next_timer_ms))
+    {
+        next_timer_ms = monotonic_ms() + timer_interval_ms;
+        timer_handler();
+    }
+}
+
+
+/*!
+ * @brief
+ *   Run tasks posted from other threads.
+ */
+void HttpServer::run_tasks()
+{
+    std::vector<Task> posted;
+
+    {
+        std::lock_guard<std::mutex> lock(task_mutex);
+        posted.swap(tasks);
+    }
+
+    for (Task &task : posted)
+    {
+        task();
+    }
+}
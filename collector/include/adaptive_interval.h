@@ -0,0 +1,103 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Measurement interval per station from the recent temperature dynamics.
+ *
+ * Between two uploads the temperature is read as the straight line between
+ * them, which is off by at most curvature * interval^2 / 8 for a curve
+ * with that second derivative. Each station's curvature is estimated from
+ * the change of slope over its last three samples, and the next interval
+ * keeps this error within half the error budget:
+ *
+ *   interval = sqrt(4 * error / curvature), within [min, max]
+ *
+ * Swings such as sunrise or a heating cycle bend the curve and shorten
+ * the interval at once. The estimate decays over two hours when the curve
+ * straightens, and the interval at most doubles per upload, so a station
+ * backs off gradually.
+ *
+ * A swing that starts between two long intervals is seen only after it.
+ * The highest curvature of each hour of the day is therefore kept as well,
+ * forgotten over a week, and a station wakes up at the start of the hours
+ * that were busy on the previous days, such as a heating schedule. The
+ * state is about 130 bytes per station, updated on every new sample.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "sample.h"
+
+/*! Hours in the curvature profile of a station */
+static const int PROFILE_HOURS = 24;
+
+struct IntervalSettings
+{
+    /*! Interval bounds in minutes */
+    int min_min;
+    int max_min;
+
+    /*! Allowed temperature error between uploads in degrees Celsius */
+    double error_c;
+};
+
+/*! Interval controller of one station */
+struct IntervalState
+{
+    /*! Samples seen, at most the 2 last are kept */
+    uint32_t samples;
+    int64_t time_s[2];
+    float temperature[2];
+
+    /*! Curvature estimate in degrees Celsius per minute squared */
+    double curvature;
+
+    /*! Highest curvature seen in each hour of the day, UTC */
+    float profile[PROFILE_HOURS];
+
+    /*! Interval given to the station in minutes */
+    int interval_min;
+};
+
+bool parse_interval_settings(const std::string &text, IntervalSettings &settings);
+void interval_reset(const IntervalSettings &settings, IntervalState &state);
+void interval_update(const IntervalSettings &settings, IntervalState &state, const Sample &sample);
+
+class AdaptiveInterval
+{
+public:
+    AdaptiveInterval(const IntervalSettings &interval_settings);
+    void on_sample(const std::string &station_id, const Sample &sample);
+    int interval(const std::string &station_id, int default_min);
+    const IntervalSettings &settings() const;
+
+private:
+    IntervalSettings limits;
+    std::mutex mutex;
+    std::unordered_map<std::string, IntervalState> stations;
+};
@@ -0,0 +1,97 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Destinations of alert events: a JSON lines file and a local webhook.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/*! Destination of alert events */
+class AlertSink
+{
+public:
+    virtual ~AlertSink() {}
+
+    /*! Deliver one event as a JSON object */
+    virtual void deliver(const std::string &json) = 0;
+};
+
+/*! Appends events as JSON lines to a file */
+class AlertFileSink : public AlertSink
+{
+public:
+    AlertFileSink(const std::string &file_path);
+    void deliver(const std::string &json);
+
+private:
+    std::string path;
+};
+
+/*! POSTs events to an HTTP URL from its own thread, so a slow receiver
+ *  does not hold up sample ingest */
+class AlertWebhookSink : public AlertSink
+{
+public:
+    AlertWebhookSink();
+    ~AlertWebhookSink();
+    bool open(const std::string &url);
+    void deliver(const std::string &json);
+    uint64_t delivered() const;
+    uint64_t dropped() const;
+
+    /*! Events waiting for delivery, older ones are dropped */
+    static const size_t MAX_QUEUE = 1024;
+
+    /*! Delivery attempts of an event */
+    static const int MAX_ATTEMPTS = 3;
+
+    /*! Wait before retrying a failed delivery */
+    static constexpr int RETRY_MS = 1000;
+
+    /*! Connect and response timeout */
+    static const int TIMEOUT_MS = 5000;
+
+private:
+    void run();
+    bool post(const std::string &json);
+
+    std::string host;
+    int port;
+    std::string path;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::string> queue;
+    bool stopping;
+    uint64_t delivered_count;
+    uint64_t dropped_count;
+    std::thread thread;
+};
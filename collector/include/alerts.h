@@ -0,0 +1,190 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Alert rules evaluated on every new sample.
+ *
+ * Rules are read from alerts.txt in the data directory, one per line:
+ *
+ *   # name   station  condition
+ *   frost    *        temperature < 0 for 30m
+ *   damp     attic    humidity >= 85 for 2h
+ *   silent   *        nodata 3
+ *
+ * A threshold rule fires when its condition has held for every sample of
+ * the station over the duration (s, m or h, default no duration), and
+ * resolves with the first sample where it does not. A nodata rule fires
+ * when a station has sent nothing for the given number of measurement
+ * intervals, and resolves with its next sample. Station "*" applies the
+ * rule to every station.
+ *
+ * Each rule keeps a few bytes of state per station, updated when a sample
+ * of the station arrives, so no history is read. Silence is found from a
+ * heap per nodata rule with one entry per station, ordered by the sample
+ * time it was queued with, so samples only update the station's last time
+ * and a check only looks at the entries that have just become too old. An
+ * entry of a station that has sent since is queued again with its last
+ * sample time.
+ * Events go to the sinks, see alert_sink.h.
+ *
+ * Stations are spread over shards by a hash of their ID, and each shard has
+ * its own lock, station state and silence queues. Samples of stations in
+ * different shards are evaluated in parallel.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "alert_sink.h"
+#include "sample.h"
+
+struct AlertRule
+{
+    enum Kind
+    {
+        THRESHOLD,
+        NO_DATA
+    };
+
+    enum Field
+    {
+        TEMPERATURE,
+        HUMIDITY
+    };
+
+    enum Compare
+    {
+        BELOW,
+        BELOW_OR_EQUAL,
+        ABOVE,
+        ABOVE_OR_EQUAL
+    };
+
+    std::string name;
+
+    /*! Station ID, "*" for all stations */
+    std::string station;
+    Kind kind;
+    Field field;
+    Compare compare;
+    double threshold;
+
+    /*! Time the condition must hold, or silence before a nodata rule fires */
+    int64_t duration_s;
+};
+
+/*! Rule firing or resolving for a station */
+struct AlertEvent
+{
+    std::string rule;
+    std::string station;
+    bool firing;
+    int64_t time_s;
+
+    /*! Sample value, NAN for nodata rules */
+    double value;
+};
+
+bool parse_alert_rule(const std::string &line, int interval_min, AlertRule &rule);
+
+class AlertEngine
+{
+public:
+    AlertEngine();
+    ~AlertEngine();
+    bool load(const std::string &rules_path, int interval_min, std::string &error);
+    void add_rule(const AlertRule &rule);
+    void add_sink(AlertSink *sink);
+    void track(const std::string &station_id, int64_t last_time_s);
+    void on_sample(const std::string &station_id, const Sample &sample, std::vector<AlertEvent> &events);
+    void check_silence(int64_t now_s, std::vector<AlertEvent> &events);
+    size_t rule_count() const;
+    size_t state_bytes() const;
+    static std::string event_to_json(const AlertEvent &event);
+
+private:
+    /*! State of one rule for one station */
+    struct RuleState
+    {
+        uint32_t rule;
+        bool firing;
+
+        /*! Nodata rules: the station has an entry in the rule's silence heap */
+        bool queued;
+
+        /*! Time of the first sample of the current run meeting the condition, -1 if none */
+        int64_t since_s;
+    };
+
+    struct StationAlerts
+    {
+        const std::string *id;
+        int64_t last_time_s;
+        std::vector<RuleState> rules;
+    };
+
+    /*! Sample time waiting in a nodata rule's silence heap */
+    struct SilenceEntry
+    {
+        StationAlerts *station;
+        uint32_t slot;
+        int64_t time_s;
+
+        bool operator>(const SilenceEntry &other) const
+        {
+            return time_s > other.time_s;
+        }
+    };
+
+    /*! Entries of a nodata rule, the oldest sample time first */
+    typedef std::priority_queue<SilenceEntry, std::vector<SilenceEntry>, std::greater<SilenceEntry>> SilenceHeap;
+
+    /*! Stations sharing a lock */
+    struct AlertShard
+    {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, StationAlerts> stations;
+        std::unordered_map<uint32_t, SilenceHeap> silence;
+    };
+
+    /*! Number of station shards */
+    static const size_t SHARDS = 64;
+
+    AlertShard &shard_of(const std::string &station_id);
+    StationAlerts &find_or_create(AlertShard &shard, const std::string &station_id);
+    void watch_silence(AlertShard &shard, StationAlerts &station, uint32_t slot);
+    void deliver(const std::vector<AlertEvent> &events, size_t first);
+
+    std::vector<AlertRule> rules;
+    std::vector<uint32_t> all_station_rules;
+    std::unordered_map<std::string, std::vector<uint32_t>> station_rules;
+    AlertShard shards[SHARDS];
+    std::vector<AlertSink *> sinks;
+};
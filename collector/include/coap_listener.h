@@ -0,0 +1,77 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * CoAP listener: lets stations upload with CoAP over UDP instead of HTTP.
+ *
+ * A confirmable POST to the samples or telemetry resource is handled as a
+ * POST of collect.php or telemetry, and a GET of the interval resource as
+ * a GET of interval.txt. The response is piggybacked on the ACK. Responses
+ * to recent requests are kept, so a retransmitted request whose ACK was
+ * lost is answered again without handling it twice.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <string>
+#include <netinet/in.h>
+#include "coap_codec.h"
+#include "collector.h"
+
+class CoapListener
+{
+public:
+    CoapListener(Collector &message_collector);
+    ~CoapListener();
+    bool listen(int port, const std::string &address = "0.0.0.0");
+    int port() const;
+    void run();
+    void stop();
+
+    /*! Poll timeout, the longest delay of stop() */
+    static const int POLL_INTERVAL_MS = 200;
+
+    /*! Number of recent responses kept for retransmitted requests */
+    static const size_t RECENT_RESPONSES = 64;
+
+private:
+    struct Exchange
+    {
+        sockaddr_in peer;
+        uint16_t message_id;
+        std::string response;
+    };
+
+    void handle_datagram(const sockaddr_in &peer, const std::string &data);
+    std::string handle_request(const CoapMessage &request);
+    static uint8_t response_code(int status, uint8_t success_code);
+
+    Collector &collector;
+    int fd;
+    int bound_port;
+    std::atomic<bool> running;
+    std::deque<Exchange> recent;
+};
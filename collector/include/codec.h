@@ -0,0 +1,157 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Compressed sample blocks.
+ *
+ * A block holds a run of samples of one station in the style of Facebook's
+ * Gorilla time series store. The first sample is stored as is. After that,
+ * times and sequence numbers are stored as the change of their delta
+ * (delta-of-delta), which is zero for evenly spaced samples, temperatures as
+ * the XOR of the previous float and humidities as the delta of the previous
+ * value. Every value is packed to a variable number of bits, so a station
+ * sampling once a minute takes about five bytes per sample.
+ *
+ * Blocks are decoded one sample at a time, so a scan needs no buffer for the
+ * decoded samples. In a block file every block has a header with its sample
+ * count and time range, so a range scan skips blocks outside the range
+ * without decoding them.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "sample.h"
+
+/*! Bit stream writer, most significant bit first */
+class BitWriter
+{
+public:
+    BitWriter();
+    void write(uint64_t bits, int count);
+    void clear();
+    const std::vector<uint8_t> &bytes() const;
+
+private:
+    std::vector<uint8_t> buffer;
+    int free_bits;
+};
+
+/*! Bit stream reader */
+class BitReader
+{
+public:
+    BitReader(const uint8_t *data, size_t size);
+    bool read(int count, uint64_t &bits);
+
+private:
+    const uint8_t *data;
+    size_t size_bits;
+    size_t position;
+};
+
+/*! Encoder of one compressed block */
+class BlockEncoder
+{
+public:
+    BlockEncoder();
+    void append(const Sample &sample);
+    void clear();
+    size_t count() const;
+    int64_t first_time() const;
+    int64_t last_time() const;
+    const std::vector<uint8_t> &bytes() const;
+
+private:
+    BitWriter writer;
+    size_t samples;
+    int64_t first_time_s;
+    Sample previous;
+    int64_t time_delta;
+    int64_t sequence_delta;
+    int leading_zeros;
+    int trailing_zeros;
+};
+
+/*! Streaming decoder of one compressed block */
+class BlockDecoder
+{
+public:
+    BlockDecoder(const uint8_t *data, size_t size, size_t count);
+    bool next(Sample &sample);
+
+private:
+    BitReader reader;
+    size_t remaining;
+    size_t decoded;
+    Sample previous;
+    int64_t time_delta;
+    int64_t sequence_delta;
+    int leading_zeros;
+    int trailing_zeros;
+};
+
+/*! Header of a block in a block file */
+struct BlockHeader
+{
+    /*! Number of samples */
+    uint32_t count;
+
+    /*! Size of the encoded samples after the header in bytes */
+    uint32_t size;
+
+    /*! Time of the first sample */
+    int64_t first_time_s;
+
+    /*! Time of the last sample */
+    int64_t last_time_s;
+
+    /*! Size of the header in the file */
+    static const size_t SIZE = 24;
+
+    void encode(uint8_t *data) const;
+    bool decode(const uint8_t *data);
+};
+
+/*! Streaming range scan of a block file */
+class BlockScanner
+{
+public:
+    BlockScanner(int file_descriptor, int64_t from_s, int64_t to_s);
+    bool next(Sample &sample);
+    size_t valid_size() const;
+
+private:
+    bool next_block();
+
+    int fd;
+    int64_t from;
+    int64_t to;
+    size_t offset;
+    size_t file_size;
+    std::vector<uint8_t> payload;
+    BlockDecoder decoder;
+};
@@ -0,0 +1,97 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Weather station data collector: receives samples from the stations, stores
+ * them per station, answers dashboard queries and pushes new samples to
+ * dashboard clients. New samples are checked against the alert rules, see
+ * alerts.h. With an adaptive interval, each station gets its own measurement
+ * interval, see adaptive_interval.h. Upload slots and an upload limiter
+ * spread the wakes of the stations, see upload_schedule.h.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "adaptive_interval.h"
+#include "alerts.h"
+#include "http_server.h"
+#include "sample.h"
+#include "sse.h"
+#include "store.h"
+#include "upload_schedule.h"
+
+class Collector
+{
+public:
+    Collector(HttpServer &http_server, Store &sample_store, const std::string &data_dir);
+    ~Collector();
+    void add_peer(Collector *peer);
+    void set_alerts(AlertEngine *engine);
+    void set_adaptive_interval(AdaptiveInterval *adaptive);
+    void set_upload_schedule(UploadSlots *upload_slots, UploadLimiter *upload_limiter);
+    StationShard::Result ingest(const std::string &station_id, const std::vector<Sample> &samples, uint32_t epoch);
+    size_t subscriber_count() const;
+    int handle_message(const std::string &method, const std::string &path, const std::string &body,
+                       std::string &response_body);
+    int handle_message(const std::string &method, const std::string &path, const std::string &body,
+                       std::string &response_body, int &retry_after_s);
+    static std::string sample_to_json(const std::string &station_id, const Sample &sample);
+
+    /*! Interval between heartbeats to idle dashboard clients */
+    static const int HEARTBEAT_INTERVAL_MS = 15000;
+
+    /*! Longest wait for the event loop to handle a message */
+    static constexpr int MESSAGE_TIMEOUT_MS = 5000;
+
+    /*! Maximum number of telemetry records returned by one query */
+    static const size_t MAX_TELEMETRY_RECORDS = 1000;
+
+    /*! Station ID for stations that do not send one */
+    static const char *const DEFAULT_STATION;
+
+private:
+    void publish(const std::string &event, const std::string &data);
+    void publish_alerts(const std::vector<AlertEvent> &events);
+    void handle_request(HttpServer::ConnectionId id, const HttpRequest &request, HttpResponse &response);
+    void handle_collect(const HttpRequest &request, HttpResponse &response);
+    void handle_interval(const HttpRequest &request, HttpResponse &response);
+    void handle_query(const HttpRequest &request, HttpResponse &response);
+    void handle_export(const HttpRequest &request, HttpResponse &response);
+    void handle_stations(HttpResponse &response);
+    void handle_telemetry_post(const HttpRequest &request, HttpResponse &response);
+    void handle_telemetry_get(const HttpRequest &request, HttpResponse &response);
+
+    HttpServer &server;
+    Store &store;
+    SseHub hub;
+    std::string interval_path;
+    std::string telemetry_dir;
+    std::vector<Collector *> peers;
+    AlertEngine *alerts;
+    AdaptiveInterval *intervals;
+    UploadSlots *slots;
+    UploadLimiter *limiter;
+};
@@ -0,0 +1,64 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Metrics derived from temperature and relative humidity: dew point,
+ * absolute humidity and heat index.
+ *
+ * The kernels take a series as columns of temperatures and humidities and
+ * write one column of results. The loops have no branches or calls, and
+ * logarithms and exponentials are polynomial approximations on the float
+ * bit fields, so the compiler can vectorise them. Against the scalar
+ * reference functions with the C library, dew point is within 0.001 degrees
+ * and absolute humidity within 1e-5 relative over the sensors' range; heat
+ * index uses no transcendental functions and differs only by rounding.
+ *
+ * Dew point and absolute humidity use the Magnus formula with the Sonntag
+ * 1990 constants. Heat index is the NOAA one: Steadman's simple formula,
+ * and the Rothfusz regression with its adjustments when it is hot.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/*! Derived metrics of a query, bits of Query::metrics */
+enum DerivedMetric
+{
+    METRIC_DEW_POINT = 1,
+    METRIC_ABSOLUTE_HUMIDITY = 2,
+    METRIC_HEAT_INDEX = 4
+};
+
+float derived_log(float x);
+float derived_exp(float x);
+void dew_point_series(const float *temperature, const float *humidity, size_t count, float *dew_point);
+void absolute_humidity_series(const float *temperature, const float *humidity, size_t count,
+                              float *absolute_humidity);
+void heat_index_series(const float *temperature, const float *humidity, size_t count, float *heat_index);
+double dew_point_reference(double temperature, double humidity);
+double absolute_humidity_reference(double temperature, double humidity);
+double heat_index_reference(double temperature, double humidity);
+bool parse_metrics(const std::string &text, unsigned &metrics);
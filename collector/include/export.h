@@ -0,0 +1,125 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Bulk export of the samples of one station in a time range, as CSV or as
+ * compact binary columns, for analysis outside the collector.
+ *
+ * An ExportStream is a body source for HttpResponse: it takes a snapshot of
+ * the station and formats up to CHUNK_SAMPLES samples at a time straight
+ * into the connection's output buffer as the client reads, so an export of
+ * years of samples takes constant memory and no intermediate copies.
+ *
+ * The binary format is the magic "WSC1" followed by chunks. A chunk is a
+ * header of sample count, minimum and maximum time, temperature and
+ * humidity, then the columns time, temperature, humidity and sequence of
+ * its samples. All values are little endian; the export ends with a chunk
+ * of count 0. With the per chunk statistics a reader can skip chunks out of
+ * the range it is interested in without decoding their columns:
+ *
+ *   uint32 count, int64 min_time, int64 max_time, float min_temperature,
+ *   float max_temperature, int32 min_humidity, int32 max_humidity,
+ *   int64 time[count], float temperature[count], int32 humidity[count],
+ *   uint32 sequence[count]
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+#include "sample.h"
+#include "store.h"
+
+/*! Export output format */
+enum ExportFormat
+{
+    EXPORT_CSV,
+    EXPORT_COLUMNS
+};
+
+struct ExportQuery
+{
+    /*! Station ID */
+    std::string station;
+
+    /*! Start of time range [from_s, to_s) as Unix time */
+    int64_t from_s = std::numeric_limits<int64_t>::min();
+
+    /*! End of time range [from_s, to_s) as Unix time */
+    int64_t to_s = std::numeric_limits<int64_t>::max();
+
+    /*! Output format */
+    ExportFormat format = EXPORT_CSV;
+};
+
+/*! Statistics of one chunk of binary columns */
+struct ExportChunkStats
+{
+    uint32_t count;
+    int64_t min_time_s;
+    int64_t max_time_s;
+    float min_temperature;
+    float max_temperature;
+    int32_t min_humidity;
+    int32_t max_humidity;
+};
+
+class ExportStream
+{
+public:
+    ExportStream(const ShardView &view, const ExportQuery &query);
+    bool next(std::string &out);
+
+    /*! Maximum samples formatted at a time and in a binary chunk */
+    static const size_t CHUNK_SAMPLES = 4096;
+
+    /*! Magic at the start of binary columns */
+    static const char MAGIC[5];
+
+    /*! Bytes of a binary chunk header */
+    static const size_t CHUNK_HEADER_BYTES = 36;
+
+    /*! Bytes of one sample in binary columns */
+    static const size_t COLUMN_SAMPLE_BYTES = 20;
+
+    /*! First line of CSV */
+    static const char CSV_HEADER[];
+
+private:
+    void write_csv(std::string &out, size_t begin, size_t end) const;
+    void write_columns(std::string &out, size_t begin, size_t end) const;
+
+    ShardView view;
+    ExportFormat format;
+    size_t position;
+    size_t end;
+    bool started;
+};
+
+bool parse_export(const std::map<std::string, std::string> &fields, ExportQuery &query);
+bool export_decode_columns(const std::string &data, std::vector<ExportChunkStats> &chunks,
+                           std::vector<Sample> &samples);
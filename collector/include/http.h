@@ -0,0 +1,88 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Minimal HTTP/1.1 request parsing and response formatting for the collector.
+ */
+
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*! Parsed HTTP request. Header names are stored in lower case. */
+struct HttpRequest
+{
+    std::string method;
+    std::string path;
+    std::string query;
+    std::string version;
+    std::map<std::string, std::string> headers;
+    std::string body;
+
+    std::string header(const std::string &name) const;
+    bool keep_alive() const;
+};
+
+/*! HTTP response to be formatted by http_format_response() */
+struct HttpResponse
+{
+    int status = 200;
+    std::string content_type = "text/plain";
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+
+    /*! Keep the connection open after the headers for pushing more data */
+    bool stream = false;
+
+    /*! Producer of a body sent with chunked transfer encoding as the client
+     *  reads it, instead of body. Appends the next piece of the body to its
+     *  argument, the connection's output buffer, and returns false after
+     *  the last piece. */
+    std::function<bool(std::string &)> source;
+};
+
+class HttpParser
+{
+public:
+    enum Result
+    {
+        INCOMPLETE,
+        COMPLETE,
+        BAD_REQUEST
+    };
+
+    static Result parse(const std::string &buffer, HttpRequest &request, size_t &consumed);
+
+    static const size_t MAX_HEADER_SIZE = 8192;
+    static const size_t MAX_BODY_SIZE = 65536;
+};
+
+std::string http_format_response(const HttpResponse &response, bool keep_alive);
+std::string http_status_text(int status);
+std::string http_url_decode(const std::string &text);
+std::map<std::string, std::string> http_parse_form(const std::string &text);
@@ -0,0 +1,112 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Single threaded epoll event loop serving HTTP requests and long lived
+ * streaming connections. Several loops can share a port to use several cores;
+ * post() runs work in another loop's thread. Large bodies are produced by a
+ * body source as the client reads them, so they are never held whole.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "http.h"
+
+class HttpServer
+{
+public:
+    typedef uint64_t ConnectionId;
+    typedef std::function<void(ConnectionId, const HttpRequest &, HttpResponse &)> RequestHandler;
+    typedef std::function<void(ConnectionId)> CloseHandler;
+    typedef std::function<void()> TimerHandler;
+    typedef std::function<void()> Task;
+
+    HttpServer();
+    ~HttpServer();
+    bool listen(int port, const std::string &address = "0.0.0.0", bool reuse_port = false);
+    int port() const;
+    void set_request_handler(RequestHandler handler);
+    void set_close_handler(CloseHandler handler);
+    void set_timer(int interval_ms, TimerHandler handler);
+    bool send(ConnectionId id, const std::string &data);
+    void close(ConnectionId id);
+    void post(Task task);
+    void run_once(int timeout_ms);
+    void run();
+    void stop();
+    size_t connection_count() const;
+
+    static const size_t MAX_OUTPUT_BUFFER = 256 * 1024;
+    static const int MAX_EVENTS = 256;
+    static const int LISTEN_BACKLOG = 1024;
+
+    /*! Pieces of a body source are taken while less than this is unsent */
+    static const size_t SOURCE_LOW_WATER = 64 * 1024;
+
+private:
+    struct Connection
+    {
+        int fd;
+        std::string input;
+        std::string output;
+        bool streaming = false;
+        std::function<bool(std::string &)> source;
+        bool close_after_source = false;
+        bool close_after_write = false;
+        bool want_write = false;
+    };
+
+    void accept_connections();
+    void read_connection(ConnectionId id);
+    void write_connection(ConnectionId id);
+    void fill_from_source(Connection &connection);
+    void update_events(ConnectionId id, Connection &connection);
+    void handle_input(ConnectionId id);
+    void close_pending();
+    void check_timer();
+    void run_tasks();
+
+    int epoll_fd;
+    int listen_fd;
+    int wake_fd;
+    int bound_port;
+    std::atomic<bool> running;
+    ConnectionId next_id;
+    std::unordered_map<ConnectionId, Connection> connections;
+    std::vector<ConnectionId> pending_close;
+    RequestHandler request_handler;
+    CloseHandler close_handler;
+    TimerHandler timer_handler;
+    int timer_interval_ms;
+    int64_t next_timer_ms;
+    std::mutex task_mutex;
+    std::vector<Task> tasks;
+};
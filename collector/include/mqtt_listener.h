@@ -0,0 +1,78 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * MQTT listener: lets stations upload with MQTT instead of HTTP.
+ *
+ * Not a general broker, only what the station's MqttTransport uses. A
+ * PUBLISH with QoS 1 to the samples or telemetry topic is handled as a POST
+ * of collect.php or telemetry, and PUBACK is sent when the collector has
+ * stored it, or rejected it as invalid so that the station does not resend
+ * it. Subscribing to the interval topic returns interval.txt for the
+ * station, whose ID is the client ID, as a retained message. All connections are served by one thread with poll().
+ */
+
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <string>
+#include "collector.h"
+#include "mqtt_codec.h"
+
+class MqttListener
+{
+public:
+    MqttListener(Collector &message_collector);
+    ~MqttListener();
+    bool listen(int port, const std::string &address = "0.0.0.0");
+    int port() const;
+    void run();
+    void stop();
+
+    /*! Poll timeout, the longest delay of stop() */
+    static const int POLL_INTERVAL_MS = 200;
+
+    /*! Maximum number of connections */
+    static const size_t MAX_CONNECTIONS = 1024;
+
+private:
+    /*! State of a connection */
+    struct Session
+    {
+        bool connected;
+        std::string client_id;
+    };
+
+    void accept_connection();
+    bool handle_input(int fd, std::string &input);
+    bool handle_packet(int fd, const MqttPacket &packet, Session &session);
+
+    Collector &collector;
+    int listen_fd;
+    int bound_port;
+    std::atomic<bool> running;
+    std::map<int, std::string> connections;
+    std::map<int, Session> sessions;
+};
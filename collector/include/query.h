@@ -0,0 +1,71 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Time range queries over one station or an aggregate of all stations, run
+ * on a snapshot of the store so that writers are neither blocked nor seen
+ * half way.
+ *
+ * Results can carry metrics derived from their temperature and humidity,
+ * see derived.h.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+#include "sample.h"
+#include "store.h"
+
+struct Query
+{
+    /*! Station ID, empty for the aggregate of all stations */
+    std::string station;
+
+    /*! Start of time range [from_s, to_s) as Unix time */
+    int64_t from_s = std::numeric_limits<int64_t>::min();
+
+    /*! End of time range [from_s, to_s) as Unix time */
+    int64_t to_s = std::numeric_limits<int64_t>::max();
+
+    /*! Bucket length for averaging in seconds, 0 for raw samples */
+    int64_t step_s = 0;
+
+    /*! Return only the last samples or buckets, 0 for all */
+    size_t last = 0;
+
+    /*! Derived metrics to add to each sample or bucket, DerivedMetric bits */
+    unsigned metrics = 0;
+
+    /*! Bucket length used for aggregates if step_s is not given */
+    static const int64_t DEFAULT_AGGREGATE_STEP_S = 60;
+};
+
+bool parse_query(const std::map<std::string, std::string> &fields, Query &query);
+std::vector<Sample> run_query(const Store &store, const Query &query);
+std::vector<Sample> run_query(const StoreSnapshot &snapshot, const Query &query);
+std::string samples_to_json(const std::vector<Sample> &samples, unsigned metrics = 0);
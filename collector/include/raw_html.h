@@ -0,0 +1,82 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Reader of legacy raw.html sample logs.
+ *
+ * The PHP collect.php appended every sample to raw.html as one paragraph in
+ * local time, with no line breaks between paragraphs:
+ *
+ *   <p>2019-06-01 12:00:00&nbsp;&nbsp;&nbsp;&nbsp;Temperature: 21.5 &deg;C
+ *   &nbsp;&nbsp;&nbsp;&nbsp;Humidity: 40</p>
+ *
+ * A file is memory mapped and split into ranges at paragraph starts, so that
+ * the ranges can be parsed in parallel and concatenated in file order.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <utility>
+#include <vector>
+#include "sample.h"
+
+/*! Converter of local times to Unix time, caching one mktime() per hour */
+class LocalTimeCache
+{
+public:
+    LocalTimeCache();
+    int64_t to_unix(int year, int month, int day, int hour, int minute, int second);
+
+private:
+    int cached_year;
+    int cached_month;
+    int cached_day;
+    int cached_hour;
+    int64_t hour_start;
+};
+
+/*! Memory mapped raw.html file */
+class RawHtmlFile
+{
+public:
+    RawHtmlFile();
+    ~RawHtmlFile();
+    bool open(const std::string &path);
+    const char *data() const;
+    size_t size() const;
+    std::vector<std::pair<size_t, size_t>> split(size_t parts) const;
+
+private:
+    const char *mapping;
+    size_t length;
+};
+
+bool parse_raw_html_line(const char *begin, const char *end, LocalTimeCache &times, Sample &sample);
+size_t parse_raw_html(const char *data, size_t begin, size_t end, std::vector<Sample> &samples,
+                      std::atomic<size_t> &progress);
@@ -0,0 +1,62 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Server-Sent Events fan-out to dashboard clients.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_set>
+#include "http_server.h"
+
+class SseHub
+{
+public:
+    SseHub(HttpServer &http_server);
+    ~SseHub();
+    void subscribe(HttpServer::ConnectionId id, const HttpRequest &request, HttpResponse &response);
+    void unsubscribe(HttpServer::ConnectionId id);
+    void publish(uint64_t event_id, const std::string &frame);
+    void heartbeat();
+    size_t subscriber_count() const;
+    static uint64_t allocate_event_id();
+    static std::string format_event(uint64_t id, const std::string &event, const std::string &data);
+
+    /*! Events kept for clients reconnecting with Last-Event-ID */
+    static const size_t REPLAY_EVENTS = 64;
+
+    /*! Client reconnect delay sent in the stream */
+    static const int RETRY_MS = 10000;
+
+private:
+    HttpServer &server;
+    std::unordered_set<HttpServer::ConnectionId> subscribers;
+    std::deque<std::pair<uint64_t, std::string>> recent_events;
+    static std::atomic<uint64_t> next_event_id;
+};
@@ -0,0 +1,208 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Sample storage sharded by station.
+ *
+ * Every station has its own shard: an append-only sample log on disk and in
+ * memory. Appending takes no locks. A writer reserves a slot with an atomic
+ * counter, writes the sample to its slot in memory and in the file, and then
+ * publishes it by advancing the shard's committed count. Readers only look at
+ * committed samples, so they never see a half written one.
+ *
+ * Stations number their samples and resend a sample when the response to an
+ * upload is lost. Each shard remembers the sequence numbers of a window of
+ * recent samples, so a resent sample is dropped in O(1) without searching
+ * the log. The samples of one upload share its sequence number and are
+ * appended together in consecutive slots.
+ *
+ * A resend is always within the window, so a number further back means that
+ * the station has lost its counter, and the window starts again. A station
+ * also sends the epoch of its counter, drawn when the counter starts from
+ * scratch, and a new epoch starts the window again however close the new
+ * numbers are to the old ones. The epoch and the log index where it started
+ * are kept in the shard's epoch file, so loading rebuilds the same window.
+ *
+ * When a memory chunk is full, its samples are sealed into a compressed block
+ * (see codec.h) in the shard's block file and the chunk's records are punched
+ * out of the sample log. The log keeps its record offsets, but only the
+ * unsealed tail takes disk space. A sealed chunk is freed as soon as no
+ * snapshot older than its block can read it, so memory holds only the
+ * unsealed tail too. Loading only reads the rest of the log to memory.
+ *
+ * Queries read through a StoreSnapshot, which takes the committed count of
+ * each shard once when it is made. A query then sees the same samples from
+ * start to end however many passes it makes over them, and neither it nor
+ * the writers take a lock: a snapshot costs one atomic load per shard, and
+ * samples committed after it are published to the next one. A view reads
+ * the samples sealed before it was taken from the block file, one decoded
+ * block at a time, and the rest from memory.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "sample.h"
+
+class StationShard
+{
+public:
+    /*! Result of append() */
+    enum Result
+    {
+        APPENDED,
+        DUPLICATE,
+        FAILED
+    };
+
+    StationShard(const std::string &station_id, int file_descriptor, int block_file_descriptor,
+                 int epoch_file_descriptor);
+    ~StationShard();
+    Result append(const Sample &sample);
+    Result append(const std::vector<Sample> &samples, uint32_t epoch);
+    size_t size() const;
+    Sample at(size_t index) const;
+    const std::string &id() const;
+    uint32_t last_sequence() const;
+    size_t sealed_chunks() const;
+
+    /*! Samples per memory chunk */
+    static const size_t CHUNK_SAMPLES = 4096;
+
+    /*! Maximum number of chunks, 16M samples or 30 years at one per minute */
+    static const size_t MAX_CHUNKS = 4096;
+
+    /*! Size of one sample record in the shard file */
+    static const size_t RECORD_SIZE = 20;
+
+    /*! Number of recent sequence numbers remembered for duplicate detection */
+    static const uint32_t DEDUP_WINDOW = 64;
+
+private:
+    struct Chunk
+    {
+        Sample samples[CHUNK_SAMPLES];
+    };
+
+    Result append(const Sample *samples, size_t count, uint32_t epoch);
+    Chunk *get_chunk(size_t chunk_index);
+    bool claim_sequence(uint32_t sequence, uint32_t epoch, uint32_t &previous);
+    void release_sequence(uint32_t sequence, uint32_t previous);
+    void forget_sequences(uint32_t highest);
+    void seal(size_t chunk_index);
+    bool read_block(size_t chunk_index, std::vector<Sample> &samples) const;
+    size_t find_block(int64_t time_s, size_t block_count) const;
+    bool load();
+    static void encode(const Sample &sample, uint8_t *record);
+    static void decode(const uint8_t *record, Sample &sample);
+
+    friend class Store;
+    friend class ShardView;
+
+    std::string station;
+    int fd;
+    int block_fd;
+    int epoch_fd;
+    uint64_t epoch_start;
+    size_t block_file_size;
+    bool sealing;
+    size_t loaded_chunks;
+    size_t freed_chunks;
+    std::atomic<size_t> sealed;
+    std::atomic<size_t> blocks;
+    mutable std::atomic<size_t> readers;
+    uint64_t block_offsets[MAX_CHUNKS];
+    std::atomic<Chunk *> chunks[MAX_CHUNKS];
+    std::atomic<size_t> reserved;
+    std::atomic<size_t> committed;
+    std::atomic<uint32_t> seen[DEDUP_WINDOW];
+    std::atomic<uint32_t> high_water;
+    std::atomic<uint32_t> sequence_epoch;
+};
+
+/*! Committed samples of one shard when a snapshot was taken. A view keeps
+ *  the last block it decoded, so it is used by one thread at a time. */
+class ShardView
+{
+public:
+    ShardView(const StationShard &station_shard);
+    ShardView(const ShardView &other);
+    ~ShardView();
+    ShardView &operator=(const ShardView &other);
+    size_t size() const;
+    Sample at(size_t index) const;
+    size_t lower_bound(int64_t time_s) const;
+    const std::string &id() const;
+
+private:
+    const StationShard *shard;
+    size_t count;
+    size_t cold_chunks;
+    mutable size_t cached_chunk;
+    mutable std::vector<Sample> cached_samples;
+};
+
+class Store;
+
+/*! Views of all shards or of one station, taken together */
+class StoreSnapshot
+{
+public:
+    StoreSnapshot(const Store &store);
+    StoreSnapshot(const Store &store, const std::string &station_id);
+    const std::vector<ShardView> &shards() const;
+    const ShardView *find(const std::string &station_id) const;
+
+private:
+    std::vector<ShardView> views;
+};
+
+class Store
+{
+public:
+    Store(const std::string &data_dir);
+    ~Store();
+    bool open();
+    StationShard::Result append(const std::string &station_id, const Sample &sample);
+    StationShard::Result append(const std::string &station_id, const std::vector<Sample> &samples, uint32_t epoch);
+    StationShard *find(const std::string &station_id) const;
+    std::vector<StationShard *> shards() const;
+    static bool valid_station_id(const std::string &station_id);
+
+    /*! Maximum number of stations */
+    static const size_t MAX_STATIONS = 4096;
+
+    /*! Maximum length of station ID */
+    static const size_t MAX_STATION_ID_LENGTH = 32;
+
+private:
+    StationShard *find_or_create(const std::string &station_id);
+    size_t slot_of(const std::string &station_id) const;
+
+    std::string directory;
+    std::atomic<StationShard *> table[MAX_STATIONS];
+};
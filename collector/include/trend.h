@@ -0,0 +1,51 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Samples of a light sleep window reconstructed from the swing-door trends
+ * posted by the station, see swing_door.h.
+ *
+ * The station posts the points of its temperature and humidity trends as
+ * "age:value" separated by commas, age in seconds before its last sample.
+ * The collector stores a sample at each point of either trend, with both
+ * values interpolated from their trends. Any sample of the window is then
+ * within the station's deviations, plus rounding to the posted decimal and
+ * the stored whole humidity, of the line between the stored samples around
+ * it.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "sample.h"
+#include "swing_door.h"
+
+/*! Maximum number of points of a posted trend */
+static const size_t MAX_TREND_POINTS = 256;
+
+bool parse_trend(const std::string &text, std::vector<TrendPoint> &points);
+std::vector<Sample> trend_samples(const std::vector<TrendPoint> &temperature, const std::vector<TrendPoint> &humidity,
+                                  int64_t end_s, int64_t after_s, uint32_t sequence);
@@ -0,0 +1,75 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Spreading of station uploads over the measurement interval.
+ *
+ * Stations that were powered on together wake up in the same second every
+ * interval. UploadSlots gives each station a phase within the interval,
+ * spread by the golden ratio so that the phases stay even however many
+ * stations there are, and tells the station how far to move its next wake
+ * to reach its phase: the "offset" line of interval.txt, see
+ * station_config.h. A station reaches its phase after one wake and keeps
+ * it, as the offset is then close to zero.
+ *
+ * UploadLimiter admits wakes at a sustained rate with a burst of
+ * BURST_S seconds, a generic cell rate algorithm. A rejected wake is told
+ * when to come back, and the rejected wakes are given successive times at
+ * the admitted rate, so that they do not return together.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class UploadSlots
+{
+public:
+    uint32_t slot(const std::string &station_id);
+    int offset_s(const std::string &station_id, int interval_s, int64_t now_s);
+    size_t size();
+
+private:
+    std::mutex mutex;
+    std::unordered_map<std::string, uint32_t> slots;
+};
+
+class UploadLimiter
+{
+public:
+    UploadLimiter(double wakes_per_s);
+    bool admit(double now_s, int &retry_after_s);
+
+    /*! Wakes admitted at once after an idle period, in seconds of the rate */
+    static constexpr double BURST_S = 1.0;
+
+private:
+    double period_s;
+    double admit_at_s;
+    double retry_at_s;
+    std::mutex mutex;
+};
@@ -0,0 +1,323 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Weather station data collector.
+ *
+ * Replaces collect.php: stations post their samples to the collector, which
+ * stores them per station under data_dir/stations, answers weather.php
+ * queries and pushes every new sample to the dashboards subscribed to
+ * /events. With -t the collector runs an event loop per thread on the same
+ * port. With -m and -u stations can also upload with MQTT and CoAP.
+ *
+ * New samples are checked against the alert rules in data_dir/alerts.txt.
+ * Alerts are appended to data_dir/alerts.jsonl, pushed to dashboards and,
+ * with -w, posted to a local webhook.
+ *
+ * With -i each station gets its own measurement interval between min and
+ * max minutes from its recent samples, see adaptive_interval.h.
+ *
+ * With -s each station gets its own upload phase of the interval, and with
+ * -r wakes over the given rate per second are turned away with a time to
+ * retry, see upload_schedule.h.
+ *
+ * Usage: collector [-p port] [-a address] [-d data_dir] [-t threads] [-m mqtt_port] [-u coap_port]
+ *                  [-w webhook_url] [-i min:max:error] [-s] [-r wakes_per_s]
+ */
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "adaptive_interval.h"
+#include "alerts.h"
+#include "coap_listener.h"
+#include "collector.h"
+#include "http_server.h"
+#include "mqtt_listener.h"
+#include "store.h"
+
+/*! Default TCP port */
+static const int DEFAULT_PORT = 8080;
+
+/*! Measurement interval of nodata alert rules without interval.txt */
+static const int DEFAULT_INTERVAL_MIN = 10;
+
+/*! Servers for signal handler */
+static std::vector<std::unique_ptr<HttpServer>> servers;
+
+/*! Listeners for signal handler */
+static std::unique_ptr<MqttListener> mqtt_listener;
+static std::unique_ptr<CoapListener> coap_listener;
+
+
+/*!
+ * @brief
+ *   Stop collector on SIGINT and SIGTERM.
+ */
+static void stop_handler(int signal_number)
+{
+    for (auto &server : servers)
+    {
+        server->stop();
+    }
+
+    if (mqtt_listener)
+    {
+        mqtt_listener->stop();
+    }
+
+    if (coap_listener)
+    {
+        coap_listener->stop();
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    int port = DEFAULT_PORT;
+    std::string address = "0.0.0.0";
+    std::string data_dir = ".";
+    int threads = 1;
+    int mqtt_port = -1;
+    int coap_port = -1;
+    std::string webhook_url;
+    IntervalSettings interval_settings = {};
+    bool adaptive = false;
+    bool upload_slots = false;
+    double wakes_per_s = 0;
+    int option;
+
+    while ((option = getopt(argc, argv, "p:a:d:t:m:u:w:i:sr:")) != -1)
+    {
+        switch (option)
+        {
+            case 'p':
+                port = atoi(optarg);
+                break;
+            case 'a':
+                address = optarg;
+                break;
+            case 'd':
+                data_dir = optarg;
+                break;
+            case 't':
+                threads = atoi(optarg);
+                break;
+            case 'm':
+                mqtt_port = atoi(optarg);
+                break;
+            case 'u':
+                coap_port = atoi(optarg);
+                break;
+            case 'w':
+                webhook_url = optarg;
+                break;
+            case 'i':
+                adaptive = true;
+
+                if (!parse_interval_settings(optarg, interval_settings))
+                {
+                    fprintf(stderr, "Invalid interval settings %s, use min:max:error like 1:60:0.2\n", optarg);
+                    return EXIT_FAILURE;
+                }
+
+                break;
+            case 's':
+                upload_slots = true;
+                break;
+            case 'r':
+                wakes_per_s = atof(optarg);
+
+                if (wakes_per_s <= 0)
+                {
+                    fprintf(stderr, "Invalid upload rate %s, use wakes per second like 5\n", optarg);
+                    return EXIT_FAILURE;
+                }
+
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-p port] [-a address] [-d data_dir] [-t threads] [-m mqtt_port] "
+                        "[-u coap_port] [-w webhook_url] [-i min:max:error] [-s] [-r wakes_per_s]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    Store store(data_dir + "/stations");
+
+    if (!store.open())
+    {
+        fprintf(stderr, "Cannot open store in %s/stations\n", data_dir.c_str());
+        return EXIT_FAILURE;
+    }
+
+    // Nodata rules count intervals as set when the collector starts
+    int interval_min = DEFAULT_INTERVAL_MIN;
+    std::ifstream interval_file(data_dir + "/interval.txt");
+    interval_file >> interval_min;
+    interval_min = (interval_min > 0) ? interval_min : DEFAULT_INTERVAL_MIN;
+
+    AlertEngine alerts;
+    AlertFileSink alert_file(data_dir + "/alerts.jsonl");
+    AlertWebhookSink alert_webhook;
+    std::string error;
+
+    if (!alerts.load(data_dir + "/alerts.txt", interval_min, error))
+    {
+        fprintf(stderr, "Invalid alert rule in %s\n", error.c_str());
+        return EXIT_FAILURE;
+    }
+
+    if (!webhook_url.empty() && !alert_webhook.open(webhook_url))
+    {
+        fprintf(stderr, "Invalid webhook URL %s\n", webhook_url.c_str());
+        return EXIT_FAILURE;
+    }
+
+    alerts.add_sink(&alert_file);
+
+    if (!webhook_url.empty())
+    {
+        alerts.add_sink(&alert_webhook);
+    }
+
+    UploadSlots slots;
+
+    for (StationShard *shard : store.shards())
+    {
+        if (shard->size() > 0)
+        {
+            alerts.track(shard->id(), shard->at(shard->size() - 1).time_s);
+        }
+
+        // Known stations get their slots at once, new ones as they come
+        if (upload_slots)
+        {
+            slots.slot(shard->id());
+        }
+    }
+
+    AdaptiveInterval intervals(interval_settings);
+    UploadLimiter limiter(wakes_per_s);
+    std::vector<std::unique_ptr<Collector>> collectors;
+
+    for (int i = 0; i < threads; i++)
+    {
+        servers.emplace_back(new HttpServer);
+
+        if (!servers.back()->listen(port, address, threads > 1))
+        {
+            fprintf(stderr, "Cannot listen on %s:%d\n", address.c_str(), port);
+            return EXIT_FAILURE;
+        }
+
+        // With port 0 all threads share the port picked for the first one
+        port = servers.front()->port();
+        collectors.emplace_back(new Collector(*servers.back(), store, data_dir));
+        collectors.back()->set_alerts(&alerts);
+
+        if (adaptive)
+        {
+            collectors.back()->set_adaptive_interval(&intervals);
+        }
+
+        collectors.back()->set_upload_schedule(upload_slots ? &slots : nullptr,
+                                               (wakes_per_s > 0) ? &limiter : nullptr);
+    }
+
+    for (auto &collector : collectors)
+    {
+        for (auto &peer : collectors)
+        {
+            if (peer != collector)
+            {
+                collector->add_peer(peer.get());
+            }
+        }
+    }
+
+    // The listeners hand messages to the first collector's event loop
+    if (mqtt_port >= 0)
+    {
+        mqtt_listener.reset(new MqttListener(*collectors.front()));
+
+        if (!mqtt_listener->listen(mqtt_port, address))
+        {
+            fprintf(stderr, "Cannot listen for MQTT on %s:%d\n", address.c_str(), mqtt_port);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (coap_port >= 0)
+    {
+        coap_listener.reset(new CoapListener(*collectors.front()));
+
+        if (!coap_listener->listen(coap_port, address))
+        {
+            fprintf(stderr, "Cannot listen for CoAP on %s:%d\n", address.c_str(), coap_port);
+            return EXIT_FAILURE;
+        }
+    }
+
+    signal(SIGINT, stop_handler);
+    signal(SIGTERM, stop_handler);
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("Collecting to %s, listening on %s:%d with %d threads, %zu alert rules\n", data_dir.c_str(),
+           address.c_str(), port, threads, alerts.rule_count());
+    std::vector<std::thread> loops;
+
+    for (int i = 1; i < threads; i++)
+    {
+        HttpServer *server = servers[static_cast<size_t>(i)].get();
+        loops.emplace_back([server]() { server->run(); });
+    }
+
+    if (mqtt_listener)
+    {
+        printf("MQTT on port %d\n", mqtt_listener->port());
+        loops.emplace_back([]() { mqtt_listener->run(); });
+    }
+
+    if (coap_listener)
+    {
+        printf("CoAP on port %d\n", coap_listener->port());
+        loops.emplace_back([]() { coap_listener->run(); });
+    }
+
+    servers.front()->run();
+
+    for (std::thread &loop : loops)
+    {
+        loop.join();
+    }
+
+    return EXIT_SUCCESS;
+}
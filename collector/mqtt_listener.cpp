@@ -0,0 +1,319 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "mqtt_listener.h"
+#include "mqtt_transport.h"
+
+
+/*!
+ * @brief
+ *   Send a whole packet on a blocking connection.
+ *
+ * @return
+ *   True if sent, false otherwise.
+ */
+static bool send_packet(int fd, const std::string &packet)
+{
+    return ::send(fd, packet.data(), packet.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(packet.size());
+}
+
+
+/*!
+ * @brief
+ *   MQTT listener class constructor.
+ *
+ * @param message_collector (IN)
+ *   Collector that handles the uploads.
+ */
+MqttListener::MqttListener(Collector &message_collector)
+    : collector(message_collector), listen_fd(-1), bound_port(0), running(false)
+{
+}
+
+
+/*!
+ * @brief
+ *   MQTT listener class destructor.
+ */
+MqttListener::~MqttListener()
+{
+    for (const auto &connection : connections)
+    {
+        close(connection.first);
+    }
+
+    if (listen_fd >= 0)
+    {
+        close(listen_fd);
+    }
+}
+
+
+/*!
+ * @brief
+ *   Start listening for stations.
+ *
+ * @param port (IN)
+ *   TCP port, 0 for any free port.
+ *
+ * @param address (IN)
+ *   Local IPv4 address.
+ *
+ * @return
+ *   True if listening, false otherwise.
+ */
+bool MqttListener::listen(int port, const std::string &address)
+{
+    listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (listen_fd < 0)
+    {
+        return false;
+    }
+
+    int enable = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+
+    if ((inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1) ||
+        (bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) || (::listen(listen_fd, 128) != 0))
+    {
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+
+    socklen_t addr_len = sizeof(addr);
+    getsockname(listen_fd, reinterpret_cast<sockaddr *>(&addr), &addr_len);
+    bound_port = ntohs(addr.sin_port);
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Get the TCP port the listener listens on.
+ */
+int MqttListener::port() const
+{
+    return bound_port;
+}
+
+
+/*!
+ * @brief
+ *   Serve connections until stop().
+ */
+void MqttListener::run()
+{
+    running = true;
+
+    while (running)
+    {
+        std::vector<pollfd> fds;
+        fds.push_back({listen_fd, POLLIN, 0});
+
+        for (const auto &connection : connections)
+        {
+            fds.push_back({connection.first, POLLIN, 0});
+        }
+
+        if (poll(fds.data(), fds.size(), POLL_INTERVAL_MS) <= 0)
+        {
+            continue;
+        }
+
+        for (size_t i = 1; i < fds.size(); i++)
+        {
+            if ((fds[i].revents != 0) && !handle_input(fds[i].fd, connections[fds[i].fd]))
+            {
+                close(fds[i].fd);
+                connections.erase(fds[i].fd);
+                sessions.erase(fds[i].fd);
+            }
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            accept_connection();
+        }
+    }
+}
+
+
+/*!
+ * @brief
+ *   Stop run(). Can be called from any thread.
+ */
+void MqttListener::stop()
+{
+    running = false;
+}
+
+
+/*!
+ * @brief
+ *   Accept a new connection, or refuse it over MAX_CONNECTIONS.
+ */
+void MqttListener::accept_connection()
+{
+    int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+
+    if ((fd >= 0) && (connections.size() >= MAX_CONNECTIONS))
+    {
+        close(fd);
+    }
+    else if (fd >= 0)
+    {
+        connections[fd].clear();
+        sessions[fd] = Session();
+    }
+}
+
+
+/*!
+ * @brief
+ *   Read from a connection and handle the complete packets.
+ *
+ * @param fd (IN)
+ *   Connection.
+ *
+ * @param input (IN/OUT)
+ *   Received bytes not yet handled.
+ *
+ * @return
+ *   True to keep the connection open, false to close it.
+ */
+bool MqttListener::handle_input(int fd, std::string &input)
+{
+    char buffer[4096];
+    ssize_t read_len = recv(fd, buffer, sizeof(buffer), 0);
+
+    if (read_len <= 0)
+    {
+        return false;
+    }
+
+    input.append(buffer, static_cast<size_t>(read_len));
+    MqttPacket packet;
+    int length;
+
+    while ((length = mqtt_parse(input, packet)) > 0)
+    {
+        input.erase(0, static_cast<size_t>(length));
+
+        if (!handle_packet(fd, packet, sessions[fd]))
+        {
+            return false;
+        }
+    }
+
+    return (length != MQTT_MALFORMED);
+}
+
+
+/*!
+ * @brief
+ *   Handle one packet. The first packet must be CONNECT.
+ *
+ * @param fd (IN)
+ *   Connection.
+ *
+ * @param packet (IN)
+ *   Packet.
+ *
+ * @param session (IN/OUT)
+ *   Connected with the client ID after CONNECT.
+ *
+ * @return
+ *   True to keep the connection open, false to close it.
+ */
+bool MqttListener::handle_packet(int fd, const MqttPacket &packet, Session &session)
+{
+    std::string topic;
+    std::string payload;
+    std::string response;
+    uint16_t packet_id;
+
+    if (!session.connected)
+    {
+        session.connected = mqtt_parse_connect(packet, session.client_id) && send_packet(fd, mqtt_connack(0));
+        return session.connected;
+    }
+
+    if (mqtt_parse_publish(packet, topic, payload, packet_id))
+    {
+        const char *path = nullptr;
+
+        if (topic == MqttTransport::SAMPLES_TOPIC)
+        {
+            path = "/collect.php";
+        }
+        else if (topic == MqttTransport::TELEMETRY_TOPIC)
+        {
+            path = "/telemetry";
+        }
+
+        int status = (path != nullptr) ? collector.handle_message("POST", path, payload, response) : 404;
+
+        // Without PUBACK the station resends, which helps only if storing failed
+        if (status >= 500)
+        {
+            return false;
+        }
+
+        return (packet_id == 0) || send_packet(fd, mqtt_puback(packet_id));
+    }
+
+    if (mqtt_parse_subscribe(packet, packet_id, topic))
+    {
+        if (topic != MqttTransport::INTERVAL_TOPIC)
+        {
+            return send_packet(fd, mqtt_suback(packet_id, 0x80));
+        }
+
+        if (collector.handle_message("GET", "/interval.txt?Station=" + session.client_id, "", response) != 200)
+        {
+            response.clear();
+        }
+
+        return send_packet(fd, mqtt_suback(packet_id, 0) + mqtt_publish(topic, response, 0, 0, true, false));
+    }
+
+    if (packet.type == MQTT_PINGREQ)
+    {
+        return send_packet(fd, mqtt_pingresp());
+    }
+
+    return false;
+}
@@ -0,0 +1,326 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include "derived.h"
+#include "query.h"
+
+/*! Running sums of one averaging bucket */
+struct Bucket
+{
+    double temperature_sum = 0.0;
+    double humidity_sum = 0.0;
+    size_t count = 0;
+};
+
+
+/*!
+ * @brief
+ *   Parse an integer query field.
+ *
+ * @return
+ *   True if the field is missing or a valid integer, false otherwise.
+ */
+static bool parse_field(const std::map<std::string, std::string> &fields, const std::string &name, int64_t &value)
+{
+    auto it = fields.find(name);
+
+    if (it == fields.end())
+    {
+        return true;
+    }
+
+    char *end = nullptr;
+    long long parsed = strtoll(it->second.c_str(), &end, 10);
+
+    if (it->second.empty() || (*end != 0))
+    {
+        return false;
+    }
+
+    value = parsed;
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Parse query from request fields station, from, to, step, last and
+ *   metrics.
+ *
+ * @param fields (IN)
+ *   Decoded query string fields.
+ *
+ * @param query (OUT)
+ *   Parsed query.
+ *
+ * @return
+ *   True if all given fields are valid, false otherwise.
+ */
+bool parse_query(const std::map<std::string, std::string> &fields, Query &query)
+{
+    auto station = fields.find("station");
+
+    if (station != fields.end())
+    {
+        query.station = station->second;
+    }
+
+    auto metrics = fields.find("metrics");
+
+    if ((metrics != fields.end()) && !parse_metrics(metrics->second, query.metrics))
+    {
+        return false;
+    }
+
+    int64_t last = 0;
+    bool ok = parse_field(fields, "from", query.from_s) && parse_field(fields, "to", query.to_s) &&
+              parse_field(fields, "step", query.step_s) && parse_field(fields, "last", last);
+    query.last = static_cast<size_t>(last);
+
+    return ok && (query.step_s >= 0) && (last >= 0) &&
+           (query.station.empty() || Store::valid_station_id(query.station));
+}
+
+
+/*!
+ * @brief
+ *   Get bucket start time.
+ */
+static int64_t bucket_of(int64_t time_s, int64_t step_s)
+{
+    int64_t bucket = time_s - (time_s % step_s);
+    return (time_s % step_s < 0) ? bucket - step_s : bucket;
+}
+
+
+/*!
+ * @brief
+ *   Run query on a snapshot of the store taken for it.
+ *
+ * @param store (IN)
+ *   Sample store.
+ *
+ * @param query (IN)
+ *   Query to run.
+ *
+ * @return
+ *   Samples or buckets in time order. Bucket time is the bucket start.
+ */
+std::vector<Sample> run_query(const Store &store, const Query &query)
+{
+    return run_query(query.station.empty() ? StoreSnapshot(store) : StoreSnapshot(store, query.station), query);
+}
+
+
+/*!
+ * @brief
+ *   Run query.
+ *   A single station without step returns raw samples. Otherwise samples are
+ *   averaged in step long buckets over the selected station(s). All passes
+ *   read the same samples, the ones committed when the snapshot was taken.
+ *
+ * @param snapshot (IN)
+ *   Snapshot of the sample store.
+ *
+ * @param query (IN)
+ *   Query to run.
+ *
+ * @return
+ *   Samples or buckets in time order. Bucket time is the bucket start.
+ */
+std::vector<Sample> run_query(const StoreSnapshot &snapshot, const Query &query)
+{
+    std::vector<const ShardView *> shards;
+
+    if (query.station.empty())
+    {
+        for (const ShardView &view : snapshot.shards())
+        {
+            shards.push_back(&view);
+        }
+    }
+    else if (const ShardView *view = snapshot.find(query.station))
+    {
+        shards.push_back(view);
+    }
+
+    int64_t step_s = query.step_s;
+
+    if ((step_s == 0) && query.station.empty())
+    {
+        step_s = Query::DEFAULT_AGGREGATE_STEP_S;
+    }
+
+    std::vector<Sample> result;
+
+    if (step_s == 0)
+    {
+        const ShardView *shard = shards.empty() ? nullptr : shards[0];
+        size_t first = (shard != nullptr) ? shard->lower_bound(query.from_s) : 0;
+        size_t end = (shard != nullptr) ? shard->lower_bound(query.to_s) : 0;
+
+        if ((query.last > 0) && (end - first > query.last))
+        {
+            first = end - query.last;
+        }
+
+        for (size_t i = first; i < end; i++)
+        {
+            result.push_back(shard->at(i));
+        }
+
+        return result;
+    }
+
+    int64_t from_s = query.from_s;
+
+    // For the last N buckets only the samples of the last N buckets are read
+    if (query.last > 0)
+    {
+        int64_t latest_s = std::numeric_limits<int64_t>::min();
+
+        for (const ShardView *shard : shards)
+        {
+            size_t end = shard->lower_bound(query.to_s);
+
+            if (end > 0)
+            {
+                latest_s = std::max(latest_s, shard->at(end - 1).time_s);
+            }
+        }
+
+        if (latest_s != std::numeric_limits<int64_t>::min())
+        {
+            int64_t window_s = static_cast<int64_t>(query.last - 1) * step_s;
+            from_s = std::max(from_s, bucket_of(latest_s, step_s) - window_s);
+        }
+    }
+
+    std::map<int64_t, Bucket> buckets;
+
+    for (const ShardView *shard : shards)
+    {
+        size_t end = shard->lower_bound(query.to_s);
+
+        for (size_t i = shard->lower_bound(from_s); i < end; i++)
+        {
+            const Sample &sample = shard->at(i);
+            Bucket &bucket = buckets[bucket_of(sample.time_s, step_s)];
+            bucket.temperature_sum += sample.temperature;
+            bucket.humidity_sum += sample.humidity;
+            bucket.count++;
+        }
+    }
+
+    for (const auto &entry : buckets)
+    {
+        Sample sample;
+        sample.time_s = entry.first;
+        sample.temperature = static_cast<float>(entry.second.temperature_sum / entry.second.count);
+        sample.humidity = static_cast<int>(lround(entry.second.humidity_sum / entry.second.count));
+        sample.sequence = 0;
+        result.push_back(sample);
+    }
+
+    if ((query.last > 0) && (result.size() > query.last))
+    {
+        result.erase(result.begin(), result.end() - static_cast<ptrdiff_t>(query.last));
+    }
+
+    return result;
+}
+
+
+/*!
+ * @brief
+ *   Format samples as JSON array.
+ *
+ * @param samples (IN)
+ *   Samples to format.
+ *
+ * @param metrics (IN)
+ *   Derived metrics to add, DerivedMetric bits.
+ *
+ * @return
+ *   [{"time":unix_s,"temperature":x.x,"humidity":y},...] with
+ *   "dew_point":x.x, "absolute_humidity":x.xx and "heat_index":x.x as asked.
+ */
+std::string samples_to_json(const std::vector<Sample> &samples, unsigned metrics)
+{
+    // The kernels work on columns, computed for the whole result at once
+    std::vector<float> temperature(metrics ? samples.size() : 0);
+    std::vector<float> humidity(temperature.size());
+    std::vector<float> dew_point((metrics & METRIC_DEW_POINT) ? samples.size() : 0);
+    std::vector<float> absolute_humidity((metrics & METRIC_ABSOLUTE_HUMIDITY) ? samples.size() : 0);
+    std::vector<float> heat_index((metrics & METRIC_HEAT_INDEX) ? samples.size() : 0);
+
+    for (size_t i = 0; i < temperature.size(); i++)
+    {
+        temperature[i] = samples[i].temperature;
+        humidity[i] = static_cast<float>(samples[i].humidity);
+    }
+
+    dew_point_series(temperature.data(), humidity.data(), dew_point.size(), dew_point.data());
+    absolute_humidity_series(temperature.data(), humidity.data(), absolute_humidity.size(),
+                             absolute_humidity.data());
+    heat_index_series(temperature.data(), humidity.data(), heat_index.size(), heat_index.data());
+
+    std::string json = "[";
+    char element[96];
+
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        snprintf(element, sizeof(element), "%s{\"time\":%lld,\"temperature\":%.1f,\"humidity\":%d",
+                 (i > 0) ? "," : "", static_cast<long long>(samples[i].time_s), samples[i].temperature,
+                 samples[i].humidity);
+        json += element;
+
+        if (!dew_point.empty())
+        {
+            snprintf(element, sizeof(element), ",\"dew_point\":%.1f", dew_point[i]);
+            json += element;
+        }
+
+        if (!absolute_humidity.empty())
+        {
+            snprintf(element, sizeof(element), ",\"absolute_humidity\":%.2f", absolute_humidity[i]);
+            json += element;
+        }
+
+        if (!heat_index.empty())
+        {
+            snprintf(element, sizeof(element), ",\"heat_index\":%.1f", heat_index[i]);
+            json += element;
+        }
+
+        json += "}";
+    }
+
+    return json + "]";
+}
@@ -0,0 +1,447 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "raw_html.h"
+
+/*! Paragraph start */
+static const char PARAGRAPH_START[] = "<p>";
+
+/*! Paragraph end */
+static const char PARAGRAPH_END[] = "</p>";
+
+/*! Temperature label */
+static const char TEMPERATURE_LABEL[] = "Temperature:";
+
+/*! Humidity label */
+static const char HUMIDITY_LABEL[] = "Humidity:";
+
+/*! Length of "YYYY-MM-DD HH:MM:SS" */
+static const size_t TIMESTAMP_LENGTH = 19;
+
+/*! Parsed bytes between progress updates */
+static const size_t PROGRESS_INTERVAL = 1 << 20;
+
+
+/*!
+ * @brief
+ *   Find text in memory range.
+ *
+ * @return
+ *   Start of text or nullptr if not found.
+ */
+static const char *find(const char *begin, const char *end, const char *text)
+{
+    if (begin >= end)
+    {
+        return nullptr;
+    }
+
+    return static_cast<const char *>(memmem(begin, static_cast<size_t>(end - begin), text, strlen(text)));
+}
+
+
+/*!
+ * @brief
+ *   Parse fixed width decimal number.
+ *
+ * @return
+ *   True if all characters are digits, false otherwise.
+ */
+static bool parse_digits(const char *text, size_t count, int &value)
+{
+    value = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if ((text[i] < '0') || (text[i] > '9'))
+        {
+            return false;
+        }
+
+        value = value * 10 + (text[i] - '0');
+    }
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Parse number after label, like "Temperature: 21.5".
+ *
+ * @return
+ *   True if a finite number follows the label before end, false otherwise.
+ */
+static bool parse_labeled_number(const char *begin, const char *end, const char *label, double &value)
+{
+    const char *text = find(begin, end, label);
+
+    if (text == nullptr)
+    {
+        return false;
+    }
+
+    text += strlen(label);
+
+    while ((text < end) && (*text == ' '))
+    {
+        text++;
+    }
+
+    // The field ends at '&' or '<' of the markup that always follows it
+    char *number_end = nullptr;
+    value = strtod(text, &number_end);
+
+    return (number_end > text) && (number_end <= end) && std::isfinite(value);
+}
+
+
+/*!
+ * @brief
+ *   Local time cache class constructor.
+ *   Times are converted in the time zone of the TZ environment variable.
+ */
+LocalTimeCache::LocalTimeCache()
+{
+    cached_year = -1;
+    cached_month = -1;
+    cached_day = -1;
+    cached_hour = -1;
+    hour_start = 0;
+}
+
+
+/*!
+ * @brief
+ *   Convert local time to Unix time.
+ *   Log lines are in time order, so mktime() is needed only when the hour
+ *   changes.
+ *
+ * @return
+ *   Unix time in seconds.
+ */
+int64_t LocalTimeCache::to_unix(int year, int month, int day, int hour, int minute, int second)
+{
+    if ((year != cached_year) || (month != cached_month) || (day != cached_day) || (hour != cached_hour))
+    {
+        struct tm local = {};
+        local.tm_year = year - 1900;
+        local.tm_mon = month - 1;
+        local.tm_mday = day;
+        local.tm_hour = hour;
+        local.tm_isdst = -1;
+        hour_start = mktime(&local);
+        cached_year = year;
+        cached_month = month;
+        cached_day = day;
+        cached_hour = hour;
+    }
+
+    return hour_start + minute * 60 + second;
+}
+
+
+/*!
+ * @brief
+ *   Raw HTML file class constructor.
+ */
+RawHtmlFile::RawHtmlFile()
+{
+    mapping = nullptr;
+    length = 0;
+}
+
+
+/*!
+ * @brief
+ *   Raw HTML file class destructor.
+ */
+RawHtmlFile::~RawHtmlFile()
+{
+    if (mapping != nullptr)
+    {
+        munmap(const_cast<char *>(mapping), length);
+    }
+}
+
+
+/*!
+ * @brief
+ *   Map file to memory.
+ *
+ * @param path (IN)
+ *   File path.
+ *
+ * @return
+ *   True if mapped or empty, false otherwise.
+ */
+bool RawHtmlFile::open(const std::string &path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat status;
+    bool ok = (fstat(fd, &status) == 0);
+
+    if (ok && (status.st_size > 0))
+    {
+        length = static_cast<size_t>(status.st_size);
+        void *address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        ok = (address != MAP_FAILED);
+
+        if (ok)
+        {
+            mapping = static_cast<const char *>(address);
+            madvise(address, length, MADV_SEQUENTIAL);
+        }
+        else
+        {
+            length = 0;
+        }
+    }
+
+    close(fd);
+
+    return ok;
+}
+
+
+/*!
+ * @brief
+ *   Get file contents.
+ */
+const char *RawHtmlFile::data() const
+{
+    return mapping;
+}
+
+
+/*!
+ * @brief
+ *   Get file size.
+ */
+size_t RawHtmlFile::size() const
+{
+    return length;
+}
+
+
+/*!
+ * @brief
+ *   Split file into ranges that start at paragraph starts.
+ *
+ * @param parts (IN)
+ *   Wanted number of ranges.
+ *
+ * @return
+ *   Ranges [begin, end) in file order, at most parts of them.
+ */
+std::vector<std::pair<size_t, size_t>> RawHtmlFile::split(size_t parts) const
+{
+    std::vector<std::pair<size_t, size_t>> ranges;
+    size_t begin = 0;
+
+    for (size_t i = 1; (i <= parts) && (begin < length); i++)
+    {
+        size_t end = length;
+
+        if (i < parts)
+        {
+            const char *next = find(mapping + std::max(begin, length / parts * i), mapping + length, PARAGRAPH_START);
+            end = (next != nullptr) ? static_cast<size_t>(next - mapping) : length;
+        }
+
+        if (end > begin)
+        {
+            ranges.emplace_back(begin, end);
+        }
+
+        begin = end;
+    }
+
+    return ranges;
+}
+
+
+/*!
+ * @brief
+ *   Parse the contents of one paragraph.
+ *
+ * @param begin (IN)
+ *   Start of paragraph contents, after "<p>".
+ *
+ * @param end (IN)
+ *   End of paragraph contents, at "</p>".
+ *
+ * @param times (IN/OUT)
+ *   Local time converter of this thread.
+ *
+ * @param sample (OUT)
+ *   Parsed sample, without sequence number.
+ *
+ * @return
+ *   True if parsed, false if the paragraph is malformed.
+ */
+bool parse_raw_html_line(const char *begin, const char *end, LocalTimeCache &times, Sample &sample)
+{
+    int year;
+    int month;
+    int day;
+    int hour;
+    int minute;
+    int second;
+
+    if ((static_cast<size_t>(end - begin) < TIMESTAMP_LENGTH) || !parse_digits(begin, 4, year) ||
+        (begin[4] != '-') || !parse_digits(begin + 5, 2, month) || (begin[7] != '-') ||
+        !parse_digits(begin + 8, 2, day) || (begin[10] != ' ') || !parse_digits(begin + 11, 2, hour) ||
+        (begin[13] != ':') || !parse_digits(begin + 14, 2, minute) || (begin[16] != ':') ||
+        !parse_digits(begin + 17, 2, second))
+    {
+        return false;
+    }
+
+    if ((month < 1) || (month > 12) || (day < 1) || (day > 31) || (hour > 23) || (minute > 59) || (second > 60))
+    {
+        return false;
+    }
+
+    double temperature;
+    double humidity;
+
+    if (!parse_labeled_number(begin + TIMESTAMP_LENGTH, end, TEMPERATURE_LABEL, temperature) ||
+        !parse_labeled_number(begin + TIMESTAMP_LENGTH, end, HUMIDITY_LABEL, humidity))
+    {
+        return false;
+    }
+
+    sample.time_s = times.to_unix(year, month, day, hour, minute, second);
+    sample.temperature = static_cast<float>(temperature);
+    sample.humidity = static_cast<int>(lround(humidity));
+    sample.sequence = 0;
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Parse paragraphs in a file range.
+ *   Text outside paragraphs is skipped. A paragraph without end tag ends at
+ *   the next start tag and counts as malformed.
+ *
+ * @param data (IN)
+ *   File contents.
+ *
+ * @param begin (IN)
+ *   Start of range.
+ *
+ * @param end (IN)
+ *   End of range, the first paragraph of the next range or end of file.
+ *
+ * @param samples (OUT)
+ *   Parsed samples are appended here.
+ *
+ * @param progress (IN/OUT)
+ *   Number of parsed bytes of all threads, updated now and then.
+ *
+ * @return
+ *   Number of malformed paragraphs.
+ */
+size_t parse_raw_html(const char *data, size_t begin, size_t end, std::vector<Sample> &samples,
+                      std::atomic<size_t> &progress)
+{
+    const char *file_end = data + end;
+    const char *position = data + begin;
+    const char *reported = position;
+    LocalTimeCache times;
+    size_t malformed = 0;
+
+    while (true)
+    {
+        const char *paragraph = find(position, file_end, PARAGRAPH_START);
+
+        if (paragraph == nullptr)
+        {
+            break;
+        }
+
+        // Find the end tag, or the next start tag if the paragraph is broken
+        const char *contents = paragraph + strlen(PARAGRAPH_START);
+        const char *tag = contents;
+        bool closed = false;
+
+        while ((tag = static_cast<const char *>(memchr(tag, '<', static_cast<size_t>(file_end - tag)))) != nullptr)
+        {
+            if ((static_cast<size_t>(file_end - tag) >= strlen(PARAGRAPH_END)) &&
+                (memcmp(tag, PARAGRAPH_END, strlen(PARAGRAPH_END)) == 0))
+            {
+                closed = true;
+                break;
+            }
+
+            if ((static_cast<size_t>(file_end - tag) >= strlen(PARAGRAPH_START)) &&
+                (memcmp(tag, PARAGRAPH_START, strlen(PARAGRAPH_START)) == 0))
+            {
+                break;
+            }
+
+            tag++;
+        }
+
+        Sample sample;
+
+        if (closed && parse_raw_html_line(contents, tag, times, sample))
+        {
+            samples.push_back(sample);
+            position = tag + strlen(PARAGRAPH_END);
+        }
+        else
+        {
+            malformed++;
+            position = closed ? tag + strlen(PARAGRAPH_END) : ((tag != nullptr) ? tag : file_end);
+        }
+
+        if (static_cast<size_t>(position - reported) >= PROGRESS_INTERVAL)
+        {
+            progress.fetch_add(static_cast<size_t>(position - reported), std::memory_order_relaxed);
+            reported = position;
+        }
+    }
+
+    progress.fetch_add(static_cast<size_t>(file_end - reported), std::memory_order_relaxed);
+
+    return malformed;
+}
@@ -0,0 +1,543 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Importer of legacy raw.html sample logs.
+ *
+ * Memory maps the raw.html files written by the old collect.php, parses them
+ * in parallel ranges split at paragraph starts and appends the samples to a
+ * station's shard in the collector store. Samples not newer than the
+ * station's last stored sample are skipped, so an import can be run again
+ * after the collector has stored new samples. Progress goes to stderr and
+ * the results to stdout as "name value" lines.
+ *
+ * With -r the samples are not imported but posted to a running collector as
+ * station uploads, for load testing the ingestion path.
+ *
+ * Usage: raw_import [-d data_dir] [-s station] [-t threads] [-z timezone]
+ *                   [-r port [-a address] [-c connections] [-x rate]] file...
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "collector.h"
+#include "raw_html.h"
+#include "store.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/*! Time zone of collect.php */
+static const char DEFAULT_TIME_ZONE[] = "Europe/Helsinki";
+
+/*! Interval between progress reports */
+static const int PROGRESS_INTERVAL_MS = 500;
+
+
+/*!
+ * @brief
+ *   Get seconds since start.
+ */
+static double seconds_since(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+
+/*!
+ * @brief
+ *   Get percentile of sorted values.
+ */
+static double percentile(const std::vector<double> &sorted, double fraction)
+{
+    if (sorted.empty())
+    {
+        return 0.0;
+    }
+
+    size_t index = static_cast<size_t>(fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+
+/*!
+ * @brief
+ *   Parse files in parallel ranges.
+ *
+ * @param paths (IN)
+ *   raw.html files in time order.
+ *
+ * @param threads (IN)
+ *   Number of parser threads.
+ *
+ * @param samples (OUT)
+ *   Samples in file order.
+ *
+ * @param malformed (OUT)
+ *   Number of malformed paragraphs.
+ *
+ * @param bytes (OUT)
+ *   Size of the files.
+ *
+ * @return
+ *   True if all files could be read, false otherwise.
+ */
+static bool parse_files(const std::vector<std::string> &paths, size_t threads, std::vector<Sample> &samples,
+                        size_t &malformed, size_t &bytes)
+{
+    std::vector<RawHtmlFile> files(paths.size());
+    bytes = 0;
+    malformed = 0;
+
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        if (!files[i].open(paths[i]))
+        {
+            fprintf(stderr, "Cannot read %s\n", paths[i].c_str());
+            return false;
+        }
+
+        bytes += files[i].size();
+    }
+
+    std::atomic<size_t> progress(0);
+    std::atomic<bool> done(false);
+    auto start = Clock::now();
+
+    std::thread reporter([&]()
+    {
+        auto reported = Clock::now();
+
+        while (!done.load())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+            if (seconds_since(reported) * 1000 >= PROGRESS_INTERVAL_MS)
+            {
+                reported = Clock::now();
+                double parsed = static_cast<double>(progress.load());
+                fprintf(stderr, "\rParsed %5.1f %% %8.1f MB/s", 100.0 * parsed / static_cast<double>(bytes),
+                        parsed / seconds_since(start) / 1e6);
+            }
+        }
+    });
+
+    for (const RawHtmlFile &file : files)
+    {
+        std::vector<std::pair<size_t, size_t>> ranges = file.split(threads);
+        std::vector<std::vector<Sample>> parts(ranges.size());
+        std::vector<size_t> part_malformed(ranges.size());
+        std::vector<std::thread> parsers;
+
+        for (size_t i = 0; i < ranges.size(); i++)
+        {
+            parsers.emplace_back([&, i]()
+            {
+                part_malformed[i] = parse_raw_html(file.data(), ranges[i].first, ranges[i].second, parts[i],
+                                                   progress);
+            });
+        }
+
+        for (size_t i = 0; i < parsers.size(); i++)
+        {
+            parsers[i].join();
+            samples.insert(samples.end(), parts[i].begin(), parts[i].end());
+            malformed += part_malformed[i];
+        }
+    }
+
+    done = true;
+    reporter.join();
+    fprintf(stderr, "\rParsed %zu bytes\n", bytes);
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Append samples newer than the station's last stored sample.
+ *
+ * @param store (IN/OUT)
+ *   Collector store.
+ *
+ * @param station_id (IN)
+ *   Station to import to.
+ *
+ * @param samples (IN)
+ *   Samples in time order.
+ *
+ * @param skipped (OUT)
+ *   Number of samples already stored.
+ *
+ * @return
+ *   Number of imported samples, or -1 if appending fails.
+ */
+static long import_samples(Store &store, const std::string &station_id, const std::vector<Sample> &samples,
+                           size_t &skipped)
+{
+    StationShard *shard = store.find(station_id);
+    int64_t last_time_s = INT64_MIN;
+
+    if ((shard != nullptr) && (shard->size() > 0))
+    {
+        last_time_s = shard->at(shard->size() - 1).time_s;
+    }
+
+    long imported = 0;
+    skipped = 0;
+
+    for (const Sample &sample : samples)
+    {
+        if (sample.time_s <= last_time_s)
+        {
+            skipped++;
+        }
+        else if (store.append(station_id, sample) == StationShard::APPENDED)
+        {
+            imported++;
+        }
+        else
+        {
+            return -1;
+        }
+    }
+
+    return imported;
+}
+
+
+/*!
+ * @brief
+ *   Connect to collector.
+ *
+ * @return
+ *   Socket or -1 on failure.
+ */
+static int connect_to(const std::string &address, int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in server = {};
+    server.sin_family = AF_INET;
+    server.sin_port = htons(static_cast<uint16_t>(port));
+    int one = 1;
+
+    if ((fd < 0) || (inet_pton(AF_INET, address.c_str(), &server.sin_addr) != 1) ||
+        (connect(fd, reinterpret_cast<sockaddr *>(&server), sizeof(server)) != 0))
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+
+        return -1;
+    }
+
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    return fd;
+}
+
+
+/*!
+ * @brief
+ *   Send request and read response on a keep-alive connection.
+ *
+ * @param fd (IN)
+ *   Connected socket.
+ *
+ * @param request (IN)
+ *   Complete HTTP request.
+ *
+ * @param body (OUT)
+ *   Response body.
+ *
+ * @return
+ *   HTTP status or -1 if the connection fails.
+ */
+static int exchange(int fd, const std::string &request, std::string &body)
+{
+    if (send(fd, request.data(), request.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(request.size()))
+    {
+        return -1;
+    }
+
+    std::string response;
+    size_t header_end = std::string::npos;
+    size_t content_length = 0;
+    char buffer[4096];
+
+    while ((header_end == std::string::npos) || (response.size() < header_end + content_length))
+    {
+        ssize_t read_len = recv(fd, buffer, sizeof(buffer), 0);
+
+        if (read_len <= 0)
+        {
+            return -1;
+        }
+
+        response.append(buffer, static_cast<size_t>(read_len));
+
+        if (header_end == std::string::npos)
+        {
+            size_t separator = response.find("\r\n\r\n");
+
+            if (separator != std::string::npos)
+            {
+                header_end = separator + 4;
+                size_t length_field = response.find("Content-Length: ");
+                content_length = (length_field < header_end) ? strtoul(response.c_str() + length_field + 16,
+                                                                       nullptr, 10) : 0;
+            }
+        }
+    }
+
+    body = response.substr(header_end, content_length);
+
+    return (response.compare(0, 9, "HTTP/1.1 ") == 0) ? atoi(response.c_str() + 9) : -1;
+}
+
+
+/*!
+ * @brief
+ *   Post samples to a running collector as station uploads.
+ *   Each connection posts every connections'th sample, paced to the total
+ *   rate. Samples are numbered from 1, so a second replay to the same
+ *   collector gets only duplicates.
+ *
+ * @return
+ *   True if every sample was acknowledged, false otherwise.
+ */
+static bool replay(const std::string &address, int port, const std::string &station_id,
+                   const std::vector<Sample> &samples, size_t connections, double rate)
+{
+    std::vector<std::vector<double>> latencies(connections);
+    std::atomic<size_t> errors(0);
+    std::atomic<size_t> duplicates(0);
+    std::vector<std::thread> clients;
+    auto start = Clock::now();
+
+    for (size_t c = 0; c < connections; c++)
+    {
+        clients.emplace_back([&, c]()
+        {
+            int fd = connect_to(address, port);
+
+            for (size_t i = c; i < samples.size(); i += connections)
+            {
+                if (rate > 0)
+                {
+                    std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double>(static_cast<double>(i) / rate)));
+                }
+
+                char fields[128];
+                int length = snprintf(fields, sizeof(fields), "Station=%s&Temperature=%.1f&Humidity=%d&Sequence=%zu",
+                                      station_id.c_str(), samples[i].temperature, samples[i].humidity, i + 1);
+                std::string request = "POST /collect.php HTTP/1.1\r\nHost: " + address +
+                                      "\r\nContent-Type: application/x-www-form-urlencoded\r\nContent-Length: " +
+                                      std::to_string(length) + "\r\n\r\n" + fields;
+                std::string body;
+                auto sent = Clock::now();
+                int status = (fd >= 0) ? exchange(fd, request, body) : -1;
+
+                if (status < 0)
+                {
+                    // Reconnect once per sample
+                    if (fd >= 0)
+                    {
+                        close(fd);
+                    }
+
+                    fd = connect_to(address, port);
+                    status = (fd >= 0) ? exchange(fd, request, body) : -1;
+                }
+
+                if (status == 200)
+                {
+                    latencies[c].push_back(seconds_since(sent) * 1000);
+                    duplicates += (body == "Duplicate") ? 1 : 0;
+                }
+                else
+                {
+                    errors++;
+                }
+            }
+
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        });
+    }
+
+    for (std::thread &client : clients)
+    {
+        client.join();
+    }
+
+    double elapsed_s = seconds_since(start);
+    std::vector<double> all;
+
+    for (const std::vector<double> &part : latencies)
+    {
+        all.insert(all.end(), part.begin(), part.end());
+    }
+
+    std::sort(all.begin(), all.end());
+
+    printf("replayed %zu\n", all.size());
+    printf("replay_errors %zu\n", errors.load());
+    printf("replay_duplicates %zu\n", duplicates.load());
+    printf("replay_s %.3f\n", elapsed_s);
+    printf("replay_requests_per_s %.0f\n", static_cast<double>(all.size()) / elapsed_s);
+    printf("replay_latency_ms_p50 %.3f\n", percentile(all, 0.50));
+    printf("replay_latency_ms_p99 %.3f\n", percentile(all, 0.99));
+    printf("replay_latency_ms_max %.3f\n", all.empty() ? 0.0 : all.back());
+
+    return errors.load() == 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    std::string data_dir = ".";
+    std::string station_id = Collector::DEFAULT_STATION;
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    const char *time_zone = DEFAULT_TIME_ZONE;
+    int replay_port = 0;
+    std::string address = "127.0.0.1";
+    size_t connections = 4;
+    double rate = 0;
+    int option;
+
+    while ((option = getopt(argc, argv, "d:s:t:z:r:a:c:x:")) != -1)
+    {
+        switch (option)
+        {
+            case 'd':
+                data_dir = optarg;
+                break;
+            case 's':
+                station_id = optarg;
+                break;
+            case 't':
+                threads = std::max(1, atoi(optarg));
+                break;
+            case 'z':
+                time_zone = optarg;
+                break;
+            case 'r':
+                replay_port = atoi(optarg);
+                break;
+            case 'a':
+                address = optarg;
+                break;
+            case 'c':
+                connections = std::max(1, atoi(optarg));
+                break;
+            case 'x':
+                rate = atof(optarg);
+                break;
+            default:
+                optind = argc + 1;
+                break;
+        }
+    }
+
+    if ((optind >= argc) || !Store::valid_station_id(station_id))
+    {
+        fprintf(stderr, "Usage: %s [-d data_dir] [-s station] [-t threads] [-z timezone]\n"
+                "       [-r port [-a address] [-c connections] [-x rate]] file...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    setenv("TZ", time_zone, 1);
+    tzset();
+
+    std::vector<std::string> paths(argv + optind, argv + argc);
+    std::vector<Sample> samples;
+    size_t malformed;
+    size_t bytes;
+    auto start = Clock::now();
+
+    if (!parse_files(paths, threads, samples, malformed, bytes))
+    {
+        return EXIT_FAILURE;
+    }
+
+    double parse_s = seconds_since(start);
+
+    printf("files %zu\n", paths.size());
+    printf("bytes %zu\n", bytes);
+    printf("samples %zu\n", samples.size());
+    printf("malformed %zu\n", malformed);
+    printf("parse_s %.3f\n", parse_s);
+    printf("parse_mb_per_s %.1f\n", static_cast<double>(bytes) / parse_s / 1e6);
+    printf("parse_samples_per_s %.0f\n", static_cast<double>(samples.size()) / parse_s);
+
+    if (replay_port > 0)
+    {
+        return replay(address, replay_port, station_id, samples, connections, rate) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    Store store(data_dir + "/stations");
+
+    if (!store.open())
+    {
+        fprintf(stderr, "Cannot open store in %s/stations\n", data_dir.c_str());
+        return EXIT_FAILURE;
+    }
+
+    size_t skipped;
+    start = Clock::now();
+    long imported = import_samples(store, station_id, samples, skipped);
+    double import_s = seconds_since(start);
+
+    if (imported < 0)
+    {
+        fprintf(stderr, "Cannot append to station %s\n", station_id.c_str());
+        return EXIT_FAILURE;
+    }
+
+    printf("imported %ld\n", imported);
+    printf("skipped_existing %zu\n", skipped);
+    printf("import_s %.3f\n", import_s);
+    printf("import_samples_per_s %.0f\n", static_cast<double>(imported) / import_s);
+
+    return EXIT_SUCCESS;
+}
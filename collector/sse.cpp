@@ -0,0 +1,195 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <chrono>
+#include <cstdlib>
+#include <sstream>
+#include "sse.h"
+
+
+/*! Event IDs are shared by all hubs and start from the current time in
+ *  milliseconds so that they keep increasing over collector restarts */
+std::atomic<uint64_t> SseHub::next_event_id(std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count());
+
+
+/*!
+ * @brief
+ *   Server-Sent Events hub class constructor.
+ *
+ * @param http_server (IN)
+ *   Server whose connections are subscribed.
+ */
+SseHub::SseHub(HttpServer &http_server) : server(http_server)
+{
+}
+
+
+/*!
+ * @brief
+ *   Server-Sent Events hub class destructor.
+ */
+SseHub::~SseHub()
+{
+}
+
+
+/*!
+ * @brief
+ *   Turn a request into an event stream subscription.
+ *   A reconnecting client sends the last event ID it got and the missed
+ *   events still in the replay buffer are sent right away.
+ *
+ * @param id (IN)
+ *   Connection of the subscriber.
+ *
+ * @param request (IN)
+ *   Subscription request.
+ *
+ * @param response (OUT)
+ *   Streaming response.
+ */
+void SseHub::subscribe(HttpServer::ConnectionId id, const HttpRequest &request, HttpResponse &response)
+{
+    response.status = 200;
+    response.content_type = "text/event-stream";
+    response.stream = true;
+    response.body = "retry: " + std::to_string(RETRY_MS) + "\n\n";
+
+    std::string last_event_id = request.header("last-event-id");
+
+    if (!last_event_id.empty())
+    {
+        uint64_t last_id = strtoull(last_event_id.c_str(), nullptr, 10);
+
+        for (const auto &event : recent_events)
+        {
+            if (event.first > last_id)
+            {
+                response.body += event.second;
+            }
+        }
+    }
+
+    subscribers.insert(id);
+}
+
+
+/*!
+ * @brief
+ *   Remove a closed connection from subscribers.
+ *
+ * @param id (IN)
+ *   Closed connection.
+ */
+void SseHub::unsubscribe(HttpServer::ConnectionId id)
+{
+    subscribers.erase(id);
+}
+
+
+/*!
+ * @brief
+ *   Push an event to all subscribers.
+ *   The event is formatted once by the caller and the same bytes are queued
+ *   to every subscriber. Stalled subscribers are dropped by the server.
+ *
+ * @param event_id (IN)
+ *   Event ID from allocate_event_id().
+ *
+ * @param frame (IN)
+ *   Event formatted with format_event().
+ */
+void SseHub::publish(uint64_t event_id, const std::string &frame)
+{
+    recent_events.emplace_back(event_id, frame);
+
+    if (recent_events.size() > REPLAY_EVENTS)
+    {
+        recent_events.pop_front();
+    }
+
+    for (HttpServer::ConnectionId id : subscribers)
+    {
+        server.send(id, frame);
+    }
+}
+
+
+/*!
+ * @brief
+ *   Send a comment line to all subscribers.
+ *   Keeps idle connections open through proxies and detects dead clients.
+ */
+void SseHub::heartbeat()
+{
+    for (HttpServer::ConnectionId id : subscribers)
+    {
+        server.send(id, ":\n\n");
+    }
+}
+
+
+/*!
+ * @brief
+ *   Get number of subscribed connections.
+ */
+size_t SseHub::subscriber_count() const
+{
+    return subscribers.size();
+}
+
+
+/*!
+ * @brief
+ *   Get ID for a new event. Can be called from any thread.
+ */
+uint64_t SseHub::allocate_event_id()
+{
+    return next_event_id++;
+}
+
+
+/*!
+ * @brief
+ *   Format one event in text/event-stream format.
+ *
+ * @param id (IN)
+ *   Event ID.
+ *
+ * @param event (IN)
+ *   Event type.
+ *
+ * @param data (IN)
+ *   Event data, single line.
+ *
+ * @return
+ *   Formatted event.
+ */
+std::string SseHub::format_event(uint64_t id, const std::string &event, const std::string &data)
+{
+    std::ostringstream frame;
+    frame << "id: " << id << "\nevent: " << event << "\ndata: " << data << "\n\n";
+    return frame.str();
+}
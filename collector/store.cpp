@@ -0,0 +1,1303 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "codec.h"
+#include "store.h"
+
+/*! Shard file name extension */
+static const std::string SHARD_EXTENSION = ".dat";
+
+/*! Block file name extension */
+static const std::string BLOCK_EXTENSION = ".blk";
+
+/*! Sequence epoch file name extension */
+static const std::string EPOCH_EXTENSION = ".seq";
+
+/*! Size of the epoch file: epoch (uint32) and the log index where it started (uint64) */
+static const size_t EPOCH_RECORD_SIZE = 12;
+
+
+/*!
+ * @brief
+ *   Station shard class constructor.
+ *
+ * @param station_id (IN)
+ *   Station ID.
+ *
+ * @param file_descriptor (IN)
+ *   Open shard file, owned by the shard.
+ *
+ * @param block_file_descriptor (IN)
+ *   Open block file, owned by the shard.
+ *
+ * @param epoch_file_descriptor (IN)
+ *   Open sequence epoch file, owned by the shard.
+ */
+StationShard::StationShard(const std::string &station_id, int file_descriptor, int block_file_descriptor,
+                           int epoch_file_descriptor)
+{
+    station = station_id;
+    fd = file_descriptor;
+    block_fd = block_file_descriptor;
+    epoch_fd = epoch_file_descriptor;
+    epoch_start = UINT64_MAX;
+    block_file_size = 0;
+    sealing = true;
+    loaded_chunks = 0;
+    freed_chunks = 0;
+    sealed = 0;
+    blocks = 0;
+    readers = 0;
+    reserved = 0;
+    committed = 0;
+    high_water = 0;
+    sequence_epoch = 0;
+
+    for (size_t i = 0; i < MAX_CHUNKS; i++)
+    {
+        block_offsets[i] = 0;
+        chunks[i] = nullptr;
+    }
+
+    for (uint32_t i = 0; i < DEDUP_WINDOW; i++)
+    {
+        seen[i] = 0;
+    }
+}
+
+
+/*!
+ * @brief
+ *   Station shard class destructor.
+ */
+StationShard::~StationShard()
+{
+    for (size_t i = 0; i < MAX_CHUNKS; i++)
+    {
+        delete chunks[i].load();
+    }
+
+    close(fd);
+    close(block_fd);
+    close(epoch_fd);
+}
+
+
+/*!
+ * @brief
+ *   Append sample to shard without locking.
+ *   Appends to the same shard from several threads are ordered by slot
+ *   reservation; a writer publishes its slot only after all earlier slots
+ *   are published. A sample whose sequence number is already stored is not
+ *   appended again.
+ *
+ * @param sample (IN)
+ *   Sample to append.
+ *
+ * @return
+ *   APPENDED if stored, DUPLICATE if the sample is already stored, FAILED if
+ *   the shard is full or the file write fails.
+ */
+StationShard::Result StationShard::append(const Sample &sample)
+{
+    return append(&sample, 1, 0);
+}
+
+
+/*!
+ * @brief
+ *   Append the samples of one upload together, in consecutive slots.
+ *   The samples carry the sequence number of the upload, which is claimed
+ *   once for all of them, so a resent upload is dropped whole and one that
+ *   failed is stored whole when resent.
+ *
+ * @param samples (IN)
+ *   Samples in time order, at least one.
+ *
+ * @param epoch (IN)
+ *   Epoch of the station's sequence counter, 0 if not sent.
+ *
+ * @return
+ *   As append() of one sample.
+ */
+StationShard::Result StationShard::append(const std::vector<Sample> &samples, uint32_t epoch)
+{
+    return append(samples.data(), samples.size(), epoch);
+}
+
+
+/*!
+ * @brief
+ *   Append samples in consecutive slots under the sequence number of the
+ *   first one.
+ *
+ * @param samples (IN)
+ *   Samples to append.
+ *
+ * @param count (IN)
+ *   Number of samples, at least one.
+ *
+ * @param epoch (IN)
+ *   Epoch of the station's sequence counter, 0 if not sent.
+ *
+ * @return
+ *   As append() of one sample.
+ */
+StationShard::Result StationShard::append(const Sample *samples, size_t count, uint32_t epoch)
+{
+    uint32_t sequence = samples[0].sequence;
+    uint32_t previous = 0;
+
+    if (!claim_sequence(sequence, epoch, previous))
+    {
+        return DUPLICATE;
+    }
+
+    size_t slot = reserved.fetch_add(count, std::memory_order_relaxed);
+
+    for (size_t i = slot / CHUNK_SAMPLES; i <= (slot + count - 1) / CHUNK_SAMPLES; i++)
+    {
+        if (get_chunk(i) == nullptr)
+        {
+            release_sequence(sequence, previous);
+            return FAILED;
+        }
+    }
+
+    // Only an upload of several samples needs a buffer from the heap
+    uint8_t record[RECORD_SIZE];
+    std::vector<uint8_t> records((count > 1) ? count * RECORD_SIZE : 0);
+    uint8_t *buffer = (count > 1) ? records.data() : record;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t index = slot + i;
+        chunks[index / CHUNK_SAMPLES].load(std::memory_order_relaxed)->samples[index % CHUNK_SAMPLES] = samples[i];
+        encode(samples[i], buffer + i * RECORD_SIZE);
+    }
+
+    bool written = (pwrite(fd, buffer, count * RECORD_SIZE, static_cast<off_t>(slot * RECORD_SIZE)) ==
+                    static_cast<ssize_t>(count * RECORD_SIZE));
+
+    // Wait for writers of earlier slots, then publish these ones. Acquiring
+    // their samples lets the writer of the last slot seal the chunk.
+    size_t expected = slot;
+
+    while (!committed.compare_exchange_weak(expected, slot + count, std::memory_order_acq_rel,
+                                            std::memory_order_relaxed))
+    {
+        expected = slot;
+        std::this_thread::yield();
+    }
+
+    for (size_t i = slot / CHUNK_SAMPLES; (i + 1) * CHUNK_SAMPLES <= slot + count; i++)
+    {
+        seal(i);
+    }
+
+    if (!written)
+    {
+        // The station resends the samples, let them in then
+        release_sequence(sequence, previous);
+        return FAILED;
+    }
+
+    return APPENDED;
+}
+
+
+/*!
+ * @brief
+ *   Get number of committed samples.
+ *   Samples [0, size()) can be read with at() without synchronization.
+ */
+size_t StationShard::size() const
+{
+    return committed.load(std::memory_order_acquire);
+}
+
+
+/*!
+ * @brief
+ *   Get committed sample.
+ *   A sealed sample is decoded from its block, so reading many samples goes
+ *   through one ShardView.
+ *
+ * @param index (IN)
+ *   Sample index, less than size().
+ */
+Sample StationShard::at(size_t index) const
+{
+    return ShardView(*this).at(index);
+}
+
+
+/*!
+ * @brief
+ *   Get station ID.
+ */
+const std::string &StationShard::id() const
+{
+    return station;
+}
+
+
+/*!
+ * @brief
+ *   Get highest sequence number received from the station.
+ *
+ * @return
+ *   Sequence number, 0 if the station does not send them.
+ */
+uint32_t StationShard::last_sequence() const
+{
+    return high_water.load(std::memory_order_relaxed);
+}
+
+
+/*!
+ * @brief
+ *   Get number of chunks sealed to compressed blocks.
+ */
+size_t StationShard::sealed_chunks() const
+{
+    return blocks.load(std::memory_order_acquire);
+}
+
+
+/*!
+ * @brief
+ *   Mark sequence number as received.
+ *   Sequence number n is remembered in window slot n % DEDUP_WINDOW, which
+ *   holds the highest number seen for that slot, so samples arriving out of
+ *   order within the window are still accepted once. A new epoch, or a
+ *   number more than DEDUP_WINDOW below the highest one, cannot be a resend:
+ *   the station has started its counter again and the window is cleared.
+ *
+ * @param sequence (IN)
+ *   Sequence number of a new sample, 0 if none.
+ *
+ * @param epoch (IN)
+ *   Epoch of the station's sequence counter, 0 if not sent.
+ *
+ * @param previous (OUT)
+ *   Earlier value of the window slot, for release_sequence().
+ *
+ * @return
+ *   True if the sample is new, false if it is a duplicate.
+ */
+bool StationShard::claim_sequence(uint32_t sequence, uint32_t epoch, uint32_t &previous)
+{
+    if (sequence == 0)
+    {
+        return true;
+    }
+
+    uint32_t highest = high_water.load(std::memory_order_relaxed);
+    uint32_t known_epoch = sequence_epoch.load(std::memory_order_relaxed);
+
+    if ((epoch != 0) && (epoch != known_epoch))
+    {
+        // Only the writer that switches the epoch clears the window
+        if (sequence_epoch.compare_exchange_strong(known_epoch, epoch, std::memory_order_relaxed))
+        {
+            uint8_t record[EPOCH_RECORD_SIZE];
+            uint64_t start = reserved.load(std::memory_order_relaxed);
+            memcpy(record, &epoch, 4);
+            memcpy(record + 4, &start, 8);
+            // Without the file a reload rebuilds the window from the numbers only
+            pwrite(epoch_fd, record, sizeof(record), 0);
+            forget_sequences(highest);
+        }
+
+        highest = high_water.load(std::memory_order_relaxed);
+    }
+    else if ((highest >= DEDUP_WINDOW) && (sequence <= highest - DEDUP_WINDOW))
+    {
+        forget_sequences(highest);
+        highest = high_water.load(std::memory_order_relaxed);
+    }
+
+    std::atomic<uint32_t> &entry = seen[sequence % DEDUP_WINDOW];
+    previous = entry.load(std::memory_order_relaxed);
+
+    do
+    {
+        if (previous >= sequence)
+        {
+            return false;
+        }
+    } while (!entry.compare_exchange_weak(previous, sequence, std::memory_order_relaxed));
+
+    while ((highest < sequence) &&
+           !high_water.compare_exchange_weak(highest, sequence, std::memory_order_relaxed))
+    {
+    }
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Forget sequence number of a sample that could not be stored.
+ *
+ * @param sequence (IN)
+ *   Sequence number given to claim_sequence().
+ *
+ * @param previous (IN)
+ *   Window slot value from claim_sequence().
+ */
+void StationShard::release_sequence(uint32_t sequence, uint32_t previous)
+{
+    if (sequence != 0)
+    {
+        seen[sequence % DEDUP_WINDOW].compare_exchange_strong(sequence, previous, std::memory_order_relaxed);
+    }
+}
+
+
+/*!
+ * @brief
+ *   Clear the duplicate window when the station starts its counter again.
+ *
+ * @param highest (IN)
+ *   Highest sequence number of the old counter.
+ */
+void StationShard::forget_sequences(uint32_t highest)
+{
+    for (uint32_t i = 0; i < DEDUP_WINDOW; i++)
+    {
+        seen[i].store(0, std::memory_order_relaxed);
+    }
+
+    high_water.compare_exchange_strong(highest, 0, std::memory_order_relaxed);
+}
+
+
+/*!
+ * @brief
+ *   Get memory chunk, allocating it if needed.
+ *   Racing writers may both allocate; the loser frees its chunk.
+ *
+ * @param chunk_index (IN)
+ *   Chunk index.
+ *
+ * @return
+ *   Chunk or nullptr if the shard is full.
+ */
+StationShard::Chunk *StationShard::get_chunk(size_t chunk_index)
+{
+    if (chunk_index >= MAX_CHUNKS)
+    {
+        return nullptr;
+    }
+
+    Chunk *chunk = chunks[chunk_index].load(std::memory_order_acquire);
+
+    if (chunk == nullptr)
+    {
+        Chunk *new_chunk = new Chunk;
+
+        if (chunks[chunk_index].compare_exchange_strong(chunk, new_chunk, std::memory_order_acq_rel))
+        {
+            chunk = new_chunk;
+        }
+        else
+        {
+            delete new_chunk;
+        }
+    }
+
+    return chunk;
+}
+
+
+/*!
+ * @brief
+ *   Seal a full chunk to a compressed block.
+ *   Called by the writer that commits the last sample of the chunk. Chunks
+ *   are sealed in order: a writer waits until the previous chunk is sealed.
+ *   The chunk's records are punched out of the sample log only after its
+ *   block is written. If a block cannot be written, sealing stops and the
+ *   log keeps all later samples.
+ *
+ * @param chunk_index (IN)
+ *   Full chunk, all its samples committed.
+ */
+void StationShard::seal(size_t chunk_index)
+{
+    while (sealed.load(std::memory_order_acquire) != chunk_index)
+    {
+        std::this_thread::yield();
+    }
+
+    if (sealing)
+    {
+        const Chunk *chunk = chunks[chunk_index].load(std::memory_order_relaxed);
+        BlockEncoder encoder;
+
+        for (size_t i = 0; i < CHUNK_SAMPLES; i++)
+        {
+            encoder.append(chunk->samples[i]);
+        }
+
+        BlockHeader header;
+        header.count = static_cast<uint32_t>(encoder.count());
+        header.size = static_cast<uint32_t>(encoder.bytes().size());
+        header.first_time_s = encoder.first_time();
+        header.last_time_s = encoder.last_time();
+
+        std::vector<uint8_t> block(BlockHeader::SIZE);
+        header.encode(block.data());
+        block.insert(block.end(), encoder.bytes().begin(), encoder.bytes().end());
+
+        if (pwrite(block_fd, block.data(), block.size(), static_cast<off_t>(block_file_size)) ==
+            static_cast<ssize_t>(block.size()))
+        {
+            block_offsets[chunk_index] = block_file_size;
+            block_file_size += block.size();
+            // Fails on file systems without hole punching, the records then stay
+            fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                      static_cast<off_t>(chunk_index * CHUNK_SAMPLES * RECORD_SIZE),
+                      static_cast<off_t>(CHUNK_SAMPLES * RECORD_SIZE));
+
+            // Views taken from now on read the chunk from its block. Older
+            // ones count as readers and may still read it from memory, so
+            // sealed chunks are freed only when there are none. Both sides
+            // are sequentially consistent: a view that is not counted here
+            // sees the new block count.
+            blocks.store(chunk_index + 1);
+
+            if (readers.load() == 0)
+            {
+                for (; freed_chunks < chunk_index + 1; freed_chunks++)
+                {
+                    delete chunks[freed_chunks].exchange(nullptr, std::memory_order_relaxed);
+                }
+            }
+        }
+        else
+        {
+            // A partially written block is cut off on next load
+            sealing = false;
+        }
+    }
+
+    sealed.store(chunk_index + 1, std::memory_order_release);
+}
+
+
+/*!
+ * @brief
+ *   Decode the block of a sealed chunk.
+ *
+ * @param chunk_index (IN)
+ *   Chunk with a block, less than the block count.
+ *
+ * @param samples (OUT)
+ *   Samples of the chunk.
+ *
+ * @return
+ *   True if decoded, false if the block cannot be read.
+ */
+bool StationShard::read_block(size_t chunk_index, std::vector<Sample> &samples) const
+{
+    uint8_t data[BlockHeader::SIZE];
+    BlockHeader header;
+    off_t offset = static_cast<off_t>(block_offsets[chunk_index]);
+
+    if (pread(block_fd, data, sizeof(data), offset) != static_cast<ssize_t>(sizeof(data)))
+    {
+        return false;
+    }
+
+    // Only the sizes are needed: samples out of time order are still read
+    header.decode(data);
+
+    if (header.count != CHUNK_SAMPLES)
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> payload(header.size);
+
+    if (pread(block_fd, payload.data(), header.size, offset + static_cast<off_t>(BlockHeader::SIZE)) !=
+        static_cast<ssize_t>(header.size))
+    {
+        return false;
+    }
+
+    BlockDecoder decoder(payload.data(), payload.size(), header.count);
+    samples.resize(CHUNK_SAMPLES);
+
+    for (size_t i = 0; i < CHUNK_SAMPLES; i++)
+    {
+        if (!decoder.next(samples[i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Find first block not older than given time from the block headers,
+ *   without decoding any block.
+ *
+ * @param time_s (IN)
+ *   Unix time in seconds.
+ *
+ * @param block_count (IN)
+ *   Number of blocks to search, at most the block count.
+ *
+ * @return
+ *   Index of first block whose last sample has time_s >= time_s, or
+ *   block_count if none. A block whose header cannot be read is taken to
+ *   reach the time.
+ */
+size_t StationShard::find_block(int64_t time_s, size_t block_count) const
+{
+    size_t first = 0;
+
+    while (block_count > first)
+    {
+        size_t middle = first + (block_count - first) / 2;
+        uint8_t data[BlockHeader::SIZE];
+        BlockHeader header;
+
+        if ((pread(block_fd, data, sizeof(data), static_cast<off_t>(block_offsets[middle])) ==
+             static_cast<ssize_t>(sizeof(data))) &&
+            header.decode(data) && (header.last_time_s < time_s))
+        {
+            first = middle + 1;
+        }
+        else
+        {
+            block_count = middle;
+        }
+    }
+
+    return first;
+}
+
+
+/*!
+ * @brief
+ *   Load unsealed samples from shard file to memory and rebuild the
+ *   duplicate window. Sealed samples are scanned from the block file for
+ *   their sequence numbers and block offsets but stay on disk, and the rest
+ *   are read from the shard file. A partially written block is cut off and a
+ *   partial record at the end of the shard file is overwritten by the next
+ *   append. The window is cleared where the last sequence epoch started.
+ *
+ * @return
+ *   True if read, false otherwise.
+ */
+bool StationShard::load()
+{
+    uint8_t epoch_record[EPOCH_RECORD_SIZE];
+
+    if (pread(epoch_fd, epoch_record, sizeof(epoch_record), 0) == static_cast<ssize_t>(sizeof(epoch_record)))
+    {
+        uint32_t epoch;
+        memcpy(&epoch, epoch_record, 4);
+        memcpy(&epoch_start, epoch_record + 4, 8);
+        sequence_epoch = epoch;
+    }
+
+    BlockScanner scanner(block_fd, INT64_MIN, INT64_MAX);
+    Sample sample;
+    size_t count = 0;
+    size_t block_end = 0;
+
+    while (scanner.next(sample))
+    {
+        if (count % CHUNK_SAMPLES == 0)
+        {
+            // First sample of a block: the scanner has just read all of it
+            if (count / CHUNK_SAMPLES >= MAX_CHUNKS)
+            {
+                return false;
+            }
+
+            block_offsets[count / CHUNK_SAMPLES] = block_end;
+            block_end = scanner.valid_size();
+        }
+
+        if (count == epoch_start)
+        {
+            forget_sequences(high_water.load(std::memory_order_relaxed));
+        }
+
+        uint32_t previous;
+        claim_sequence(sample.sequence, 0, previous);
+        count++;
+    }
+
+    if ((count % CHUNK_SAMPLES != 0) || (ftruncate(block_fd, static_cast<off_t>(scanner.valid_size())) != 0))
+    {
+        return false;
+    }
+
+    block_file_size = scanner.valid_size();
+    sealed = count / CHUNK_SAMPLES;
+    blocks = count / CHUNK_SAMPLES;
+    freed_chunks = count / CHUNK_SAMPLES;
+
+    uint8_t records[RECORD_SIZE * 1024];
+    off_t offset = static_cast<off_t>(count * RECORD_SIZE);
+
+    while (true)
+    {
+        ssize_t read_len = pread(fd, records, sizeof(records), offset);
+
+        if (read_len < 0)
+        {
+            return false;
+        }
+
+        size_t full_records = static_cast<size_t>(read_len) / RECORD_SIZE;
+
+        for (size_t i = 0; i < full_records; i++)
+        {
+            Chunk *chunk = get_chunk(count / CHUNK_SAMPLES);
+
+            if (chunk == nullptr)
+            {
+                return false;
+            }
+
+            Sample &sample = chunk->samples[count % CHUNK_SAMPLES];
+            decode(records + i * RECORD_SIZE, sample);
+
+            if (count == epoch_start)
+            {
+                forget_sequences(high_water.load(std::memory_order_relaxed));
+            }
+
+            uint32_t previous;
+            claim_sequence(sample.sequence, 0, previous);
+            count++;
+        }
+
+        if (read_len < static_cast<ssize_t>(sizeof(records)))
+        {
+            break;
+        }
+
+        offset += read_len;
+    }
+
+    reserved = count;
+    committed = count;
+    loaded_chunks = count / CHUNK_SAMPLES;
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Encode sample to little endian file record.
+ *   Record: time_s (int64), temperature (float), humidity (int32),
+ *   sequence (uint32).
+ */
+void StationShard::encode(const Sample &sample, uint8_t *record)
+{
+    memcpy(record, &sample.time_s, 8);
+    memcpy(record + 8, &sample.temperature, 4);
+    int32_t humidity = sample.humidity;
+    memcpy(record + 12, &humidity, 4);
+    memcpy(record + 16, &sample.sequence, 4);
+}
+
+
+/*!
+ * @brief
+ *   Decode sample from file record.
+ */
+void StationShard::decode(const uint8_t *record, Sample &sample)
+{
+    memcpy(&sample.time_s, record, 8);
+    memcpy(&sample.temperature, record + 8, 4);
+    int32_t humidity;
+    memcpy(&humidity, record + 12, 4);
+    sample.humidity = humidity;
+    memcpy(&sample.sequence, record + 16, 4);
+}
+
+
+/*!
+ * @brief
+ *   Shard view class constructor.
+ *   Takes the samples committed by now; later ones are not seen.
+ *
+ * @param station_shard (IN)
+ *   Shard to view.
+ */
+ShardView::ShardView(const StationShard &station_shard)
+{
+    shard = &station_shard;
+    // Counted as a reader before taking the block count, see seal()
+    shard->readers.fetch_add(1);
+    cold_chunks = shard->blocks.load();
+    count = station_shard.size();
+    cached_chunk = StationShard::MAX_CHUNKS;
+}
+
+
+/*!
+ * @brief
+ *   Shard view copy constructor.
+ *   The copy sees the same samples.
+ *
+ * @param other (IN)
+ *   View to copy.
+ */
+ShardView::ShardView(const ShardView &other)
+{
+    shard = other.shard;
+    shard->readers.fetch_add(1);
+    cold_chunks = other.cold_chunks;
+    count = other.count;
+    cached_chunk = StationShard::MAX_CHUNKS;
+}
+
+
+/*!
+ * @brief
+ *   Shard view destructor.
+ *   Sealed chunks that only this view could read are freed by the next seal.
+ */
+ShardView::~ShardView()
+{
+    shard->readers.fetch_sub(1);
+}
+
+
+/*!
+ * @brief
+ *   Shard view assignment.
+ *
+ * @param other (IN)
+ *   View to copy.
+ */
+ShardView &ShardView::operator=(const ShardView &other)
+{
+    other.shard->readers.fetch_add(1);
+    shard->readers.fetch_sub(1);
+    shard = other.shard;
+    cold_chunks = other.cold_chunks;
+    count = other.count;
+    cached_chunk = StationShard::MAX_CHUNKS;
+
+    return *this;
+}
+
+
+/*!
+ * @brief
+ *   Get number of samples in view.
+ */
+size_t ShardView::size() const
+{
+    return count;
+}
+
+
+/*!
+ * @brief
+ *   Get sample in view.
+ *   A sample sealed before the view was taken is read from its block, which
+ *   is decoded once for consecutive reads. A sample whose block cannot be
+ *   read is returned zeroed.
+ *
+ * @param index (IN)
+ *   Sample index, less than size().
+ */
+Sample ShardView::at(size_t index) const
+{
+    size_t chunk_index = index / StationShard::CHUNK_SAMPLES;
+
+    if (chunk_index >= cold_chunks)
+    {
+        return shard->chunks[chunk_index].load(std::memory_order_relaxed)->samples[index % StationShard::CHUNK_SAMPLES];
+    }
+
+    if (cached_chunk != chunk_index)
+    {
+        if (!shard->read_block(chunk_index, cached_samples))
+        {
+            cached_samples.assign(StationShard::CHUNK_SAMPLES, Sample());
+        }
+
+        cached_chunk = chunk_index;
+    }
+
+    return cached_samples[index % StationShard::CHUNK_SAMPLES];
+}
+
+
+/*!
+ * @brief
+ *   Find first sample in view not older than given time.
+ *   Samples are stored in arrival order, which is time order. In the sealed
+ *   part the block is found from the block headers, so only that block is
+ *   decoded.
+ *
+ * @param time_s (IN)
+ *   Unix time in seconds.
+ *
+ * @return
+ *   Index of first sample with time_s >= time_s, or size() if none.
+ */
+size_t ShardView::lower_bound(int64_t time_s) const
+{
+    size_t first = 0;
+    size_t last = count;
+    size_t hot = cold_chunks * StationShard::CHUNK_SAMPLES;
+
+    if ((hot < count) && (hot > 0) && (at(hot).time_s < time_s))
+    {
+        first = hot;
+    }
+    else if (hot > 0)
+    {
+        size_t block = shard->find_block(time_s, cold_chunks);
+
+        if (block == cold_chunks)
+        {
+            return hot;
+        }
+
+        first = block * StationShard::CHUNK_SAMPLES;
+        last = first + StationShard::CHUNK_SAMPLES;
+    }
+
+    while (last > first)
+    {
+        size_t middle = first + (last - first) / 2;
+
+        if (at(middle).time_s < time_s)
+        {
+            first = middle + 1;
+        }
+        else
+        {
+            last = middle;
+        }
+    }
+
+    return first;
+}
+
+
+/*!
+ * @brief
+ *   Get station ID.
+ */
+const std::string &ShardView::id() const
+{
+    return shard->id();
+}
+
+
+/*!
+ * @brief
+ *   Store snapshot class constructor.
+ *   Takes a view of every shard, in station ID order.
+ *
+ * @param store (IN)
+ *   Store to view.
+ */
+StoreSnapshot::StoreSnapshot(const Store &store)
+{
+    for (StationShard *shard : store.shards())
+    {
+        views.push_back(ShardView(*shard));
+    }
+}
+
+
+/*!
+ * @brief
+ *   Store snapshot class constructor.
+ *   Takes a view of one station, none if the station is not stored.
+ *
+ * @param store (IN)
+ *   Store to view.
+ *
+ * @param station_id (IN)
+ *   Station ID.
+ */
+StoreSnapshot::StoreSnapshot(const Store &store, const std::string &station_id)
+{
+    if (StationShard *shard = store.find(station_id))
+    {
+        views.push_back(ShardView(*shard));
+    }
+}
+
+
+/*!
+ * @brief
+ *   Get views of the shards in snapshot.
+ */
+const std::vector<ShardView> &StoreSnapshot::shards() const
+{
+    return views;
+}
+
+
+/*!
+ * @brief
+ *   Find view of a station.
+ *
+ * @param station_id (IN)
+ *   Station ID.
+ *
+ * @return
+ *   View or nullptr if the station is not in snapshot.
+ */
+const ShardView *StoreSnapshot::find(const std::string &station_id) const
+{
+    for (const ShardView &view : views)
+    {
+        if (view.id() == station_id)
+        {
+            return &view;
+        }
+    }
+
+    return nullptr;
+}
+
+
+/*!
+ * @brief
+ *   Store class constructor.
+ *
+ * @param data_dir (IN)
+ *   Directory for shard files.
+ */
+Store::Store(const std::string &data_dir)
+{
+    directory = data_dir;
+
+    for (size_t i = 0; i < MAX_STATIONS; i++)
+    {
+        table[i] = nullptr;
+    }
+}
+
+
+/*!
+ * @brief
+ *   Store class destructor.
+ */
+Store::~Store()
+{
+    for (size_t i = 0; i < MAX_STATIONS; i++)
+    {
+        delete table[i].load();
+    }
+}
+
+
+/*!
+ * @brief
+ *   Create data directory if needed and load existing shards.
+ *
+ * @return
+ *   True if all shards are loaded, false otherwise.
+ */
+bool Store::open()
+{
+    if ((mkdir(directory.c_str(), 0755) != 0) && (errno != EEXIST))
+    {
+        return false;
+    }
+
+    DIR *dir = opendir(directory.c_str());
+
+    if (dir == nullptr)
+    {
+        return false;
+    }
+
+    bool ok = true;
+    dirent *entry;
+
+    while ((entry = readdir(dir)) != nullptr)
+    {
+        std::string name = entry->d_name;
+        size_t id_length = name.size() - SHARD_EXTENSION.size();
+
+        if ((name.size() > SHARD_EXTENSION.size()) && (name.compare(id_length, std::string::npos, SHARD_EXTENSION) == 0))
+        {
+            ok = (find_or_create(name.substr(0, id_length)) != nullptr) && ok;
+        }
+    }
+
+    closedir(dir);
+
+    return ok;
+}
+
+
+/*!
+ * @brief
+ *   Append sample to station's shard, creating the shard for a new station.
+ *
+ * @param station_id (IN)
+ *   Station ID.
+ *
+ * @param sample (IN)
+ *   Sample to append.
+ *
+ * @return
+ *   Result of StationShard::append(), FAILED if the shard cannot be created.
+ */
+StationShard::Result Store::append(const std::string &station_id, const Sample &sample)
+{
+    StationShard *shard = find_or_create(station_id);
+
+    return (shard != nullptr) ? shard->append(sample) : StationShard::FAILED;
+}
+
+
+/*!
+ * @brief
+ *   Append the samples of one upload to station's shard together, creating
+ *   the shard for a new station.
+ *
+ * @param station_id (IN)
+ *   Station ID.
+ *
+ * @param samples (IN)
+ *   Samples in time order, at least one, with the upload's sequence number.
+ *
+ * @param epoch (IN)
+ *   Epoch of the station's sequence counter, 0 if not sent.
+ *
+ * @return
+ *   Result of StationShard::append(), FAILED if the shard cannot be created.
+ */
+StationShard::Result Store::append(const std::string &station_id, const std::vector<Sample> &samples, uint32_t epoch)
+{
+    StationShard *shard = find_or_create(station_id);
+
+    return (shard != nullptr) ? shard->append(samples, epoch) : StationShard::FAILED;
+}
+
+
+/*!
+ * @brief
+ *   Find station's shard.
+ *
+ * @param station_id (IN)
+ *   Station ID.
+ *
+ * @return
+ *   Shard or nullptr if the station has no samples.
+ */
+StationShard *Store::find(const std::string &station_id) const
+{
+    size_t slot = slot_of(station_id);
+
+    for (size_t i = 0; i < MAX_STATIONS; i++)
+    {
+        StationShard *shard = table[(slot + i) % MAX_STATIONS].load(std::memory_order_acquire);
+
+        if ((shard == nullptr) || (shard->id() == station_id))
+        {
+            return shard;
+        }
+    }
+
+    return nullptr;
+}
+
+
+/*!
+ * @brief
+ *   Get all station shards in station ID order.
+ */
+std::vector<StationShard *> Store::shards() const
+{
+    std::vector<StationShard *> all;
+
+    for (size_t i = 0; i < MAX_STATIONS; i++)
+    {
+        StationShard *shard = table[i].load(std::memory_order_acquire);
+
+        if (shard != nullptr)
+        {
+            all.push_back(shard);
+        }
+    }
+
+    std::sort(all.begin(), all.end(),
+              [](const StationShard *a, const StationShard *b) { return a->id() < b->id(); });
+
+    return all;
+}
+
+
+/*!
+ * @brief
+ *   Check that station ID is usable as a file name: 1-32 characters from
+ *   letters, digits, '-' and '_'.
+ */
+bool Store::valid_station_id(const std::string &station_id)
+{
+    if (station_id.empty() || (station_id.size() > MAX_STATION_ID_LENGTH))
+    {
+        return false;
+    }
+
+    for (char c : station_id)
+    {
+        if (!isalnum(static_cast<unsigned char>(c)) && (c != '-') && (c != '_'))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Find station's shard or create it.
+ *   The station table is open addressed and shards are inserted with
+ *   compare-and-swap, so lookups and inserts take no locks.
+ *
+ * @param station_id (IN)
+ *   Station ID.
+ *
+ * @return
+ *   Shard or nullptr if the ID is invalid, the table is full or the file
+ *   cannot be opened.
+ */
+StationShard *Store::find_or_create(const std::string &station_id)
+{
+    if (!valid_station_id(station_id))
+    {
+        return nullptr;
+    }
+
+    size_t slot = slot_of(station_id);
+
+    for (size_t i = 0; i < MAX_STATIONS; i++)
+    {
+        std::atomic<StationShard *> &entry = table[(slot + i) % MAX_STATIONS];
+        StationShard *shard = entry.load(std::memory_order_acquire);
+
+        if (shard == nullptr)
+        {
+            std::string path = directory + "/" + station_id + SHARD_EXTENSION;
+            int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+
+            if (fd < 0)
+            {
+                return nullptr;
+            }
+
+            path = directory + "/" + station_id + BLOCK_EXTENSION;
+            int block_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+
+            if (block_fd < 0)
+            {
+                close(fd);
+                return nullptr;
+            }
+
+            path = directory + "/" + station_id + EPOCH_EXTENSION;
+            int epoch_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+
+            if (epoch_fd < 0)
+            {
+                close(fd);
+                close(block_fd);
+                return nullptr;
+            }
+
+            StationShard *new_shard = new StationShard(station_id, fd, block_fd, epoch_fd);
+
+            if (!new_shard->load())
+            {
+                delete new_shard;
+                return nullptr;
+            }
+
+            if (entry.compare_exchange_strong(shard, new_shard, std::memory_order_acq_rel))
+            {
+                // Seal full chunks of a log written before sealing, or after
+                // a failed seal. Only the shard in the table writes blocks.
+                for (size_t chunk_index = new_shard->sealed; chunk_index < new_shard->loaded_chunks; chunk_index++)
+                {
+                    new_shard->seal(chunk_index);
+                }
+
+                return new_shard;
+            }
+
+            delete new_shard;
+        }
+
+        if (shard->id() == station_id)
+        {
+            return shard;
+        }
+    }
+
+    return nullptr;
+}
+
+
+/*!
+ * @brief
+ *   Get first station table slot to probe for station ID.
+ */
+size_t Store::slot_of(const std::string &station_id) const
+{
+    return std::hash<std::string>()(station_id) % MAX_STATIONS;
+}
@@ -0,0 +1,250 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <cmath>
+#include <fstream>
+#include <mutex>
+#include "unity.h"
+#include "alerts.h"
+#include "test_client.h"
+
+
+/*! Sink remembering delivered events */
+class TestSink : public AlertSink
+{
+public:
+    void deliver(const std::string &json)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        events.push_back(json);
+    }
+
+    std::vector<std::string> events;
+    std::mutex mutex;
+};
+
+
+/*! Sample at a time with a temperature */
+static Sample make_sample(int64_t time_s, float temperature, int humidity = 50)
+{
+    return {time_s, temperature, humidity, 0};
+}
+
+
+TEST_CASE("Alert rules are parsed", "[alerts]")
+{
+    AlertRule rule;
+    TEST_ASSERT_TRUE(parse_alert_rule("frost * temperature < 0 for 30m", 10, rule));
+    TEST_ASSERT_EQUAL_STRING("frost", rule.name.c_str());
+    TEST_ASSERT_EQUAL_STRING("*", rule.station.c_str());
+    TEST_ASSERT_EQUAL(AlertRule::THRESHOLD, rule.kind);
+    TEST_ASSERT_EQUAL(AlertRule::TEMPERATURE, rule.field);
+    TEST_ASSERT_EQUAL(AlertRule::BELOW, rule.compare);
+    TEST_ASSERT_EQUAL(1800, static_cast<int>(rule.duration_s));
+
+    TEST_ASSERT_TRUE(parse_alert_rule("damp attic humidity >= 85.5", 10, rule));
+    TEST_ASSERT_EQUAL(AlertRule::ABOVE_OR_EQUAL, rule.compare);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 85.5, rule.threshold);
+    TEST_ASSERT_EQUAL(0, static_cast<int>(rule.duration_s));
+
+    TEST_ASSERT_TRUE(parse_alert_rule("silent * nodata 3", 10, rule));
+    TEST_ASSERT_EQUAL(AlertRule::NO_DATA, rule.kind);
+    TEST_ASSERT_EQUAL(1800, static_cast<int>(rule.duration_s));
+
+    TEST_ASSERT_FALSE(parse_alert_rule("frost * temperature < 0 for 30", 10, rule));
+    TEST_ASSERT_FALSE(parse_alert_rule("frost * pressure < 0", 10, rule));
+    TEST_ASSERT_FALSE(parse_alert_rule("frost * temperature = 0", 10, rule));
+    TEST_ASSERT_FALSE(parse_alert_rule("frost * temperature < cold", 10, rule));
+    TEST_ASSERT_FALSE(parse_alert_rule("fr\"ost * temperature < 0", 10, rule));
+    TEST_ASSERT_FALSE(parse_alert_rule("silent * nodata 0", 10, rule));
+    TEST_ASSERT_FALSE(parse_alert_rule("silent * nodata 3 extra", 10, rule));
+}
+
+
+TEST_CASE("Threshold alert fires once after its duration and resolves", "[alerts]")
+{
+    AlertEngine engine;
+    AlertRule rule;
+    parse_alert_rule("frost * temperature < 0 for 30m", 10, rule);
+    engine.add_rule(rule);
+    std::vector<AlertEvent> events;
+
+    engine.on_sample("attic", make_sample(0, -1.0f), events);
+    engine.on_sample("attic", make_sample(1200, -2.0f), events);
+    TEST_ASSERT_EQUAL(0u, events.size());
+    engine.on_sample("attic", make_sample(1800, -3.0f), events);
+    TEST_ASSERT_EQUAL(1u, events.size());
+    TEST_ASSERT_TRUE(events[0].firing);
+    TEST_ASSERT_EQUAL_STRING("attic", events[0].station.c_str());
+    engine.on_sample("attic", make_sample(2400, -4.0f), events);
+    TEST_ASSERT_EQUAL(1u, events.size());
+
+    engine.on_sample("attic", make_sample(3000, 0.5f), events);
+    TEST_ASSERT_EQUAL(2u, events.size());
+    TEST_ASSERT_FALSE(events[1].firing);
+    TEST_ASSERT_EQUAL_STRING("{\"alert\":\"frost\",\"station\":\"attic\",\"state\":\"resolved\",\"time\":3000,"
+                             "\"value\":0.5}", AlertEngine::event_to_json(events[1]).c_str());
+
+    // A warm sample starts the duration again
+    engine.on_sample("attic", make_sample(3600, -1.0f), events);
+    engine.on_sample("attic", make_sample(4200, 1.0f), events);
+    engine.on_sample("attic", make_sample(4800, -1.0f), events);
+    engine.on_sample("attic", make_sample(6000, -1.0f), events);
+    TEST_ASSERT_EQUAL(2u, events.size());
+}
+
+
+TEST_CASE("Alert rules apply to their stations only", "[alerts]")
+{
+    AlertEngine engine;
+    TestSink sink;
+    engine.add_sink(&sink);
+    AlertRule rule;
+    parse_alert_rule("damp attic humidity > 80", 10, rule);
+    engine.add_rule(rule);
+    std::vector<AlertEvent> events;
+
+    engine.on_sample("cellar", make_sample(0, 10.0f, 90), events);
+    TEST_ASSERT_EQUAL(0u, events.size());
+    engine.on_sample("attic", make_sample(0, 10.0f, 90), events);
+    TEST_ASSERT_EQUAL(1u, events.size());
+    TEST_ASSERT_EQUAL(1u, sink.events.size());
+    TEST_ASSERT_EQUAL_STRING("{\"alert\":\"damp\",\"station\":\"attic\",\"state\":\"firing\",\"time\":0,"
+                             "\"value\":90.0}", sink.events[0].c_str());
+}
+
+
+TEST_CASE("Nodata alert fires for silent stations", "[alerts]")
+{
+    AlertEngine engine;
+    AlertRule rule;
+    parse_alert_rule("silent * nodata 3", 10, rule);
+    engine.add_rule(rule);
+    std::vector<AlertEvent> events;
+
+    engine.track("cellar", 0);
+    engine.on_sample("attic", make_sample(0, 20.0f), events);
+    engine.on_sample("attic", make_sample(600, 20.0f), events);
+    engine.check_silence(1799, events);
+    TEST_ASSERT_EQUAL(0u, events.size());
+
+    engine.check_silence(1800, events);
+    TEST_ASSERT_EQUAL(1u, events.size());
+    TEST_ASSERT_EQUAL_STRING("cellar", events[0].station.c_str());
+    TEST_ASSERT_TRUE(std::isnan(events[0].value));
+    engine.check_silence(2400, events);
+    TEST_ASSERT_EQUAL(2u, events.size());
+    TEST_ASSERT_EQUAL_STRING("attic", events[1].station.c_str());
+    engine.check_silence(10000, events);
+    TEST_ASSERT_EQUAL(2u, events.size());
+
+    engine.on_sample("cellar", make_sample(10000, 20.0f), events);
+    TEST_ASSERT_EQUAL(3u, events.size());
+    TEST_ASSERT_FALSE(events[2].firing);
+    TEST_ASSERT_EQUAL_STRING("{\"alert\":\"silent\",\"station\":\"cellar\",\"state\":\"resolved\",\"time\":10000}",
+                             AlertEngine::event_to_json(events[2]).c_str());
+
+    // A station keeps one silence entry however many samples it sends
+    size_t bytes = engine.state_bytes();
+
+    for (int64_t time_s = 10600; time_s < 610000; time_s += 600)
+    {
+        engine.on_sample("cellar", make_sample(time_s, 20.0f), events);
+        engine.check_silence(time_s, events);
+    }
+
+    TEST_ASSERT_EQUAL(bytes, engine.state_bytes());
+    TEST_ASSERT_EQUAL(3u, events.size());
+    engine.check_silence(609400 + 1799, events);
+    TEST_ASSERT_EQUAL(3u, events.size());
+    engine.check_silence(609400 + 1800, events);
+    TEST_ASSERT_EQUAL(4u, events.size());
+    TEST_ASSERT_EQUAL_STRING("cellar", events[3].station.c_str());
+}
+
+
+TEST_CASE("Alert rule file reports the invalid line", "[alerts]")
+{
+    std::string dir = make_test_dir();
+    std::ofstream(dir + "/alerts.txt") << "# rules\n\nfrost * temperature < 0 for 30m # night frost\n"
+                                          "silent * nodata 3\nbad rule\n";
+    AlertEngine engine;
+    std::string error;
+    TEST_ASSERT_FALSE(engine.load(dir + "/alerts.txt", 10, error));
+    TEST_ASSERT_EQUAL(2u, engine.rule_count());
+    TEST_ASSERT_TRUE(error.find("line 5") != std::string::npos);
+
+    AlertEngine empty;
+    TEST_ASSERT_TRUE(empty.load(dir + "/missing.txt", 10, error));
+    TEST_ASSERT_EQUAL(0u, empty.rule_count());
+}
+
+
+TEST_CASE("Uploaded samples raise alerts to file, webhook and dashboards", "[alerts]")
+{
+    std::string dir = make_test_dir();
+    TestCollector receiver(make_test_dir());
+    std::string received;
+    std::mutex received_mutex;
+    receiver.server.set_request_handler(
+        [&](HttpServer::ConnectionId id, const HttpRequest &request, HttpResponse &response)
+        {
+            std::lock_guard<std::mutex> lock(received_mutex);
+            received += request.body;
+        });
+
+    AlertEngine engine;
+    AlertRule rule;
+    parse_alert_rule("frost * temperature < 0", 10, rule);
+    engine.add_rule(rule);
+    AlertFileSink file(dir + "/alerts.jsonl");
+    AlertWebhookSink webhook;
+    TEST_ASSERT_FALSE(webhook.open("https://127.0.0.1/hook"));
+    TEST_ASSERT_TRUE(webhook.open("http://127.0.0.1:" + std::to_string(receiver.port()) + "/hook"));
+    engine.add_sink(&file);
+    engine.add_sink(&webhook);
+
+    TestCollector collector(dir);
+    collector.collector.set_alerts(&engine);
+    TestClient dashboard(collector.port());
+    dashboard.send_text("GET /events HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    dashboard.receive_until("retry:");
+
+    http_request(collector.port(), "POST", "/collect.php", "Station=attic&Temperature=-1.5&Humidity=40");
+    TEST_ASSERT_TRUE(dashboard.receive_until("event: alert").find("\"state\":\"firing\"") != std::string::npos);
+
+    std::ifstream lines(dir + "/alerts.jsonl");
+    std::string line;
+    std::getline(lines, line);
+    TEST_ASSERT_TRUE(line.find("{\"alert\":\"frost\",\"station\":\"attic\",\"state\":\"firing\"") == 0);
+
+    for (int i = 0; (i < 200) && (webhook.delivered() == 0); i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    TEST_ASSERT_EQUAL(1u, webhook.delivered());
+    std::lock_guard<std::mutex> lock(received_mutex);
+    TEST_ASSERT_EQUAL_STRING(line.c_str(), received.c_str());
+}
@@ -0,0 +1,216 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Loopback helpers for collector tests and benchmarks: a collector running in
+ * its own thread, its MQTT and CoAP listeners and a blocking HTTP client.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "coap_listener.h"
+#include "collector.h"
+#include "http_server.h"
+#include "mqtt_listener.h"
+#include "store.h"
+
+/*! Create an empty temporary data directory */
+inline std::string make_test_dir()
+{
+    char dir[] = "/tmp/collector_test_XXXXXX";
+    return mkdtemp(dir);
+}
+
+/*! Collector listening on a free loopback port in a background thread */
+class TestCollector
+{
+public:
+    TestCollector(const std::string &data_dir)
+        : store(data_dir + "/stations"), collector(server, store, data_dir)
+    {
+        store.open();
+        server.listen(0, "127.0.0.1");
+        thread = std::thread([this]() { server.run(); });
+    }
+
+    ~TestCollector()
+    {
+        server.stop();
+        thread.join();
+    }
+
+    int port() const
+    {
+        return server.port();
+    }
+
+    HttpServer server;
+    Store store;
+    Collector collector;
+
+private:
+    std::thread thread;
+};
+
+/*! MQTT and CoAP listeners of a test collector on free loopback ports */
+class TestListeners
+{
+public:
+    TestListeners(Collector &collector) : mqtt(collector), coap(collector)
+    {
+        mqtt.listen(0, "127.0.0.1");
+        coap.listen(0, "127.0.0.1");
+        mqtt_thread = std::thread([this]() { mqtt.run(); });
+        coap_thread = std::thread([this]() { coap.run(); });
+    }
+
+    ~TestListeners()
+    {
+        mqtt.stop();
+        coap.stop();
+        mqtt_thread.join();
+        coap_thread.join();
+    }
+
+    MqttListener mqtt;
+    CoapListener coap;
+
+private:
+    std::thread mqtt_thread;
+    std::thread coap_thread;
+};
+
+/*! Blocking loopback TCP client */
+class TestClient
+{
+public:
+    TestClient(int port)
+    {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        connected = (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0);
+    }
+
+    ~TestClient()
+    {
+        close(fd);
+    }
+
+    bool send_text(const std::string &text)
+    {
+        return ::send(fd, text.data(), text.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(text.size());
+    }
+
+    /*! Receive until marker is seen, the peer closes or timeout. Empty marker reads until close. */
+    std::string receive_until(const std::string &marker, int timeout_ms = 2000)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+
+        while (marker.empty() || (received.find(marker) == std::string::npos))
+        {
+            int remaining_ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count());
+            pollfd poll_fd = {fd, POLLIN, 0};
+
+            if ((remaining_ms <= 0) || (poll(&poll_fd, 1, remaining_ms) <= 0))
+            {
+                break;
+            }
+
+            char buffer[4096];
+            ssize_t read_len = recv(fd, buffer, sizeof(buffer), 0);
+
+            if (read_len <= 0)
+            {
+                break;
+            }
+
+            received.append(buffer, static_cast<size_t>(read_len));
+        }
+
+        return received;
+    }
+
+    int fd;
+    bool connected;
+    std::string received;
+};
+
+/*! Send one request with "Connection: close" and return the whole response */
+inline std::string http_request(int port, const std::string &method, const std::string &target,
+                                const std::string &body = "")
+{
+    TestClient client(port);
+    client.send_text(method + " " + target + " HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n" +
+                     "Content-Type: application/x-www-form-urlencoded\r\n" +
+                     "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body);
+
+    return client.receive_until("");
+}
+
+
+/*! Body of a response with chunked transfer encoding, empty if it is not complete */
+inline std::string http_chunked_body(const std::string &response)
+{
+    // Each chunk size line follows the line break ending the headers or the previous chunk
+    size_t offset = response.find("\r\n\r\n");
+    offset = (offset != std::string::npos) ? offset + 2 : offset;
+    std::string body;
+
+    while (offset != std::string::npos)
+    {
+        offset += 2;
+        char *end = nullptr;
+        size_t size = strtoul(response.c_str() + offset, &end, 16);
+        size_t data = response.find("\r\n", offset);
+
+        if ((end == response.c_str() + offset) || (data == std::string::npos) ||
+            (response.size() < data + 2 + size + 2))
+        {
+            break;
+        }
+
+        if (size == 0)
+        {
+            return body;
+        }
+
+        body.append(response, data + 2, size);
+        offset = data + 2 + size;
+    }
+
+    return "";
+}
@@ -0,0 +1,175 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "unity.h"
+#include "codec.h"
+#include "test_client.h"
+
+
+/*!
+ * @brief
+ *   Make samples of a station sampling about once a minute.
+ */
+static std::vector<Sample> make_samples(size_t count)
+{
+    std::vector<Sample> samples;
+    int64_t time_s = 1559390400;
+    float temperature = 21.5f;
+    int humidity = 40;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        time_s += 60 + static_cast<int>(i % 5) - 2;
+        temperature += static_cast<float>(static_cast<int>(i % 7) - 3) / 10;
+        humidity += static_cast<int>(i % 3) - 1;
+        samples.push_back({time_s, temperature, humidity, static_cast<uint32_t>(i + 1)});
+    }
+
+    return samples;
+}
+
+
+TEST_CASE("Bit stream round trip", "[codec]")
+{
+    BitWriter writer;
+    writer.write(1, 1);
+    writer.write(0x1234, 13);
+    writer.write(UINT64_MAX, 64);
+    writer.write(5, 3);
+    TEST_ASSERT_EQUAL(11u, writer.bytes().size());
+
+    BitReader reader(writer.bytes().data(), writer.bytes().size());
+    uint64_t bits;
+    TEST_ASSERT_TRUE(reader.read(1, bits) && (bits == 1));
+    TEST_ASSERT_TRUE(reader.read(13, bits) && (bits == 0x1234));
+    TEST_ASSERT_TRUE(reader.read(64, bits) && (bits == UINT64_MAX));
+    TEST_ASSERT_TRUE(reader.read(3, bits) && (bits == 5));
+    TEST_ASSERT_TRUE(reader.read(7, bits) && (bits == 0));
+    TEST_ASSERT_FALSE(reader.read(1, bits));
+}
+
+
+TEST_CASE("Block round trip is lossless", "[codec]")
+{
+    std::vector<Sample> samples = make_samples(1000);
+    // Gaps, jumps and a station that lost its sequence counter
+    samples[100].time_s += 86400;
+    samples[200].temperature = -40.0f;
+    samples[300].humidity = 100;
+    samples[400].sequence = 1;
+    samples[500].time_s = samples[499].time_s;
+
+    BlockEncoder encoder;
+
+    for (const Sample &sample : samples)
+    {
+        encoder.append(sample);
+    }
+
+    TEST_ASSERT_EQUAL(1000u, encoder.count());
+    TEST_ASSERT_TRUE(encoder.bytes().size() < 1000 * 6);
+
+    BlockDecoder decoder(encoder.bytes().data(), encoder.bytes().size(), encoder.count());
+    Sample sample;
+
+    for (const Sample &expected : samples)
+    {
+        TEST_ASSERT_TRUE(decoder.next(sample));
+        TEST_ASSERT_EQUAL(expected.time_s, sample.time_s);
+        TEST_ASSERT_TRUE(memcmp(&expected.temperature, &sample.temperature, 4) == 0);
+        TEST_ASSERT_EQUAL(expected.humidity, sample.humidity);
+        TEST_ASSERT_EQUAL(expected.sequence, sample.sequence);
+    }
+
+    TEST_ASSERT_FALSE(decoder.next(sample));
+
+    // Truncated block ends the stream instead of reading past it
+    BlockDecoder truncated(encoder.bytes().data(), 30, encoder.count());
+    size_t decoded = 0;
+
+    while (truncated.next(sample))
+    {
+        decoded++;
+    }
+
+    TEST_ASSERT_TRUE(decoded < 100);
+}
+
+
+TEST_CASE("Scan time range of block file", "[codec]")
+{
+    std::string path = make_test_dir() + "/test.blk";
+    int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    std::vector<Sample> samples = make_samples(3000);
+    BlockEncoder encoder;
+
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        encoder.append(samples[i]);
+
+        if ((encoder.count() == 1000) || (i == samples.size() - 1))
+        {
+            BlockHeader header = {static_cast<uint32_t>(encoder.count()), static_cast<uint32_t>(encoder.bytes().size()),
+                                  encoder.first_time(), encoder.last_time()};
+            uint8_t data[BlockHeader::SIZE];
+            header.encode(data);
+            TEST_ASSERT_EQUAL(static_cast<ssize_t>(sizeof(data)), write(fd, data, sizeof(data)));
+            TEST_ASSERT_EQUAL(static_cast<ssize_t>(encoder.bytes().size()),
+                              write(fd, encoder.bytes().data(), encoder.bytes().size()));
+            encoder.clear();
+        }
+    }
+
+    off_t complete_size = lseek(fd, 0, SEEK_CUR);
+    // Partially written block at the end
+    TEST_ASSERT_EQUAL(10, write(fd, "0123456789", 10));
+
+    BlockScanner scanner(fd, samples[1500].time_s, samples[2499].time_s);
+    Sample sample;
+    size_t count = 0;
+
+    while (scanner.next(sample))
+    {
+        TEST_ASSERT_EQUAL(samples[1500 + count].time_s, sample.time_s);
+        count++;
+    }
+
+    TEST_ASSERT_EQUAL(1000u, count);
+
+    BlockScanner all(fd, INT64_MIN, INT64_MAX);
+    count = 0;
+
+    while (all.next(sample))
+    {
+        count++;
+    }
+
+    TEST_ASSERT_EQUAL(3000u, count);
+    TEST_ASSERT_EQUAL(static_cast<size_t>(complete_size), all.valid_size());
+    close(fd);
+}
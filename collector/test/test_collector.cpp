@@ -0,0 +1,178 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <fstream>
+#include "unity.h"
+#include "test_client.h"
+
+
+TEST_CASE("Format sample event", "[collector]")
+{
+    Sample sample = {1559390400, 21.5f, 40, 0};
+    TEST_ASSERT_EQUAL_STRING("{\"station\":\"attic\",\"time\":1559390400,\"temperature\":21.5,\"humidity\":40}",
+                             Collector::sample_to_json("attic", sample));
+}
+
+
+TEST_CASE("Posted samples are stored per station", "[collector]")
+{
+    TestCollector collector(make_test_dir());
+    std::string response = http_request(collector.port(), "POST", "/collect.php",
+                                        "Station=240ac4123456&Temperature=25.0&Humidity=40");
+    TEST_ASSERT_TRUE(response.find("HTTP/1.1 200 OK") == 0);
+    response = http_request(collector.port(), "POST", "/collect.php?Temperature=-0.5&Humidity=99");
+    TEST_ASSERT_TRUE(response.find("HTTP/1.1 200 OK") == 0);
+
+    StationShard *shard = collector.store.find("240ac4123456");
+    TEST_ASSERT_TRUE(shard != nullptr);
+    TEST_ASSERT_EQUAL(1u, shard->size());
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 25.0, shard->at(0).temperature);
+    shard = collector.store.find(Collector::DEFAULT_STATION);
+    TEST_ASSERT_TRUE(shard != nullptr);
+    TEST_ASSERT_EQUAL(99, shard->at(0).humidity);
+
+    response = http_request(collector.port(), "GET", "/stations");
+    TEST_ASSERT_TRUE(response.find("[{\"station\":\"240ac4123456\",\"samples\":1,\"sequence\":0},"
+                                   "{\"station\":\"default\",\"samples\":1,\"sequence\":0}]") != std::string::npos);
+}
+
+
+TEST_CASE("Resent sample is acknowledged but stored once", "[collector]")
+{
+    TestCollector collector(make_test_dir());
+    std::string body = "Station=attic&Temperature=25.0&Humidity=40&Sequence=7";
+    std::string response = http_request(collector.port(), "POST", "/collect.php", body);
+    TEST_ASSERT_TRUE(response.find("HTTP/1.1 200 OK") == 0);
+    response = http_request(collector.port(), "POST", "/collect.php", body);
+    TEST_ASSERT_TRUE(response.find("HTTP/1.1 200 OK") == 0);
+    TEST_ASSERT_TRUE(response.find("\r\n\r\nDuplicate") != std::string::npos);
+    TEST_ASSERT_EQUAL(1u, collector.store.find("attic")->size());
+    TEST_ASSERT_EQUAL(7u, collector.store.find("attic")->last_sequence());
+
+    // A station that started its counter again is stored under its new epoch
+    response = http_request(collector.port(), "POST", "/collect.php", body + "&Epoch=42");
+    TEST_ASSERT_TRUE(response.find("\r\n\r\nDuplicate") == std::string::npos);
+    TEST_ASSERT_EQUAL(2u, collector.store.find("attic")->size());
+
+    response = http_request(collector.port(), "POST", "/collect.php", "Temperature=25&Humidity=40&Sequence=-1");
+    TEST_ASSERT_TRUE(response.find("HTTP/1.1 400") == 0);
+    response = http_request(collector.port(), "POST", "/collect.php", "Temperature=25&Humidity=40&Epoch=x");
+    TEST_ASSERT_TRUE(response.find("HTTP/1.1 400") == 0);
+}
+
+
+TEST_CASE("Invalid sample is rejected", "[collector]")
+{
+    TestCollector collector(make_test_dir());
+    std::string response = http_request(collector.port(), "POST", "/collect.php", "Temperature=hot&Humidity=40");
+    TEST_ASSERT_TRUE(response.find("HTTP/1.1 400") == 0);
+    response = http_request(collector.port(), "POST", "/collect.php", "Temperature=20");
+    TEST_ASSERT_TRUE(response.find("HTTP/1.1 400") == 0);
+    response = http_request(collector.port(), "POST", "/collect.php", "Station=../x&Temperature=20&Humidity=40");
+    TEST_ASSERT_TRUE(response.find("HTTP/1.1 400") == 0);
+    TEST_ASSERT_EQUAL(0u, collector.store.shards().size());
+}
+
+
+TEST_CASE("Query one station and aggregate", "[collector]")
+{
+    TestCollector collector(make_test_dir());
+    http_request(collector.port(), "POST", "/collect.php", "Station=a&Temperature=10.0&Humidity=40");
+    http_request(collector.port(), "POST", "/collect.php", "Station=b&Temperature=20.0&Humidity=60");
+
+    std::string response = http_request(collector.port(), "GET", "/query?station=b&last=16");
+    TEST_ASSERT_TRUE(response.find("\"temperature\":20.0,\"humidity\":60}]") != std::string::npos);
+    response = http_request(collector.port(), "GET", "/query?step=86400&last=1");
+    TEST_ASSERT_TRUE(response.find("\"temperature\":15.0,\"humidity\":50}]") != std::string::npos);
+    response = http_request(collector.port(), "GET", "/query?station=b&last=x");
+    TEST_ASSERT_TRUE(response.find("HTTP/1.1 400") == 0);
+}
+
+
+TEST_CASE("Serve measurement interval", "[collector]")
+{
+    std::string dir = make_test_dir();
+    std::ofstream(dir + "/interval.txt") << "10";
+    TestCollector collector(dir);
+    std::string response = http_request(collector.port(), "GET", "/interval.txt");
+    TEST_ASSERT_TRUE(response.find("HTTP/1.1 200 OK") == 0);
+    TEST_ASSERT_TRUE(response.find("\r\n\r\n10") != std::string::npos);
+    response = http_request(collector.port(), "GET", "/weather.php");
+    TEST_ASSERT_TRUE(response.find("HTTP/1.1 404") == 0);
+}
+
+
+TEST_CASE("Keep-alive connection serves several requests", "[collector]")
+{
+    std::string dir = make_test_dir();
+    std::ofstream(dir + "/interval.txt") << "60";
+    TestCollector collector(dir);
+    TestClient client(collector.port());
+    client.send_text("GET /interval.txt HTTP/1.1\r\n\r\nGET /interval.txt HTTP/1.1\r\n\r\n");
+    std::string response = client.receive_until("60HTTP/1.1 200 OK");
+    TEST_ASSERT_TRUE(response.rfind("\r\n\r\n60") > response.find("\r\n\r\n60"));
+}
+
+
+TEST_CASE("Telemetry is stored per station and queried", "[collector]")
+{
+    std::string dir = make_test_dir();
+    TestCollector collector(dir);
+    std::string response = http_request(collector.port(), "POST", "/telemetry",
+                                        "Station=attic&RadioProfile=balanced&RadioOnMs=1830&TxPower=-0.5");
+    TEST_ASSERT_TRUE(response.find("HTTP/1.1 200 OK") == 0);
+    http_request(collector.port(), "POST", "/telemetry", "Station=attic&RadioOnMs=2000");
+
+    std::ifstream file(dir + "/telemetry/attic.jsonl");
+    std::string line;
+    std::getline(file, line);
+    TEST_ASSERT_TRUE(line.find("{\"station\":\"attic\",\"time\":") == 0);
+    TEST_ASSERT_TRUE(line.find(",\"RadioOnMs\":1830,\"RadioProfile\":\"balanced\",\"TxPower\":-0.5}") !=
+                     std::string::npos);
+
+    response = http_request(collector.port(), "GET", "/telemetry?station=attic&last=1");
+    TEST_ASSERT_TRUE(response.find("\"RadioOnMs\":2000}]") != std::string::npos);
+    TEST_ASSERT_TRUE(response.find("1830") == std::string::npos);
+    response = http_request(collector.port(), "GET", "/telemetry?station=cellar");
+    TEST_ASSERT_TRUE(response.find("\r\n\r\n[]") != std::string::npos);
+
+    // Histograms of the station's DHT diagnostics stay strings
+    http_request(collector.port(), "POST", "/telemetry", "Station=attic&DhtLowUs=3_7");
+    response = http_request(collector.port(), "GET", "/telemetry?station=attic&last=1");
+    TEST_ASSERT_TRUE(response.find("\"DhtLowUs\":\"3_7\"}]") != std::string::npos);
+}
+
+
+TEST_CASE("Invalid telemetry is rejected", "[collector]")
+{
+    TestCollector collector(make_test_dir());
+    std::string response = http_request(collector.port(), "POST", "/telemetry", "Station=attic");
+    TEST_ASSERT_TRUE(response.find("HTTP/1.1 400") == 0);
+    response = http_request(collector.port(), "POST", "/telemetry", "Station=attic&Note=%22quoted%22");
+    TEST_ASSERT_TRUE(response.find("HTTP/1.1 400") == 0);
+    response = http_request(collector.port(), "POST", "/telemetry", "Station=../x&RadioOnMs=1");
+    TEST_ASSERT_TRUE(response.find("HTTP/1.1 400") == 0);
+    response = http_request(collector.port(), "GET", "/telemetry?station=attic&last=0");
+    TEST_ASSERT_TRUE(response.find("HTTP/1.1 400") == 0);
+}
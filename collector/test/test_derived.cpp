@@ -0,0 +1,107 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include "unity.h"
+#include "derived.h"
+#include "query.h"
+
+
+TEST_CASE("Approximate log and exp stay within their bounds", "[derived]")
+{
+    double log_error = 0;
+    double exp_error = 0;
+
+    for (float x = 0.005f; x <= 1.0f; x += 0.0001f)
+    {
+        log_error = std::max(log_error, std::fabs(derived_log(x) - std::log(static_cast<double>(x))));
+    }
+
+    for (float x = -20.0f; x <= 20.0f; x += 0.001f)
+    {
+        exp_error = std::max(exp_error, std::fabs(derived_exp(x) / std::exp(static_cast<double>(x)) - 1));
+    }
+
+    TEST_ASSERT_TRUE(log_error < 1e-5);
+    TEST_ASSERT_TRUE(exp_error < 2e-6);
+}
+
+
+TEST_CASE("Kernels match the scalar references", "[derived]")
+{
+    std::vector<float> temperature;
+    std::vector<float> humidity;
+
+    for (int t = -400; t <= 600; t++)
+    {
+        for (int h = 0; h <= 100; h++)
+        {
+            temperature.push_back(static_cast<float>(t) / 10);
+            humidity.push_back(static_cast<float>(h));
+        }
+    }
+
+    size_t count = temperature.size();
+    std::vector<float> dew_point(count);
+    std::vector<float> absolute_humidity(count);
+    std::vector<float> heat_index(count);
+    dew_point_series(temperature.data(), humidity.data(), count, dew_point.data());
+    absolute_humidity_series(temperature.data(), humidity.data(), count, absolute_humidity.data());
+    heat_index_series(temperature.data(), humidity.data(), count, heat_index.data());
+
+    for (size_t i = 0; i < count; i++)
+    {
+        double reference = absolute_humidity_reference(temperature[i], humidity[i]);
+        TEST_ASSERT_FLOAT_WITHIN(0.001, dew_point_reference(temperature[i], humidity[i]), dew_point[i]);
+        TEST_ASSERT_FLOAT_WITHIN(reference * 1e-5, reference, absolute_humidity[i]);
+        TEST_ASSERT_FLOAT_WITHIN(0.001, heat_index_reference(temperature[i], humidity[i]), heat_index[i]);
+    }
+
+    // Published values: 20 C at 50 % and 90 F at 70 % (NOAA table: 106 F)
+    TEST_ASSERT_FLOAT_WITHIN(0.05, 9.26, dew_point_reference(20, 50));
+    TEST_ASSERT_FLOAT_WITHIN(0.05, 8.62, absolute_humidity_reference(20, 50));
+    TEST_ASSERT_FLOAT_WITHIN(0.5, 41.1, heat_index_reference(32.22, 70));
+}
+
+
+TEST_CASE("Queries return the derived metrics asked for", "[derived]")
+{
+    Query query;
+    TEST_ASSERT_TRUE(parse_query({{"station", "attic"}, {"metrics", "dew_point,heat_index"}}, query));
+    TEST_ASSERT_EQUAL(METRIC_DEW_POINT | METRIC_HEAT_INDEX, query.metrics);
+    TEST_ASSERT_FALSE(parse_query({{"metrics", "dew_point,mould"}}, query));
+    TEST_ASSERT_FALSE(parse_query({{"metrics", ""}}, query));
+
+    std::vector<Sample> samples = {{1000, 20.0f, 50, 1}, {1060, 25.0f, 80, 2}};
+    TEST_ASSERT_EQUAL_STRING("[{\"time\":1000,\"temperature\":20.0,\"humidity\":50,\"dew_point\":9.3,"
+                             "\"absolute_humidity\":8.62,\"heat_index\":19.4},"
+                             "{\"time\":1060,\"temperature\":25.0,\"humidity\":80,\"dew_point\":21.3,"
+                             "\"absolute_humidity\":18.37,\"heat_index\":25.6}]",
+                             samples_to_json(samples, METRIC_DEW_POINT | METRIC_ABSOLUTE_HUMIDITY |
+                                                      METRIC_HEAT_INDEX).c_str());
+    TEST_ASSERT_EQUAL_STRING("[{\"time\":1000,\"temperature\":20.0,\"humidity\":50}]",
+                             samples_to_json({samples[0]}).c_str());
+}
@@ -0,0 +1,135 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "unity.h"
+#include "export.h"
+#include "test_client.h"
+
+
+/*! Append samples of one station at one minute intervals */
+static void fill_station(Store &store, const std::string &station_id, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        Sample sample = {1559390400 + i * 60, -10.0f + (i % 400) / 10.0f, 20 + i % 70, static_cast<uint32_t>(i + 1)};
+        store.append(station_id, sample);
+    }
+}
+
+
+TEST_CASE("Export station range as CSV", "[export]")
+{
+    TestCollector collector(make_test_dir());
+    fill_station(collector.store, "attic", 5);
+
+    std::string response = http_request(collector.port(), "GET", "/export?station=attic&from=1559390460&to=1559390640");
+    TEST_ASSERT_TRUE(response.find("HTTP/1.1 200 OK") == 0);
+    TEST_ASSERT_TRUE(response.find("Content-Type: text/csv\r\n") != std::string::npos);
+    TEST_ASSERT_TRUE(response.find("Transfer-Encoding: chunked\r\n") != std::string::npos);
+    TEST_ASSERT_EQUAL_STRING("time,temperature,humidity,sequence\n"
+                             "1559390460,-9.9,21,2\n"
+                             "1559390520,-9.8,22,3\n"
+                             "1559390580,-9.7,23,4\n",
+                             http_chunked_body(response).c_str());
+
+    response = http_request(collector.port(), "GET", "/export?station=attic&from=1559391000");
+    TEST_ASSERT_EQUAL_STRING("time,temperature,humidity,sequence\n", http_chunked_body(response).c_str());
+
+    TEST_ASSERT_TRUE(http_request(collector.port(), "GET", "/export?station=cellar").find("HTTP/1.1 404") == 0);
+    TEST_ASSERT_TRUE(http_request(collector.port(), "GET", "/export").find("HTTP/1.1 400") == 0);
+    TEST_ASSERT_TRUE(http_request(collector.port(), "GET", "/export?station=attic&format=xml").find("HTTP/1.1 400") ==
+                     0);
+}
+
+
+TEST_CASE("CSV temperatures are formatted like printf", "[export]")
+{
+    Store store(make_test_dir());
+    TEST_ASSERT_TRUE(store.open());
+    std::vector<float> temperatures = {0.0f, -0.04f, 0.05f, 0.25f, 0.35f, -12.25f, 99.95f, 1234.5f, -40.0f, 3e9f};
+    std::string expected = ExportStream::CSV_HEADER;
+
+    for (size_t i = 0; i < temperatures.size(); i++)
+    {
+        Sample sample = {static_cast<int64_t>(i), temperatures[i], -5, 4000000000u + static_cast<uint32_t>(i)};
+        store.append("attic", sample);
+        char line[128];
+        snprintf(line, sizeof(line), "%zu,%.1f,-5,%u\n", i, temperatures[i], sample.sequence);
+        expected += line;
+    }
+
+    ExportQuery query;
+    query.station = "attic";
+    ExportStream stream(ShardView(*store.find("attic")), query);
+    std::string csv;
+    TEST_ASSERT_FALSE(stream.next(csv));
+    TEST_ASSERT_EQUAL_STRING(expected.c_str(), csv.c_str());
+}
+
+
+TEST_CASE("Export binary columns with chunk statistics", "[export]")
+{
+    TestCollector collector(make_test_dir());
+    int count = static_cast<int>(ExportStream::CHUNK_SAMPLES) * 2 + 100;
+    fill_station(collector.store, "attic", count);
+
+    // The export is pipelined with a request that is answered after it
+    TestClient client(collector.port());
+    client.send_text("GET /export?station=attic&format=columns HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                     "GET /stations HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n");
+    std::string response = client.receive_until("");
+    TEST_ASSERT_TRUE(response.find("Content-Type: application/octet-stream\r\n") != std::string::npos);
+    TEST_ASSERT_TRUE(response.find("{\"station\":\"attic\",\"samples\":8292") != std::string::npos);
+
+    std::vector<ExportChunkStats> chunks;
+    std::vector<Sample> samples;
+    TEST_ASSERT_TRUE(export_decode_columns(http_chunked_body(response), chunks, samples));
+    TEST_ASSERT_EQUAL(3u, chunks.size());
+    TEST_ASSERT_EQUAL(static_cast<size_t>(count), samples.size());
+    TEST_ASSERT_EQUAL(100u, chunks[2].count);
+    TEST_ASSERT_EQUAL(1559390400 + 4096 * 60, chunks[1].min_time_s);
+    TEST_ASSERT_EQUAL(1559390400 + 8191 * 60, chunks[1].max_time_s);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, -10.0, chunks[0].min_temperature);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 29.9, chunks[0].max_temperature);
+    TEST_ASSERT_EQUAL(20, chunks[2].min_humidity);
+    TEST_ASSERT_EQUAL(89, chunks[2].max_humidity);
+
+    for (size_t i = 0; i < samples.size(); i++)
+    {
+        const Sample &stored = collector.store.find("attic")->at(i);
+
+        if ((samples[i].time_s != stored.time_s) || (samples[i].temperature != stored.temperature) ||
+            (samples[i].humidity != stored.humidity) || (samples[i].sequence != stored.sequence))
+        {
+            TEST_FAIL_MESSAGE("Decoded sample differs from stored one");
+        }
+    }
+
+    std::string truncated = http_chunked_body(response);
+    truncated.resize(truncated.size() - 1);
+    TEST_ASSERT_FALSE(export_decode_columns(truncated, chunks, samples));
+}
@@ -0,0 +1,106 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include "unity.h"
+#include "http.h"
+
+
+TEST_CASE("Parse complete request with body", "[http]")
+{
+    std::string buffer = "POST /collect.php?a=1 HTTP/1.1\r\nHost: x\r\nContent-Length: 28\r\n\r\n"
+                         "Temperature=21.5&Humidity=40GET";
+    HttpRequest request;
+    size_t consumed = 0;
+    TEST_ASSERT_EQUAL(HttpParser::COMPLETE, HttpParser::parse(buffer, request, consumed));
+    TEST_ASSERT_EQUAL_STRING("POST", request.method);
+    TEST_ASSERT_EQUAL_STRING("/collect.php", request.path);
+    TEST_ASSERT_EQUAL_STRING("a=1", request.query);
+    TEST_ASSERT_EQUAL_STRING("x", request.header("host"));
+    TEST_ASSERT_EQUAL_STRING("Temperature=21.5&Humidity=40", request.body);
+    TEST_ASSERT_EQUAL(buffer.size() - 3, consumed);
+    TEST_ASSERT_TRUE(request.keep_alive());
+}
+
+
+TEST_CASE("Parse incomplete and bad requests", "[http]")
+{
+    HttpRequest request;
+    size_t consumed = 0;
+    TEST_ASSERT_EQUAL(HttpParser::INCOMPLETE, HttpParser::parse("GET / HTTP/1.1\r\n", request, consumed));
+    TEST_ASSERT_EQUAL(HttpParser::INCOMPLETE,
+                      HttpParser::parse("POST / HTTP/1.1\r\nContent-Length: 5\r\n\r\nab", request, consumed));
+    TEST_ASSERT_EQUAL(HttpParser::BAD_REQUEST, HttpParser::parse("GARBAGE\r\n\r\n", request, consumed));
+    TEST_ASSERT_EQUAL(HttpParser::BAD_REQUEST,
+                      HttpParser::parse("GET / HTTP/1.1\r\nContent-Length: x\r\n\r\n", request, consumed));
+    TEST_ASSERT_EQUAL(HttpParser::BAD_REQUEST,
+                      HttpParser::parse(std::string(HttpParser::MAX_HEADER_SIZE + 1, 'a'), request, consumed));
+}
+
+
+TEST_CASE("Keep-alive follows HTTP version and Connection header", "[http]")
+{
+    HttpRequest request;
+    size_t consumed = 0;
+    HttpParser::parse("GET / HTTP/1.1\r\nConnection: Close\r\n\r\n", request, consumed);
+    TEST_ASSERT_FALSE(request.keep_alive());
+    HttpParser::parse("GET / HTTP/1.0\r\n\r\n", request, consumed);
+    TEST_ASSERT_FALSE(request.keep_alive());
+    HttpParser::parse("GET / HTTP/1.0\r\nConnection: keep-alive\r\n\r\n", request, consumed);
+    TEST_ASSERT_TRUE(request.keep_alive());
+}
+
+
+TEST_CASE("Decode form fields", "[http]")
+{
+    std::map<std::string, std::string> fields = http_parse_form("Temperature=-3.5&Humidity=40&a+b=%41%2b&flag");
+    TEST_ASSERT_EQUAL_STRING("-3.5", fields["Temperature"]);
+    TEST_ASSERT_EQUAL_STRING("40", fields["Humidity"]);
+    TEST_ASSERT_EQUAL_STRING("A+", fields["a b"]);
+    TEST_ASSERT_EQUAL(1u, fields.count("flag"));
+    TEST_ASSERT_EQUAL_STRING("100%", http_url_decode("100%"));
+}
+
+
+TEST_CASE("Format fixed length, streaming and chunked responses", "[http]")
+{
+    HttpResponse response;
+    response.body = "10";
+    std::string text = http_format_response(response, false);
+    TEST_ASSERT_TRUE(text.find("HTTP/1.1 200 OK\r\n") == 0);
+    TEST_ASSERT_TRUE(text.find("Content-Length: 2\r\n") != std::string::npos);
+    TEST_ASSERT_TRUE(text.find("Connection: close\r\n\r\n10") != std::string::npos);
+
+    response.stream = true;
+    response.body = "retry: 1\n\n";
+    text = http_format_response(response, true);
+    TEST_ASSERT_TRUE(text.find("Content-Length") == std::string::npos);
+    TEST_ASSERT_TRUE(text.find("\r\n\r\nretry: 1\n\n") != std::string::npos);
+
+    response.stream = false;
+    response.body.clear();
+    response.source = [](std::string &out) { return false; };
+    text = http_format_response(response, false);
+    TEST_ASSERT_TRUE(text.find("Content-Length") == std::string::npos);
+    TEST_ASSERT_TRUE(text.find("Transfer-Encoding: chunked\r\nConnection: close\r\n\r\n") != std::string::npos);
+}
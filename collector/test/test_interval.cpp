@@ -0,0 +1,186 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <fstream>
+#include "unity.h"
+#include "adaptive_interval.h"
+#include "coap_transport.h"
+#include "mqtt_transport.h"
+#include "test_client.h"
+
+/*! Settings of the collector's -i 1:60:0.2 */
+static const IntervalSettings SETTINGS = {1, 60, 0.2};
+
+
+/*!
+ * @brief
+ *   Feed a station samples at the intervals it is given.
+ *
+ * @param state (IN/OUT)
+ *   Interval controller of the station.
+ *
+ * @param time_s (IN/OUT)
+ *   Time of the next sample, advanced past the last one.
+ *
+ * @param minutes (IN)
+ *   Minutes to run.
+ *
+ * @param temperature (IN)
+ *   Temperature at a time in seconds.
+ */
+template <typename Curve>
+static void run_station(IntervalState &state, int64_t &time_s, int minutes, Curve temperature)
+{
+    int64_t end_s = time_s + minutes * 60;
+
+    while (time_s < end_s)
+    {
+        Sample sample = {time_s, static_cast<float>(temperature(time_s)), 50, 0};
+        interval_update(SETTINGS, state, sample);
+        time_s += state.interval_min * 60;
+    }
+}
+
+
+TEST_CASE("Interval settings are parsed", "[interval]")
+{
+    IntervalSettings settings;
+    TEST_ASSERT_TRUE(parse_interval_settings("1:60:0.2", settings));
+    TEST_ASSERT_EQUAL(1, settings.min_min);
+    TEST_ASSERT_EQUAL(60, settings.max_min);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 0.2, settings.error_c);
+
+    TEST_ASSERT_TRUE(parse_interval_settings("10:10:1", settings));
+    TEST_ASSERT_FALSE(parse_interval_settings("0:60:0.2", settings));
+    TEST_ASSERT_FALSE(parse_interval_settings("20:10:0.2", settings));
+    TEST_ASSERT_FALSE(parse_interval_settings("1:60:0", settings));
+    TEST_ASSERT_FALSE(parse_interval_settings("1:60", settings));
+    TEST_ASSERT_FALSE(parse_interval_settings("1:60:0.2x", settings));
+}
+
+
+TEST_CASE("Interval backs off on flat temperature", "[interval]")
+{
+    IntervalState state;
+    interval_reset(SETTINGS, state);
+    TEST_ASSERT_EQUAL(1, state.interval_min);
+
+    // Sensor resolution steps are not a swing
+    int64_t time_s = 0;
+    run_station(state, time_s, 12 * 60, [](int64_t t) { return 20.0 + 0.1 * ((t / 60) % 2); });
+    TEST_ASSERT_EQUAL(60, state.interval_min);
+
+    Sample old = {time_s - 3600, 30.0f, 50, 0};
+    interval_update(SETTINGS, state, old);
+    TEST_ASSERT_EQUAL(60, state.interval_min);
+}
+
+
+TEST_CASE("Interval shortens on a swing and recovers", "[interval]")
+{
+    IntervalState state;
+    interval_reset(SETTINGS, state);
+    int64_t time_s = 0;
+    run_station(state, time_s, 6 * 60, [](int64_t t) { return 10.0; });
+    TEST_ASSERT_EQUAL(60, state.interval_min);
+
+    // Heating turns on: the slope turns from flat to 6 degrees an hour
+    int64_t start_s = time_s;
+    auto rising = [start_s](int64_t t) { return 10.0 + 6.0 * static_cast<double>(t - start_s) / 3600; };
+    run_station(state, time_s, 1, rising);
+    run_station(state, time_s, 1, rising);
+    TEST_ASSERT_TRUE(state.interval_min < 30);
+    TEST_ASSERT_TRUE(state.interval_min >= SETTINGS.min_min);
+
+    // A steady rise is a straight line again
+    run_station(state, time_s, 12 * 60, rising);
+    TEST_ASSERT_EQUAL(60, state.interval_min);
+}
+
+
+TEST_CASE("Interval anticipates the busy hours of previous days", "[interval]")
+{
+    IntervalState state;
+    interval_reset(SETTINGS, state);
+
+    // Heating turns on at 6:00 every day and warms the room by 3 degrees
+    auto room = [](int64_t t) {
+        double hours = static_cast<double>(t % 86400) / 3600;
+        return 17.0 + ((hours >= 6) ? std::min(hours - 6, 0.5) * 6 : 0.0);
+    };
+    int64_t time_s = 0;
+    run_station(state, time_s, 24 * 60, room);
+    TEST_ASSERT_EQUAL(60, state.interval_min);
+
+    // The next day the station wakes up right as the heating turns on
+    int64_t six_s = 86400 + 6 * 3600;
+
+    while (time_s < six_s)
+    {
+        run_station(state, time_s, 1, room);
+    }
+
+    TEST_ASSERT_TRUE(time_s - six_s < 5 * 60);
+}
+
+
+TEST_CASE("Collector serves the interval of each station", "[interval]")
+{
+    std::string dir = make_test_dir();
+    std::ofstream(dir + "/interval.txt") << "10\nstatistics";
+    TestCollector collector(dir);
+    AdaptiveInterval intervals(SETTINGS);
+    collector.collector.set_adaptive_interval(&intervals);
+
+    for (int minute = 0; minute < 10 * 60; minute += 5)
+    {
+        Sample sample = {1600000000 + minute * 60, 20.0f, 50, 0};
+        intervals.on_sample("attic", sample);
+    }
+
+    TEST_ASSERT_EQUAL(60, intervals.interval("attic", 10));
+    std::string response = http_request(collector.port(), "GET", "/interval.txt?Station=attic");
+    TEST_ASSERT_TRUE(response.find("\r\n\r\n60\nstatistics") != std::string::npos);
+
+    // A new station starts fast, one without an ID gets the file
+    response = http_request(collector.port(), "POST", "/collect.php", "Station=cellar&Temperature=5.0&Humidity=80");
+    TEST_ASSERT_TRUE(response.find("HTTP/1.1 200") == 0);
+    response = http_request(collector.port(), "GET", "/interval.txt?Station=cellar");
+    TEST_ASSERT_TRUE(response.find("\r\n\r\n2\nstatistics") != std::string::npos);
+    response = http_request(collector.port(), "GET", "/interval.txt?Station=garage");
+    TEST_ASSERT_TRUE(response.find("\r\n\r\n10\nstatistics") != std::string::npos);
+    response = http_request(collector.port(), "GET", "/interval.txt");
+    TEST_ASSERT_TRUE(response.find("\r\n\r\n10\nstatistics") != std::string::npos);
+
+    TestListeners listeners(collector.collector);
+    MqttTransport mqtt("127.0.0.1", listeners.mqtt.port(), "cellar");
+    CoapTransport coap("127.0.0.1", listeners.coap.port(), "cellar");
+    std::string config;
+    TEST_ASSERT_TRUE(mqtt.open() && mqtt.get_config(config));
+    TEST_ASSERT_EQUAL_STRING("2\nstatistics", config.c_str());
+    mqtt.close();
+    TEST_ASSERT_TRUE(coap.open() && coap.get_config(config));
+    TEST_ASSERT_EQUAL_STRING("2\nstatistics", config.c_str());
+    coap.close();
+}
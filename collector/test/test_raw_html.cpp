@@ -0,0 +1,133 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "unity.h"
+#include "raw_html.h"
+#include "test_client.h"
+
+
+/*!
+ * @brief
+ *   Format sample as collect.php did.
+ */
+static std::string raw_line(int minute, const char *temperature, const char *humidity)
+{
+    char line[160];
+    snprintf(line, sizeof(line), "<p>2019-06-01 12:%02d:00&nbsp;&nbsp;&nbsp;&nbsp;Temperature: %s &deg;C"
+             "&nbsp;&nbsp;&nbsp;&nbsp;Humidity: %s</p>", minute, temperature, humidity);
+    return line;
+}
+
+
+/*!
+ * @brief
+ *   Use the time zone of collect.php without depending on tzdata.
+ */
+static void set_helsinki_time()
+{
+    setenv("TZ", "EET-2EEST,M3.5.0/3,M10.5.0/4", 1);
+    tzset();
+}
+
+
+TEST_CASE("Parse raw.html paragraph", "[raw_html]")
+{
+    set_helsinki_time();
+    LocalTimeCache times;
+    Sample sample;
+    std::string line = raw_line(0, "-3.5", "40");
+    const char *contents = line.c_str() + 3;
+
+    TEST_ASSERT_TRUE(parse_raw_html_line(contents, line.c_str() + line.size() - 4, times, sample));
+    TEST_ASSERT_EQUAL(1559379600, sample.time_s);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, -3.5, sample.temperature);
+    TEST_ASSERT_EQUAL(40, sample.humidity);
+
+    line = raw_line(0, "", "40");
+    TEST_ASSERT_FALSE(parse_raw_html_line(line.c_str() + 3, line.c_str() + line.size() - 4, times, sample));
+    line = raw_line(0, "21.5", "nan");
+    TEST_ASSERT_FALSE(parse_raw_html_line(line.c_str() + 3, line.c_str() + line.size() - 4, times, sample));
+    line = "<p>2019-13-01 12:00:00 Temperature: 1 Humidity: 2</p>";
+    TEST_ASSERT_FALSE(parse_raw_html_line(line.c_str() + 3, line.c_str() + line.size() - 4, times, sample));
+}
+
+
+TEST_CASE("Parallel ranges parse like the whole file", "[raw_html]")
+{
+    set_helsinki_time();
+    std::string content = "<html>";
+
+    for (int i = 0; i < 60; i++)
+    {
+        content += raw_line(i, "21.5", std::to_string(i).c_str());
+
+        if (i % 20 == 10)
+        {
+            // Broken paragraphs: missing value, missing end tag, garbage
+            content += raw_line(i, "21.5", "");
+            content += "<p>2019-06-01 12:00:00 Temperature: 1";
+            content += "junk<br>";
+        }
+    }
+
+    std::string path = make_test_dir() + "/raw.html";
+    std::ofstream(path) << content;
+    RawHtmlFile file;
+    TEST_ASSERT_TRUE(file.open(path));
+    TEST_ASSERT_EQUAL(content.size(), file.size());
+
+    std::atomic<size_t> progress(0);
+    std::vector<Sample> whole;
+    TEST_ASSERT_EQUAL(6u, parse_raw_html(file.data(), 0, file.size(), whole, progress));
+    TEST_ASSERT_EQUAL(60u, whole.size());
+    TEST_ASSERT_EQUAL(file.size(), progress.load());
+
+    std::vector<std::pair<size_t, size_t>> ranges = file.split(7);
+    TEST_ASSERT_EQUAL(7u, ranges.size());
+    std::vector<Sample> parts;
+    size_t malformed = 0;
+
+    for (size_t i = 0; i < ranges.size(); i++)
+    {
+        TEST_ASSERT_EQUAL((i == 0) ? 0u : ranges[i - 1].second, ranges[i].first);
+        TEST_ASSERT_TRUE((i == 0) || (content.compare(ranges[i].first, 3, "<p>") == 0));
+        malformed += parse_raw_html(file.data(), ranges[i].first, ranges[i].second, parts, progress);
+    }
+
+    TEST_ASSERT_EQUAL(file.size(), ranges.back().second);
+    TEST_ASSERT_EQUAL(6u, malformed);
+    TEST_ASSERT_EQUAL(60u, parts.size());
+
+    for (size_t i = 0; i < parts.size(); i++)
+    {
+        TEST_ASSERT_EQUAL(1559379600 + static_cast<int64_t>(i) * 60, parts[i].time_s);
+        TEST_ASSERT_EQUAL(static_cast<int>(i), parts[i].humidity);
+    }
+}
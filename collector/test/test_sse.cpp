@@ -0,0 +1,123 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include "unity.h"
+#include "sse.h"
+#include "test_client.h"
+
+static const std::string SUBSCRIBE = "GET /events HTTP/1.1\r\nHost: localhost\r\nAccept: text/event-stream\r\n\r\n";
+
+
+TEST_CASE("Format event", "[sse]")
+{
+    TEST_ASSERT_EQUAL_STRING("id: 7\nevent: sample\ndata: {}\n\n", SseHub::format_event(7, "sample", "{}"));
+}
+
+
+TEST_CASE("Subscribers get only new samples", "[sse]")
+{
+    TestCollector collector(make_test_dir());
+    TestClient first(collector.port());
+    TestClient second(collector.port());
+    first.send_text(SUBSCRIBE);
+    second.send_text(SUBSCRIBE);
+    TEST_ASSERT_TRUE(first.receive_until("retry:").find("text/event-stream") != std::string::npos);
+    second.receive_until("retry:");
+
+    std::string response = http_request(collector.port(), "POST", "/collect.php", "Temperature=-1.5&Humidity=93");
+    TEST_ASSERT_TRUE(response.find("200 OK") != std::string::npos);
+
+    std::string events = first.receive_until("\"humidity\":93}\n\n");
+    TEST_ASSERT_TRUE(events.find("event: sample\n") != std::string::npos);
+    TEST_ASSERT_TRUE(events.find("\"temperature\":-1.5,\"humidity\":93}") != std::string::npos);
+    TEST_ASSERT_TRUE(second.receive_until("\"humidity\":93}\n\n").find("\"humidity\":93}") != std::string::npos);
+}
+
+
+TEST_CASE("Reconnecting subscriber gets missed samples", "[sse]")
+{
+    TestCollector collector(make_test_dir());
+    TestClient first(collector.port());
+    first.send_text(SUBSCRIBE);
+    first.receive_until("retry:");
+    http_request(collector.port(), "POST", "/collect.php", "Temperature=1.0&Humidity=10");
+    std::string events = first.receive_until("\"humidity\":10}\n\n");
+    size_t id_start = events.find("id: ") + 4;
+    std::string last_id = events.substr(id_start, events.find('\n', id_start) - id_start);
+
+    http_request(collector.port(), "POST", "/collect.php", "Temperature=2.0&Humidity=20");
+
+    TestClient second(collector.port());
+    second.send_text("GET /events HTTP/1.1\r\nLast-Event-ID: " + last_id + "\r\n\r\n");
+    events = second.receive_until("\"humidity\":20}\n\n");
+    TEST_ASSERT_TRUE(events.find("\"humidity\":20}") != std::string::npos);
+    TEST_ASSERT_TRUE(events.find("\"humidity\":10}") == std::string::npos);
+}
+
+
+TEST_CASE("Closed subscribers are removed", "[sse]")
+{
+    TestCollector collector(make_test_dir());
+    {
+        TestClient client(collector.port());
+        client.send_text(SUBSCRIBE);
+        client.receive_until("retry:");
+    }
+
+    http_request(collector.port(), "POST", "/collect.php", "Temperature=1.0&Humidity=10");
+    TestClient probe(collector.port());
+    probe.send_text(SUBSCRIBE);
+    probe.receive_until("retry:");
+    TEST_ASSERT_EQUAL(1u, collector.collector.subscriber_count());
+}
+
+
+TEST_CASE("Samples are pushed to subscribers of other threads", "[sse]")
+{
+    std::string dir = make_test_dir();
+    Store store(dir + "/stations");
+    store.open();
+    HttpServer first_server;
+    HttpServer second_server;
+    first_server.listen(0, "127.0.0.1", true);
+    second_server.listen(0, "127.0.0.1");
+    Collector first(first_server, store, dir);
+    Collector second(second_server, store, dir);
+    first.add_peer(&second);
+    second.add_peer(&first);
+    std::thread first_loop([&first_server]() { first_server.run(); });
+    std::thread second_loop([&second_server]() { second_server.run(); });
+
+    TestClient subscriber(second_server.port());
+    subscriber.send_text(SUBSCRIBE);
+    subscriber.receive_until("retry:");
+    http_request(first_server.port(), "POST", "/collect.php", "Station=a&Temperature=1.0&Humidity=11");
+    std::string events = subscriber.receive_until("\"humidity\":11}\n\n");
+
+    first_server.stop();
+    second_server.stop();
+    first_loop.join();
+    second_loop.join();
+    TEST_ASSERT_TRUE(events.find("{\"station\":\"a\"") != std::string::npos);
+}
@@ -0,0 +1,359 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "unity.h"
+#include "query.h"
+#include "store.h"
+#include "test_client.h"
+
+
+TEST_CASE("Append and read back after reopen", "[store]")
+{
+    std::string dir = make_test_dir();
+    {
+        Store store(dir);
+        TEST_ASSERT_TRUE(store.open());
+
+        for (int i = 0; i < 5000; i++)
+        {
+            Sample sample = {1000 + i, static_cast<float>(i) / 10, i % 100, 0};
+            TEST_ASSERT_EQUAL(StationShard::APPENDED, store.append("station1", sample));
+        }
+    }
+
+    Store store(dir);
+    TEST_ASSERT_TRUE(store.open());
+    StationShard *shard = store.find("station1");
+    TEST_ASSERT_TRUE(shard != nullptr);
+    TEST_ASSERT_EQUAL(5000u, shard->size());
+    TEST_ASSERT_EQUAL(1u, shard->sealed_chunks());
+    TEST_ASSERT_EQUAL(5999, shard->at(4999).time_s);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 499.9, shard->at(4999).temperature);
+    TEST_ASSERT_EQUAL(99, shard->at(4999).humidity);
+
+    // The sealed chunk is read from its block
+    ShardView view(*shard);
+    TEST_ASSERT_EQUAL(2000u, view.lower_bound(3000));
+    TEST_ASSERT_EQUAL(4096u, view.lower_bound(5096));
+    TEST_ASSERT_EQUAL(5000u, view.lower_bound(7000));
+    TEST_ASSERT_EQUAL(1010, view.at(10).time_s);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 409.5, view.at(4095).temperature);
+    TEST_ASSERT_TRUE(store.find("station2") == nullptr);
+}
+
+
+TEST_CASE("Reject invalid station IDs", "[store]")
+{
+    Store store(make_test_dir());
+    TEST_ASSERT_TRUE(store.open());
+    Sample sample = {1, 1.0f, 1, 0};
+    TEST_ASSERT_EQUAL(StationShard::FAILED, store.append("", sample));
+    TEST_ASSERT_EQUAL(StationShard::FAILED, store.append("a/b", sample));
+    TEST_ASSERT_EQUAL(StationShard::FAILED, store.append(std::string(Store::MAX_STATION_ID_LENGTH + 1, 'a'), sample));
+    TEST_ASSERT_EQUAL(StationShard::APPENDED, store.append("Aa0-_", sample));
+}
+
+
+TEST_CASE("Drop resent samples by sequence number", "[store]")
+{
+    std::string dir = make_test_dir();
+    {
+        Store store(dir);
+        TEST_ASSERT_TRUE(store.open());
+
+        for (uint32_t sequence = 1; sequence <= 100; sequence++)
+        {
+            Sample sample = {sequence, 20.0f, 50, sequence};
+            TEST_ASSERT_EQUAL(StationShard::APPENDED, store.append("s", sample));
+        }
+
+        Sample sample = {200, 20.0f, 50, 100};
+        TEST_ASSERT_EQUAL(StationShard::DUPLICATE, store.append("s", sample));
+
+        // Out of order within the window is accepted once
+        sample.sequence = 103;
+        TEST_ASSERT_EQUAL(StationShard::APPENDED, store.append("s", sample));
+        sample.sequence = 102;
+        TEST_ASSERT_EQUAL(StationShard::APPENDED, store.append("s", sample));
+        TEST_ASSERT_EQUAL(StationShard::DUPLICATE, store.append("s", sample));
+
+        // Samples without sequence number are always new
+        sample.sequence = 0;
+        TEST_ASSERT_EQUAL(StationShard::APPENDED, store.append("s", sample));
+        TEST_ASSERT_EQUAL(StationShard::APPENDED, store.append("s", sample));
+    }
+
+    Store store(dir);
+    TEST_ASSERT_TRUE(store.open());
+    StationShard *shard = store.find("s");
+    TEST_ASSERT_EQUAL(104u, shard->size());
+    TEST_ASSERT_EQUAL(103u, shard->last_sequence());
+    TEST_ASSERT_EQUAL(102u, shard->at(101).sequence);
+
+    Sample sample = {300, 20.0f, 50, 102};
+    TEST_ASSERT_EQUAL(StationShard::DUPLICATE, store.append("s", sample));
+    sample.sequence = 101;
+    TEST_ASSERT_EQUAL(StationShard::APPENDED, store.append("s", sample));
+
+    // Station lost its counter and starts from 1 again: a number before the
+    // window cannot be a resend, so the restarted samples are stored
+    sample.sequence = 1;
+    TEST_ASSERT_EQUAL(StationShard::APPENDED, store.append("s", sample));
+    TEST_ASSERT_EQUAL(1u, shard->last_sequence());
+    sample.sequence = 2;
+    TEST_ASSERT_EQUAL(StationShard::APPENDED, store.append("s", sample));
+    TEST_ASSERT_EQUAL(StationShard::DUPLICATE, store.append("s", sample));
+    TEST_ASSERT_EQUAL(107u, shard->size());
+}
+
+
+TEST_CASE("A new sequence epoch starts the duplicate window again", "[store]")
+{
+    std::string dir = make_test_dir();
+    std::vector<Sample> upload(1);
+    {
+        Store store(dir);
+        TEST_ASSERT_TRUE(store.open());
+
+        for (uint32_t sequence = 1; sequence <= 10; sequence++)
+        {
+            upload[0] = {sequence, 20.0f, 50, sequence};
+            TEST_ASSERT_EQUAL(StationShard::APPENDED, store.append("s", upload, 111));
+        }
+
+        // A replacement unit with a new counter, its numbers within the window
+        upload[0] = {20, 20.0f, 50, 3};
+        TEST_ASSERT_EQUAL(StationShard::APPENDED, store.append("s", upload, 222));
+        TEST_ASSERT_EQUAL(StationShard::DUPLICATE, store.append("s", upload, 222));
+        upload[0] = {21, 20.0f, 50, 4};
+        TEST_ASSERT_EQUAL(StationShard::APPENDED, store.append("s", upload, 222));
+    }
+
+    // The window is rebuilt from where the epoch started
+    Store store(dir);
+    TEST_ASSERT_TRUE(store.open());
+    TEST_ASSERT_EQUAL(12u, store.find("s")->size());
+    TEST_ASSERT_EQUAL(4u, store.find("s")->last_sequence());
+    TEST_ASSERT_EQUAL(StationShard::DUPLICATE, store.append("s", upload, 222));
+    upload[0] = {22, 20.0f, 50, 5};
+    TEST_ASSERT_EQUAL(StationShard::APPENDED, store.append("s", upload, 222));
+}
+
+
+TEST_CASE("Append the samples of an upload together", "[store]")
+{
+    Store store(make_test_dir());
+    TEST_ASSERT_TRUE(store.open());
+    std::vector<Sample> upload;
+
+    for (int i = 0; i < 10; i++)
+    {
+        upload.push_back({4090 + i, 20.0f, 50, 7});
+    }
+
+    for (int i = 0; i < 4090; i++)
+    {
+        TEST_ASSERT_EQUAL(StationShard::APPENDED, store.append("s", {i, 20.0f, 50, 0}));
+    }
+
+    // The upload fills the first chunk and is resent whole
+    TEST_ASSERT_EQUAL(StationShard::APPENDED, store.append("s", upload, 0));
+    TEST_ASSERT_EQUAL(StationShard::DUPLICATE, store.append("s", upload, 0));
+    StationShard *shard = store.find("s");
+    TEST_ASSERT_EQUAL(4100u, shard->size());
+    TEST_ASSERT_EQUAL(1u, shard->sealed_chunks());
+    ShardView view(*shard);
+
+    for (size_t i = 0; i < view.size(); i++)
+    {
+        TEST_ASSERT_EQUAL(static_cast<int64_t>(i), view.at(i).time_s);
+    }
+
+    TEST_ASSERT_EQUAL(7u, view.at(4099).sequence);
+}
+
+
+TEST_CASE("Concurrent appends to shared and own shards", "[store]")
+{
+    Store store(make_test_dir());
+    TEST_ASSERT_TRUE(store.open());
+    const int threads = 4;
+    const int samples = 10000;
+    std::vector<std::thread> writers;
+
+    for (int t = 0; t < threads; t++)
+    {
+        writers.emplace_back([&store, t, samples]()
+        {
+            for (int i = 0; i < samples; i++)
+            {
+                Sample sample = {i, static_cast<float>(t), i, 0};
+                store.append("shared", sample);
+                store.append("own" + std::to_string(t), sample);
+            }
+        });
+    }
+
+    for (std::thread &writer : writers)
+    {
+        writer.join();
+    }
+
+    TEST_ASSERT_EQUAL(static_cast<size_t>(threads * samples), store.find("shared")->size());
+    TEST_ASSERT_EQUAL(static_cast<size_t>(threads + 1), store.shards().size());
+
+    long long humidity_sum = 0;
+    StationShard *shared = store.find("shared");
+    ShardView view(*shared);
+
+    for (size_t i = 0; i < view.size(); i++)
+    {
+        humidity_sum += view.at(i).humidity;
+    }
+
+    TEST_ASSERT_EQUAL(static_cast<long long>(threads) * samples * (samples - 1) / 2, humidity_sum);
+    TEST_ASSERT_EQUAL(shared->size() / StationShard::CHUNK_SAMPLES, shared->sealed_chunks());
+}
+
+
+TEST_CASE("Snapshot reads committed prefixes while writers append", "[store]")
+{
+    Store store(make_test_dir());
+    TEST_ASSERT_TRUE(store.open());
+    const int samples = 20000;
+    std::atomic<bool> done(false);
+    std::thread writer([&store, &done, samples]()
+    {
+        for (int i = 0; i < samples; i++)
+        {
+            Sample sample = {i, static_cast<float>(i), i % 100, 0};
+            store.append("a", sample);
+            store.append("b", sample);
+        }
+
+        done = true;
+    });
+
+    size_t previous = 0;
+    int snapshots = 0;
+
+    while (!done || (snapshots == 0))
+    {
+        StoreSnapshot snapshot(store, "a");
+
+        if (snapshot.shards().empty())
+        {
+            continue;
+        }
+
+        const ShardView &view = snapshot.shards()[0];
+        size_t count = view.size();
+        TEST_ASSERT_TRUE(count >= previous);
+        previous = count;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            TEST_ASSERT_EQUAL(static_cast<int64_t>(i), view.at(i).time_s);
+        }
+
+        // Every pass of a query reads the same samples, later ones stay out
+        Query query;
+        query.station = "a";
+        TEST_ASSERT_EQUAL(count, run_query(snapshot, query).size());
+        query.last = 5;
+        std::vector<Sample> last = run_query(snapshot, query);
+        TEST_ASSERT_EQUAL(std::min(count, static_cast<size_t>(5)), last.size());
+        TEST_ASSERT_TRUE(last.empty() || (last.back().time_s == static_cast<int64_t>(count) - 1));
+        snapshots++;
+    }
+
+    writer.join();
+    StoreSnapshot snapshot(store);
+    TEST_ASSERT_EQUAL(2u, snapshot.shards().size());
+    TEST_ASSERT_EQUAL(static_cast<size_t>(samples), snapshot.find("b")->size());
+    TEST_ASSERT_TRUE(snapshot.find("c") == nullptr);
+
+    store.append("b", {samples, 1.0f, 1, 0});
+    TEST_ASSERT_EQUAL(static_cast<size_t>(samples), snapshot.find("b")->size());
+    TEST_ASSERT_EQUAL(static_cast<size_t>(samples), snapshot.find("b")->lower_bound(samples));
+}
+
+
+TEST_CASE("Query raw range, last samples and buckets", "[store]")
+{
+    Store store(make_test_dir());
+    TEST_ASSERT_TRUE(store.open());
+
+    for (int i = 0; i < 120; i++)
+    {
+        Sample a = {i * 60, 10.0f, 40, 0};
+        Sample b = {i * 60 + 30, 20.0f, 60, 0};
+        store.append("a", a);
+        store.append("b", b);
+    }
+
+    Query query;
+    query.station = "a";
+    query.from_s = 600;
+    query.to_s = 1200;
+    std::vector<Sample> result = run_query(store, query);
+    TEST_ASSERT_EQUAL(10u, result.size());
+    TEST_ASSERT_EQUAL(600, result[0].time_s);
+
+    query.last = 3;
+    result = run_query(store, query);
+    TEST_ASSERT_EQUAL(3u, result.size());
+    TEST_ASSERT_EQUAL(1140, result[2].time_s);
+
+    Query aggregate;
+    aggregate.step_s = 600;
+    aggregate.last = 4;
+    result = run_query(store, aggregate);
+    TEST_ASSERT_EQUAL(4u, result.size());
+    TEST_ASSERT_EQUAL(119 * 60 / 600 * 600, result[3].time_s);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 15.0, result[3].temperature);
+    TEST_ASSERT_EQUAL(50, result[3].humidity);
+
+    query.station = "missing";
+    TEST_ASSERT_EQUAL(0u, run_query(store, query).size());
+}
+
+
+TEST_CASE("Parse query fields", "[store]")
+{
+    Query query;
+    TEST_ASSERT_TRUE(parse_query(http_parse_form("station=a&from=10&to=20&step=5&last=2"), query));
+    TEST_ASSERT_EQUAL_STRING("a", query.station);
+    TEST_ASSERT_EQUAL(10, query.from_s);
+    TEST_ASSERT_EQUAL(20, query.to_s);
+    TEST_ASSERT_EQUAL(5, query.step_s);
+    TEST_ASSERT_EQUAL(2u, query.last);
+    TEST_ASSERT_FALSE(parse_query(http_parse_form("step=-1"), query));
+    TEST_ASSERT_FALSE(parse_query(http_parse_form("from=x"), query));
+    TEST_ASSERT_FALSE(parse_query(http_parse_form("station=a.b"), query));
+}
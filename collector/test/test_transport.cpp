@@ -0,0 +1,147 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <fstream>
+#include "unity.h"
+#include "coap_transport.h"
+#include "mqtt_transport.h"
+#include "test_client.h"
+
+
+/*! Count lines of a file */
+static int count_lines(const std::string &path)
+{
+    std::ifstream file(path);
+    std::string line;
+    int lines = 0;
+
+    while (std::getline(file, line))
+    {
+        lines++;
+    }
+
+    return lines;
+}
+
+
+TEST_CASE("MQTT uploads are stored and acknowledged", "[transport]")
+{
+    std::string dir = make_test_dir();
+    std::ofstream(dir + "/interval.txt") << "10";
+    TestCollector collector(dir);
+    TestListeners listeners(collector.collector);
+    MqttTransport transport("127.0.0.1", listeners.mqtt.port(), "attic");
+    TEST_ASSERT_TRUE(transport.open());
+
+    std::string config;
+    TEST_ASSERT_TRUE(transport.get_config(config));
+    TEST_ASSERT_EQUAL_STRING("10", config.c_str());
+    std::string body = "Station=attic&Temperature=25.0&Humidity=40&Sequence=7";
+    TEST_ASSERT_TRUE(transport.send(Transport::SAMPLES, body));
+    TEST_ASSERT_TRUE(transport.send(Transport::SAMPLES, body));
+    TEST_ASSERT_TRUE(transport.send(Transport::TELEMETRY, "Station=attic&RadioOnMs=1830"));
+    transport.close();
+
+    TEST_ASSERT_EQUAL(1u, collector.store.find("attic")->size());
+    TEST_ASSERT_EQUAL(7u, collector.store.find("attic")->last_sequence());
+    TEST_ASSERT_EQUAL(1, count_lines(dir + "/telemetry/attic.jsonl"));
+
+    TransportStats stats = transport.stats();
+    TEST_ASSERT_EQUAL(6u, stats.round_trips);
+    TEST_ASSERT_TRUE(stats.bytes_sent > body.size() * 2);
+}
+
+
+TEST_CASE("MQTT config fails without interval file", "[transport]")
+{
+    TestCollector collector(make_test_dir());
+    TestListeners listeners(collector.collector);
+    MqttTransport transport("127.0.0.1", listeners.mqtt.port(), "attic");
+    TEST_ASSERT_TRUE(transport.open());
+    std::string config;
+    TEST_ASSERT_FALSE(transport.get_config(config));
+}
+
+
+TEST_CASE("CoAP uploads are stored and acknowledged", "[transport]")
+{
+    std::string dir = make_test_dir();
+    std::ofstream(dir + "/interval.txt") << "15";
+    TestCollector collector(dir);
+    TestListeners listeners(collector.collector);
+    CoapTransport transport("127.0.0.1", listeners.coap.port(), "attic");
+    TEST_ASSERT_TRUE(transport.open());
+
+    std::string config;
+    TEST_ASSERT_TRUE(transport.get_config(config));
+    TEST_ASSERT_EQUAL_STRING("15", config.c_str());
+    TEST_ASSERT_TRUE(transport.send(Transport::SAMPLES, "Station=attic&Temperature=25.0&Humidity=40&Sequence=7"));
+    TEST_ASSERT_FALSE(transport.send(Transport::SAMPLES, "Station=attic&Temperature=hot&Humidity=40"));
+    TEST_ASSERT_TRUE(transport.send(Transport::TELEMETRY, "Station=attic&RadioOnMs=1830"));
+    transport.close();
+
+    TEST_ASSERT_EQUAL(1u, collector.store.find("attic")->size());
+    TEST_ASSERT_EQUAL(1, count_lines(dir + "/telemetry/attic.jsonl"));
+    TransportStats stats = transport.stats();
+    TEST_ASSERT_EQUAL(4u, stats.round_trips);
+    TEST_ASSERT_EQUAL(4u, stats.packets_sent);
+    TEST_ASSERT_EQUAL(4u, stats.packets_received);
+}
+
+
+TEST_CASE("CoAP retransmission is answered without handling it again", "[transport]")
+{
+    std::string dir = make_test_dir();
+    TestCollector collector(dir);
+    TestListeners listeners(collector.collector);
+    TransportStats stats = {};
+    TransportSocket socket(stats);
+    TEST_ASSERT_TRUE(socket.open("127.0.0.1", listeners.coap.port(), true));
+
+    CoapMessage request = {COAP_CONFIRMABLE, COAP_POST, 0x1234, "ab", {CoapTransport::TELEMETRY_PATH}, {}, 0,
+                           "Station=attic&RadioOnMs=1830"};
+    CoapMessage response;
+
+    for (int i = 0; i < 2; i++)
+    {
+        std::string datagram;
+        TEST_ASSERT_TRUE(socket.send(coap_encode(request)));
+        TEST_ASSERT_TRUE(socket.receive(datagram, 2000));
+        TEST_ASSERT_TRUE(coap_decode(datagram, response));
+        TEST_ASSERT_EQUAL(COAP_ACKNOWLEDGEMENT, response.type);
+        TEST_ASSERT_EQUAL(COAP_CHANGED, response.code);
+        TEST_ASSERT_EQUAL(0x1234, response.message_id);
+        TEST_ASSERT_EQUAL_STRING("ab", response.token.c_str());
+    }
+
+    TEST_ASSERT_EQUAL(1, count_lines(dir + "/telemetry/attic.jsonl"));
+
+    request.message_id++;
+    request.uri_path = {"unknown"};
+    std::string datagram;
+    TEST_ASSERT_TRUE(socket.send(coap_encode(request)));
+    TEST_ASSERT_TRUE(socket.receive(datagram, 2000));
+    TEST_ASSERT_TRUE(coap_decode(datagram, response));
+    TEST_ASSERT_EQUAL(COAP_NOT_FOUND, response.code);
+}
@@ -0,0 +1,108 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include "unity.h"
+#include "test_client.h"
+#include "trend.h"
+
+
+TEST_CASE("Parse posted trend points", "[trend]")
+{
+    std::vector<TrendPoint> points;
+    TEST_ASSERT_TRUE(parse_trend("870:21.3,600:21.8,0:22.0", points));
+    TEST_ASSERT_EQUAL(3u, points.size());
+    TEST_ASSERT_EQUAL(-870, points[0].time_s);
+    TEST_ASSERT_EQUAL(0, points[2].time_s);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, 21.8, points[1].value);
+    TEST_ASSERT_TRUE(parse_trend("0:-3.5", points));
+    TEST_ASSERT_EQUAL(1u, points.size());
+
+    for (const char *text : {"", "0:1,", "600:1,870:2", "0:1,0:2", "-5:1", "10", "10:x", "10:1;0:2", "10:nan"})
+    {
+        if (parse_trend(text, points))
+        {
+            TEST_FAIL_MESSAGE(text);
+        }
+    }
+}
+
+
+TEST_CASE("Window samples are reconstructed at the points of both trends", "[trend]")
+{
+    std::vector<TrendPoint> temperature = {{-600, 20.0f}, {0, 23.0f}};
+    std::vector<TrendPoint> humidity = {{-600, 40.0f}, {-300, 50.0f}, {0, 50.0f}};
+    std::vector<Sample> samples = trend_samples(temperature, humidity, 1559390400, 0, 9);
+    TEST_ASSERT_EQUAL(3u, samples.size());
+    TEST_ASSERT_EQUAL(1559389800, samples[0].time_s);
+    TEST_ASSERT_EQUAL(9u, samples[0].sequence);
+    TEST_ASSERT_EQUAL(1559390100, samples[1].time_s);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, 21.5, samples[1].temperature);
+    TEST_ASSERT_EQUAL(50, samples[1].humidity);
+    TEST_ASSERT_EQUAL(9u, samples[1].sequence);
+    TEST_ASSERT_EQUAL(1559390400, samples[2].time_s);
+    TEST_ASSERT_EQUAL(9u, samples[2].sequence);
+
+    // Points not after the last stored sample are dropped, the last one is kept after it
+    samples = trend_samples(temperature, humidity, 1559390400, 1559390100, 9);
+    TEST_ASSERT_EQUAL(1u, samples.size());
+    TEST_ASSERT_EQUAL(1559390400, samples[0].time_s);
+    samples = trend_samples(temperature, humidity, 1559390400, 1559390400, 9);
+    TEST_ASSERT_EQUAL(1u, samples.size());
+    TEST_ASSERT_EQUAL(1559390401, samples[0].time_s);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, 23.0, samples[0].temperature);
+}
+
+
+TEST_CASE("Posted window trends are stored once", "[trend]")
+{
+    TestCollector collector(make_test_dir());
+    std::string body = "Station=attic&Temperature=21.5&Humidity=45&Sequence=3&Samples=20"
+                       "&TemperatureTrend=570:20.0,300:22.5,0:21.0&HumidityTrend=570:40.0,0:50.0";
+
+    for (int post = 0; post < 2; post++)
+    {
+        std::string response = http_request(collector.port(), "POST", "/collect.php", body);
+        TEST_ASSERT_TRUE(response.find("HTTP/1.1 200 OK") == 0);
+    }
+
+    StationShard *shard = collector.store.find("attic");
+    TEST_ASSERT_EQUAL(3u, shard->size());
+    TEST_ASSERT_EQUAL(shard->at(0).time_s + 570, shard->at(2).time_s);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, 22.5, shard->at(1).temperature);
+    TEST_ASSERT_EQUAL(45, shard->at(1).humidity);
+    TEST_ASSERT_EQUAL(3u, shard->last_sequence());
+
+    // The next window overlaps the stored one and starts after it
+    std::string next = "Station=attic&Temperature=21.5&Humidity=45&Sequence=4&Samples=20"
+                       "&TemperatureTrend=900:20.0,0:21.0&HumidityTrend=900:40.0,0:50.0";
+    TEST_ASSERT_TRUE(http_request(collector.port(), "POST", "/collect.php", next).find("HTTP/1.1 200 OK") == 0);
+    TEST_ASSERT_EQUAL(4u, shard->size());
+    TEST_ASSERT_TRUE(shard->at(3).time_s > shard->at(2).time_s);
+    TEST_ASSERT_EQUAL(4u, shard->at(3).sequence);
+
+    body += "&HumidityTrend=0:50.0,10:40.0";
+    TEST_ASSERT_TRUE(http_request(collector.port(), "POST", "/collect.php", body).find("HTTP/1.1 400") == 0);
+}
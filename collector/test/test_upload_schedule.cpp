@@ -0,0 +1,151 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+#include "unity.h"
+#include "coap_transport.h"
+#include "test_client.h"
+
+
+TEST_CASE("Upload slots spread stations over the interval", "[schedule]")
+{
+    UploadSlots slots;
+    const int interval_s = 600;
+    std::vector<int> phases;
+
+    for (int i = 0; i < 100; i++)
+    {
+        std::string station_id = "station" + std::to_string(i);
+        int offset_s = slots.offset_s(station_id, interval_s, 1000000);
+        TEST_ASSERT_TRUE(2 * abs(offset_s) <= interval_s);
+        phases.push_back(((1000000 + offset_s) % interval_s + interval_s) % interval_s);
+    }
+
+    TEST_ASSERT_EQUAL(100u, slots.size());
+    TEST_ASSERT_EQUAL(0u, slots.slot("station0"));
+    TEST_ASSERT_EQUAL(42u, slots.slot("station42"));
+
+    // Golden ratio phases leave no gap much over the even spacing
+    std::sort(phases.begin(), phases.end());
+    int largest_gap_s = phases.front() + interval_s - phases.back();
+
+    for (size_t i = 1; i < phases.size(); i++)
+    {
+        largest_gap_s = std::max(largest_gap_s, phases[i] - phases[i - 1]);
+    }
+
+    TEST_ASSERT_TRUE(largest_gap_s <= 3 * interval_s / 100);
+
+    // A station in its phase is not moved
+    int offset_s = slots.offset_s("station7", interval_s, 1000000);
+    TEST_ASSERT_EQUAL(0, slots.offset_s("station7", interval_s, 1000000 + offset_s + interval_s));
+    TEST_ASSERT_EQUAL(0, slots.offset_s("station7", 0, 1000000));
+}
+
+
+TEST_CASE("Upload limiter admits a burst and queues the rest", "[schedule]")
+{
+    UploadLimiter limiter(2);
+    int retry_after_s;
+    int admitted = 0;
+
+    for (int i = 0; i < 3; i++)
+    {
+        admitted += limiter.admit(100.0, retry_after_s) ? 1 : 0;
+    }
+
+    TEST_ASSERT_EQUAL(3, admitted);
+    TEST_ASSERT_FALSE(limiter.admit(100.0, retry_after_s));
+    TEST_ASSERT_EQUAL(1, retry_after_s);
+
+    // Each rejected wake is given a later time, at the admitted rate
+    std::vector<int> retries;
+
+    for (int i = 0; i < 8; i++)
+    {
+        TEST_ASSERT_FALSE(limiter.admit(100.0, retry_after_s));
+        retries.push_back(retry_after_s);
+    }
+
+    TEST_ASSERT_TRUE(std::is_sorted(retries.begin(), retries.end()));
+    TEST_ASSERT_EQUAL(5, retries.back());
+
+    // The wait is over after the queue has drained
+    TEST_ASSERT_TRUE(limiter.admit(110.0, retry_after_s));
+    TEST_ASSERT_EQUAL(0, retry_after_s);
+}
+
+
+TEST_CASE("Collector sends upload offset and turns away overload", "[schedule]")
+{
+    std::string dir = make_test_dir();
+    std::ofstream(dir + "/interval.txt") << "10\nfirmware 3 http://example.com\n";
+    TestCollector collector(dir);
+    UploadSlots slots;
+    UploadLimiter limiter(0.01);
+    collector.collector.set_upload_schedule(&slots, &limiter);
+
+    std::string response = http_request(collector.port(), "GET", "/interval.txt?Station=attic");
+    TEST_ASSERT_EQUAL(0u, response.find("HTTP/1.1 200"));
+    std::string body = response.substr(response.find("\r\n\r\n") + 4);
+    TEST_ASSERT_EQUAL(0u, body.find("10\nfirmware 3 http://example.com\noffset "));
+    int offset_s = atoi(body.c_str() + body.rfind(' '));
+    TEST_ASSERT_TRUE(2 * abs(offset_s) <= 600);
+    TEST_ASSERT_EQUAL('\n', body.back());
+
+    // The burst is spent, the next wake is told when to come back
+    response = http_request(collector.port(), "GET", "/interval.txt?Station=garage");
+    TEST_ASSERT_EQUAL(0u, response.find("HTTP/1.1 503"));
+    size_t retry_at = response.find("Retry-After: ");
+    TEST_ASSERT_TRUE(retry_at != std::string::npos);
+    TEST_ASSERT_TRUE(atoi(response.c_str() + retry_at + 13) > 100);
+    TEST_ASSERT_EQUAL(1u, slots.size());
+}
+
+
+TEST_CASE("CoAP tells the time to retry in Max-Age", "[schedule]")
+{
+    std::string dir = make_test_dir();
+    std::ofstream(dir + "/interval.txt") << "10";
+    TestCollector collector(dir);
+    TestListeners listeners(collector.collector);
+    UploadLimiter limiter(0.01);
+    collector.collector.set_upload_schedule(nullptr, &limiter);
+
+    std::string config;
+    CoapTransport transport("127.0.0.1", listeners.coap.port(), "attic");
+    TEST_ASSERT_TRUE(transport.open());
+    TEST_ASSERT_TRUE(transport.get_config(config));
+    TEST_ASSERT_EQUAL(0, transport.retry_after_s());
+    TEST_ASSERT_FALSE(transport.get_config(config));
+    TEST_ASSERT_TRUE(transport.retry_after_s() > 100);
+
+    // Other requests are not limited and clear the hint
+    TEST_ASSERT_TRUE(transport.send(Transport::TELEMETRY, "Station=attic&RadioOnMs=1830"));
+    TEST_ASSERT_EQUAL(0, transport.retry_after_s());
+    transport.close();
+}
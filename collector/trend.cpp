@@ -0,0 +1,145 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include "trend.h"
+
+
+/*!
+ * @brief
+ *   Parse posted trend points.
+ *
+ * @param text (IN)
+ *   Points as "age:value" separated by commas, oldest first.
+ *
+ * @param points (OUT)
+ *   Points in time order, with time as minus the age.
+ *
+ * @return
+ *   True if there are 1 to MAX_TREND_POINTS valid points with decreasing
+ *   ages, false otherwise.
+ */
+bool parse_trend(const std::string &text, std::vector<TrendPoint> &points)
+{
+    points.clear();
+    const char *cursor = text.c_str();
+
+    while (*cursor != 0)
+    {
+        char *end = nullptr;
+        long age_s = strtol(cursor, &end, 10);
+
+        if ((end == cursor) || (*end != ':') || (age_s < 0) || (age_s > INT32_MAX) ||
+            (points.size() == MAX_TREND_POINTS))
+        {
+            return false;
+        }
+
+        cursor = end + 1;
+        float value = strtof(cursor, &end);
+
+        if ((end == cursor) || !std::isfinite(value) || ((*end != ',') && (*end != 0)))
+        {
+            return false;
+        }
+
+        TrendPoint point = {static_cast<int32_t>(-age_s), value};
+
+        if (!points.empty() && (point.time_s <= points.back().time_s))
+        {
+            return false;
+        }
+
+        points.push_back(point);
+        cursor = (*end == ',') ? end + 1 : end;
+    }
+
+    return !points.empty() && (text.back() != ',');
+}
+
+
+/*!
+ * @brief
+ *   Reconstruct the samples of a window from its trends.
+ *
+ * @param temperature (IN)
+ *   Temperature trend points.
+ *
+ * @param humidity (IN)
+ *   Humidity trend points.
+ *
+ * @param end_s (IN)
+ *   Unix time of age 0.
+ *
+ * @param after_s (IN)
+ *   Unix time of the station's last stored sample. The samples must be
+ *   later to keep the station's samples in time order.
+ *
+ * @param sequence (IN)
+ *   Sequence number of the post.
+ *
+ * @return
+ *   A sample at each point of either trend in time order, all with the
+ *   sequence number of the post, to be stored together. Points at or before
+ *   after_s are dropped, except the last one, which is moved just after it.
+ */
+std::vector<Sample> trend_samples(const std::vector<TrendPoint> &temperature, const std::vector<TrendPoint> &humidity,
+                                  int64_t end_s, int64_t after_s, uint32_t sequence)
+{
+    std::vector<int32_t> times;
+
+    for (const std::vector<TrendPoint> *trend : {&temperature, &humidity})
+    {
+        for (const TrendPoint &point : *trend)
+        {
+            times.push_back(point.time_s);
+        }
+    }
+
+    std::sort(times.begin(), times.end());
+    times.erase(std::unique(times.begin(), times.end()), times.end());
+    std::vector<Sample> samples;
+
+    for (int32_t time_s : times)
+    {
+        bool last = (time_s == times.back());
+
+        if ((end_s + time_s <= after_s) && !last)
+        {
+            continue;
+        }
+
+        Sample sample;
+        sample.time_s = std::max(end_s + time_s, after_s + 1);
+        sample.temperature = trend_value(temperature.data(), static_cast<int>(temperature.size()), time_s);
+        sample.humidity = static_cast<int>(
+            lround(trend_value(humidity.data(), static_cast<int>(humidity.size()), time_s)));
+        sample.sequence = sequence;
+        samples.push_back(sample);
+    }
+
+    return samples;
+}
@@ -0,0 +1,146 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include "upload_schedule.h"
+
+/*! Fractional part of the golden ratio. Multiples of it modulo 1 fill the
+ *  unit interval evenly for any count. */
+static const double GOLDEN_FRACTION = 0.6180339887498949;
+
+
+/*!
+ * @brief
+ *   Get the slot of a station, assigning the next free one to a new
+ *   station.
+ *
+ * @param station_id (IN)
+ *   Station ID.
+ *
+ * @return
+ *   Slot number, in the order the stations were first seen.
+ */
+uint32_t UploadSlots::slot(const std::string &station_id)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = slots.find(station_id);
+
+    if (found == slots.end())
+    {
+        found = slots.emplace(station_id, static_cast<uint32_t>(slots.size())).first;
+    }
+
+    return found->second;
+}
+
+
+/*!
+ * @brief
+ *   Get how far a station should move its next wake to upload in its phase
+ *   of the interval.
+ *
+ * @param station_id (IN)
+ *   Station ID.
+ *
+ * @param interval_s (IN)
+ *   Measurement interval of the station in seconds.
+ *
+ * @param now_s (IN)
+ *   Time of the station's request, Unix time.
+ *
+ * @return
+ *   Seconds to add to the next interval, from -interval_s / 2 to
+ *   interval_s / 2.
+ */
+int UploadSlots::offset_s(const std::string &station_id, int interval_s, int64_t now_s)
+{
+    if (interval_s <= 1)
+    {
+        return 0;
+    }
+
+    double fraction = fmod(slot(station_id) * GOLDEN_FRACTION, 1.0);
+    int64_t phase_s = static_cast<int64_t>(fraction * interval_s);
+    int64_t offset = ((phase_s - now_s) % interval_s + interval_s) % interval_s;
+
+    return static_cast<int>((offset > interval_s / 2) ? offset - interval_s : offset);
+}
+
+
+/*!
+ * @brief
+ *   Get the number of stations with a slot.
+ */
+size_t UploadSlots::size()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return slots.size();
+}
+
+
+/*!
+ * @brief
+ *   Upload limiter class constructor.
+ *
+ * @param wakes_per_s (IN)
+ *   Sustained rate of admitted wakes.
+ */
+UploadLimiter::UploadLimiter(double wakes_per_s)
+    : period_s(1.0 / wakes_per_s), admit_at_s(0), retry_at_s(0)
+{
+}
+
+
+/*!
+ * @brief
+ *   Admit a wake or tell it when to come back.
+ *
+ * @param now_s (IN)
+ *   Current time in seconds, from any monotonic start.
+ *
+ * @param retry_after_s (OUT)
+ *   Seconds to wait before retrying if not admitted, at least 1.
+ *
+ * @return
+ *   True if admitted, false if over the rate.
+ */
+bool UploadLimiter::admit(double now_s, int &retry_after_s)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    double theoretical_s = std::max(admit_at_s, now_s);
+
+    if (theoretical_s - now_s <= BURST_S)
+    {
+        admit_at_s = theoretical_s + period_s;
+        retry_after_s = 0;
+        return true;
+    }
+
+    // Queue the rejected wakes behind the admitted ones, one period apart
+    retry_at_s = std::max(retry_at_s, theoretical_s - BURST_S) + period_s;
+    retry_after_s = std::max(1, static_cast<int>(ceil(retry_at_s - now_s)));
+
+    return false;
+}
@@ -0,0 +1,335 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include "dht_decode.h"
+#include "sensor_model.h"
+
+/*! Decoding state of one sensor */
+enum ChannelState
+{
+    WAIT_RELEASE,       // Line still low from the start signal
+    WAIT_RESPONSE,      // Line pulled up, waiting for the sensor
+    RESPONSE_LOW,       // 80 us response low
+    RESPONSE_HIGH,      // 80 us response high
+    BIT_LOW,            // 50 us low before each bit
+    BIT_HIGH,           // 26-28 us or 70 us high, the bit value
+    DONE,
+    FAILED
+};
+
+/*! Decoder of one sensor */
+template <class Model>
+struct Channel
+{
+    ChannelState state;
+    uint32_t changed;
+    int bits;
+    uint8_t data[Model::DATA_BITS / 8];
+};
+
+
+/*!
+ * @brief
+ *   Advance sensor state machine at a level change.
+ *
+ * @param channel (IN/OUT)
+ *   Sensor state.
+ *
+ * @param time (IN)
+ *   Time of the change in ticks.
+ *
+ * @param level (IN)
+ *   New line level.
+ *
+ * @param max_pulse (IN)
+ *   Longest valid pulse in ticks.
+ *
+ * @param one_threshold (IN)
+ *   Shortest one bit high pulse in ticks.
+ */
+template <class Model>
+static inline void step(Channel<Model> &channel, uint32_t time, bool level, uint32_t max_pulse,
+                        uint32_t one_threshold)
+{
+    uint32_t width = time - channel.changed;
+    channel.changed = time;
+
+    if ((channel.state != WAIT_RELEASE) && (channel.state != WAIT_RESPONSE) && (width > max_pulse))
+    {
+        channel.state = FAILED;
+        return;
+    }
+
+    switch (channel.state)
+    {
+        case WAIT_RELEASE:
+            channel.state = level ? WAIT_RESPONSE : WAIT_RELEASE;
+            break;
+        case WAIT_RESPONSE:
+            channel.state = level ? WAIT_RESPONSE : RESPONSE_LOW;
+            break;
+        case RESPONSE_LOW:
+            channel.state = level ? RESPONSE_HIGH : FAILED;
+            break;
+        case RESPONSE_HIGH:
+            channel.state = level ? FAILED : BIT_LOW;
+            break;
+        case BIT_LOW:
+            channel.state = level ? BIT_HIGH : FAILED;
+            break;
+        case BIT_HIGH:
+            if (level)
+            {
+                channel.state = FAILED;
+                break;
+            }
+
+            if (width > one_threshold)
+            {
+                channel.data[channel.bits / 8] |= static_cast<uint8_t>(0x80 >> (channel.bits % 8));
+            }
+
+            channel.bits++;
+            channel.state = (channel.bits == Model::DATA_BITS) ? DONE : BIT_LOW;
+            break;
+        default:
+            break;
+    }
+}
+
+
+/*!
+ * @brief
+ *   Decode the transmissions of several sensors from one capture.
+ *   Each edge is handed only to the sensors whose bits changed, so the cost
+ *   is one pass over the timeline plus the sensors' own edges.
+ *
+ * @param edges (IN)
+ *   Level changes of the GPIO input register in time order.
+ *
+ * @param count (IN)
+ *   Number of edges.
+ *
+ * @param initial_levels (IN)
+ *   GPIO input register at start of capture.
+ *
+ * @param channel_bits (IN)
+ *   GPIO input register bit of each sensor.
+ *
+ * @param channels (IN)
+ *   Number of sensors, at most DHT_MAX_CHANNELS.
+ *
+ * @param ticks_per_us (IN)
+ *   Capture clock ticks per microsecond.
+ *
+ * @param readings (OUT)
+ *   Result of each sensor.
+ */
+template <class Model>
+void dht_decode_channels(const DhtEdge *edges, size_t count, uint32_t initial_levels, const int *channel_bits,
+                         int channels, uint32_t ticks_per_us, DhtReading *readings)
+{
+    Channel<Model> channel[DHT_MAX_CHANNELS];
+    int channel_of_bit[DHT_MAX_CHANNELS];
+    uint32_t mask = 0;
+
+    for (int bit = 0; bit < DHT_MAX_CHANNELS; bit++)
+    {
+        channel_of_bit[bit] = -1;
+    }
+
+    for (int c = 0; c < channels; c++)
+    {
+        channel[c].state = ((initial_levels >> channel_bits[c]) & 1) ? WAIT_RESPONSE : WAIT_RELEASE;
+        channel[c].changed = 0;
+        channel[c].bits = 0;
+
+        for (int i = 0; i < Model::DATA_BITS / 8; i++)
+        {
+            channel[c].data[i] = 0;
+        }
+
+        channel_of_bit[channel_bits[c]] = c;
+        mask |= 1u << channel_bits[c];
+    }
+
+    uint32_t max_pulse = Model::MAX_PULSE_US * ticks_per_us;
+    uint32_t one_threshold = Model::ONE_THRESHOLD_US * ticks_per_us;
+    uint32_t previous = initial_levels;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t changed = (edges[i].levels ^ previous) & mask;
+        previous = edges[i].levels;
+
+        while (changed != 0)
+        {
+            int bit = __builtin_ctz(changed);
+            changed &= changed - 1;
+            step(channel[channel_of_bit[bit]], edges[i].time, (edges[i].levels >> bit) & 1, max_pulse,
+                 one_threshold);
+        }
+    }
+
+    for (int c = 0; c < channels; c++)
+    {
+        readings[c].temperature = 0.0;
+        readings[c].humidity = 0.0;
+        readings[c].status = (channel[c].state == DONE) ? Model::convert(channel[c].data, readings[c]) :
+                             DHT_TIMEOUT_ERROR;
+    }
+}
+
+template void dht_decode_channels<Dht22>(const DhtEdge *, size_t, uint32_t, const int *, int, uint32_t,
+                                         DhtReading *);
+template void dht_decode_channels<Am2302>(const DhtEdge *, size_t, uint32_t, const int *, int, uint32_t,
+                                          DhtReading *);
+template void dht_decode_channels<Dht11>(const DhtEdge *, size_t, uint32_t, const int *, int, uint32_t,
+                                         DhtReading *);
+
+
+/*!
+ * @brief
+ *   Convert DHT22 data bytes to temperature and humidity.
+ *
+ * @param data (IN)
+ *   Humidity (2 bytes), temperature (2 bytes, sign in top bit), checksum.
+ *
+ * @param reading (OUT)
+ *   Temperature and humidity.
+ *
+ * @return
+ *   DHT_OK if checksum matches, DHT_CHECKSUM_ERROR otherwise.
+ */
+int Dht22::convert(const uint8_t *data, DhtReading &reading)
+{
+    reading.humidity = static_cast<float>((data[0] << 8) | data[1]) / 10;
+    reading.temperature = static_cast<float>(((data[2] & 0x7F) << 8) | data[3]) / 10;
+
+    if (data[2] & 0x80)
+    {
+        reading.temperature = -reading.temperature;
+    }
+
+    if (data[4] != ((data[0] + data[1] + data[2] + data[3]) & 0xFF))
+    {
+        return DHT_CHECKSUM_ERROR;
+    }
+
+    return DHT_OK;
+}
+
+
+/*!
+ * @brief
+ *   Convert DHT11 data bytes to temperature and humidity.
+ *   Original DHT11 parts send zero decimal bytes, newer ones send tenths
+ *   and the sign of the temperature in the top bit of its decimal byte.
+ *
+ * @param data (IN)
+ *   Humidity integer and decimal, temperature integer and decimal, checksum.
+ *
+ * @param reading (OUT)
+ *   Temperature and humidity.
+ *
+ * @return
+ *   DHT_OK if checksum matches, DHT_CHECKSUM_ERROR otherwise.
+ */
+int Dht11::convert(const uint8_t *data, DhtReading &reading)
+{
+    reading.humidity = data[0] + static_cast<float>(data[1]) / 10;
+    reading.temperature = data[2] + static_cast<float>(data[3] & 0x7F) / 10;
+
+    if (data[3] & 0x80)
+    {
+        reading.temperature = -reading.temperature;
+    }
+
+    if (data[4] != ((data[0] + data[1] + data[2] + data[3]) & 0xFF))
+    {
+        return DHT_CHECKSUM_ERROR;
+    }
+
+    return DHT_OK;
+}
+
+
+/*!
+ * @brief
+ *   Convert SHT3x measurement bytes to temperature and humidity.
+ *
+ * @param data (IN)
+ *   Temperature (2 bytes, big endian), CRC, humidity (2 bytes), CRC.
+ *
+ * @param reading (OUT)
+ *   Temperature and humidity.
+ *
+ * @return
+ *   DHT_OK if both CRCs match, DHT_CHECKSUM_ERROR otherwise.
+ */
+int Sht3x::convert(const uint8_t *data, DhtReading &reading)
+{
+    uint32_t temperature = (static_cast<uint32_t>(data[0]) << 8) | data[1];
+    uint32_t humidity = (static_cast<uint32_t>(data[3]) << 8) | data[4];
+    reading.temperature = -45.0f + 175.0f * static_cast<float>(temperature) / 65535;
+    reading.humidity = 100.0f * static_cast<float>(humidity) / 65535;
+
+    if ((crc8(data, 2) != data[2]) || (crc8(data + 3, 2) != data[5]))
+    {
+        return DHT_CHECKSUM_ERROR;
+    }
+
+    return DHT_OK;
+}
+
+
+/*!
+ * @brief
+ *   Compute SHT3x CRC-8: polynomial 0x31, initial value 0xFF.
+ *
+ * @param data (IN)
+ *   Bytes to check.
+ *
+ * @param count (IN)
+ *   Number of bytes.
+ *
+ * @return
+ *   CRC of the bytes.
+ */
+uint8_t Sht3x::crc8(const uint8_t *data, int count)
+{
+    uint8_t crc = 0xFF;
+
+    for (int i = 0; i < count; i++)
+    {
+        crc ^= data[i];
+
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = static_cast<uint8_t>((crc & 0x80) ? ((crc << 1) ^ 0x31) : (crc << 1));
+        }
+    }
+
+    return crc;
+}
@@ -0,0 +1,250 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <cstring>
+#include "dht_diagnostics.h"
+#include "sensor_model.h"
+
+/*! Pulse counting of one sensor */
+struct PulseChannel
+{
+    /*! Line has been high, so the next falling edge starts the response */
+    bool released;
+
+    /*! Pulses since start of the response, -1 before it */
+    int pulses;
+
+    /*! Time of the last level change in ticks */
+    uint32_t changed;
+};
+
+
+/*!
+ * @brief
+ *   Add one to a histogram bin or counter, stopping at
+ *   DHT_DIAGNOSTICS_MAX_COUNT.
+ *
+ * @param count (IN/OUT)
+ *   Count to increment.
+ */
+static inline void count_up(uint16_t &count)
+{
+    if (count < DHT_DIAGNOSTICS_MAX_COUNT)
+    {
+        count++;
+    }
+}
+
+
+/*!
+ * @brief
+ *   Get histogram bin of a value, the last bin for values beyond it.
+ *
+ * @param ticks (IN)
+ *   Value in capture clock ticks.
+ *
+ * @param bin_ticks (IN)
+ *   Bin width in ticks.
+ *
+ * @return
+ *   Bin index.
+ */
+static inline int bin_of(uint32_t ticks, uint32_t bin_ticks)
+{
+    uint32_t bin = ticks / bin_ticks;
+
+    return (bin < DHT_DIAGNOSTICS_BINS) ? static_cast<int>(bin) : DHT_DIAGNOSTICS_BINS - 1;
+}
+
+
+/*!
+ * @brief
+ *   Start diagnostics after wake: keep the histograms of earlier wakes, or
+ *   clear them after power on when RTC memory holds no diagnostics.
+ *
+ * @param diagnostics (IN/OUT)
+ *   Diagnostics in RTC memory.
+ */
+void dht_diagnostics_start(DhtDiagnostics &diagnostics)
+{
+    if (diagnostics.magic != DHT_DIAGNOSTICS_MAGIC)
+    {
+        dht_diagnostics_clear(diagnostics);
+    }
+}
+
+
+/*!
+ * @brief
+ *   Clear all counts, after they have been uploaded.
+ *
+ * @param diagnostics (OUT)
+ *   Diagnostics to clear.
+ */
+void dht_diagnostics_clear(DhtDiagnostics &diagnostics)
+{
+    memset(&diagnostics, 0, sizeof(diagnostics));
+    diagnostics.magic = DHT_DIAGNOSTICS_MAGIC;
+}
+
+
+/*!
+ * @brief
+ *   Count the pulses and results of one capture into the histograms.
+ *   The pulses of each sensor are counted from its response until it has
+ *   sent its data bits. A pulse ended by a rising edge is a low pulse and
+ *   one ended by a falling edge a high pulse, so glitches are counted as
+ *   the short pulses they are instead of shifting the bits.
+ *
+ * @param edges (IN)
+ *   Level changes of the GPIO input register in time order.
+ *
+ * @param count (IN)
+ *   Number of edges.
+ *
+ * @param initial_levels (IN)
+ *   GPIO input register at start of capture.
+ *
+ * @param channel_bits (IN)
+ *   GPIO input register bit of each sensor.
+ *
+ * @param channels (IN)
+ *   Number of sensors, at most DHT_MAX_CHANNELS.
+ *
+ * @param ticks_per_us (IN)
+ *   Capture clock ticks per microsecond.
+ *
+ * @param readings (IN)
+ *   Result of each sensor decoded from the capture.
+ *
+ * @param diagnostics (IN/OUT)
+ *   Histograms and counters to add to.
+ */
+template <class Model>
+void dht_diagnostics_record(const DhtEdge *edges, size_t count, uint32_t initial_levels, const int *channel_bits,
+                            int channels, uint32_t ticks_per_us, const DhtReading *readings,
+                            DhtDiagnostics &diagnostics)
+{
+    // Response low and high, then a low and a high pulse per bit
+    const int last_pulse = 2 + 2 * Model::DATA_BITS;
+    uint32_t width_bin = DHT_WIDTH_BIN_US * ticks_per_us;
+    uint32_t margin_bin = DHT_MARGIN_BIN_US * ticks_per_us;
+    uint32_t one_threshold = Model::ONE_THRESHOLD_US * ticks_per_us;
+
+    for (int c = 0; c < channels; c++)
+    {
+        PulseChannel channel = {((initial_levels >> channel_bits[c]) & 1) != 0, -1, 0};
+        uint32_t previous = initial_levels;
+
+        for (size_t i = 0; (i < count) && (channel.pulses < last_pulse); i++)
+        {
+            bool changed = ((edges[i].levels ^ previous) >> channel_bits[c]) & 1;
+            bool level = (edges[i].levels >> channel_bits[c]) & 1;
+            previous = edges[i].levels;
+
+            if (!changed)
+            {
+                continue;
+            }
+
+            if (channel.pulses < 0)
+            {
+                channel.pulses = (!level && channel.released) ? 0 : -1;
+                channel.released = channel.released || level;
+                channel.changed = edges[i].time;
+                continue;
+            }
+
+            uint32_t width = edges[i].time - channel.changed;
+            channel.changed = edges[i].time;
+
+            if (channel.pulses++ < 2)
+            {
+                continue;
+            }
+
+            if (level)
+            {
+                count_up(diagnostics.low[bin_of(width, width_bin)]);
+            }
+            else
+            {
+                count_up(diagnostics.high[bin_of(width, width_bin)]);
+                uint32_t margin = (width > one_threshold) ? width - one_threshold : one_threshold - width;
+                count_up(diagnostics.margin[bin_of(margin, margin_bin)]);
+            }
+        }
+
+        count_up(diagnostics.reads);
+
+        if (readings[c].status == DHT_CHECKSUM_ERROR)
+        {
+            count_up(diagnostics.checksum_errors);
+        }
+        else if (readings[c].status == DHT_TIMEOUT_ERROR)
+        {
+            count_up(diagnostics.timeouts);
+        }
+    }
+}
+
+template void dht_diagnostics_record<Dht22>(const DhtEdge *, size_t, uint32_t, const int *, int, uint32_t,
+                                            const DhtReading *, DhtDiagnostics &);
+template void dht_diagnostics_record<Am2302>(const DhtEdge *, size_t, uint32_t, const int *, int, uint32_t,
+                                             const DhtReading *, DhtDiagnostics &);
+template void dht_diagnostics_record<Dht11>(const DhtEdge *, size_t, uint32_t, const int *, int, uint32_t,
+                                            const DhtReading *, DhtDiagnostics &);
+
+
+/*!
+ * @brief
+ *   Format a histogram as a telemetry value: the counts of the bins
+ *   separated by underscores, without the empty bins at the end, like
+ *   "0_0_3_812". At least two bins are kept, so that the collector never
+ *   reads a histogram like "3.7" or "812" as a number.
+ *
+ * @param bins (IN)
+ *   DHT_DIAGNOSTICS_BINS counts.
+ *
+ * @return
+ *   Histogram text, "0_0" when all bins are empty.
+ */
+std::string dht_histogram_text(const uint16_t *bins)
+{
+    int used = DHT_DIAGNOSTICS_BINS;
+
+    while ((used > 2) && (bins[used - 1] == 0))
+    {
+        used--;
+    }
+
+    std::string text = std::to_string(bins[0]);
+
+    for (int i = 1; i < used; i++)
+    {
+        text += "_" + std::to_string(bins[i]);
+    }
+
+    return text;
+}
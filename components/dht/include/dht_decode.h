@@ -0,0 +1,80 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Decoder of DHT bit streams of several sensors sampled together.
+ *
+ * All sensors are triggered at the same time and the whole GPIO input
+ * register is sampled into one timeline of level changes. The decoder walks
+ * the timeline once and runs a small state machine per sensor, so the
+ * sensors' bit streams are decoded in parallel even though their responses
+ * are skewed against each other.
+ *
+ * The decoder is a template on the sensor model (see sensor_model.h), which
+ * gives the pulse thresholds and the data conversion at compile time. It is
+ * instantiated in dht_decode.cpp for the single-wire models.
+ *
+ * The decoder has no ESP-IDF dependencies and is also built on the host
+ * against simulated waveforms (see /host).
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/* Same status values as in dht.h, which depends on ESP-IDF */
+#define DHT_OK 0
+#define DHT_CHECKSUM_ERROR -1
+#define DHT_TIMEOUT_ERROR -2
+
+/*! Level change of the sampled GPIO input register */
+struct DhtEdge
+{
+    /*! Time from start of capture in capture clock ticks */
+    uint32_t time;
+
+    /*! GPIO input register after the change */
+    uint32_t levels;
+};
+
+/*! Result of one sensor */
+struct DhtReading
+{
+    /*! DHT_OK, DHT_CHECKSUM_ERROR or DHT_TIMEOUT_ERROR */
+    int status;
+
+    /*! Temperature in degrees Celsius */
+    float temperature;
+
+    /*! Relative humidity in percent */
+    float humidity;
+};
+
+/*! Maximum number of sensors, one per GPIO input register bit */
+static const int DHT_MAX_CHANNELS = 32;
+
+template <class Model>
+void dht_decode_channels(const DhtEdge *edges, size_t count, uint32_t initial_levels, const int *channel_bits,
+                         int channels, uint32_t ticks_per_us, DhtReading *readings);
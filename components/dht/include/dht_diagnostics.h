@@ -0,0 +1,97 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Bit timing diagnostics of single-wire sensors.
+ *
+ * A failed read tells only that the checksum did not match or that the
+ * sensor stopped answering. With diagnostics on, the pulses of every
+ * capture are also counted into histograms of low and high pulse widths and
+ * of the margin of each bit's high pulse to the one/zero threshold. The
+ * histograms are kept in RTC memory and posted as telemetry with the next
+ * upload.
+ *
+ * A long or noisy cable shows as short spikes in the lowest bins, a sensor
+ * with a drifting clock as data bits near the threshold, and stalls of the
+ * capture loop as long pulses in the last bin, while the decoder
+ * still sees only checksum errors and timeouts.
+ *
+ * The pulses are counted from the same edge timeline that
+ * dht_decode_channels() decodes, apart from it, so the decoder is not
+ * slowed down when diagnostics are off. No ESP-IDF dependencies.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "dht_decode.h"
+
+/*! Number of bins of each histogram */
+static const int DHT_DIAGNOSTICS_BINS = 12;
+
+/*! Width of a pulse width bin, the last bin also counts longer pulses */
+static const uint32_t DHT_WIDTH_BIN_US = 8;
+
+/*! Width of a margin bin, the last bin also counts larger margins */
+static const uint32_t DHT_MARGIN_BIN_US = 4;
+
+/*! Counts stop here, so that a histogram fits in one telemetry value */
+static const uint16_t DHT_DIAGNOSTICS_MAX_COUNT = 9999;
+
+/*! Bit timing of the reads since the last upload, kept over deep sleep */
+struct DhtDiagnostics
+{
+    /*! DHT_DIAGNOSTICS_MAGIC when valid */
+    uint32_t magic;
+
+    /*! Sensor reads, checksum errors and timeouts */
+    uint16_t reads;
+    uint16_t checksum_errors;
+    uint16_t timeouts;
+
+    /*! Widths of the bit low pulses, DHT_WIDTH_BIN_US bins */
+    uint16_t low[DHT_DIAGNOSTICS_BINS];
+
+    /*! Widths of the bit high pulses, DHT_WIDTH_BIN_US bins */
+    uint16_t high[DHT_DIAGNOSTICS_BINS];
+
+    /*! Distance of the bit high pulses from the one/zero threshold,
+     *  DHT_MARGIN_BIN_US bins */
+    uint16_t margin[DHT_DIAGNOSTICS_BINS];
+};
+
+/*! Value of DhtDiagnostics::magic for valid diagnostics */
+static const uint32_t DHT_DIAGNOSTICS_MAGIC = 0x44494147;
+
+void dht_diagnostics_start(DhtDiagnostics &diagnostics);
+void dht_diagnostics_clear(DhtDiagnostics &diagnostics);
+
+template <class Model>
+void dht_diagnostics_record(const DhtEdge *edges, size_t count, uint32_t initial_levels, const int *channel_bits,
+                            int channels, uint32_t ticks_per_us, const DhtReading *readings,
+                            DhtDiagnostics &diagnostics);
+
+std::string dht_histogram_text(const uint16_t *bins);
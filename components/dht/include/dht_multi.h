@@ -0,0 +1,58 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#pragma once
+
+#include <driver/gpio.h>
+#include "dht_decode.h"
+#include "dht_diagnostics.h"
+#include "sensor.h"
+#include "sensor_model.h"
+
+/*! Reader of several single-wire sensors of one model, see sensor_model.h.
+ *  Instantiated in dht_multi.cpp for Dht22, Am2302 and Dht11. */
+template <class Model>
+class DHTMulti : public Sensor
+{
+public:
+	DHTMulti(const gpio_num_t *ports, int count);
+	~DHTMulti();
+	int count() const;
+	void read(DhtReading *readings) const;
+	int power_up_ms() const;
+	int min_interval_ms() const;
+	void set_diagnostics(DhtDiagnostics *bit_timing);
+
+private:
+	size_t capture(DhtEdge *edges, uint32_t &initial_levels) const;
+
+	gpio_num_t port[MAX_SENSORS];
+	int channel_bits[MAX_SENSORS];
+	int sensors;
+	uint32_t mask;
+	DhtDiagnostics *diagnostics;
+	static const size_t MAX_EDGES = MAX_SENSORS * 2 * (Model::DATA_BITS + 3);
+	static const int START_HIGH_US = 25;
+	static const uint32_t IDLE_TIMEOUT_US = 200;
+};
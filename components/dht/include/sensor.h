@@ -0,0 +1,57 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Temperature and humidity sensor interface.
+ *
+ * The application reads its sensors through this interface whatever the
+ * model. A read is one virtual call for all sensors of a reader; the
+ * timing-critical capture and the bit decoding behind it are specialised
+ * for the model at compile time (see sensor_model.h).
+ */
+
+#pragma once
+
+#include "dht_decode.h"
+
+class Sensor
+{
+public:
+	virtual ~Sensor() {}
+
+	/*! Get number of sensors read together */
+	virtual int count() const = 0;
+
+	/*! Read all sensors, one result per sensor */
+	virtual void read(DhtReading *readings) const = 0;
+
+	/*! Get time from power on to first read in milliseconds */
+	virtual int power_up_ms() const = 0;
+
+	/*! Get shortest time between two reads in milliseconds */
+	virtual int min_interval_ms() const = 0;
+
+	/*! Maximum number of sensors read together */
+	static const int MAX_SENSORS = 8;
+};
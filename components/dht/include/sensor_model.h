@@ -0,0 +1,135 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Timing and decoding policies of the supported sensor models.
+ *
+ * Each model is a struct of constexpr constants and a static conversion
+ * function. The readers and decoders are templates on the model, so all
+ * thresholds, timeouts and scalings are constants in the generated code and
+ * the bit loop has no runtime parameters or virtual calls.
+ *
+ * DHT11, DHT22 and AM2302 share the single-wire protocol and differ in the
+ * start signal, read interval and data format. SHT3x sensors use I2C and
+ * only share the conversion step.
+ *
+ * The models have no ESP-IDF dependencies and are also built on the host.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "dht_decode.h"
+
+/*! DHT22: 0.1 degree and 0.1 % resolution, sign bit in temperature */
+struct Dht22
+{
+    /*! Model name */
+    static constexpr const char *NAME = "DHT22";
+
+    /*! Time from power on to first read */
+    static constexpr int POWER_UP_MS = 1000;
+
+    /*! Start signal low time, datasheet minimum 1 ms */
+    static constexpr uint32_t START_LOW_US = 3000;
+
+    /*! Number of data bits in a transmission */
+    static constexpr int DATA_BITS = 40;
+
+    /*! High pulses longer than this are ones (0: 26-28 us, 1: 70 us). Half
+     *  way between them, unlike the 40 us of the old reader, so jitter and
+     *  clock drift have about 20 us of margin to both sides. */
+    static constexpr uint32_t ONE_THRESHOLD_US = 48;
+
+    /*! Longest valid pulse, longer means the sensor stopped responding */
+    static constexpr uint32_t MAX_PULSE_US = 120;
+
+    /*! Shortest time between two reads */
+    static constexpr int MIN_INTERVAL_MS = 2000;
+
+    static int convert(const uint8_t *data, DhtReading &reading);
+};
+
+/*! AM2302: wired DHT22, same protocol and data format */
+struct Am2302 : Dht22
+{
+    /*! Model name */
+    static constexpr const char *NAME = "AM2302";
+};
+
+/*! DHT11: 1 degree and 1 % resolution, tenths only in newer parts */
+struct Dht11
+{
+    /*! Model name */
+    static constexpr const char *NAME = "DHT11";
+
+    /*! Time from power on to first read */
+    static constexpr int POWER_UP_MS = 1000;
+
+    /*! Start signal low time, datasheet minimum 18 ms */
+    static constexpr uint32_t START_LOW_US = 20000;
+
+    /*! Number of data bits in a transmission */
+    static constexpr int DATA_BITS = 40;
+
+    /*! High pulses longer than this are ones (0: 26-28 us, 1: 70 us), half
+     *  way between them as for DHT22 */
+    static constexpr uint32_t ONE_THRESHOLD_US = 48;
+
+    /*! Longest valid pulse, longer means the sensor stopped responding */
+    static constexpr uint32_t MAX_PULSE_US = 120;
+
+    /*! Shortest time between two reads */
+    static constexpr int MIN_INTERVAL_MS = 1000;
+
+    static int convert(const uint8_t *data, DhtReading &reading);
+};
+
+/*! SHT3x: I2C sensor with 16-bit values and CRC-8 per value */
+struct Sht3x
+{
+    /*! Model name */
+    static constexpr const char *NAME = "SHT3x";
+
+    /*! Time from power on to first read, datasheet maximum 1.5 ms */
+    static constexpr int POWER_UP_MS = 2;
+
+    /*! I2C address with ADDR pin low, 0x45 with ADDR high */
+    static constexpr uint8_t ADDRESS = 0x44;
+
+    /*! Single shot measurement, high repeatability, no clock stretching */
+    static constexpr uint16_t MEASURE_COMMAND = 0x2400;
+
+    /*! Longest measurement time with high repeatability */
+    static constexpr int MEASURE_TIME_MS = 16;
+
+    /*! Number of bytes in a measurement: temperature, CRC, humidity, CRC */
+    static constexpr int DATA_BYTES = 6;
+
+    /*! Shortest time between two reads */
+    static constexpr int MIN_INTERVAL_MS = 100;
+
+    static int convert(const uint8_t *data, DhtReading &reading);
+    static uint8_t crc8(const uint8_t *data, int count);
+};
@@ -0,0 +1,86 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Readiness of a sensor for the next read.
+ *
+ * A sensor may be read when it has had its power-up time after power on and
+ * its minimum read interval after the previous read. The times of power on
+ * and last read are kept in a SensorClock, which the device keeps in RTC
+ * memory, so the spacing holds over deep sleep and the station waits only
+ * for what is left of it.
+ *
+ * After a failed read the next one is paced by the failure: a checksum
+ * error is a disturbed transmission from a working sensor and is retried
+ * after the minimum interval, while a timeout means that the sensor did not
+ * answer, so the wait doubles and the reads stop after MAX_TIMEOUTS in a
+ * row instead of spending all retries on a missing sensor.
+ *
+ * No ESP-IDF dependencies, times are given by the caller.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/*! Read timing of a sensor, kept over deep sleep */
+struct SensorClock
+{
+    /*! SensorTiming::MAGIC when valid */
+    uint32_t magic;
+
+    /*! Extra wait before the next read after timeouts */
+    uint32_t backoff_ms;
+
+    /*! Time of sensor power on */
+    uint64_t power_on_us;
+
+    /*! Time of last read, 0 for none */
+    uint64_t last_read_us;
+};
+
+class SensorTiming
+{
+public:
+    SensorTiming(SensorClock &sensor_clock, int power_up_ms, int min_interval_ms);
+    void start(uint64_t now_us, bool power_on);
+    uint32_t wait_ms(uint64_t now_us) const;
+    bool record(uint64_t now_us, int status);
+    bool responding() const;
+
+    /*! Value of SensorClock::magic for a valid clock */
+    static const uint32_t MAGIC = 0x53434C4B;
+
+    /*! Timeouts in a row after which reading stops */
+    static const int MAX_TIMEOUTS = 2;
+
+    /*! Longest extra wait after timeouts */
+    static const uint32_t MAX_BACKOFF_MS = 8000;
+
+private:
+    SensorClock &clock;
+    uint32_t power_up_us;
+    uint32_t min_interval_us;
+    int timeouts;
+};
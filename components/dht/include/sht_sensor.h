@@ -0,0 +1,48 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#pragma once
+
+#include <driver/gpio.h>
+#include <driver/i2c.h>
+#include "sensor.h"
+#include "sensor_model.h"
+
+/*! Reader of one SHT3x sensor on an I2C bus */
+class SHTSensor : public Sensor
+{
+public:
+	SHTSensor(gpio_num_t sda_port, gpio_num_t scl_port);
+	~SHTSensor();
+	int count() const;
+	void read(DhtReading *readings) const;
+	int power_up_ms() const;
+	int min_interval_ms() const;
+
+private:
+	bool installed;
+	static const i2c_port_t I2C_PORT = I2C_NUM_0;
+	static const uint32_t CLOCK_HZ = 100000;
+	static const int TIMEOUT_MS = 50;
+};
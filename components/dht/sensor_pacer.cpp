@@ -0,0 +1,129 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Sensor read pacing on the device.
+ *
+ * The sensor clock is kept in RTC memory and timed with the RTC timer,
+ * which runs over deep sleep, so a read right after wake waits only for
+ * what is left of the sensor's power-up time and read interval. Usually
+ * that is nothing.
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_clk.h"
+#include "rom/rtc.h"
+#include "sensor_pacer.h"
+
+/*! Times of sensor power on and last read, kept over deep sleep */
+RTC_DATA_ATTR static SensorClock rtc_sensor_clock;
+
+
+/*!
+ * @brief
+ *   Sensor read pacer class constructor.
+ *   A power on reset powered the sensor when the RTC timer started.
+ *
+ * @param sensor (IN)
+ *   Paced sensor.
+ */
+SensorPacer::SensorPacer(const Sensor &sensor) :
+    timing(rtc_sensor_clock, sensor.power_up_ms(), sensor.min_interval_ms()), read_start_us(0), waited(0)
+{
+    timing.start(esp_clk_rtc_time(), rtc_get_reset_reason(0) == POWERON_RESET);
+}
+
+
+/*!
+ * @brief
+ *   Sensor read pacer class destructor.
+ */
+SensorPacer::~SensorPacer()
+{
+}
+
+
+/*!
+ * @brief
+ *   Wait until the sensor may be read.
+ */
+void SensorPacer::wait()
+{
+    uint64_t start_us = esp_clk_rtc_time();
+    uint64_t now_us = start_us;
+    uint32_t wait_ms;
+
+    while ((wait_ms = timing.wait_ms(now_us)) > 0)
+    {
+        vTaskDelay((wait_ms + portTICK_RATE_MS - 1) / portTICK_RATE_MS);
+        now_us = esp_clk_rtc_time();
+    }
+
+    waited += static_cast<uint32_t>((now_us - start_us) / 1000);
+    read_start_us = now_us;
+}
+
+
+/*!
+ * @brief
+ *   Record the result of a read started after wait().
+ *
+ * @param status (IN)
+ *   DHT_OK, DHT_CHECKSUM_ERROR or DHT_TIMEOUT_ERROR.
+ *
+ * @return
+ *   False if the sensor does not answer and is not worth retrying.
+ */
+bool SensorPacer::record(int status)
+{
+    return timing.record(read_start_us, status);
+}
+
+
+/*!
+ * @brief
+ *   Check if the sensor is worth reading.
+ *
+ * @return
+ *   False if the sensor has stopped answering during this boot.
+ */
+bool SensorPacer::responding() const
+{
+    return timing.responding();
+}
+
+
+/*!
+ * @brief
+ *   Get total time spent waiting for the sensor since construction.
+ *
+ * @return
+ *   Time in milliseconds.
+ */
+uint32_t SensorPacer::waited_ms() const
+{
+    return waited;
+}
@@ -0,0 +1,153 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include "dht_decode.h"
+#include "sensor_timing.h"
+
+
+/*!
+ * @brief
+ *   Sensor read timing class constructor.
+ *
+ * @param sensor_clock (IN/OUT)
+ *   Times of power on and last read, kept over deep sleep.
+ *
+ * @param power_up_ms (IN)
+ *   Time from power on to first read.
+ *
+ * @param min_interval_ms (IN)
+ *   Shortest time between two reads.
+ */
+SensorTiming::SensorTiming(SensorClock &sensor_clock, int power_up_ms, int min_interval_ms) :
+    clock(sensor_clock), power_up_us(static_cast<uint32_t>(power_up_ms) * 1000),
+    min_interval_us(static_cast<uint32_t>(min_interval_ms) * 1000), timeouts(0)
+{
+}
+
+
+/*!
+ * @brief
+ *   Start timing at boot.
+ *   The clock is reset if it is not valid, which is the case after power
+ *   loss cleared it, or if its times are in the future.
+ *
+ * @param now_us (IN)
+ *   Current time on a clock that runs over deep sleep.
+ *
+ * @param power_on (IN)
+ *   True if the boot was a power on, which started the clock and powered
+ *   the sensor at time 0. Otherwise an unknown clock is assumed to have
+ *   just powered the sensor.
+ */
+void SensorTiming::start(uint64_t now_us, bool power_on)
+{
+    if (power_on || (clock.magic != MAGIC) || (clock.power_on_us > now_us) || (clock.last_read_us > now_us))
+    {
+        clock.magic = MAGIC;
+        clock.backoff_ms = 0;
+        clock.power_on_us = power_on ? 0 : now_us;
+        clock.last_read_us = 0;
+    }
+
+    timeouts = 0;
+}
+
+
+/*!
+ * @brief
+ *   Get time left until the sensor may be read.
+ *
+ * @param now_us (IN)
+ *   Current time.
+ *
+ * @return
+ *   Time to wait in milliseconds, rounded up, 0 if ready.
+ */
+uint32_t SensorTiming::wait_ms(uint64_t now_us) const
+{
+    uint64_t ready_us = clock.power_on_us + power_up_us;
+
+    if (clock.last_read_us != 0)
+    {
+        uint64_t interval_ready_us = clock.last_read_us + min_interval_us +
+                                     static_cast<uint64_t>(clock.backoff_ms) * 1000;
+        ready_us = (interval_ready_us > ready_us) ? interval_ready_us : ready_us;
+    }
+
+    return (ready_us > now_us) ? static_cast<uint32_t>((ready_us - now_us + 999) / 1000) : 0;
+}
+
+
+/*!
+ * @brief
+ *   Record a read and pace the next one by its result.
+ *   A timeout doubles the wait before the next read, up to MAX_BACKOFF_MS
+ *   more than the minimum interval. Any answer from the sensor resets it.
+ *
+ * @param now_us (IN)
+ *   Time of the start of the read.
+ *
+ * @param status (IN)
+ *   DHT_OK, DHT_CHECKSUM_ERROR or DHT_TIMEOUT_ERROR.
+ *
+ * @return
+ *   False if the sensor has timed out MAX_TIMEOUTS times in a row and is
+ *   not worth retrying, true otherwise.
+ */
+bool SensorTiming::record(uint64_t now_us, int status)
+{
+    clock.last_read_us = now_us;
+
+    if (status != DHT_TIMEOUT_ERROR)
+    {
+        timeouts = 0;
+        clock.backoff_ms = 0;
+        return true;
+    }
+
+    timeouts++;
+    uint64_t interval_ms = min_interval_us / 1000;
+    uint64_t backoff_ms = (interval_ms << ((timeouts < 16) ? timeouts : 16)) - interval_ms;
+    clock.backoff_ms = MAX_BACKOFF_MS;
+
+    if (backoff_ms < MAX_BACKOFF_MS)
+    {
+        clock.backoff_ms = static_cast<uint32_t>(backoff_ms);
+    }
+
+    return responding();
+}
+
+
+/*!
+ * @brief
+ *   Check if the sensor is worth reading.
+ *
+ * @return
+ *   False after MAX_TIMEOUTS timeouts in a row, true otherwise.
+ */
+bool SensorTiming::responding() const
+{
+    return (timeouts < MAX_TIMEOUTS);
+}
@@ -0,0 +1,157 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Reader of an SHT3x temperature and humidity sensor.
+ *
+ * Starts a single shot measurement, waits for it and reads the six result
+ * bytes. The conversion and CRC check are shared with the host build (see
+ * sensor_model.h).
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sht_sensor.h"
+
+
+/*!
+ * @brief
+ *   SHT3x sensor reader class constructor.
+ *   Installs the I2C master driver.
+ *
+ * @param sda_port (IN)
+ *   I2C data GPIO port.
+ *
+ * @param scl_port (IN)
+ *   I2C clock GPIO port.
+ */
+SHTSensor::SHTSensor(gpio_num_t sda_port, gpio_num_t scl_port)
+{
+    i2c_config_t config = {};
+    config.mode = I2C_MODE_MASTER;
+    config.sda_io_num = sda_port;
+    config.sda_pullup_en = GPIO_PULLUP_ENABLE;
+    config.scl_io_num = scl_port;
+    config.scl_pullup_en = GPIO_PULLUP_ENABLE;
+    config.master.clk_speed = CLOCK_HZ;
+
+    installed = (i2c_param_config(I2C_PORT, &config) == ESP_OK) &&
+                (i2c_driver_install(I2C_PORT, config.mode, 0, 0, 0) == ESP_OK);
+}
+
+
+/*!
+ * @brief
+ *   SHT3x sensor reader class destructor.
+ *   Removes the I2C master driver.
+ */
+SHTSensor::~SHTSensor()
+{
+    if (installed)
+    {
+        i2c_driver_delete(I2C_PORT);
+    }
+}
+
+
+/*!
+ * @brief
+ *   Get number of sensors, always one.
+ */
+int SHTSensor::count() const
+{
+    return 1;
+}
+
+
+/*!
+ * @brief
+ *   Measure temperature and humidity.
+ *
+ * @param readings (OUT)
+ *   Result, DHT_TIMEOUT_ERROR if the sensor does not answer on the bus.
+ */
+void SHTSensor::read(DhtReading *readings) const
+{
+    readings[0].status = DHT_TIMEOUT_ERROR;
+    readings[0].temperature = 0.0;
+    readings[0].humidity = 0.0;
+
+    if (!installed)
+    {
+        return;
+    }
+
+    i2c_cmd_handle_t command = i2c_cmd_link_create();
+    i2c_master_start(command);
+    i2c_master_write_byte(command, (Sht3x::ADDRESS << 1) | I2C_MASTER_WRITE, true);
+    i2c_master_write_byte(command, Sht3x::MEASURE_COMMAND >> 8, true);
+    i2c_master_write_byte(command, Sht3x::MEASURE_COMMAND & 0xFF, true);
+    i2c_master_stop(command);
+    esp_err_t status = i2c_master_cmd_begin(I2C_PORT, command, TIMEOUT_MS / portTICK_RATE_MS);
+    i2c_cmd_link_delete(command);
+
+    if (status != ESP_OK)
+    {
+        return;
+    }
+
+    // A delay of n ticks may end just after n - 1 ticks, add one more
+    vTaskDelay(Sht3x::MEASURE_TIME_MS / portTICK_RATE_MS + 2);
+
+    uint8_t data[Sht3x::DATA_BYTES];
+    command = i2c_cmd_link_create();
+    i2c_master_start(command);
+    i2c_master_write_byte(command, (Sht3x::ADDRESS << 1) | I2C_MASTER_READ, true);
+    i2c_master_read(command, data, Sht3x::DATA_BYTES - 1, I2C_MASTER_ACK);
+    i2c_master_read_byte(command, data + Sht3x::DATA_BYTES - 1, I2C_MASTER_NACK);
+    i2c_master_stop(command);
+    status = i2c_master_cmd_begin(I2C_PORT, command, TIMEOUT_MS / portTICK_RATE_MS);
+    i2c_cmd_link_delete(command);
+
+    if (status == ESP_OK)
+    {
+        readings[0].status = Sht3x::convert(data, readings[0]);
+    }
+}
+
+
+/*!
+ * @brief
+ *   Get time from power on to first read in milliseconds.
+ */
+int SHTSensor::power_up_ms() const
+{
+    return Sht3x::POWER_UP_MS;
+}
+
+
+/*!
+ * @brief
+ *   Get shortest time between two reads in milliseconds.
+ */
+int SHTSensor::min_interval_ms() const
+{
+    return Sht3x::MIN_INTERVAL_MS;
+}
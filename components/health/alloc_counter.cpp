@@ -0,0 +1,178 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "alloc_counter.h"
+
+/*! Counters, relaxed since they are only read for reporting */
+static std::atomic<uint32_t> allocations(0);
+static std::atomic<uint32_t> frees(0);
+static std::atomic<uint32_t> bytes(0);
+
+
+/*!
+ * @brief
+ *   Count and allocate memory.
+ *
+ * @param size (IN)
+ *   Bytes requested.
+ *
+ * @return
+ *   Allocated memory, nullptr if out of memory.
+ */
+static void *counted_malloc(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(static_cast<uint32_t>(size), std::memory_order_relaxed);
+
+    return malloc((size > 0) ? size : 1);
+}
+
+
+/*!
+ * @brief
+ *   Count and free memory.
+ *
+ * @param ptr (IN)
+ *   Memory from counted_malloc(), or nullptr.
+ */
+static void counted_free(void *ptr)
+{
+    if (ptr != nullptr)
+    {
+        frees.fetch_add(1, std::memory_order_relaxed);
+        free(ptr);
+    }
+}
+
+
+/*!
+ * @brief
+ *   Allocate memory for operator new, which does not return nullptr.
+ */
+static void *checked_malloc(size_t size)
+{
+    void *ptr = counted_malloc(size);
+
+    if (ptr == nullptr)
+    {
+#if __cpp_exceptions
+        throw std::bad_alloc();
+#else
+        abort();
+#endif
+    }
+
+    return ptr;
+}
+
+
+/*!
+ * @brief
+ *   Replaced global allocation functions, each counted. The sized and
+ *   nothrow deletes free like the plain ones.
+ */
+void *operator new(size_t size)
+{
+    return checked_malloc(size);
+}
+
+
+void *operator new[](size_t size)
+{
+    return checked_malloc(size);
+}
+
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return counted_malloc(size);
+}
+
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return counted_malloc(size);
+}
+
+
+void operator delete(void *ptr) noexcept
+{
+    counted_free(ptr);
+}
+
+
+void operator delete[](void *ptr) noexcept
+{
+    counted_free(ptr);
+}
+
+
+void operator delete(void *ptr, size_t size) noexcept
+{
+    counted_free(ptr);
+}
+
+
+void operator delete[](void *ptr, size_t size) noexcept
+{
+    counted_free(ptr);
+}
+
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept
+{
+    counted_free(ptr);
+}
+
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept
+{
+    counted_free(ptr);
+}
+
+
+/*!
+ * @brief
+ *   Start counting from zero, at the start of a wake.
+ */
+void alloc_counter_reset()
+{
+    allocations = 0;
+    frees = 0;
+    bytes = 0;
+}
+
+
+/*!
+ * @brief
+ *   Get allocations since alloc_counter_reset().
+ */
+AllocStats alloc_counter_stats()
+{
+    return {allocations.load(std::memory_order_relaxed), frees.load(std::memory_order_relaxed),
+            bytes.load(std::memory_order_relaxed)};
+}
@@ -0,0 +1,51 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Allocation counter: counts the C++ heap allocations of the station.
+ *
+ * Global operator new and delete are replaced by versions that count the
+ * calls and requested bytes before calling malloc and free, so the
+ * allocations of std::string, std::stringstream and the station classes
+ * during a wake can be reported and checked against a budget. C code such
+ * as esp_http_client allocates with malloc directly and is not counted; its
+ * share shows in the free heap watermarks instead.
+ *
+ * No ESP-IDF dependencies, also built on the host.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/*! Allocations since alloc_counter_reset() */
+struct AllocStats
+{
+    uint32_t allocations;
+    uint32_t frees;
+    uint32_t bytes;
+};
+
+void alloc_counter_reset();
+AllocStats alloc_counter_stats();
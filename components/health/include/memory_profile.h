@@ -0,0 +1,84 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Memory profile of a wake: free heap, its low watermark and largest free
+ * block, counted allocations and the stack high-water marks of the tasks.
+ *
+ * The station posts the profile as telemetry so that buffers and task
+ * stacks can be sized from field data. A budget gives the limits a profile
+ * must stay within; the host tests check the upload path against one.
+ *
+ * No ESP-IDF dependencies, also built on the host. The profile is read on
+ * the device with memory_monitor.h.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/*! Most tasks in a profile, the ones with the least free stack */
+static const int MEMORY_MAX_TASKS = 8;
+
+/*! Longest task name, as FreeRTOS configMAX_TASK_NAME_LEN */
+static const int MEMORY_TASK_NAME_LENGTH = 16;
+
+/*! Stack high-water mark of a task */
+struct TaskStack
+{
+    char name[MEMORY_TASK_NAME_LENGTH];
+
+    /*! Stack never used since the task started in bytes */
+    uint32_t free_bytes;
+};
+
+struct MemoryProfile
+{
+    /*! Free heap now, lowest since boot and largest allocatable block in bytes */
+    uint32_t free_heap;
+    uint32_t min_free_heap;
+    uint32_t largest_free_block;
+
+    /*! Counted allocations of the wake, see alloc_counter.h */
+    uint32_t allocations;
+    uint32_t frees;
+    uint32_t allocated_bytes;
+
+    int task_count;
+    TaskStack tasks[MEMORY_MAX_TASKS];
+};
+
+/*! Limits of a memory profile, 0 for no limit */
+struct MemoryBudget
+{
+    uint32_t min_free_heap;
+    uint32_t min_largest_block;
+    uint32_t max_allocations;
+    uint32_t max_allocated_bytes;
+    uint32_t min_stack_free;
+};
+
+bool memory_within_budget(const MemoryProfile &profile, const MemoryBudget &budget, std::string &violations);
+std::string memory_task_key(const char *task_name);
@@ -0,0 +1,91 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "sdkconfig.h"
+#include "alloc_counter.h"
+#include "memory_monitor.h"
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+/*! Most tasks read from FreeRTOS, WiFi and lwIP start about a dozen */
+static const UBaseType_t MAX_SYSTEM_TASKS = 32;
+
+/*! Task states, static to keep them off the stack being measured */
+static TaskStatus_t task_states[MAX_SYSTEM_TASKS];
+#endif
+
+
+/*!
+ * @brief
+ *   Copy a task's name and stack high-water mark to the profile.
+ */
+static void add_task(MemoryProfile &profile, const char *name, uint32_t free_bytes)
+{
+    TaskStack &task = profile.tasks[profile.task_count++];
+    strncpy(task.name, name, sizeof(task.name) - 1);
+    task.name[sizeof(task.name) - 1] = 0;
+    task.free_bytes = free_bytes;
+}
+
+
+/*!
+ * @brief
+ *   Read the memory profile. The heap low watermark is since boot, which is
+ *   the wake when the station deep sleeps. ESP-IDF stacks are counted in
+ *   bytes. Without CONFIG_FREERTOS_USE_TRACE_FACILITY only the calling
+ *   task's stack is read.
+ *
+ * @param profile (OUT)
+ *   Memory profile.
+ */
+void memory_profile_read(MemoryProfile &profile)
+{
+    profile.free_heap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    profile.min_free_heap = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    profile.largest_free_block = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    AllocStats allocs = alloc_counter_stats();
+    profile.allocations = allocs.allocations;
+    profile.frees = allocs.frees;
+    profile.allocated_bytes = allocs.bytes;
+    profile.task_count = 0;
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+    UBaseType_t count = uxTaskGetSystemState(task_states, MAX_SYSTEM_TASKS, nullptr);
+
+    // The tasks closest to overflow first
+    std::sort(task_states, task_states + count, [](const TaskStatus_t &a, const TaskStatus_t &b)
+              { return a.usStackHighWaterMark < b.usStackHighWaterMark; });
+
+    for (UBaseType_t i = 0; (i < count) && (profile.task_count < MEMORY_MAX_TASKS); i++)
+    {
+        add_task(profile, task_states[i].pcTaskName, task_states[i].usStackHighWaterMark);
+    }
+#else
+    add_task(profile, pcTaskGetTaskName(nullptr), uxTaskGetStackHighWaterMark(nullptr));
+#endif
+}
@@ -0,0 +1,112 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <cctype>
+#include "memory_profile.h"
+
+
+/*!
+ * @brief
+ *   Add a violation to the list if a value is below its lower limit.
+ */
+static void check_min(const std::string &name, uint32_t value, uint32_t limit, std::string &violations)
+{
+    if ((limit > 0) && (value < limit))
+    {
+        violations += name + " " + std::to_string(value) + " < " + std::to_string(limit) + "\n";
+    }
+}
+
+
+/*!
+ * @brief
+ *   Add a violation to the list if a value is above its upper limit.
+ */
+static void check_max(const std::string &name, uint32_t value, uint32_t limit, std::string &violations)
+{
+    if ((limit > 0) && (value > limit))
+    {
+        violations += name + " " + std::to_string(value) + " > " + std::to_string(limit) + "\n";
+    }
+}
+
+
+/*!
+ * @brief
+ *   Check a memory profile against a budget.
+ *
+ * @param profile (IN)
+ *   Memory profile.
+ *
+ * @param budget (IN)
+ *   Limits, 0 for no limit.
+ *
+ * @param violations (OUT)
+ *   One line per exceeded limit, empty if none.
+ *
+ * @return
+ *   True if the profile is within the budget, false otherwise.
+ */
+bool memory_within_budget(const MemoryProfile &profile, const MemoryBudget &budget, std::string &violations)
+{
+    violations.clear();
+    check_min("min_free_heap", profile.min_free_heap, budget.min_free_heap, violations);
+    check_min("largest_free_block", profile.largest_free_block, budget.min_largest_block, violations);
+    check_max("allocations", profile.allocations, budget.max_allocations, violations);
+    check_max("allocated_bytes", profile.allocated_bytes, budget.max_allocated_bytes, violations);
+
+    for (int i = 0; i < profile.task_count; i++)
+    {
+        check_min(std::string("stack ") + profile.tasks[i].name, profile.tasks[i].free_bytes, budget.min_stack_free,
+                  violations);
+    }
+
+    return violations.empty();
+}
+
+
+/*!
+ * @brief
+ *   Get telemetry field name of a task's stack high-water mark. Characters
+ *   the collector does not accept in names, such as the space in "Tmr Svc",
+ *   are replaced with '_'.
+ *
+ * @param task_name (IN)
+ *   FreeRTOS task name.
+ *
+ * @return
+ *   "Stack_<task name>".
+ */
+std::string memory_task_key(const char *task_name)
+{
+    std::string key = "Stack_";
+
+    for (const char *c = task_name; (c < task_name + MEMORY_TASK_NAME_LENGTH) && (*c != 0); c++)
+    {
+        bool valid = isalnum(static_cast<unsigned char>(*c)) || (*c == '-') || (*c == '_');
+        key += valid ? *c : '_';
+    }
+
+    return key;
+}
@@ -0,0 +1,173 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <cstring>
+#include "delta_format.h"
+
+
+/*!
+ * @brief
+ *   Update a CRC-32 (IEEE 802.3, as zlib) with data. Bitwise, to keep the
+ *   station free of a 1 kB table; the station checks about one image per
+ *   update.
+ *
+ * @param crc (IN)
+ *   CRC of the preceding data, 0 to start.
+ *
+ * @param data (IN)
+ *   Data.
+ *
+ * @param size (IN)
+ *   Size of data.
+ *
+ * @return
+ *   CRC of the preceding data and data.
+ */
+uint32_t delta_crc32(uint32_t crc, const uint8_t *data, size_t size)
+{
+    crc = ~crc;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        crc ^= data[i];
+
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+
+    return ~crc;
+}
+
+
+/*!
+ * @brief
+ *   Write a 32-bit value little-endian.
+ */
+static void put_u32(uint8_t *data, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        data[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+
+/*!
+ * @brief
+ *   Read a 32-bit value little-endian.
+ */
+static uint32_t get_u32(const uint8_t *data)
+{
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+
+/*!
+ * @brief
+ *   Encode a patch header.
+ *
+ * @param header (IN)
+ *   Header.
+ *
+ * @param data (OUT)
+ *   DELTA_HEADER_SIZE bytes.
+ */
+void delta_encode_header(const DeltaHeader &header, uint8_t *data)
+{
+    memcpy(data, DELTA_MAGIC, sizeof(DELTA_MAGIC));
+    put_u32(data + 4, header.old_size);
+    put_u32(data + 8, header.old_crc);
+    put_u32(data + 12, header.new_size);
+    put_u32(data + 16, header.new_crc);
+}
+
+
+/*!
+ * @brief
+ *   Decode a patch header.
+ *
+ * @param data (IN)
+ *   DELTA_HEADER_SIZE bytes.
+ *
+ * @param header (OUT)
+ *   Header.
+ *
+ * @return
+ *   True if the magic is right, false otherwise.
+ */
+bool delta_decode_header(const uint8_t *data, DeltaHeader &header)
+{
+    header.old_size = get_u32(data + 4);
+    header.old_crc = get_u32(data + 8);
+    header.new_size = get_u32(data + 12);
+    header.new_crc = get_u32(data + 16);
+
+    return (memcmp(data, DELTA_MAGIC, sizeof(DELTA_MAGIC)) == 0);
+}
+
+
+/*!
+ * @brief
+ *   Append a varint: 7 bits per byte, low bits first, high bit set on all
+ *   but the last byte.
+ *
+ * @param patch (IN/OUT)
+ *   Patch to append to.
+ *
+ * @param value (IN)
+ *   Value.
+ */
+void delta_append_varint(std::string &patch, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        patch += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+
+    patch += static_cast<char>(value);
+}
+
+
+/*!
+ * @brief
+ *   Map a signed value to unsigned so that small magnitudes have short
+ *   varints: 0, -1, 1, -2... to 0, 1, 2, 3...
+ */
+uint32_t delta_zigzag(int32_t value)
+{
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+
+/*!
+ * @brief
+ *   Inverse of delta_zigzag().
+ */
+int32_t delta_unzigzag(uint32_t value)
+{
+    return static_cast<int32_t>((value >> 1) ^ (0 - (value & 1)));
+}
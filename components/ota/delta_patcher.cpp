@@ -0,0 +1,367 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include "delta_patcher.h"
+
+
+/*!
+ * @brief
+ *   Delta patcher class constructor.
+ *
+ * @param old_image (IN)
+ *   Image the patch was made against.
+ *
+ * @param new_image (IN)
+ *   Image the patch writes.
+ */
+DeltaPatcher::DeltaPatcher(DeltaSource &old_image, DeltaSink &new_image)
+    : source(old_image), sink(new_image), state(HEADER), failure(nullptr), header(), header_size(0), varint(0),
+      varint_shift(0), seek(0), remaining(0), old_cursor(0), new_size(0), new_crc(0)
+{
+}
+
+
+/*!
+ * @brief
+ *   Apply the next piece of the patch.
+ *
+ * @param data (IN)
+ *   Patch data.
+ *
+ * @param size (IN)
+ *   Size of data.
+ *
+ * @return
+ *   True if the patch is good so far, false if it failed.
+ */
+bool DeltaPatcher::feed(const uint8_t *data, size_t size)
+{
+    size_t offset = 0;
+
+    while ((offset < size) && (state != FAILED))
+    {
+        bool complete = false;
+
+        switch (state)
+        {
+            case HEADER:
+                header_data[header_size++] = data[offset++];
+
+                if (header_size == DELTA_HEADER_SIZE)
+                {
+                    state = start() ? OPERATION : FAILED;
+                }
+                break;
+
+            case OPERATION:
+                varint = 0;
+                varint_shift = 0;
+
+                if (data[offset] == DELTA_COPY)
+                {
+                    state = COPY_SEEK;
+                }
+                else if (data[offset] == DELTA_ADD)
+                {
+                    state = ADD_LENGTH;
+                }
+                else
+                {
+                    fail("unknown operation");
+                }
+
+                offset++;
+                break;
+
+            case COPY_SEEK:
+                if (read_varint(data[offset++], complete) && complete)
+                {
+                    seek = delta_unzigzag(varint);
+                    varint = 0;
+                    varint_shift = 0;
+                    state = COPY_LENGTH;
+                }
+                break;
+
+            case COPY_LENGTH:
+                if (read_varint(data[offset++], complete) && complete)
+                {
+                    remaining = varint;
+                    state = copy() ? OPERATION : FAILED;
+                }
+                break;
+
+            case ADD_LENGTH:
+                if (read_varint(data[offset++], complete) && complete)
+                {
+                    remaining = varint;
+                    state = (remaining > 0) ? ADD_DATA : OPERATION;
+                }
+                break;
+
+            case ADD_DATA:
+            {
+                size_t length = size - offset;
+                length = (length < remaining) ? length : remaining;
+
+                if (emit(data + offset, length))
+                {
+                    offset += length;
+                    remaining -= static_cast<uint32_t>(length);
+                    state = (remaining > 0) ? ADD_DATA : OPERATION;
+                }
+                break;
+            }
+
+            case FAILED:
+                break;
+        }
+    }
+
+    return (state != FAILED);
+}
+
+
+/*!
+ * @brief
+ *   Check that the whole patch was applied and the new image is right.
+ *
+ * @return
+ *   True if the new image is complete with the CRC of the header, false
+ *   otherwise.
+ */
+bool DeltaPatcher::finish()
+{
+    if (state == FAILED)
+    {
+        return false;
+    }
+
+    if ((state != OPERATION) || (new_size != header.new_size))
+    {
+        return fail("patch truncated");
+    }
+
+    if (new_crc != header.new_crc)
+    {
+        return fail("new image CRC mismatch");
+    }
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Get header of the patch, valid after the first DELTA_HEADER_SIZE bytes.
+ */
+const DeltaHeader &DeltaPatcher::patch_header() const
+{
+    return header;
+}
+
+
+/*!
+ * @brief
+ *   Get number of bytes written to the new image.
+ */
+uint32_t DeltaPatcher::written() const
+{
+    return new_size;
+}
+
+
+/*!
+ * @brief
+ *   Get reason of failure, nullptr if not failed.
+ */
+const char *DeltaPatcher::error() const
+{
+    return failure;
+}
+
+
+/*!
+ * @brief
+ *   Check the header and the old image, and begin the new image. Reading
+ *   the whole old image costs a flash read of it, but a patch for another
+ *   image would write garbage.
+ *
+ * @return
+ *   True if the patch is for the old image, false otherwise.
+ */
+bool DeltaPatcher::start()
+{
+    if (!delta_decode_header(header_data, header))
+    {
+        return fail("not a delta patch");
+    }
+
+    uint32_t crc = 0;
+
+    for (uint32_t offset = 0; offset < header.old_size; offset += BUFFER_SIZE)
+    {
+        size_t length = header.old_size - offset;
+        length = (length < BUFFER_SIZE) ? length : BUFFER_SIZE;
+
+        if (!source.read(offset, buffer, length))
+        {
+            return fail("cannot read old image");
+        }
+
+        crc = delta_crc32(crc, buffer, length);
+    }
+
+    if (crc != header.old_crc)
+    {
+        return fail("patch is for another image");
+    }
+
+    if (!sink.begin(header.new_size))
+    {
+        return fail("new image does not fit");
+    }
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Copy remaining bytes from the old image at the old cursor moved by
+ *   seek, through the buffer.
+ *
+ * @return
+ *   True if copied, false otherwise.
+ */
+bool DeltaPatcher::copy()
+{
+    int64_t from = static_cast<int64_t>(old_cursor) + seek;
+
+    if ((from < 0) || (from + remaining > header.old_size))
+    {
+        return fail("copy outside old image");
+    }
+
+    old_cursor = static_cast<uint32_t>(from);
+
+    while (remaining > 0)
+    {
+        size_t length = (remaining < BUFFER_SIZE) ? remaining : BUFFER_SIZE;
+
+        if (!source.read(old_cursor, buffer, length))
+        {
+            return fail("cannot read old image");
+        }
+
+        if (!emit(buffer, length))
+        {
+            return false;
+        }
+
+        old_cursor += static_cast<uint32_t>(length);
+        remaining -= static_cast<uint32_t>(length);
+    }
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Write bytes to the new image.
+ *
+ * @param data (IN)
+ *   Bytes of the new image.
+ *
+ * @param size (IN)
+ *   Number of bytes.
+ *
+ * @return
+ *   True if written, false otherwise.
+ */
+bool DeltaPatcher::emit(const uint8_t *data, size_t size)
+{
+    if (size > header.new_size - new_size)
+    {
+        return fail("new image too long");
+    }
+
+    if (!sink.write(data, size))
+    {
+        return fail("cannot write new image");
+    }
+
+    new_crc = delta_crc32(new_crc, data, size);
+    new_size += static_cast<uint32_t>(size);
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Add a byte to the varint being read.
+ *
+ * @param byte (IN)
+ *   Patch byte.
+ *
+ * @param complete (OUT)
+ *   True if the byte was the last one of the varint.
+ *
+ * @return
+ *   True if the varint is valid so far, false otherwise.
+ */
+bool DeltaPatcher::read_varint(uint8_t byte, bool &complete)
+{
+    if (varint_shift >= static_cast<int>(7 * DELTA_MAX_VARINT_SIZE))
+    {
+        return fail("varint too long");
+    }
+
+    varint |= static_cast<uint32_t>(byte & 0x7F) << varint_shift;
+    varint_shift += 7;
+    complete = ((byte & 0x80) == 0);
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Stop applying the patch.
+ *
+ * @param message (IN)
+ *   Reason.
+ *
+ * @return
+ *   False.
+ */
+bool DeltaPatcher::fail(const char *message)
+{
+    state = FAILED;
+    failure = message;
+
+    return false;
+}
@@ -0,0 +1,84 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Delta patch format for firmware updates over the air.
+ *
+ * A patch rebuilds a new firmware image from the old one, which the
+ * station already has in its running partition. Most of a new image is
+ * old code at the same or a shifted position, so a patch is a list of
+ * copies from the old image and the bytes that are new:
+ *
+ *   header   "WSD1", old size, old CRC-32, new size, new CRC-32 (u32 LE)
+ *   COPY     0x01, varint zigzag seek, varint length
+ *            Copy length bytes from the old image at the old cursor moved
+ *            by seek, and leave the cursor after them.
+ *   ADD      0x02, varint length, length bytes
+ *            Append the bytes to the new image.
+ *
+ * The new image is written in order and the old image is only read, so a
+ * patch is applied while it streams in, with one small buffer. The header
+ * CRCs check that the patch is for the running image and that the result
+ * is the new image.
+ *
+ * No ESP-IDF dependencies, also built on the host.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*! Patch file magic */
+static const char DELTA_MAGIC[4] = {'W', 'S', 'D', '1'};
+
+/*! Size of the patch header */
+static const size_t DELTA_HEADER_SIZE = 20;
+
+/*! Operation codes */
+enum DeltaOp
+{
+    DELTA_COPY = 0x01,
+    DELTA_ADD = 0x02
+};
+
+/*! Longest varint of a 32-bit value */
+static const size_t DELTA_MAX_VARINT_SIZE = 5;
+
+/*! Patch header */
+struct DeltaHeader
+{
+    uint32_t old_size;
+    uint32_t old_crc;
+    uint32_t new_size;
+    uint32_t new_crc;
+};
+
+uint32_t delta_crc32(uint32_t crc, const uint8_t *data, size_t size);
+void delta_encode_header(const DeltaHeader &header, uint8_t *data);
+bool delta_decode_header(const uint8_t *data, DeltaHeader &header);
+void delta_append_varint(std::string &patch, uint32_t value);
+uint32_t delta_zigzag(int32_t value);
+int32_t delta_unzigzag(uint32_t value);
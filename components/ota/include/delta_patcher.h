@@ -0,0 +1,112 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Streaming delta patch applier, see delta_format.h.
+ *
+ * The patch is fed in pieces as it downloads. The old image is read and
+ * the new image written through small interfaces, the running and the
+ * update partition on the station and files or memory on the host. RAM use
+ * is the patcher object with its fixed copy buffer, whatever the sizes of
+ * the images and the patch.
+ *
+ * No ESP-IDF dependencies, also built on the host.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "delta_format.h"
+
+/*! Old image a patch is applied to */
+class DeltaSource
+{
+public:
+    virtual ~DeltaSource() {}
+
+    /*! Read size bytes at offset, true if read */
+    virtual bool read(uint32_t offset, uint8_t *data, size_t size) = 0;
+};
+
+/*! New image a patch writes */
+class DeltaSink
+{
+public:
+    virtual ~DeltaSink() {}
+
+    /*! Prepare for an image of size bytes, true if it fits */
+    virtual bool begin(uint32_t size) = 0;
+
+    /*! Append data to the image, true if written */
+    virtual bool write(const uint8_t *data, size_t size) = 0;
+};
+
+class DeltaPatcher
+{
+public:
+    DeltaPatcher(DeltaSource &old_image, DeltaSink &new_image);
+    bool feed(const uint8_t *data, size_t size);
+    bool finish();
+    const DeltaHeader &patch_header() const;
+    uint32_t written() const;
+    const char *error() const;
+
+    /*! Copy buffer, read from the old image and written to the new one */
+    static const size_t BUFFER_SIZE = 256;
+
+private:
+    enum State
+    {
+        HEADER,
+        OPERATION,
+        COPY_SEEK,
+        COPY_LENGTH,
+        ADD_LENGTH,
+        ADD_DATA,
+        FAILED
+    };
+
+    bool start();
+    bool copy();
+    bool emit(const uint8_t *data, size_t size);
+    bool read_varint(uint8_t byte, bool &complete);
+    bool fail(const char *message);
+
+    DeltaSource &source;
+    DeltaSink &sink;
+    State state;
+    const char *failure;
+    DeltaHeader header;
+    uint8_t header_data[DELTA_HEADER_SIZE];
+    size_t header_size;
+    uint32_t varint;
+    int varint_shift;
+    int32_t seek;
+    uint32_t remaining;
+    uint32_t old_cursor;
+    uint32_t new_size;
+    uint32_t new_crc;
+    uint8_t buffer[BUFFER_SIZE];
+};
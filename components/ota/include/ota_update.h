@@ -0,0 +1,58 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Firmware update over the air with delta patches, see delta_format.h.
+ *
+ * The server offers a firmware version in the station configuration. A
+ * station running an older version downloads the patch from its version
+ * and applies it while it downloads, from the running partition to the
+ * next OTA partition, and boots the new firmware. The project needs a
+ * partition table with two OTA partitions.
+ */
+
+#pragma once
+
+#include <string>
+
+class OtaUpdate
+{
+public:
+	OtaUpdate(int running_version);
+	~OtaUpdate();
+	bool wanted(int version) const;
+	bool apply(const std::string &base_url, int version);
+
+	/*! Attempts to update to a version before giving it up */
+	static const int MAX_ATTEMPTS = 3;
+
+	/*! Download buffer, with the patcher the RAM used by an update */
+	static const int DOWNLOAD_BUFFER_SIZE = 512;
+
+	/*! Download timeout */
+	static const int TIMEOUT_MS = 10000;
+
+private:
+	int running;
+};
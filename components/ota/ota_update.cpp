@@ -0,0 +1,202 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <cstdio>
+#include "esp_attr.h"
+#include "esp_http_client.h"
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "delta_patcher.h"
+#include "ota_update.h"
+
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+
+/*! Marks valid update attempts in RTC memory */
+static const uint32_t ATTEMPTS_MAGIC = 0x4F544131;
+
+/*! Failed update attempts of a version, kept over deep sleep */
+RTC_DATA_ATTR static uint32_t rtc_attempts_magic;
+RTC_DATA_ATTR static int rtc_attempts_version;
+RTC_DATA_ATTR static int rtc_attempts;
+
+/*! Download buffer, static to keep it off the main task stack */
+static uint8_t download_buffer[OtaUpdate::DOWNLOAD_BUFFER_SIZE];
+
+
+/*! Old image in the running partition */
+class PartitionSource : public DeltaSource
+{
+public:
+    PartitionSource(const esp_partition_t *running_partition) : partition(running_partition)
+    {
+    }
+
+    bool read(uint32_t offset, uint8_t *data, size_t size)
+    {
+        return (esp_partition_read(partition, offset, data, size) == ESP_OK);
+    }
+
+private:
+    const esp_partition_t *partition;
+};
+
+
+/*! New image in the update partition */
+class OtaSink : public DeltaSink
+{
+public:
+    OtaSink(const esp_partition_t *update_partition) : partition(update_partition), handle(0), begun(false)
+    {
+    }
+
+    bool begin(uint32_t size)
+    {
+        begun = (size <= partition->size) && (esp_ota_begin(partition, size, &handle) == ESP_OK);
+        return begun;
+    }
+
+    bool write(const uint8_t *data, size_t size)
+    {
+        return (esp_ota_write(handle, data, size) == ESP_OK);
+    }
+
+    bool end()
+    {
+        return begun && (esp_ota_end(handle) == ESP_OK);
+    }
+
+private:
+    const esp_partition_t *partition;
+    esp_ota_handle_t handle;
+    bool begun;
+};
+
+
+/*!
+ * @brief
+ *   OTA update class constructor.
+ *
+ * @param running_version (IN)
+ *   Version of the running firmware.
+ */
+OtaUpdate::OtaUpdate(int running_version) : running(running_version)
+{
+}
+
+
+/*!
+ * @brief
+ *   OTA update class destructor.
+ */
+OtaUpdate::~OtaUpdate()
+{
+}
+
+
+/*!
+ * @brief
+ *   Check if an offered version should be installed: it is newer than the
+ *   running one and has not failed MAX_ATTEMPTS times, so that a bad patch
+ *   does not keep the radio on at every wake.
+ *
+ * @param version (IN)
+ *   Offered firmware version.
+ *
+ * @return
+ *   True if the update should be tried, false otherwise.
+ */
+bool OtaUpdate::wanted(int version) const
+{
+    bool given_up = (rtc_attempts_magic == ATTEMPTS_MAGIC) && (rtc_attempts_version == version) &&
+                    (rtc_attempts >= MAX_ATTEMPTS);
+
+    return (version > running) && !given_up;
+}
+
+
+/*!
+ * @brief
+ *   Download the patch "<base URL>/<running version>-<version>.wsd" and
+ *   apply it to the next OTA partition as it downloads. The new image is
+ *   checked with the patch CRC and by esp_ota_end() before it is set to
+ *   boot. The caller restarts the station.
+ *
+ * @param base_url (IN)
+ *   Base URL of the patches.
+ *
+ * @param version (IN)
+ *   Firmware version to install.
+ *
+ * @return
+ *   True if the new firmware boots at the next restart, false otherwise.
+ */
+bool OtaUpdate::apply(const std::string &base_url, int version)
+{
+    const esp_partition_t *running_partition = esp_ota_get_running_partition();
+    const esp_partition_t *update_partition = esp_ota_get_next_update_partition(nullptr);
+
+    if ((running_partition == nullptr) || (update_partition == nullptr))
+    {
+        printf("No OTA partition for firmware %d\n", version);
+        return false;
+    }
+
+    if ((rtc_attempts_magic != ATTEMPTS_MAGIC) || (rtc_attempts_version != version))
+    {
+        rtc_attempts_magic = ATTEMPTS_MAGIC;
+        rtc_attempts_version = version;
+        rtc_attempts = 0;
+    }
+
+    rtc_attempts++;
+    std::string url = base_url + "/" + std::to_string(running) + "-" + std::to_string(version) + ".wsd";
+    esp_http_client_config_t config = {url.c_str()};
+    config.timeout_ms = TIMEOUT_MS;
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    bool ok = (esp_http_client_open(client, 0) == ESP_OK) && (esp_http_client_fetch_headers(client) >= 0) &&
+              (esp_http_client_get_status_code(client) == 200);
+
+    PartitionSource old_image(running_partition);
+    OtaSink new_image(update_partition);
+    DeltaPatcher patcher(old_image, new_image);
+    int read_len;
+
+    while (ok && ((read_len = esp_http_client_read(client, reinterpret_cast<char *>(download_buffer),
+                                                   sizeof(download_buffer))) > 0))
+    {
+        ok = patcher.feed(download_buffer, static_cast<size_t>(read_len));
+    }
+
+    ok = ok && (read_len == 0) && patcher.finish();
+    esp_http_client_cleanup(client);
+
+    // esp_ota_end() also releases the update, so it is called after a failure too
+    ok = new_image.end() && ok;
+    ok = ok && (esp_ota_set_boot_partition(update_partition) == ESP_OK);
+
+    printf("Firmware %d from %s: %s\n", version, url.c_str(),
+           ok ? "updated" : (patcher.error() != nullptr) ? patcher.error() : "failed");
+
+    return ok;
+}
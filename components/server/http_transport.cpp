@@ -0,0 +1,178 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <cstdlib>
+#include <strings.h>
+#include "http_transport.h"
+
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+
+
+/*!
+ * @brief
+ *   HTTP transport class constructor.
+ *
+ * @param get_address (IN)
+ *   Server address to get measurement interval.
+ *
+ * @param post_address (IN)
+ *   Server address to post sensor data.
+ *
+ * @param telemetry_address (IN)
+ *   Server address to post telemetry.
+ */
+HttpTransport::HttpTransport(const std::string &get_address, const std::string &post_address,
+                             const std::string &telemetry_address)
+    : interval_url(get_address), samples_url(post_address), telemetry_url(telemetry_address), client(nullptr)
+{
+}
+
+
+/*!
+ * @brief
+ *   HTTP transport class destructor.
+ */
+HttpTransport::~HttpTransport()
+{
+    close();
+}
+
+
+/*!
+ * @brief
+ *   HTTP connection event handler. Keeps the Retry-After header of an
+ *   overloaded server in the int given as user data.
+ *
+ * @param evt (IN)
+ *   HTTP client events data.
+ *
+ * @return
+ *   ESP32 error.
+ */
+static esp_err_t http_event_handler(esp_http_client_event_t *evt)
+{
+    if ((evt->event_id == HTTP_EVENT_ON_HEADER) && (strcasecmp(evt->header_key, "Retry-After") == 0))
+    {
+        *static_cast<int *>(evt->user_data) = atoi(evt->header_value);
+    }
+
+    return ESP_OK;
+}
+
+
+/*!
+ * @brief
+ *   Connect to server and get the interval file. Following requests reuse
+ *   the connection.
+ *
+ * @return
+ *   True if connected, false otherwise.
+ */
+bool HttpTransport::open()
+{
+    esp_http_client_config_t config = {interval_url.c_str()};
+    config.event_handler = http_event_handler;
+    config.user_data = &retry_after;
+    retry_after = 0;
+    client = esp_http_client_init(&config);
+    esp_http_client_perform(client);
+    traffic.round_trips++;
+    int status_code = esp_http_client_get_status_code(client);
+
+    if (status_code != HTTP_SERVICE_UNAVAILABLE)
+    {
+        retry_after = 0;
+    }
+
+    return (status_code == HTTP_OK);
+}
+
+
+/*!
+ * @brief
+ *   Disconnect from server.
+ */
+void HttpTransport::close()
+{
+    if (client != nullptr)
+    {
+        esp_http_client_cleanup(client);
+        client = nullptr;
+    }
+}
+
+
+/*!
+ * @brief
+ *   Get station configuration from the interval file got by open().
+ *   Text beyond READ_BUFFER_SIZE is ignored.
+ *
+ * @param config (OUT)
+ *   Configuration text.
+ *
+ * @return
+ *   True if reading succeeds, false otherwise.
+ */
+bool HttpTransport::get_config(std::string &config)
+{
+    int content_length = esp_http_client_get_content_length(client);
+    char buffer[READ_BUFFER_SIZE];
+    int read_len = esp_http_client_read(client, buffer,
+                                        (content_length < READ_BUFFER_SIZE) ? content_length : READ_BUFFER_SIZE - 1);
+    config.assign(buffer, (read_len > 0) ? read_len : 0);
+    traffic.bytes_received += (read_len > 0) ? read_len : 0;
+    int status_code = esp_http_client_get_status_code(client);
+
+    return (status_code == HTTP_OK);
+}
+
+
+/*!
+ * @brief
+ *   Post form data. Only the body is counted in the traffic, the client
+ *   does not tell the size of the headers.
+ *
+ * @param channel (IN)
+ *   Kind of data, selects the address.
+ *
+ * @param data (IN)
+ *   URL encoded form fields.
+ *
+ * @return
+ *   True if the server answers OK, false otherwise.
+ */
+bool HttpTransport::send(Channel channel, const std::string &data)
+{
+    const std::string &url = (channel == TELEMETRY) ? telemetry_url : samples_url;
+    esp_http_client_set_url(client, url.c_str());
+    esp_http_client_set_method(client, HTTP_METHOD_POST);
+    esp_http_client_set_post_field(client, data.c_str(), data.length());
+    esp_http_client_perform(client);
+    traffic.bytes_sent += data.length();
+    traffic.packets_sent++;
+    traffic.round_trips++;
+    int status_code = esp_http_client_get_status_code(client);
+
+    return (status_code == HTTP_OK);
+}
@@ -0,0 +1,56 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * HTTP backend with esp_http_client, compatible with the PHP server files:
+ * GET interval.txt and POST collect.php. Each request carries HTTP
+ * headers, and over HTTPS the connection costs a TLS handshake.
+ */
+
+#pragma once
+
+#include <string>
+#include "esp_http_client.h"
+#include "transport.h"
+
+class HttpTransport : public Transport
+{
+public:
+	HttpTransport(const std::string &get_address, const std::string &post_address,
+	              const std::string &telemetry_address);
+	~HttpTransport();
+	bool open();
+	void close();
+	bool get_config(std::string &config);
+	bool send(Channel channel, const std::string &data);
+
+private:
+	std::string interval_url;
+	std::string samples_url;
+	std::string telemetry_url;
+	esp_http_client_handle_t client;
+	static const int READ_BUFFER_SIZE = 256;
+	static const int HTTP_OK = 200;
+	static const int HTTP_SERVICE_UNAVAILABLE = 503;
+};
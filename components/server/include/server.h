@@ -24,25 +24,51 @@
 
 #pragma once
 
+#include <sstream>
 #include <string>
-#include "esp_http_client.h"
+#include "running_stats.h"
+#include "station_config.h"
+#include "swing_door.h"
+#include "telemetry.h"
+#include "transport.h"
 
 class Server
 {
 public:
-	Server(std::string server_get_address, std::string server_post_address);
+	Server(Transport &server_transport, std::string station_id);
 	~Server();
 	bool connect();
 	void disconnect();
 	bool get_interval(int &interval_min);
-	bool post_sensor_data(float temperature, int humidity);
+	bool get_config(StationConfig &config);
+	bool post_sensor_data(float temperature, int humidity, uint32_t sequence);
+	bool post_sensor_statistics(const RunningStats &temperature, const RunningStats &humidity, uint32_t sequence);
+	bool post_sensor_trend(const RunningStats &temperature, const RunningStats &humidity,
+	                       const SwingDoor &temperature_trend, const SwingDoor &humidity_trend, uint32_t sequence);
+	bool post_telemetry(const Telemetry &telemetry);
+	void set_station_id(const std::string &station_id);
+	void set_sequence_epoch(uint32_t epoch);
 
 private:
-	std::string get_address;
-	std::string post_address;
-    esp_http_client_handle_t client;
-	static const int READ_BUFFER_SIZE = 16;
-	static const int HTTP_OK = 200;
-	const std::string TEMPERATURE_ID = "Temperature=";
+	void write_statistics(std::stringstream &post_data, const RunningStats &temperature,
+	                      const RunningStats &humidity, uint32_t sequence);
+	void write_trend(std::stringstream &post_data, const SwingDoor &trend, int32_t end_s);
+
+	Transport &transport;
+	std::string station;
+	uint32_t sequence_epoch;
+	const std::string STATION_ID = "Station=";
+	const std::string TEMPERATURE_ID = "&Temperature=";
     const std::string HUMIDITY_ID = "&Humidity=";
+	const std::string SEQUENCE_ID = "&Sequence=";
+	const std::string EPOCH_ID = "&Epoch=";
+	const std::string SAMPLES_ID = "&Samples=";
+	const std::string TEMPERATURE_MIN_ID = "&TemperatureMin=";
+	const std::string TEMPERATURE_MAX_ID = "&TemperatureMax=";
+	const std::string TEMPERATURE_STD_ID = "&TemperatureStd=";
+	const std::string HUMIDITY_MIN_ID = "&HumidityMin=";
+	const std::string HUMIDITY_MAX_ID = "&HumidityMax=";
+	const std::string HUMIDITY_STD_ID = "&HumidityStd=";
+	const std::string TEMPERATURE_TREND_ID = "&TemperatureTrend=";
+	const std::string HUMIDITY_TREND_ID = "&HumidityTrend=";
 };
@@ -0,0 +1,64 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Station configuration from the server's interval.txt.
+ *
+ * The first line is the measurement interval in minutes, as always, so
+ * older stations keep reading the file. Further lines are "key value"
+ * settings that stations without them ignore:
+ *
+ *   10
+ *   offset -42
+ *   firmware 3 https://your.website.address/firmware
+ *
+ * "offset <seconds>" moves the next wake of the station by that much, so
+ * that the stations upload in their own phases of the interval instead of
+ * all at once. The collector sends it to each station, see
+ * collector/include/upload_schedule.h.
+ *
+ * "firmware <version> <base URL>" offers firmware <version> as delta
+ * patches "<base URL>/<from version>-<version>.wsd", see delta_format.h.
+ *
+ * No ESP-IDF dependencies, also built on the host.
+ */
+
+#pragma once
+
+#include <string>
+
+struct StationConfig
+{
+	/*! Measurement interval in minutes */
+	int interval_min;
+
+	/*! Seconds to move the next wake by, within half an interval */
+	int offset_s;
+
+	/*! Offered firmware version and base URL of its patches, 0 and empty if none */
+	int firmware_version;
+	std::string firmware_url;
+};
+
+void parse_station_config(const std::string &text, StationConfig &config);
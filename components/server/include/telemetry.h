@@ -0,0 +1,51 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Station telemetry: form fields describing the station rather than the
+ * weather, such as the radio use of a wake. The collector stores the fields
+ * as they are, so new telemetry needs no server changes.
+ *
+ * No ESP-IDF dependencies, also built on the host.
+ */
+
+#pragma once
+
+#include <string>
+
+class Telemetry
+{
+public:
+	Telemetry();
+	~Telemetry();
+	void add(const std::string &name, int value);
+	void add(const std::string &name, unsigned value);
+	void add(const std::string &name, float value, int decimals);
+	void add(const std::string &name, const std::string &value);
+	const std::string &fields() const;
+	bool empty() const;
+
+private:
+	std::string form;
+};
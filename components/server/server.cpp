@@ -25,29 +25,23 @@
 #include <string>
 #include <sstream>
 #include <iomanip>
-#include "freertos/FreeRTOS.h"
-#include "freertos/event_groups.h"
-#include "esp_http_client.h"
 #include "server.h"
 
-#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
-
 
 /*!
  * @brief
  *   Server class constructor.
  *
- * @param server_get_address (IN)
- *   Server address to get measurement interval.
+ * @param server_transport (IN)
+ *   Transport to the collector, see transport.h.
  *
- * @param server_post_address (IN)
- *   Server address to post temperature and humidity.
+ * @param station_id (IN)
+ *   Station ID posted with sensor data.
  */
-Server::Server(std::string server_get_address, std::string server_post_address)
+Server::Server(Transport &server_transport, std::string station_id) : transport(server_transport)
 {
-    get_address = server_get_address;
-    post_address = server_post_address;
-    client = nullptr;
+    station = station_id;
+    sequence_epoch = 0;
 }
 
 
@@ -60,22 +54,6 @@ Server::~Server()
 }
 
 
-/*!
- * @brief
- *   HTTP connection event handler.
- *
- * @param evt (IN)
- *   HTTP client events data.
- *
- * @return
- *   ESP32 error.
- */
-static esp_err_t http_event_handler(esp_http_client_event_t *evt)
-{
-    return ESP_OK;
-}
-
-
 /*!
  * @brief
  *   Connect to server.
@@ -85,13 +63,7 @@ static esp_err_t http_event_handler(esp_http_client_event_t *evt)
  */
 bool Server::connect()
 {
-    esp_http_client_config_t config = {get_address.c_str()};
-    config.event_handler = http_event_handler;
-    client = esp_http_client_init(&config);
-    esp_http_client_perform(client);
-    int status_code = esp_http_client_get_status_code(client);
-
-    return (status_code == HTTP_OK);
+    return transport.open();
 }
 
 
@@ -101,13 +73,13 @@ bool Server::connect()
  */
 void Server::disconnect()
 {
-    esp_http_client_cleanup(client);
+    transport.close();
 }
 
 
 /*!
  * @brief
- *   Get measurement interval from server file.
+ *   Get measurement interval from server.
  *
  * @param interval_min (OUT)
  *   Measurement interval in minutes.
@@ -117,20 +89,40 @@ void Server::disconnect()
  */
 bool Server::get_interval(int &interval_min)
 {
-    int content_length = esp_http_client_get_content_length(client);
-    char buffer[READ_BUFFER_SIZE];
-    int read_len = esp_http_client_read(client, buffer, content_length);
-    buffer[read_len] = 0;
-    interval_min = atoi(buffer);
-    int status_code = esp_http_client_get_status_code(client);
-
-    return (status_code == HTTP_OK);
+    StationConfig config;
+    bool ok = get_config(config);
+    interval_min = config.interval_min;
+
+    return ok;
+}
+
+
+/*!
+ * @brief
+ *   Get station configuration from server: measurement interval and
+ *   offered firmware.
+ *
+ * @param config (OUT)
+ *   Station configuration.
+ *
+ * @return
+ *   True if reading succeeds, false otherwise.
+ */
+bool Server::get_config(StationConfig &config)
+{
+    std::string text;
+    bool ok = transport.get_config(text);
+    parse_station_config(text, config);
+
+    return ok;
 }
 
 
 /*!
  * @brief
- *   Post sensor data to server.
+ *   Post sensor data to server with station ID and sample sequence number.
+ *   The server ignores a sample with an already received sequence number,
+ *   so a sample can be resent if the response to an earlier post is lost.
  *
  * @param temperature (IN)
  *   Temperature value to post.
@@ -138,20 +130,194 @@ bool Server::get_interval(int &interval_min)
  * @param humidity (IN)
  *   Humidity value to post.
  *
+ * @param sequence (IN)
+ *   Sample sequence number from Station::next_sequence().
+ *
  * @return
  *   True if posting succeeds, false otherwise.
  */
-bool Server::post_sensor_data(float temperature, int humidity)
+bool Server::post_sensor_data(float temperature, int humidity, uint32_t sequence)
 {
     std::stringstream post_data;
 	post_data << std::fixed << std::setprecision(1);
-    post_data << TEMPERATURE_ID << temperature << HUMIDITY_ID << humidity;
-    std::string data = post_data.str();
-    esp_http_client_set_url(client, post_address.c_str());
-    esp_http_client_set_method(client, HTTP_METHOD_POST);
-    esp_http_client_set_post_field(client, data.c_str(), data.length());
-    esp_http_client_perform(client);
-    int status_code = esp_http_client_get_status_code(client);
-
-    return (status_code == HTTP_OK);
+    post_data << STATION_ID << station << TEMPERATURE_ID << temperature << HUMIDITY_ID << humidity;
+    post_data << SEQUENCE_ID << sequence;
+
+    if (sequence_epoch != 0)
+    {
+        post_data << EPOCH_ID << sequence_epoch;
+    }
+
+    return transport.send(Transport::SAMPLES, post_data.str());
+}
+
+
+/*!
+ * @brief
+ *   Post statistics of a window of samples to server. The means are posted
+ *   as the sample, so the window is stored like a single measurement, and
+ *   the sample count, minimum, maximum and standard deviation as extra
+ *   fields.
+ *
+ * @param temperature (IN)
+ *   Temperature window.
+ *
+ * @param humidity (IN)
+ *   Humidity window.
+ *
+ * @param sequence (IN)
+ *   Sample sequence number from Station::next_sequence().
+ *
+ * @return
+ *   True if posting succeeds, false otherwise.
+ */
+bool Server::post_sensor_statistics(const RunningStats &temperature, const RunningStats &humidity,
+                                    uint32_t sequence)
+{
+    std::stringstream post_data;
+    write_statistics(post_data, temperature, humidity, sequence);
+
+    return transport.send(Transport::SAMPLES, post_data.str());
+}
+
+
+/*!
+ * @brief
+ *   Post statistics of a window of samples with the swing-door trends of
+ *   its temperatures and humidities, from which the collector stores the
+ *   samples instead of the means. The trends are posted as "age:value"
+ *   points in time order separated by commas, where age is the seconds
+ *   before the last sample of the window.
+ *
+ * @param temperature (IN)
+ *   Temperature window.
+ *
+ * @param humidity (IN)
+ *   Humidity window.
+ *
+ * @param temperature_trend (IN)
+ *   Finished trend of the window's temperatures.
+ *
+ * @param humidity_trend (IN)
+ *   Finished trend of the window's humidities.
+ *
+ * @param sequence (IN)
+ *   Sample sequence number from Station::next_sequence().
+ *
+ * @return
+ *   True if posting succeeds, false otherwise.
+ */
+bool Server::post_sensor_trend(const RunningStats &temperature, const RunningStats &humidity,
+                               const SwingDoor &temperature_trend, const SwingDoor &humidity_trend,
+                               uint32_t sequence)
+{
+    std::stringstream post_data;
+    write_statistics(post_data, temperature, humidity, sequence);
+    int32_t end_s = 0;
+
+    for (const SwingDoor *trend : {&temperature_trend, &humidity_trend})
+    {
+        if ((trend->count() > 0) && (trend->points()[trend->count() - 1].time_s > end_s))
+        {
+            end_s = trend->points()[trend->count() - 1].time_s;
+        }
+    }
+
+    post_data << std::setprecision(1) << TEMPERATURE_TREND_ID;
+    write_trend(post_data, temperature_trend, end_s);
+    post_data << HUMIDITY_TREND_ID;
+    write_trend(post_data, humidity_trend, end_s);
+
+    return transport.send(Transport::SAMPLES, post_data.str());
+}
+
+
+/*!
+ * @brief
+ *   Write station ID, window means as the sample, sequence number and the
+ *   sample count, minimum, maximum and standard deviation of a window.
+ */
+void Server::write_statistics(std::stringstream &post_data, const RunningStats &temperature,
+                              const RunningStats &humidity, uint32_t sequence)
+{
+    post_data << std::fixed << std::setprecision(1);
+    post_data << STATION_ID << station << TEMPERATURE_ID << temperature.mean() << HUMIDITY_ID
+              << static_cast<int>(humidity.mean() + 0.5f);
+    post_data << SEQUENCE_ID << sequence;
+
+    if (sequence_epoch != 0)
+    {
+        post_data << EPOCH_ID << sequence_epoch;
+    }
+
+    post_data << SAMPLES_ID << temperature.count();
+    post_data << TEMPERATURE_MIN_ID << temperature.min() << TEMPERATURE_MAX_ID << temperature.max();
+    post_data << HUMIDITY_MIN_ID << humidity.min() << HUMIDITY_MAX_ID << humidity.max();
+    post_data << std::setprecision(2) << TEMPERATURE_STD_ID << temperature.stddev() << HUMIDITY_STD_ID
+              << humidity.stddev();
+}
+
+
+/*!
+ * @brief
+ *   Write trend points as "age:value" separated by commas.
+ *
+ * @param post_data (IN/OUT)
+ *   Post data with the value precision set.
+ *
+ * @param trend (IN)
+ *   Finished trend.
+ *
+ * @param end_s (IN)
+ *   Time of age 0.
+ */
+void Server::write_trend(std::stringstream &post_data, const SwingDoor &trend, int32_t end_s)
+{
+    for (int i = 0; i < trend.count(); i++)
+    {
+        post_data << ((i > 0) ? "," : "") << (end_s - trend.points()[i].time_s) << ":" << trend.points()[i].value;
+    }
+}
+
+
+/*!
+ * @brief
+ *   Post station telemetry with station ID.
+ *
+ * @param telemetry (IN)
+ *   Telemetry fields.
+ *
+ * @return
+ *   True if posting succeeds, false otherwise.
+ */
+bool Server::post_telemetry(const Telemetry &telemetry)
+{
+    return transport.send(Transport::TELEMETRY, STATION_ID + station + telemetry.fields());
+}
+
+
+/*!
+ * @brief
+ *   Set station ID posted with following sensor data.
+ *   A station with several sensors posts each as its own station.
+ *
+ * @param station_id (IN)
+ *   Station ID.
+ */
+void Server::set_station_id(const std::string &station_id)
+{
+    station = station_id;
+}
+
+
+/*!
+ * @brief
+ *   Set epoch of the sequence counter posted with following sensor data.
+ *
+ * @param epoch (IN)
+ *   Epoch from Station::sequence_epoch(), 0 to post none.
+ */
+void Server::set_sequence_epoch(uint32_t epoch)
+{
+    sequence_epoch = epoch;
 }
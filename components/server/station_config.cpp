@@ -0,0 +1,70 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <cstdlib>
+#include <sstream>
+#include "station_config.h"
+
+
+/*!
+ * @brief
+ *   Parse station configuration. Unknown settings and malformed lines are
+ *   ignored, so new settings can be added without breaking stations.
+ *
+ * @param text (IN)
+ *   Contents of interval.txt.
+ *
+ * @param config (OUT)
+ *   Station configuration.
+ */
+void parse_station_config(const std::string &text, StationConfig &config)
+{
+    std::istringstream lines(text);
+    std::string line;
+    config.interval_min = atoi(text.c_str());
+    config.offset_s = 0;
+    config.firmware_version = 0;
+    config.firmware_url.clear();
+    std::getline(lines, line);
+
+    while (std::getline(lines, line))
+    {
+        std::istringstream fields(line);
+        std::string key;
+        int version = 0;
+        int offset_s = 0;
+        std::string url;
+        fields >> key;
+
+        if ((key == "firmware") && (fields >> version >> url) && (version > 0))
+        {
+            config.firmware_version = version;
+            config.firmware_url = url;
+        }
+        else if ((key == "offset") && (fields >> offset_s) && (2 * std::abs(offset_s) <= config.interval_min * 60))
+        {
+            config.offset_s = offset_s;
+        }
+    }
+}
@@ -0,0 +1,137 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <sstream>
+#include <iomanip>
+#include "telemetry.h"
+
+
+/*!
+ * @brief
+ *   Telemetry class constructor.
+ */
+Telemetry::Telemetry()
+{
+}
+
+
+/*!
+ * @brief
+ *   Telemetry class destructor.
+ */
+Telemetry::~Telemetry()
+{
+}
+
+
+/*!
+ * @brief
+ *   Add an integer field.
+ *
+ * @param name (IN)
+ *   Field name, letters and digits.
+ *
+ * @param value (IN)
+ *   Field value.
+ */
+void Telemetry::add(const std::string &name, int value)
+{
+    form += "&" + name + "=" + std::to_string(value);
+}
+
+
+/*!
+ * @brief
+ *   Add an unsigned integer field.
+ *
+ * @param name (IN)
+ *   Field name, letters and digits.
+ *
+ * @param value (IN)
+ *   Field value.
+ */
+void Telemetry::add(const std::string &name, unsigned value)
+{
+    form += "&" + name + "=" + std::to_string(value);
+}
+
+
+/*!
+ * @brief
+ *   Add a decimal field.
+ *
+ * @param name (IN)
+ *   Field name, letters and digits.
+ *
+ * @param value (IN)
+ *   Field value.
+ *
+ * @param decimals (IN)
+ *   Number of decimals posted.
+ */
+void Telemetry::add(const std::string &name, float value, int decimals)
+{
+    std::stringstream field;
+    field << std::fixed << std::setprecision(decimals) << "&" << name << "=" << value;
+    form += field.str();
+}
+
+
+/*!
+ * @brief
+ *   Add a text field.
+ *
+ * @param name (IN)
+ *   Field name, letters and digits.
+ *
+ * @param value (IN)
+ *   Field value, letters, digits, '.', '-' and '_'.
+ */
+void Telemetry::add(const std::string &name, const std::string &value)
+{
+    form += "&" + name + "=" + value;
+}
+
+
+/*!
+ * @brief
+ *   Get fields as URL encoded form data.
+ *
+ * @return
+ *   "&Name=value" for each field.
+ */
+const std::string &Telemetry::fields() const
+{
+    return form;
+}
+
+
+/*!
+ * @brief
+ *   Check if no fields have been added.
+ */
+bool Telemetry::empty() const
+{
+    return form.empty();
+}
@@ -24,17 +24,21 @@
 
 #include <limits.h>
 #include "unity.h"
+#include "http_transport.h"
 #include "server.h"
 
 
 static const std::string SERVER_ADDRESS = "https://your.website.address/";
 static const std::string GET_ADDRESS = SERVER_ADDRESS + "interval.txt";
 static const std::string POST_ADDRESS = SERVER_ADDRESS + "collect.php";
+static const std::string TELEMETRY_ADDRESS = SERVER_ADDRESS + "telemetry";
+static const std::string STATION_ID = "test";
 
 
  TEST_CASE("Connect to server", "[server]")
  {
-    Server server(GET_ADDRESS, POST_ADDRESS);
+    HttpTransport transport(GET_ADDRESS, POST_ADDRESS, TELEMETRY_ADDRESS);
+    Server server(transport, STATION_ID);
     TEST_ASSERT_EQUAL(true, server.connect());
 	server.disconnect();
  }
@@ -42,7 +46,8 @@ static const std::string POST_ADDRESS = SERVER_ADDRESS + "collect.php";
 
 TEST_CASE("Get measurement interval from server", "[server]")
 {
-    Server server(GET_ADDRESS, POST_ADDRESS);
+    HttpTransport transport(GET_ADDRESS, POST_ADDRESS, TELEMETRY_ADDRESS);
+    Server server(transport, STATION_ID);
 	server.connect();
     TEST_ASSERT_EQUAL(true, server.connect());
 	int interval;
@@ -54,8 +59,9 @@ TEST_CASE("Get measurement interval from server", "[server]")
 
 TEST_CASE("Post measurement data to server", "[server]")
 {
-    Server server(GET_ADDRESS, POST_ADDRESS);
+    HttpTransport transport(GET_ADDRESS, POST_ADDRESS, TELEMETRY_ADDRESS);
+    Server server(transport, STATION_ID);
     TEST_ASSERT_EQUAL(true, server.connect());
-    TEST_ASSERT_EQUAL(true, server.post_sensor_data(25, 40));
+    TEST_ASSERT_EQUAL(true, server.post_sensor_data(25, 40, 1));
 	server.disconnect();
 }
@@ -24,15 +24,21 @@
 
 #pragma once
 
+#include <cstdint>
+
 class Sleep
 {
 public:
     Sleep();
 	~Sleep();
-	void deep_sleep(int interval_min) const;
+	void start_interval();
+	void deep_sleep(int interval_min, int offset_s) const;
+	bool light_sleep(uint32_t time_ms) const;
 
 private:
 	uint64_t start_time_us;
     static const uint64_t MIN_TO_US = 60000000;
+    static const int64_t S_TO_US = 1000000;
     static const int TIME_TO_BOOT_US = 5600000;
+	static const uint64_t MIN_SLEEP_US = 1000000;
 };
@@ -22,19 +22,20 @@
  * SOFTWARE.
 */
 
-#include <soc/rtc.h>
+#include <algorithm>
+#include "esp_clk.h"
 #include "esp_sleep.h"
 #include "sleep.h"
 
 
 /*!
  * @brief
- *   Deep sleep class constructor.
- *   Gets boot time.
+ *   Sleep class constructor.
+ *   Gets boot time, which starts the first interval.
  */
 Sleep::Sleep()
 {
-    start_time_us = rtc_time_get();
+    start_time_us = esp_clk_rtc_time();
 }
 
 
@@ -47,17 +48,57 @@ Sleep::~Sleep()
 }
 
 
+/*!
+ * @brief
+ *   Start a new interval at the current time, for a station that stays
+ *   awake over several intervals.
+ */
+void Sleep::start_interval()
+{
+    start_time_us = esp_clk_rtc_time();
+}
+
+
 /*!
  * @brief
  *   Go to deep sleep for the given interval (reboots after this).
+ *   The interval is counted from boot or start_interval(), minus the time
+ *   to boot again.
  *
  * @param interval_min (IN)
  *   Time to deep sleep in minutes.
+ *
+ * @param offset_s (IN)
+ *   Seconds to add to the interval, negative to wake earlier. Moves the
+ *   wake to the upload phase given by the server, or is the time to retry
+ *   with a zero interval.
  */
-void Sleep::deep_sleep(int interval_min) const
+void Sleep::deep_sleep(int interval_min, int offset_s) const
 {
+    int64_t offset_us = S_TO_US * offset_s;
     uint64_t interval_us = MIN_TO_US * static_cast<uint64_t>(interval_min);
-    uint64_t sleep_time_us = interval_us - (rtc_time_get() - start_time_us) - TIME_TO_BOOT_US;
+    interval_us = (offset_us < 0) ? interval_us - std::min(interval_us, static_cast<uint64_t>(-offset_us))
+                                  : interval_us + static_cast<uint64_t>(offset_us);
+    uint64_t elapsed_us = esp_clk_rtc_time() - start_time_us + TIME_TO_BOOT_US;
+    uint64_t sleep_time_us = (interval_us > elapsed_us + MIN_SLEEP_US) ? interval_us - elapsed_us : MIN_SLEEP_US;
     esp_sleep_enable_timer_wakeup(sleep_time_us);
     esp_deep_sleep_start();
 };
+
+
+/*!
+ * @brief
+ *   Go to light sleep for the given time. CPU and RAM state are kept and
+ *   execution continues after the call. WiFi must be disconnected.
+ *
+ * @param time_ms (IN)
+ *   Time to light sleep in milliseconds.
+ *
+ * @return
+ *   True if slept, false if light sleep was rejected.
+ */
+bool Sleep::light_sleep(uint32_t time_ms) const
+{
+    esp_sleep_enable_timer_wakeup(static_cast<uint64_t>(time_ms) * 1000);
+    return (esp_light_sleep_start() == ESP_OK);
+}
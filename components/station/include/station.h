@@ -0,0 +1,48 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+class Station
+{
+public:
+	Station();
+	~Station();
+	std::string get_id() const;
+	bool set_id(const std::string &id) const;
+	uint32_t next_sequence() const;
+	uint32_t sequence_epoch() const;
+
+	/*! Longest station ID the collector accepts */
+	static const int COLLECTOR_ID_LENGTH = 32;
+
+	/*! Room for the "-<sensor number>" the other sensors add to the ID */
+	static const int SENSOR_SUFFIX_LENGTH = 3;
+
+	static const int MAX_ID_LENGTH = COLLECTOR_ID_LENGTH - SENSOR_SUFFIX_LENGTH;
+	static const uint32_t SEQUENCE_LEASE = 1000;
+};
@@ -0,0 +1,216 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <cctype>
+#include <cstdio>
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "nvs.h"
+#include "station.h"
+
+/*! NVS namespace of station settings */
+static const char NVS_NAMESPACE[] = "station";
+
+/*! NVS key of provisioned station ID */
+static const char NVS_ID_KEY[] = "id";
+
+/*! NVS key of the end of the sequence numbers leased to RTC memory */
+static const char NVS_SEQUENCE_KEY[] = "seq_lease";
+
+/*! NVS key of the epoch of the sequence counter */
+static const char NVS_EPOCH_KEY[] = "seq_epoch";
+
+/*! Last used sample sequence number, kept over deep sleep */
+RTC_DATA_ATTR static uint32_t rtc_sequence = 0;
+
+/*! End of sequence numbers that can be used without writing NVS */
+RTC_DATA_ATTR static uint32_t rtc_sequence_lease_end = 0;
+
+/*! Epoch of the sequence counter, read with the lease */
+RTC_DATA_ATTR static uint32_t rtc_sequence_epoch = 0;
+
+
+/*!
+ * @brief
+ *   Station identity class constructor.
+ */
+Station::Station()
+{
+}
+
+
+/*!
+ * @brief
+ *   Station identity class destructor.
+ */
+Station::~Station()
+{
+}
+
+
+/*!
+ * @brief
+ *   Get station ID sent with sensor data.
+ *   Uses the ID provisioned in NVS, or the WiFi MAC address as 12 hex digits
+ *   if no ID is provisioned. NVS must be initialized before this.
+ *
+ * @return
+ *   Station ID.
+ */
+std::string Station::get_id() const
+{
+    char id[COLLECTOR_ID_LENGTH + 1];
+    size_t length = sizeof(id);
+    nvs_handle handle;
+
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK)
+    {
+        esp_err_t err = nvs_get_str(handle, NVS_ID_KEY, id, &length);
+        nvs_close(handle);
+
+        if ((err == ESP_OK) && (length > 1))
+        {
+            return id;
+        }
+    }
+
+    uint8_t mac[6];
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+    snprintf(id, sizeof(id), "%02x%02x%02x%02x%02x%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+
+    return id;
+}
+
+
+/*!
+ * @brief
+ *   Provision station ID to NVS.
+ *   The collector accepts letters, digits, '-' and '_' in station IDs of
+ *   at most COLLECTOR_ID_LENGTH characters, which the ID must also fit with
+ *   the sensor number suffix of the other sensors.
+ *
+ * @param id (IN)
+ *   Station ID, at most MAX_ID_LENGTH characters. Empty ID returns to the
+ *   MAC address.
+ *
+ * @return
+ *   True if stored, false if the collector would not accept the ID or it
+ *   could not be stored.
+ */
+bool Station::set_id(const std::string &id) const
+{
+    if (id.length() > MAX_ID_LENGTH)
+    {
+        return false;
+    }
+
+    for (char c : id)
+    {
+        if (!isalnum(static_cast<unsigned char>(c)) && (c != '-') && (c != '_'))
+        {
+            return false;
+        }
+    }
+
+    nvs_handle handle;
+
+    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK)
+    {
+        return false;
+    }
+
+    esp_err_t err = id.empty() ? nvs_erase_key(handle, NVS_ID_KEY) : nvs_set_str(handle, NVS_ID_KEY, id.c_str());
+
+    if ((err == ESP_OK) || (err == ESP_ERR_NVS_NOT_FOUND))
+    {
+        err = nvs_commit(handle);
+    }
+
+    nvs_close(handle);
+
+    return (err == ESP_OK);
+}
+
+
+/*!
+ * @brief
+ *   Get next sample sequence number.
+ *   Sequence numbers increase over deep sleep and power loss. The counter is
+ *   kept in RTC memory and NVS is written only once per SEQUENCE_LEASE
+ *   samples: NVS holds the end of the numbers leased to RTC memory, and after
+ *   power loss numbering continues from there. A counter that starts from
+ *   scratch, after NVS is erased or on a new unit, gets a new random epoch.
+ *
+ * @return
+ *   Sequence number, starting from 1.
+ */
+uint32_t Station::next_sequence() const
+{
+    if (rtc_sequence >= rtc_sequence_lease_end)
+    {
+        uint32_t stored_lease_end = 0;
+        nvs_handle handle;
+
+        if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle) == ESP_OK)
+        {
+            nvs_get_u32(handle, NVS_SEQUENCE_KEY, &stored_lease_end);
+
+            if ((nvs_get_u32(handle, NVS_EPOCH_KEY, &rtc_sequence_epoch) != ESP_OK) || (rtc_sequence_epoch == 0))
+            {
+                // 0 means no epoch to the collector
+                rtc_sequence_epoch = esp_random() | 1;
+                nvs_set_u32(handle, NVS_EPOCH_KEY, rtc_sequence_epoch);
+            }
+
+            // RTC memory is cleared on power loss, continue after the last lease
+            if (rtc_sequence < stored_lease_end)
+            {
+                rtc_sequence = stored_lease_end;
+            }
+
+            rtc_sequence_lease_end = rtc_sequence + SEQUENCE_LEASE;
+            nvs_set_u32(handle, NVS_SEQUENCE_KEY, rtc_sequence_lease_end);
+            nvs_commit(handle);
+            nvs_close(handle);
+        }
+    }
+
+    return ++rtc_sequence;
+}
+
+
+/*!
+ * @brief
+ *   Get epoch of the sequence counter.
+ *   The collector starts its duplicate detection of the station again when
+ *   the epoch changes, so the numbers of a new counter are not taken for
+ *   resent samples.
+ *
+ * @return
+ *   Epoch, 0 before the first next_sequence().
+ */
+uint32_t Station::sequence_epoch() const
+{
+    return rtc_sequence_epoch;
+}
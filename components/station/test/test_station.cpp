@@ -0,0 +1,78 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <limits.h>
+#include "unity.h"
+#include "nvs_flash.h"
+#include "station.h"
+
+
+TEST_CASE("Station ID defaults to MAC address", "[station]")
+{
+    nvs_flash_init();
+    Station station;
+    TEST_ASSERT_EQUAL(true, station.set_id(""));
+    std::string id = station.get_id();
+    TEST_ASSERT_EQUAL(12, id.length());
+    TEST_ASSERT_EQUAL(std::string::npos, id.find_first_not_of("0123456789abcdef"));
+}
+
+
+TEST_CASE("Provisioned station ID", "[station]")
+{
+    nvs_flash_init();
+    Station station;
+    TEST_ASSERT_EQUAL(true, station.set_id("attic"));
+    TEST_ASSERT_EQUAL(true, station.get_id() == "attic");
+    TEST_ASSERT_EQUAL(true, station.set_id(""));
+}
+
+
+TEST_CASE("Station ID the collector would reject is not stored", "[station]")
+{
+    nvs_flash_init();
+    Station station;
+    TEST_ASSERT_EQUAL(true, station.set_id("attic"));
+    TEST_ASSERT_EQUAL(false, station.set_id("attic room"));
+    TEST_ASSERT_EQUAL(false, station.set_id("../attic"));
+
+    // Room is left for the "-<sensor number>" of the other sensors
+    TEST_ASSERT_EQUAL(true, station.set_id(std::string(Station::MAX_ID_LENGTH, 'a')));
+    TEST_ASSERT_EQUAL(false, station.set_id(std::string(Station::MAX_ID_LENGTH + 1, 'a')));
+    TEST_ASSERT_EQUAL(true, station.set_id(""));
+}
+
+
+TEST_CASE("Sequence numbers increase", "[station]")
+{
+    nvs_flash_init();
+    Station station;
+    uint32_t first = station.next_sequence();
+    TEST_ASSERT_EQUAL(true, first > 0);
+
+    for (uint32_t i = 1; i <= Station::SEQUENCE_LEASE; i++)
+    {
+        TEST_ASSERT_EQUAL(first + i, station.next_sequence());
+    }
+}
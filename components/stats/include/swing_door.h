@@ -0,0 +1,85 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Swing-door trend compression of a series of samples.
+ *
+ * Most samples of a slowly changing temperature or humidity lie on a
+ * straight line within the sensor's accuracy. The compressor keeps only the
+ * points where the trend turns: from the last kept point it narrows the
+ * range of slopes of lines that pass within the deviation of every sample
+ * since, the doors, and keeps a point when a sample closes them. The kept
+ * point is on the last line that fitted, at the time of the sample before,
+ * so linear interpolation between kept points is within the deviation of
+ * every sample, not only of the kept ones.
+ *
+ * Points are kept in a fixed array so the compressor can run in a light
+ * sleep window without the heap. No ESP-IDF dependencies, also built on
+ * the host and in the collector, which reconstructs the series with
+ * trend_value().
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/*! Point of a piecewise linear trend */
+struct TrendPoint
+{
+    /*! Time in seconds from any fixed origin */
+    int32_t time_s;
+
+    /*! Value at the time */
+    float value;
+};
+
+class SwingDoor
+{
+public:
+    SwingDoor();
+    void start(float deviation);
+    bool add(int32_t time_s, float value);
+    void finish();
+    bool complete() const;
+    int count() const;
+    const TrendPoint *points() const;
+
+    /*! Maximum number of kept points, a 15 minute light sleep window of
+     *  samples at 30 s with room for an upload offset */
+    static const int MAX_POINTS = 40;
+
+private:
+    void keep(int32_t time_s, float value);
+
+    float max_deviation;
+    TrendPoint kept[MAX_POINTS];
+    int kept_count;
+    bool overflow;
+    TrendPoint last;
+    bool open;
+    float slope_min;
+    float slope_max;
+};
+
+float trend_value(const TrendPoint *points, int count, int32_t time_s);
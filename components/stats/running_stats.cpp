@@ -0,0 +1,138 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <cmath>
+#include "running_stats.h"
+
+
+/*!
+ * @brief
+ *   Running statistics class constructor.
+ */
+RunningStats::RunningStats()
+{
+    clear();
+}
+
+
+/*!
+ * @brief
+ *   Start a new window.
+ */
+void RunningStats::clear()
+{
+    samples = 0;
+    minimum = 0.0f;
+    maximum = 0.0f;
+    average = 0.0f;
+    squares = 0.0f;
+}
+
+
+/*!
+ * @brief
+ *   Add a sample to the window.
+ *
+ * @param value (IN)
+ *   Sample value.
+ */
+void RunningStats::add(float value)
+{
+    samples++;
+
+    if (samples == 1)
+    {
+        minimum = value;
+        maximum = value;
+    }
+    else
+    {
+        minimum = (value < minimum) ? value : minimum;
+        maximum = (value > maximum) ? value : maximum;
+    }
+
+    float delta = value - average;
+    average += delta / static_cast<float>(samples);
+    squares += delta * (value - average);
+}
+
+
+/*!
+ * @brief
+ *   Get number of samples in the window.
+ */
+uint32_t RunningStats::count() const
+{
+    return samples;
+}
+
+
+/*!
+ * @brief
+ *   Get smallest sample, 0 for an empty window.
+ */
+float RunningStats::min() const
+{
+    return minimum;
+}
+
+
+/*!
+ * @brief
+ *   Get largest sample, 0 for an empty window.
+ */
+float RunningStats::max() const
+{
+    return maximum;
+}
+
+
+/*!
+ * @brief
+ *   Get mean of samples, 0 for an empty window.
+ */
+float RunningStats::mean() const
+{
+    return average;
+}
+
+
+/*!
+ * @brief
+ *   Get sample variance, 0 for less than two samples.
+ */
+float RunningStats::variance() const
+{
+    return (samples > 1) ? squares / static_cast<float>(samples - 1) : 0.0f;
+}
+
+
+/*!
+ * @brief
+ *   Get sample standard deviation, 0 for less than two samples.
+ */
+float RunningStats::stddev() const
+{
+    return sqrtf(variance());
+}
@@ -0,0 +1,223 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include "swing_door.h"
+
+
+/*!
+ * @brief
+ *   Swing-door compressor class constructor.
+ *   The compressor keeps every sample until started with a deviation.
+ */
+SwingDoor::SwingDoor()
+{
+    start(0.0f);
+}
+
+
+/*!
+ * @brief
+ *   Start a new series.
+ *
+ * @param deviation (IN)
+ *   Largest distance of a sample from the trend.
+ */
+void SwingDoor::start(float deviation)
+{
+    max_deviation = deviation;
+    kept_count = 0;
+    overflow = false;
+    open = false;
+    slope_min = 0.0f;
+    slope_max = 0.0f;
+    last.time_s = 0;
+    last.value = 0.0f;
+}
+
+
+/*!
+ * @brief
+ *   Add a sample to the series.
+ *
+ * @param time_s (IN)
+ *   Sample time in seconds, later than the previous sample.
+ *
+ * @param value (IN)
+ *   Sample value.
+ *
+ * @return
+ *   False if the sample is not later than the previous one or a point did
+ *   not fit, true otherwise.
+ */
+bool SwingDoor::add(int32_t time_s, float value)
+{
+    if (kept_count == 0)
+    {
+        keep(time_s, value);
+        return !overflow;
+    }
+
+    const TrendPoint &anchor = kept[kept_count - 1];
+    int32_t previous_s = open ? last.time_s : anchor.time_s;
+
+    if (time_s <= previous_s)
+    {
+        return false;
+    }
+
+    float elapsed_s = static_cast<float>(time_s - anchor.time_s);
+    float low = (value - max_deviation - anchor.value) / elapsed_s;
+    float high = (value + max_deviation - anchor.value) / elapsed_s;
+
+    if (open)
+    {
+        low = (low > slope_min) ? low : slope_min;
+        high = (high < slope_max) ? high : slope_max;
+
+        if (low > high)
+        {
+            // The doors closed: end the trend at the previous sample
+            finish();
+            return add(time_s, value);
+        }
+    }
+
+    slope_min = low;
+    slope_max = high;
+    last.time_s = time_s;
+    last.value = value;
+    open = true;
+
+    return !overflow;
+}
+
+
+/*!
+ * @brief
+ *   End the series with a point at the last sample.
+ *   The point is on the line within the doors nearest to the sample.
+ */
+void SwingDoor::finish()
+{
+    if (!open)
+    {
+        return;
+    }
+
+    const TrendPoint &anchor = kept[kept_count - 1];
+    float elapsed_s = static_cast<float>(last.time_s - anchor.time_s);
+    float slope = (last.value - anchor.value) / elapsed_s;
+    slope = (slope < slope_min) ? slope_min : ((slope > slope_max) ? slope_max : slope);
+    open = false;
+    keep(last.time_s, anchor.value + slope * elapsed_s);
+}
+
+
+/*!
+ * @brief
+ *   Check that all points fitted in MAX_POINTS.
+ */
+bool SwingDoor::complete() const
+{
+    return !overflow;
+}
+
+
+/*!
+ * @brief
+ *   Get number of kept points. A finished series of samples ends with a
+ *   point at the last sample.
+ */
+int SwingDoor::count() const
+{
+    return kept_count;
+}
+
+
+/*!
+ * @brief
+ *   Get kept points in time order.
+ */
+const TrendPoint *SwingDoor::points() const
+{
+    return kept;
+}
+
+
+/*!
+ * @brief
+ *   Keep a point, or mark the series incomplete if it does not fit.
+ */
+void SwingDoor::keep(int32_t time_s, float value)
+{
+    if (kept_count == MAX_POINTS)
+    {
+        overflow = true;
+        return;
+    }
+
+    kept[kept_count].time_s = time_s;
+    kept[kept_count].value = value;
+    kept_count++;
+}
+
+
+/*!
+ * @brief
+ *   Get value of a piecewise linear trend.
+ *
+ * @param points (IN)
+ *   Points of the trend in time order.
+ *
+ * @param count (IN)
+ *   Number of points, at least one.
+ *
+ * @param time_s (IN)
+ *   Time in seconds.
+ *
+ * @return
+ *   Value interpolated between the points around the time, or the value of
+ *   the first or last point outside them.
+ */
+float trend_value(const TrendPoint *points, int count, int32_t time_s)
+{
+    if (time_s <= points[0].time_s)
+    {
+        return points[0].value;
+    }
+
+    for (int i = 1; i < count; i++)
+    {
+        if (time_s <= points[i].time_s)
+        {
+            const TrendPoint &before = points[i - 1];
+            float fraction = static_cast<float>(time_s - before.time_s) /
+                             static_cast<float>(points[i].time_s - before.time_s);
+
+            return before.value + (points[i].value - before.value) * fraction;
+        }
+    }
+
+    return points[count - 1].value;
+}
@@ -0,0 +1,270 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include "coap_codec.h"
+
+/*! Marks the start of payload */
+static const uint8_t PAYLOAD_MARKER = 0xFF;
+
+
+/*!
+ * @brief
+ *   Append an option delta or length nibble and its extended bytes.
+ *
+ * @param value (IN)
+ *   Delta or length.
+ *
+ * @param nibble (OUT)
+ *   Value for the option header nibble.
+ *
+ * @param extended (OUT)
+ *   Extended bytes are appended here.
+ */
+static void encode_option_value(size_t value, uint8_t &nibble, std::string &extended)
+{
+    if (value < 13)
+    {
+        nibble = static_cast<uint8_t>(value);
+    }
+    else if (value < 269)
+    {
+        nibble = 13;
+        extended += static_cast<char>(value - 13);
+    }
+    else
+    {
+        nibble = 14;
+        extended += static_cast<char>((value - 269) >> 8);
+        extended += static_cast<char>((value - 269) & 0xFF);
+    }
+}
+
+
+/*!
+ * @brief
+ *   Read extended option delta or length.
+ *
+ * @param data (IN)
+ *   Message.
+ *
+ * @param offset (IN/OUT)
+ *   Position of extended bytes, moved past them.
+ *
+ * @param value (IN/OUT)
+ *   Nibble value, replaced with the full value.
+ *
+ * @return
+ *   True if valid, false otherwise.
+ */
+static bool decode_option_value(const std::string &data, size_t &offset, size_t &value)
+{
+    if (value == 13)
+    {
+        if (offset + 1 > data.size())
+        {
+            return false;
+        }
+
+        value = 13 + static_cast<uint8_t>(data[offset++]);
+    }
+    else if (value == 14)
+    {
+        if (offset + 2 > data.size())
+        {
+            return false;
+        }
+
+        value = 269 + ((static_cast<uint8_t>(data[offset]) << 8) | static_cast<uint8_t>(data[offset + 1]));
+        offset += 2;
+    }
+
+    return (value != 15);
+}
+
+
+/*!
+ * @brief
+ *   Append options with the same number.
+ *
+ * @param number (IN)
+ *   Option number, not less than the previous one.
+ *
+ * @param values (IN)
+ *   Option values.
+ *
+ * @param previous (IN/OUT)
+ *   Number of the previous option.
+ *
+ * @param data (IN/OUT)
+ *   Options are appended here.
+ */
+static void encode_options(int number, const std::vector<std::string> &values, int &previous, std::string &data)
+{
+    for (const std::string &value : values)
+    {
+        uint8_t delta;
+        uint8_t length;
+        std::string extended;
+        encode_option_value(static_cast<size_t>(number - previous), delta, extended);
+        encode_option_value(value.size(), length, extended);
+        data += static_cast<char>((delta << 4) | length);
+        data += extended + value;
+        previous = number;
+    }
+}
+
+
+/*!
+ * @brief
+ *   Encode message.
+ *
+ * @param message (IN)
+ *   Message with at most COAP_MAX_TOKEN_LENGTH bytes of token.
+ *
+ * @return
+ *   Datagram.
+ */
+std::string coap_encode(const CoapMessage &message)
+{
+    std::string data;
+    data += static_cast<char>(0x40 | (message.type << 4) | message.token.size());
+    data += static_cast<char>(message.code);
+    data += static_cast<char>(message.message_id >> 8);
+    data += static_cast<char>(message.message_id & 0xFF);
+    data += message.token;
+    int previous = 0;
+    std::string max_age;
+
+    // Unsigned integer option in as few bytes as needed
+    for (uint32_t value = message.max_age; value > 0; value >>= 8)
+    {
+        max_age.insert(max_age.begin(), static_cast<char>(value & 0xFF));
+    }
+
+    encode_options(COAP_URI_PATH, message.uri_path, previous, data);
+    encode_options(COAP_MAX_AGE, max_age.empty() ? std::vector<std::string>() : std::vector<std::string>{max_age},
+                   previous, data);
+    encode_options(COAP_URI_QUERY, message.uri_query, previous, data);
+
+    if (!message.payload.empty())
+    {
+        data += static_cast<char>(PAYLOAD_MARKER);
+        data += message.payload;
+    }
+
+    return data;
+}
+
+
+/*!
+ * @brief
+ *   Decode message. Options other than Uri-Path and Uri-Query are skipped.
+ *
+ * @param data (IN)
+ *   Datagram.
+ *
+ * @param message (OUT)
+ *   Message.
+ *
+ * @return
+ *   True if a valid CoAP version 1 message, false otherwise.
+ */
+bool coap_decode(const std::string &data, CoapMessage &message)
+{
+    if (data.size() < 4)
+    {
+        return false;
+    }
+
+    uint8_t first = static_cast<uint8_t>(data[0]);
+    size_t token_length = first & 0x0F;
+
+    if (((first >> 6) != 1) || (token_length > COAP_MAX_TOKEN_LENGTH) || (4 + token_length > data.size()))
+    {
+        return false;
+    }
+
+    message.type = (first >> 4) & 0x03;
+    message.code = static_cast<uint8_t>(data[1]);
+    message.message_id = static_cast<uint16_t>((static_cast<uint8_t>(data[2]) << 8) | static_cast<uint8_t>(data[3]));
+    message.token = data.substr(4, token_length);
+    message.uri_path.clear();
+    message.uri_query.clear();
+    message.max_age = 0;
+    message.payload.clear();
+    size_t offset = 4 + token_length;
+    size_t option = 0;
+
+    while (offset < data.size())
+    {
+        uint8_t header = static_cast<uint8_t>(data[offset++]);
+
+        if (header == PAYLOAD_MARKER)
+        {
+            message.payload = data.substr(offset);
+            return (offset < data.size());
+        }
+
+        size_t delta = header >> 4;
+        size_t length = header & 0x0F;
+
+        if (!decode_option_value(data, offset, delta) || !decode_option_value(data, offset, length) ||
+            (offset + length > data.size()))
+        {
+            return false;
+        }
+
+        option += delta;
+
+        if (option == static_cast<size_t>(COAP_URI_PATH))
+        {
+            message.uri_path.push_back(data.substr(offset, length));
+        }
+        else if ((option == static_cast<size_t>(COAP_MAX_AGE)) && (length <= 4))
+        {
+            for (size_t i = 0; i < length; i++)
+            {
+                message.max_age = (message.max_age << 8) | static_cast<uint8_t>(data[offset + i]);
+            }
+        }
+        else if (option == static_cast<size_t>(COAP_URI_QUERY))
+        {
+            message.uri_query.push_back(data.substr(offset, length));
+        }
+
+        offset += length;
+    }
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Check if a response code is a success, class 2.
+ */
+bool coap_success(uint8_t code)
+{
+    return ((code >> 5) == 2);
+}
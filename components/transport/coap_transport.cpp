@@ -0,0 +1,205 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include "coap_transport.h"
+
+const char *const CoapTransport::SAMPLES_PATH = "collect";
+const char *const CoapTransport::TELEMETRY_PATH = "telemetry";
+const char *const CoapTransport::INTERVAL_PATH = "interval";
+
+
+/*!
+ * @brief
+ *   CoAP transport class constructor.
+ *
+ * @param server_host (IN)
+ *   Host name or address of the collector.
+ *
+ * @param server_port (IN)
+ *   CoAP port, normally 5683.
+ *
+ * @param station_id (IN)
+ *   Station ID, sent with the interval request.
+ */
+CoapTransport::CoapTransport(const std::string &server_host, int server_port, const std::string &station_id)
+    : host(server_host), port(server_port), station(station_id), socket(traffic), message_id(0)
+{
+}
+
+
+/*!
+ * @brief
+ *   CoAP transport class destructor.
+ */
+CoapTransport::~CoapTransport()
+{
+    close();
+}
+
+
+/*!
+ * @brief
+ *   Open UDP socket to the collector. Nothing is sent.
+ *
+ * @return
+ *   True if the collector address was resolved, false otherwise.
+ */
+bool CoapTransport::open()
+{
+    return socket.open(host, port, true);
+}
+
+
+/*!
+ * @brief
+ *   Close UDP socket.
+ */
+void CoapTransport::close()
+{
+    socket.close();
+}
+
+
+/*!
+ * @brief
+ *   Get station configuration with GET INTERVAL_PATH?Station=<station ID>.
+ *
+ * @param config (OUT)
+ *   Configuration text.
+ *
+ * @return
+ *   True if got, false otherwise.
+ */
+bool CoapTransport::get_config(std::string &config)
+{
+    CoapMessage response;
+
+    if (!request(COAP_GET, INTERVAL_PATH, "Station=" + station, "", response) || (response.code != COAP_CONTENT) ||
+        response.payload.empty())
+    {
+        return false;
+    }
+
+    config = response.payload;
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Post form fields with a confirmable POST.
+ *
+ * @param channel (IN)
+ *   Kind of data, selects the resource.
+ *
+ * @param data (IN)
+ *   URL encoded form fields.
+ *
+ * @return
+ *   True if the collector answered with success, false otherwise.
+ */
+bool CoapTransport::send(Channel channel, const std::string &data)
+{
+    CoapMessage response;
+
+    return request(COAP_POST, (channel == TELEMETRY) ? TELEMETRY_PATH : SAMPLES_PATH, "", data, response) &&
+           coap_success(response.code);
+}
+
+
+/*!
+ * @brief
+ *   Send a confirmable request and wait for the piggybacked response with
+ *   the same message ID and token. The request is retransmitted after
+ *   ACK_TIMEOUT_MS, doubling, up to MAX_RETRANSMIT times. The collector
+ *   drops resent samples by their sequence number, so a retransmission of a
+ *   request that was stored is harmless.
+ *
+ * @param code (IN)
+ *   Request method.
+ *
+ * @param path (IN)
+ *   Resource.
+ *
+ * @param query (IN)
+ *   Query, empty for none.
+ *
+ * @param payload (IN)
+ *   Request payload.
+ *
+ * @param response (OUT)
+ *   Response.
+ *
+ * @return
+ *   True if a response was received, false otherwise.
+ */
+bool CoapTransport::request(uint8_t code, const char *path, const std::string &query, const std::string &payload,
+                            CoapMessage &response)
+{
+    CoapMessage message;
+    message.type = COAP_CONFIRMABLE;
+    message.code = code;
+    message.message_id = ++message_id;
+    message.token = std::string(1, static_cast<char>(message_id >> 8)) + static_cast<char>(message_id & 0xFF);
+    message.uri_path.push_back(path);
+    message.max_age = 0;
+
+    if (!query.empty())
+    {
+        message.uri_query.push_back(query);
+    }
+
+    message.payload = payload;
+    std::string datagram = coap_encode(message);
+    int timeout_ms = ACK_TIMEOUT_MS;
+
+    for (int n = 0; n <= MAX_RETRANSMIT; n++)
+    {
+        if (!socket.send(datagram))
+        {
+            return false;
+        }
+
+        traffic.round_trips++;
+        std::string received;
+
+        while (socket.receive(received, timeout_ms))
+        {
+            if (coap_decode(received, response) && (response.message_id == message.message_id) &&
+                (response.token == message.token))
+            {
+                retry_after = (response.code == COAP_SERVICE_UNAVAILABLE) ? static_cast<int>(response.max_age) : 0;
+
+                return (response.type == COAP_ACKNOWLEDGEMENT);
+            }
+
+            received.clear();
+        }
+
+        timeout_ms *= 2;
+    }
+
+    return false;
+}
@@ -0,0 +1,90 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * CoAP (RFC 7252) messages used by the station and the collector:
+ * confirmable requests with Uri-Path and Uri-Query options and piggybacked
+ * responses. A 5.03 response tells in its Max-Age option when to retry.
+ *
+ * No ESP-IDF dependencies, also built on the host and in the collector.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*! Message types */
+enum CoapType
+{
+    COAP_CONFIRMABLE = 0,
+    COAP_NON_CONFIRMABLE = 1,
+    COAP_ACKNOWLEDGEMENT = 2,
+    COAP_RESET = 3
+};
+
+/*! Request and response codes, class in the upper 3 bits */
+enum CoapCode
+{
+    COAP_EMPTY = 0x00,
+    COAP_GET = 0x01,
+    COAP_POST = 0x02,
+    COAP_CHANGED = 0x44,
+    COAP_CONTENT = 0x45,
+    COAP_BAD_REQUEST = 0x80,
+    COAP_NOT_FOUND = 0x84,
+    COAP_INTERNAL_ERROR = 0xA0,
+    COAP_SERVICE_UNAVAILABLE = 0xA3
+};
+
+/*! Uri-Path option number */
+static const int COAP_URI_PATH = 11;
+
+/*! Max-Age option number */
+static const int COAP_MAX_AGE = 14;
+
+/*! Uri-Query option number */
+static const int COAP_URI_QUERY = 15;
+
+/*! Longest token */
+static const size_t COAP_MAX_TOKEN_LENGTH = 8;
+
+struct CoapMessage
+{
+    uint8_t type;
+    uint8_t code;
+    uint16_t message_id;
+    std::string token;
+    std::vector<std::string> uri_path;
+    std::vector<std::string> uri_query;
+
+    /*! Max-Age in seconds, 0 if none */
+    uint32_t max_age;
+    std::string payload;
+};
+
+std::string coap_encode(const CoapMessage &message);
+bool coap_decode(const std::string &data, CoapMessage &message);
+bool coap_success(uint8_t code);
@@ -0,0 +1,74 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * CoAP backend: each upload is one confirmable POST in one UDP datagram,
+ * and the piggybacked 2.04 Changed response is its acknowledgement. There
+ * is no connection setup, so an upload costs one round trip. Lost
+ * datagrams are retransmitted with doubling timeouts, shorter than the RFC
+ * 7252 defaults to bound the radio on time of a wake.
+ */
+
+#pragma once
+
+#include <string>
+#include "coap_codec.h"
+#include "transport.h"
+#include "transport_socket.h"
+
+class CoapTransport : public Transport
+{
+public:
+    CoapTransport(const std::string &server_host, int server_port, const std::string &station_id);
+    ~CoapTransport();
+    bool open();
+    void close();
+    bool get_config(std::string &config);
+    bool send(Channel channel, const std::string &data);
+
+    /*! Resource of sensor data */
+    static const char *const SAMPLES_PATH;
+
+    /*! Resource of telemetry */
+    static const char *const TELEMETRY_PATH;
+
+    /*! Resource of measurement interval */
+    static const char *const INTERVAL_PATH;
+
+    /*! Wait for the first acknowledgement, doubled for each retransmission */
+    static const int ACK_TIMEOUT_MS = 1000;
+
+    /*! Retransmissions before giving up, 15 seconds in all */
+    static const int MAX_RETRANSMIT = 3;
+
+private:
+    bool request(uint8_t code, const char *path, const std::string &query, const std::string &payload,
+                 CoapMessage &response);
+
+    std::string host;
+    int port;
+    std::string station;
+    TransportSocket socket;
+    uint16_t message_id;
+};
@@ -0,0 +1,81 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * MQTT 3.1.1 packets used by the station and the collector: connect,
+ * publish with QoS 0 or 1, subscribe and disconnect.
+ *
+ * No ESP-IDF dependencies, also built on the host and in the collector.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/*! MQTT control packet types */
+enum MqttPacketType
+{
+    MQTT_CONNECT = 1,
+    MQTT_CONNACK = 2,
+    MQTT_PUBLISH = 3,
+    MQTT_PUBACK = 4,
+    MQTT_SUBSCRIBE = 8,
+    MQTT_SUBACK = 9,
+    MQTT_PINGREQ = 12,
+    MQTT_PINGRESP = 13,
+    MQTT_DISCONNECT = 14
+};
+
+/*! Result of mqtt_parse() for an incomplete packet */
+static const int MQTT_INCOMPLETE = 0;
+
+/*! Result of mqtt_parse() for a malformed or too long packet */
+static const int MQTT_MALFORMED = -1;
+
+/*! Longest packet accepted by mqtt_parse() */
+static const int MQTT_MAX_PACKET_SIZE = 4096;
+
+/*! Control packet split to fixed header fields and the rest */
+struct MqttPacket
+{
+    uint8_t type;
+    uint8_t flags;
+    std::string body;
+};
+
+std::string mqtt_connect(const std::string &client_id, uint16_t keep_alive_s);
+std::string mqtt_connack(uint8_t return_code);
+std::string mqtt_publish(const std::string &topic, const std::string &payload, int qos, uint16_t packet_id,
+                         bool retain, bool dup);
+std::string mqtt_puback(uint16_t packet_id);
+std::string mqtt_subscribe(uint16_t packet_id, const std::string &topic, int qos);
+std::string mqtt_suback(uint16_t packet_id, uint8_t granted_qos);
+std::string mqtt_pingresp();
+std::string mqtt_disconnect();
+int mqtt_parse(const std::string &data, MqttPacket &packet);
+bool mqtt_parse_connect(const MqttPacket &packet, std::string &client_id);
+bool mqtt_parse_publish(const MqttPacket &packet, std::string &topic, std::string &payload, uint16_t &packet_id);
+bool mqtt_parse_subscribe(const MqttPacket &packet, uint16_t &packet_id, std::string &topic);
+bool mqtt_parse_packet_id(const MqttPacket &packet, uint16_t &packet_id);
@@ -0,0 +1,71 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * MQTT backend: one TCP connection per wake to the collector's MQTT
+ * listener or a broker. Uploads are published with QoS 1 and the PUBACK is
+ * the acknowledgement; the interval is the retained message of
+ * INTERVAL_TOPIC, got by subscribing to it.
+ */
+
+#pragma once
+
+#include <string>
+#include "mqtt_codec.h"
+#include "transport.h"
+#include "transport_socket.h"
+
+class MqttTransport : public Transport
+{
+public:
+    MqttTransport(const std::string &broker_host, int broker_port, const std::string &client_id);
+    ~MqttTransport();
+    bool open();
+    void close();
+    bool get_config(std::string &config);
+    bool send(Channel channel, const std::string &data);
+
+    /*! Topic of sensor data */
+    static const char *const SAMPLES_TOPIC;
+
+    /*! Topic of telemetry */
+    static const char *const TELEMETRY_TOPIC;
+
+    /*! Topic of retained measurement interval */
+    static const char *const INTERVAL_TOPIC;
+
+    /*! Longest wait for an answer */
+    static const int TIMEOUT_MS = 5000;
+
+private:
+    bool receive_packet(MqttPacket &packet, int timeout_ms);
+    uint16_t next_packet_id();
+
+    std::string host;
+    int port;
+    std::string client;
+    TransportSocket socket;
+    std::string input;
+    uint16_t packet_id;
+};
@@ -0,0 +1,100 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Transport of uploads from the station to the collector.
+ *
+ * The wake cycle gets the station configuration (see station_config.h) and
+ * sends sensor data and telemetry as URL encoded form fields through a
+ * Transport. The backends differ in what an upload costs on air: HTTP
+ * (server component) is compatible with the PHP server files, MQTT with
+ * QoS 1 keeps one TCP connection without HTTP headers, and CoAP sends each
+ * message in one UDP datagram with the response as its acknowledgement.
+ * Every backend counts its bytes, packets and round trips, so the cost of
+ * an upload can be measured. An overloaded collector turns a wake away
+ * with a time to retry: Retry-After in HTTP and Max-Age in CoAP. MQTT
+ * 3.1.1 has no way to tell it.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/*! Traffic of a transport */
+struct TransportStats
+{
+    /*! Application bytes sent and received, without TCP/IP headers */
+    uint32_t bytes_sent;
+    uint32_t bytes_received;
+
+    /*! Send and receive calls, each about one packet for small messages */
+    uint32_t packets_sent;
+    uint32_t packets_received;
+
+    /*! Exchanges where the station waited for an answer */
+    uint32_t round_trips;
+};
+
+class Transport
+{
+public:
+    /*! Kind of uploaded data */
+    enum Channel
+    {
+        SAMPLES,
+        TELEMETRY
+    };
+
+    virtual ~Transport() {}
+
+    /*! Connect to the collector, true if connected */
+    virtual bool open() = 0;
+
+    /*! Disconnect from the collector */
+    virtual void close() = 0;
+
+    /*! Get station configuration text, see station_config.h, true if got */
+    virtual bool get_config(std::string &config) = 0;
+
+    /*! Send form fields and wait for the acknowledgement, true if acknowledged */
+    virtual bool send(Channel channel, const std::string &data) = 0;
+
+    /*! Get traffic since construction */
+    const TransportStats &stats() const
+    {
+        return traffic;
+    }
+
+    /*! Get the seconds the collector asked to wait before retrying the
+     *  last request when it was overloaded, 0 if it did not ask */
+    int retry_after_s() const
+    {
+        return retry_after;
+    }
+
+protected:
+    TransportStats traffic = {};
+    int retry_after = 0;
+};
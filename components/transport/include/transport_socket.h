@@ -0,0 +1,55 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Blocking TCP or UDP socket of a transport backend.
+ *
+ * Uses BSD sockets, which lwIP provides on the ESP32, so the MQTT and CoAP
+ * backends are built and tested on the host too. All traffic is counted in
+ * the backend's TransportStats.
+ */
+
+#pragma once
+
+#include <string>
+#include "transport.h"
+
+class TransportSocket
+{
+public:
+    TransportSocket(TransportStats &transport_stats);
+    ~TransportSocket();
+    bool open(const std::string &host, int port, bool datagram);
+    void close();
+    bool is_open() const;
+    bool send(const std::string &data);
+    bool receive(std::string &data, int timeout_ms);
+
+    /*! Largest datagram or read */
+    static const int RECEIVE_BUFFER_SIZE = 1024;
+
+private:
+    TransportStats &stats;
+    int fd;
+};
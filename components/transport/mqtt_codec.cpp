@@ -0,0 +1,488 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include "mqtt_codec.h"
+
+
+/*!
+ * @brief
+ *   Append a 16-bit big endian number.
+ */
+static void put_u16(std::string &data, uint16_t value)
+{
+    data += static_cast<char>(value >> 8);
+    data += static_cast<char>(value & 0xFF);
+}
+
+
+/*!
+ * @brief
+ *   Append a length prefixed UTF-8 string.
+ */
+static void put_string(std::string &data, const std::string &text)
+{
+    put_u16(data, static_cast<uint16_t>(text.size()));
+    data += text;
+}
+
+
+/*!
+ * @brief
+ *   Read a 16-bit big endian number.
+ *
+ * @param data (IN)
+ *   Packet body.
+ *
+ * @param offset (IN/OUT)
+ *   Position of the number, moved past it.
+ *
+ * @param value (OUT)
+ *   Number.
+ *
+ * @return
+ *   True if the body is long enough, false otherwise.
+ */
+static bool get_u16(const std::string &data, size_t &offset, uint16_t &value)
+{
+    if (offset + 2 > data.size())
+    {
+        return false;
+    }
+
+    value = static_cast<uint16_t>((static_cast<uint8_t>(data[offset]) << 8) | static_cast<uint8_t>(data[offset + 1]));
+    offset += 2;
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Read a length prefixed string.
+ *
+ * @param data (IN)
+ *   Packet body.
+ *
+ * @param offset (IN/OUT)
+ *   Position of the string, moved past it.
+ *
+ * @param text (OUT)
+ *   String.
+ *
+ * @return
+ *   True if the body is long enough, false otherwise.
+ */
+static bool get_string(const std::string &data, size_t &offset, std::string &text)
+{
+    uint16_t length;
+
+    if (!get_u16(data, offset, length) || (offset + length > data.size()))
+    {
+        return false;
+    }
+
+    text = data.substr(offset, length);
+    offset += length;
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Build a packet from its type, flags and body. The remaining length is
+ *   encoded 7 bits per byte.
+ *
+ * @param type (IN)
+ *   Packet type.
+ *
+ * @param flags (IN)
+ *   Packet flags.
+ *
+ * @param body (IN)
+ *   Variable header and payload.
+ *
+ * @return
+ *   Packet.
+ */
+static std::string make_packet(MqttPacketType type, uint8_t flags, const std::string &body)
+{
+    std::string packet(1, static_cast<char>((type << 4) | flags));
+    size_t length = body.size();
+
+    do
+    {
+        uint8_t digit = length % 128;
+        length /= 128;
+        packet += static_cast<char>((length > 0) ? (digit | 0x80) : digit);
+    } while (length > 0);
+
+    return packet + body;
+}
+
+
+/*!
+ * @brief
+ *   Build CONNECT packet with clean session.
+ *
+ * @param client_id (IN)
+ *   Client ID.
+ *
+ * @param keep_alive_s (IN)
+ *   Keep alive time in seconds, 0 for none.
+ *
+ * @return
+ *   Packet.
+ */
+std::string mqtt_connect(const std::string &client_id, uint16_t keep_alive_s)
+{
+    std::string body;
+    put_string(body, "MQTT");
+    body += static_cast<char>(4);       // Protocol level 3.1.1
+    body += static_cast<char>(0x02);    // Clean session
+    put_u16(body, keep_alive_s);
+    put_string(body, client_id);
+
+    return make_packet(MQTT_CONNECT, 0, body);
+}
+
+
+/*!
+ * @brief
+ *   Build CONNACK packet.
+ *
+ * @param return_code (IN)
+ *   0 if accepted.
+ *
+ * @return
+ *   Packet.
+ */
+std::string mqtt_connack(uint8_t return_code)
+{
+    return make_packet(MQTT_CONNACK, 0, std::string(1, 0) + static_cast<char>(return_code));
+}
+
+
+/*!
+ * @brief
+ *   Build PUBLISH packet.
+ *
+ * @param topic (IN)
+ *   Topic name.
+ *
+ * @param payload (IN)
+ *   Message.
+ *
+ * @param qos (IN)
+ *   0 or 1.
+ *
+ * @param packet_id (IN)
+ *   Packet ID acknowledged by PUBACK, only with QoS 1.
+ *
+ * @param retain (IN)
+ *   True to keep the message for later subscribers.
+ *
+ * @param dup (IN)
+ *   True when resending.
+ *
+ * @return
+ *   Packet.
+ */
+std::string mqtt_publish(const std::string &topic, const std::string &payload, int qos, uint16_t packet_id,
+                         bool retain, bool dup)
+{
+    std::string body;
+    put_string(body, topic);
+
+    if (qos > 0)
+    {
+        put_u16(body, packet_id);
+    }
+
+    body += payload;
+
+    return make_packet(MQTT_PUBLISH, static_cast<uint8_t>((dup ? 0x08 : 0) | (qos << 1) | (retain ? 0x01 : 0)), body);
+}
+
+
+/*!
+ * @brief
+ *   Build PUBACK packet.
+ *
+ * @param packet_id (IN)
+ *   ID of the acknowledged PUBLISH.
+ *
+ * @return
+ *   Packet.
+ */
+std::string mqtt_puback(uint16_t packet_id)
+{
+    std::string body;
+    put_u16(body, packet_id);
+
+    return make_packet(MQTT_PUBACK, 0, body);
+}
+
+
+/*!
+ * @brief
+ *   Build SUBSCRIBE packet for one topic.
+ *
+ * @param packet_id (IN)
+ *   Packet ID acknowledged by SUBACK.
+ *
+ * @param topic (IN)
+ *   Topic filter.
+ *
+ * @param qos (IN)
+ *   Maximum QoS.
+ *
+ * @return
+ *   Packet.
+ */
+std::string mqtt_subscribe(uint16_t packet_id, const std::string &topic, int qos)
+{
+    std::string body;
+    put_u16(body, packet_id);
+    put_string(body, topic);
+    body += static_cast<char>(qos);
+
+    return make_packet(MQTT_SUBSCRIBE, 0x02, body);
+}
+
+
+/*!
+ * @brief
+ *   Build SUBACK packet for one topic.
+ *
+ * @param packet_id (IN)
+ *   ID of the acknowledged SUBSCRIBE.
+ *
+ * @param granted_qos (IN)
+ *   Granted QoS, 0x80 for failure.
+ *
+ * @return
+ *   Packet.
+ */
+std::string mqtt_suback(uint16_t packet_id, uint8_t granted_qos)
+{
+    std::string body;
+    put_u16(body, packet_id);
+    body += static_cast<char>(granted_qos);
+
+    return make_packet(MQTT_SUBACK, 0, body);
+}
+
+
+/*!
+ * @brief
+ *   Build PINGRESP packet.
+ */
+std::string mqtt_pingresp()
+{
+    return make_packet(MQTT_PINGRESP, 0, "");
+}
+
+
+/*!
+ * @brief
+ *   Build DISCONNECT packet.
+ */
+std::string mqtt_disconnect()
+{
+    return make_packet(MQTT_DISCONNECT, 0, "");
+}
+
+
+/*!
+ * @brief
+ *   Split the first packet of a stream.
+ *
+ * @param data (IN)
+ *   Received bytes.
+ *
+ * @param packet (OUT)
+ *   Packet type, flags and body.
+ *
+ * @return
+ *   Length of the packet, MQTT_INCOMPLETE if more bytes are needed or
+ *   MQTT_MALFORMED.
+ */
+int mqtt_parse(const std::string &data, MqttPacket &packet)
+{
+    size_t length = 0;
+    size_t offset = 1;
+    int shift = 0;
+
+    while (true)
+    {
+        if (offset >= data.size())
+        {
+            return MQTT_INCOMPLETE;
+        }
+
+        uint8_t digit = static_cast<uint8_t>(data[offset++]);
+        length |= static_cast<size_t>(digit & 0x7F) << shift;
+        shift += 7;
+
+        if ((digit & 0x80) == 0)
+        {
+            break;
+        }
+
+        if (shift >= 28)
+        {
+            return MQTT_MALFORMED;
+        }
+    }
+
+    if (offset + length > static_cast<size_t>(MQTT_MAX_PACKET_SIZE))
+    {
+        return MQTT_MALFORMED;
+    }
+
+    if (offset + length > data.size())
+    {
+        return MQTT_INCOMPLETE;
+    }
+
+    packet.type = static_cast<uint8_t>(data[0]) >> 4;
+    packet.flags = static_cast<uint8_t>(data[0]) & 0x0F;
+    packet.body = data.substr(offset, length);
+
+    return static_cast<int>(offset + length);
+}
+
+
+/*!
+ * @brief
+ *   Read client ID of CONNECT packet.
+ *
+ * @param packet (IN)
+ *   CONNECT packet.
+ *
+ * @param client_id (OUT)
+ *   Client ID.
+ *
+ * @return
+ *   True if MQTT 3.1.1 CONNECT, false otherwise.
+ */
+bool mqtt_parse_connect(const MqttPacket &packet, std::string &client_id)
+{
+    size_t offset = 0;
+    std::string protocol;
+
+    if ((packet.type != MQTT_CONNECT) || !get_string(packet.body, offset, protocol) || (protocol != "MQTT") ||
+        (offset + 4 > packet.body.size()) || (packet.body[offset] != 4))
+    {
+        return false;
+    }
+
+    offset += 4;
+
+    return get_string(packet.body, offset, client_id);
+}
+
+
+/*!
+ * @brief
+ *   Read PUBLISH packet.
+ *
+ * @param packet (IN)
+ *   PUBLISH packet.
+ *
+ * @param topic (OUT)
+ *   Topic name.
+ *
+ * @param payload (OUT)
+ *   Message.
+ *
+ * @param packet_id (OUT)
+ *   Packet ID with QoS 1, 0 with QoS 0.
+ *
+ * @return
+ *   True if PUBLISH with QoS 0 or 1, false otherwise.
+ */
+bool mqtt_parse_publish(const MqttPacket &packet, std::string &topic, std::string &payload, uint16_t &packet_id)
+{
+    size_t offset = 0;
+    int qos = (packet.flags >> 1) & 0x03;
+    packet_id = 0;
+
+    if ((packet.type != MQTT_PUBLISH) || (qos > 1) || !get_string(packet.body, offset, topic) ||
+        ((qos == 1) && !get_u16(packet.body, offset, packet_id)))
+    {
+        return false;
+    }
+
+    payload = packet.body.substr(offset);
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Read SUBSCRIBE packet with one topic.
+ *
+ * @param packet (IN)
+ *   SUBSCRIBE packet.
+ *
+ * @param packet_id (OUT)
+ *   Packet ID.
+ *
+ * @param topic (OUT)
+ *   First topic filter.
+ *
+ * @return
+ *   True if SUBSCRIBE, false otherwise.
+ */
+bool mqtt_parse_subscribe(const MqttPacket &packet, uint16_t &packet_id, std::string &topic)
+{
+    size_t offset = 0;
+
+    return (packet.type == MQTT_SUBSCRIBE) && (packet.flags == 0x02) && get_u16(packet.body, offset, packet_id) &&
+           get_string(packet.body, offset, topic);
+}
+
+
+/*!
+ * @brief
+ *   Read packet ID of PUBACK or SUBACK packet.
+ *
+ * @param packet (IN)
+ *   PUBACK or SUBACK packet.
+ *
+ * @param packet_id (OUT)
+ *   Packet ID.
+ *
+ * @return
+ *   True if the body starts with a packet ID, false otherwise.
+ */
+bool mqtt_parse_packet_id(const MqttPacket &packet, uint16_t &packet_id)
+{
+    size_t offset = 0;
+
+    return get_u16(packet.body, offset, packet_id);
+}
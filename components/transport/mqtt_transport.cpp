@@ -0,0 +1,245 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include "mqtt_transport.h"
+
+const char *const MqttTransport::SAMPLES_TOPIC = "weather/collect";
+const char *const MqttTransport::TELEMETRY_TOPIC = "weather/telemetry";
+const char *const MqttTransport::INTERVAL_TOPIC = "weather/interval";
+
+
+/*!
+ * @brief
+ *   MQTT transport class constructor.
+ *
+ * @param broker_host (IN)
+ *   Host name or address of the collector or broker.
+ *
+ * @param broker_port (IN)
+ *   MQTT port, normally 1883.
+ *
+ * @param client_id (IN)
+ *   MQTT client ID, the station ID.
+ */
+MqttTransport::MqttTransport(const std::string &broker_host, int broker_port, const std::string &client_id)
+    : host(broker_host), port(broker_port), client(client_id), socket(traffic), packet_id(0)
+{
+}
+
+
+/*!
+ * @brief
+ *   MQTT transport class destructor.
+ */
+MqttTransport::~MqttTransport()
+{
+    close();
+}
+
+
+/*!
+ * @brief
+ *   Connect to the broker with a clean session and without keep alive,
+ *   since the connection lasts one upload.
+ *
+ * @return
+ *   True if the broker accepted the connection, false otherwise.
+ */
+bool MqttTransport::open()
+{
+    input.clear();
+
+    if (!socket.open(host, port, false) || !socket.send(mqtt_connect(client, 0)))
+    {
+        socket.close();
+        return false;
+    }
+
+    traffic.round_trips++;
+    MqttPacket packet;
+
+    if (!receive_packet(packet, TIMEOUT_MS) || (packet.type != MQTT_CONNACK) || (packet.body.size() != 2) ||
+        (packet.body[1] != 0))
+    {
+        socket.close();
+        return false;
+    }
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Disconnect from the broker.
+ */
+void MqttTransport::close()
+{
+    if (socket.is_open())
+    {
+        socket.send(mqtt_disconnect());
+        socket.close();
+    }
+}
+
+
+/*!
+ * @brief
+ *   Get station configuration from the retained message of INTERVAL_TOPIC.
+ *   The broker answers the subscription with SUBACK and the retained
+ *   message, which come in one round trip.
+ *
+ * @param config (OUT)
+ *   Configuration text.
+ *
+ * @return
+ *   True if the retained message was got, false otherwise.
+ */
+bool MqttTransport::get_config(std::string &config)
+{
+    if (!socket.send(mqtt_subscribe(next_packet_id(), INTERVAL_TOPIC, 0)))
+    {
+        return false;
+    }
+
+    traffic.round_trips++;
+    MqttPacket packet;
+    bool subscribed = false;
+
+    while (receive_packet(packet, TIMEOUT_MS))
+    {
+        std::string topic;
+        std::string payload;
+        uint16_t id;
+
+        if (packet.type == MQTT_SUBACK)
+        {
+            subscribed = (packet.body.size() == 3) && (static_cast<uint8_t>(packet.body[2]) != 0x80);
+
+            if (!subscribed)
+            {
+                return false;
+            }
+        }
+        else if (mqtt_parse_publish(packet, topic, payload, id) && (topic == INTERVAL_TOPIC))
+        {
+            config = payload;
+            return !payload.empty();
+        }
+    }
+
+    return false;
+}
+
+
+/*!
+ * @brief
+ *   Publish form fields with QoS 1 and wait for PUBACK. TCP already resends
+ *   lost segments, so a message without PUBACK is not published again on
+ *   this connection but left to the caller's retry with a new session.
+ *
+ * @param channel (IN)
+ *   Kind of data, selects the topic.
+ *
+ * @param data (IN)
+ *   URL encoded form fields.
+ *
+ * @return
+ *   True if acknowledged, false otherwise.
+ */
+bool MqttTransport::send(Channel channel, const std::string &data)
+{
+    const char *topic = (channel == TELEMETRY) ? TELEMETRY_TOPIC : SAMPLES_TOPIC;
+    uint16_t id = next_packet_id();
+
+    if (!socket.send(mqtt_publish(topic, data, 1, id, false, false)))
+    {
+        return false;
+    }
+
+    traffic.round_trips++;
+    MqttPacket packet;
+    uint16_t acked_id;
+
+    while (receive_packet(packet, TIMEOUT_MS))
+    {
+        if ((packet.type == MQTT_PUBACK) && mqtt_parse_packet_id(packet, acked_id) && (acked_id == id))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/*!
+ * @brief
+ *   Receive the next packet. The connection is closed if the broker sends
+ *   a malformed packet.
+ *
+ * @param packet (OUT)
+ *   Packet.
+ *
+ * @param timeout_ms (IN)
+ *   Longest wait for more bytes.
+ *
+ * @return
+ *   True if a packet was received, false otherwise.
+ */
+bool MqttTransport::receive_packet(MqttPacket &packet, int timeout_ms)
+{
+    while (true)
+    {
+        int length = mqtt_parse(input, packet);
+
+        if (length > 0)
+        {
+            input.erase(0, static_cast<size_t>(length));
+            return true;
+        }
+
+        if ((length == MQTT_MALFORMED) || !socket.receive(input, timeout_ms))
+        {
+            if (length == MQTT_MALFORMED)
+            {
+                socket.close();
+            }
+
+            return false;
+        }
+    }
+}
+
+
+/*!
+ * @brief
+ *   Get next packet ID, never 0.
+ */
+uint16_t MqttTransport::next_packet_id()
+{
+    packet_id = (packet_id == UINT16_MAX) ? 1 : packet_id + 1;
+
+    return packet_id;
+}
@@ -0,0 +1,207 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <cstring>
+#include <netdb.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "transport_socket.h"
+
+
+/*!
+ * @brief
+ *   Transport socket class constructor.
+ *
+ * @param transport_stats (IN/OUT)
+ *   Traffic counters of the backend.
+ */
+TransportSocket::TransportSocket(TransportStats &transport_stats) : stats(transport_stats), fd(-1)
+{
+}
+
+
+/*!
+ * @brief
+ *   Transport socket class destructor.
+ */
+TransportSocket::~TransportSocket()
+{
+    close();
+}
+
+
+/*!
+ * @brief
+ *   Open a socket to a server. A TCP connection costs one round trip, a UDP
+ *   socket only fixes the peer address.
+ *
+ * @param host (IN)
+ *   Host name or address of the server.
+ *
+ * @param port (IN)
+ *   Port of the server.
+ *
+ * @param datagram (IN)
+ *   True for UDP, false for TCP.
+ *
+ * @return
+ *   True if opened, false otherwise.
+ */
+bool TransportSocket::open(const std::string &host, int port, bool datagram)
+{
+    close();
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = datagram ? SOCK_DGRAM : SOCK_STREAM;
+    addrinfo *address = nullptr;
+
+    if ((getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &address) != 0) || (address == nullptr))
+    {
+        return false;
+    }
+
+    fd = socket(address->ai_family, address->ai_socktype, 0);
+
+    if ((fd >= 0) && (connect(fd, address->ai_addr, address->ai_addrlen) != 0))
+    {
+        ::close(fd);
+        fd = -1;
+    }
+
+    freeaddrinfo(address);
+
+    if ((fd >= 0) && !datagram)
+    {
+        stats.round_trips++;
+    }
+
+    return (fd >= 0);
+}
+
+
+/*!
+ * @brief
+ *   Close the socket.
+ */
+void TransportSocket::close()
+{
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+
+/*!
+ * @brief
+ *   Check if the socket is open.
+ */
+bool TransportSocket::is_open() const
+{
+    return (fd >= 0);
+}
+
+
+/*!
+ * @brief
+ *   Send a message: a TCP segment or a UDP datagram.
+ *
+ * @param data (IN)
+ *   Message.
+ *
+ * @return
+ *   True if sent, false otherwise.
+ */
+bool TransportSocket::send(const std::string &data)
+{
+    size_t sent = 0;
+
+    while ((fd >= 0) && (sent < data.size()))
+    {
+        ssize_t written = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+
+        if (written <= 0)
+        {
+            return false;
+        }
+
+        sent += static_cast<size_t>(written);
+    }
+
+    stats.bytes_sent += static_cast<uint32_t>(data.size());
+    stats.packets_sent++;
+
+    return (fd >= 0);
+}
+
+
+/*!
+ * @brief
+ *   Receive what has arrived: the next TCP read or UDP datagram.
+ *
+ * @param data (OUT)
+ *   Received bytes are appended to data.
+ *
+ * @param timeout_ms (IN)
+ *   Longest time to wait.
+ *
+ * @return
+ *   True if something was received, false on timeout, error or closed
+ *   connection.
+ */
+bool TransportSocket::receive(std::string &data, int timeout_ms)
+{
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    fd_set read_fds;
+    FD_ZERO(&read_fds);
+    FD_SET(fd, &read_fds);
+    timeval timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+
+    if (select(fd + 1, &read_fds, nullptr, nullptr, &timeout) <= 0)
+    {
+        return false;
+    }
+
+    char buffer[RECEIVE_BUFFER_SIZE];
+    ssize_t read_len = recv(fd, buffer, sizeof(buffer), 0);
+
+    if (read_len <= 0)
+    {
+        return false;
+    }
+
+    data.append(buffer, static_cast<size_t>(read_len));
+    stats.bytes_received += static_cast<uint32_t>(read_len);
+    stats.packets_received++;
+
+    return true;
+}
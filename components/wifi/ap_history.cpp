@@ -0,0 +1,249 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <algorithm>
+#include "ap_history.h"
+
+
+/*!
+ * @brief
+ *   Access point history class constructor.
+ *   The cache is cleared if it is not valid, which is the case after power
+ *   loss cleared it.
+ *
+ * @param ap_cache (IN/OUT)
+ *   History of access points, kept over deep sleep.
+ */
+ApHistory::ApHistory(ApCache &ap_cache) : cache(ap_cache)
+{
+    if (cache.magic != MAGIC)
+    {
+        cache = ApCache();
+        cache.magic = MAGIC;
+    }
+}
+
+
+/*!
+ * @brief
+ *   Rank access points by expected connect time.
+ *   Access points with equal expected time keep their configured order.
+ *
+ * @param ssids (IN)
+ *   SSIDs of the access points in configured priority order.
+ *
+ * @return
+ *   Indexes to ssids, fastest first.
+ */
+std::vector<int> ApHistory::rank(const std::vector<std::string> &ssids) const
+{
+    std::vector<uint32_t> expected_ms;
+    std::vector<int> order;
+
+    for (size_t i = 0; i < ssids.size(); i++)
+    {
+        expected_ms.push_back(expected_connect_ms(ssids[i]));
+        order.push_back(static_cast<int>(i));
+    }
+
+    std::stable_sort(order.begin(), order.end(),
+                     [&expected_ms](int a, int b) { return expected_ms[a] < expected_ms[b]; });
+
+    return order;
+}
+
+
+/*!
+ * @brief
+ *   Find history of an access point.
+ *
+ * @param ssid (IN)
+ *   SSID of the access point.
+ *
+ * @return
+ *   History, nullptr if the access point has not been tried.
+ */
+const ApRecord *ApHistory::find(const std::string &ssid) const
+{
+    int index = index_of(ssid);
+
+    return (index >= 0) ? &cache.records[index] : nullptr;
+}
+
+
+/*!
+ * @brief
+ *   Get record index of an access point.
+ *
+ * @param ssid (IN)
+ *   SSID of the access point.
+ *
+ * @return
+ *   Index to ApCache::records, -1 if the access point has not been tried.
+ */
+int ApHistory::index_of(const std::string &ssid) const
+{
+    uint32_t ssid_hash = hash(ssid);
+
+    for (int i = 0; i < MAX_ACCESS_POINTS; i++)
+    {
+        if (cache.records[i].ssid_hash == ssid_hash)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+
+/*!
+ * @brief
+ *   Record a connection attempt.
+ *   An access point without history takes a free record or the one with the
+ *   fewest successes. The counts are halved every MAX_ATTEMPTS attempts and
+ *   the connect time and signal strength are averaged with weight 1/4 for
+ *   the new value.
+ *
+ * @param ssid (IN)
+ *   SSID of the access point.
+ *
+ * @param connected (IN)
+ *   True if the attempt got an IP address.
+ *
+ * @param connect_ms (IN)
+ *   Time to IP address, ignored if not connected.
+ *
+ * @param channel (IN)
+ *   Channel of the access point, ignored if not connected.
+ *
+ * @param rssi (IN)
+ *   Signal strength in dBm, ignored if not connected.
+ */
+void ApHistory::record(const std::string &ssid, bool connected, uint32_t connect_ms, int channel, int rssi)
+{
+    int index = index_of(ssid);
+    ApRecord *record = (index >= 0) ? &cache.records[index] : nullptr;
+
+    if (record == nullptr)
+    {
+        record = &cache.records[0];
+
+        for (ApRecord &candidate : cache.records)
+        {
+            if ((candidate.ssid_hash == 0) || (candidate.successes < record->successes))
+            {
+                record = &candidate;
+
+                if (candidate.ssid_hash == 0)
+                {
+                    break;
+                }
+            }
+        }
+
+        *record = ApRecord();
+        record->ssid_hash = hash(ssid);
+    }
+
+    if (record->attempts >= MAX_ATTEMPTS)
+    {
+        record->attempts /= 2;
+        record->successes /= 2;
+    }
+
+    record->attempts++;
+
+    if (!connected)
+    {
+        return;
+    }
+
+    uint32_t clamped_ms = (connect_ms < UINT16_MAX) ? connect_ms : UINT16_MAX;
+
+    if (record->successes == 0)
+    {
+        record->connect_ms = static_cast<uint16_t>(clamped_ms);
+        record->rssi = static_cast<int8_t>(rssi);
+    }
+    else
+    {
+        record->connect_ms = static_cast<uint16_t>((3 * record->connect_ms + clamped_ms) / 4);
+        record->rssi = static_cast<int8_t>((3 * record->rssi + rssi) / 4);
+    }
+
+    record->successes++;
+    record->channel = static_cast<uint8_t>(channel);
+}
+
+
+/*!
+ * @brief
+ *   Get expected time to connect to an access point: the average connect
+ *   time plus FAILURE_COST_MS weighted by the failure rate.
+ *
+ * @param ssid (IN)
+ *   SSID of the access point.
+ *
+ * @return
+ *   Expected connect time in milliseconds, DEFAULT_CONNECT_MS without
+ *   history.
+ */
+uint32_t ApHistory::expected_connect_ms(const std::string &ssid) const
+{
+    const ApRecord *record = find(ssid);
+
+    if ((record == nullptr) || (record->attempts == 0))
+    {
+        return DEFAULT_CONNECT_MS;
+    }
+
+    uint32_t connect_ms = (record->successes > 0) ? record->connect_ms : DEFAULT_CONNECT_MS;
+    uint32_t failures = record->attempts - record->successes;
+
+    return connect_ms + failures * FAILURE_COST_MS / record->attempts;
+}
+
+
+/*!
+ * @brief
+ *   Hash an SSID with FNV-1a. The hash is never 0, which marks a free record.
+ *
+ * @param ssid (IN)
+ *   SSID.
+ *
+ * @return
+ *   Hash.
+ */
+uint32_t ApHistory::hash(const std::string &ssid)
+{
+    uint32_t value = 2166136261u;
+
+    for (char c : ssid)
+    {
+        value = (value ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+
+    return (value != 0) ? value : 1;
+}
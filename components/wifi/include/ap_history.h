@@ -0,0 +1,105 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Connection history of the configured access points.
+ *
+ * Every connection attempt is recorded per access point: the channel and
+ * signal strength it was found at, the time to an IP address and how many
+ * attempts succeeded. Older attempts fade out, so an access point that
+ * stops working loses its rank within a few wakes. The history is kept in
+ * an ApCache, which the device keeps in RTC memory, and ranks the access
+ * points by expected connect time: a fast, reliable access point is tried
+ * first, directly on its known channel.
+ *
+ * No ESP-IDF dependencies, also built on the host.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*! Maximum number of access points */
+static const int MAX_ACCESS_POINTS = 8;
+
+/*! History of one access point */
+struct ApRecord
+{
+    /*! Hash of SSID, 0 for an unused record */
+    uint32_t ssid_hash;
+
+    /*! Time to IP address, averaged over successful attempts */
+    uint16_t connect_ms;
+
+    /*! Channel found at, 0 for unknown */
+    uint8_t channel;
+
+    /*! Signal strength in dBm, averaged over successful attempts */
+    int8_t rssi;
+
+    /*! Recent attempts */
+    uint8_t attempts;
+
+    /*! Successful recent attempts */
+    uint8_t successes;
+};
+
+/*! History of all access points, kept over deep sleep */
+struct ApCache
+{
+    /*! ApHistory::MAGIC when valid */
+    uint32_t magic;
+
+    ApRecord records[MAX_ACCESS_POINTS];
+};
+
+class ApHistory
+{
+public:
+    ApHistory(ApCache &ap_cache);
+    std::vector<int> rank(const std::vector<std::string> &ssids) const;
+    const ApRecord *find(const std::string &ssid) const;
+    void record(const std::string &ssid, bool connected, uint32_t connect_ms, int channel, int rssi);
+    uint32_t expected_connect_ms(const std::string &ssid) const;
+
+    /*! Value of ApCache::magic for a valid cache */
+    static const uint32_t MAGIC = 0x41504853;
+
+    /*! Attempts after which the counts are halved */
+    static const uint8_t MAX_ATTEMPTS = 16;
+
+    /*! Expected connect time of an access point without history */
+    static const uint32_t DEFAULT_CONNECT_MS = 3000;
+
+    /*! Time lost in a failed attempt */
+    static const uint32_t FAILURE_COST_MS = 5000;
+
+private:
+    int index_of(const std::string &ssid) const;
+    static uint32_t hash(const std::string &ssid);
+
+    ApCache &cache;
+};
@@ -0,0 +1,102 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * WiFi radio profiles and their energy estimate.
+ *
+ * A profile sets the modem power save, the listen interval, TX power
+ * adaptation and whether 802.11b rates are allowed. Wifi applies it and
+ * measures the radio on time of each wake; radio_energy_mj() weights that
+ * time with ESP32 datasheet currents, so profiles can be compared per site
+ * from telemetry. The energy is an estimate for comparison, not a
+ * measurement.
+ *
+ * No ESP-IDF dependencies, also built on the host.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/*! Modem power save while connected */
+enum RadioPowerSave
+{
+    POWER_SAVE_NONE,        // Radio always on
+    POWER_SAVE_MIN_MODEM,   // Wake for every DTIM beacon
+    POWER_SAVE_MAX_MODEM    // Wake every listen interval
+};
+
+/*! Radio settings of a connection */
+struct RadioProfile
+{
+    /*! Name reported in telemetry */
+    const char *name;
+
+    /*! Modem power save while connected */
+    RadioPowerSave power_save;
+
+    /*! Beacon intervals between wakes with POWER_SAVE_MAX_MODEM */
+    uint16_t listen_interval;
+
+    /*! Lower TX power when the access point is heard well */
+    bool adaptive_tx_power;
+
+    /*! Allow 802.11b, whose slow rates keep the radio on longer */
+    bool allow_11b;
+};
+
+/*! Radio use of one wake */
+struct RadioUsage
+{
+    /*! Time from radio start to IP address */
+    uint32_t connect_ms;
+
+    /*! Time from IP address to radio stop */
+    uint32_t connected_ms;
+
+    /*! TX power in 0.25 dBm */
+    int8_t tx_power;
+
+    /*! Signal strength of the access point in dBm */
+    int8_t rssi;
+};
+
+/*! Radio always on, full TX power and all protocols */
+extern const RadioProfile RADIO_PROFILE_PERFORMANCE;
+
+/*! Power save between DTIM beacons and adaptive TX power */
+extern const RadioProfile RADIO_PROFILE_BALANCED;
+
+/*! Longest power save, adaptive TX power and no 802.11b */
+extern const RadioProfile RADIO_PROFILE_LOW_POWER;
+
+/*! Highest TX power in 0.25 dBm, 19.5 dBm */
+static const int8_t RADIO_MAX_TX_POWER = 78;
+
+/*! Lowest TX power in 0.25 dBm, 2 dBm */
+static const int8_t RADIO_MIN_TX_POWER = 8;
+
+int8_t radio_tx_power(const RadioProfile &profile, int rssi);
+uint32_t radio_on_air_ms(const RadioUsage &usage);
+float radio_energy_mj(const RadioProfile &profile, const RadioUsage &usage);
@@ -25,17 +25,43 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
+#include "ap_history.h"
+#include "radio_profile.h"
+
+/*! Credentials of an access point */
+struct AccessPoint
+{
+	std::string ssid;
+	std::string password;
+};
 
 class Wifi
 {
 public:
 	Wifi();
+	Wifi(const RadioProfile &radio_profile);
 	~Wifi();
-	bool connect() const;
-	void disconnect() const;
+	bool connect();
+	void disconnect();
+	const RadioProfile &radio_profile() const;
+	bool previous_usage(RadioUsage &radio_usage) const;
+	std::vector<AccessPoint> access_points() const;
+	bool set_access_points(const std::vector<AccessPoint> &access_points) const;
 
 	static const int WIFI_CONNECTED_BIT = BIT0;
+	static const int WIFI_FAIL_BIT = BIT1;
 	static const int WIFI_WAIT_TIME_MS = 10000;
+	static const int AP_WAIT_TIME_MS = 5000;
+
+private:
+	bool try_access_point(const AccessPoint &access_point, const ApRecord *record, int wait_ms);
+	void apply_profile();
+
+	RadioProfile profile;
+	RadioUsage usage;
+	int64_t start_us;
+	int64_t connected_us;
 };
@@ -0,0 +1,140 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include "radio_profile.h"
+
+const RadioProfile RADIO_PROFILE_PERFORMANCE = {"performance", POWER_SAVE_NONE, 3, false, true};
+const RadioProfile RADIO_PROFILE_BALANCED = {"balanced", POWER_SAVE_MIN_MODEM, 3, true, true};
+const RadioProfile RADIO_PROFILE_LOW_POWER = {"low_power", POWER_SAVE_MAX_MODEM, 10, true, false};
+
+/*! Access point signal strength kept with adaptive TX power, which leaves
+ *  margin for the access point hearing the station worse than vice versa */
+static const int TARGET_RSSI = -60;
+
+/*! Supply voltage */
+static const float SUPPLY_V = 3.3f;
+
+/*! Current with the radio receiving, CPU running */
+static const float RX_MA = 100.0f;
+
+/*! Current while transmitting at highest and lowest TX power */
+static const float TX_MAX_MA = 240.0f;
+static const float TX_MIN_MA = 130.0f;
+
+/*! Share of radio active time spent transmitting */
+static const float TX_DUTY = 0.1f;
+
+/*! Current with the radio off between beacons, CPU running */
+static const float MODEM_SLEEP_MA = 30.0f;
+
+/*! Share of connected time spent transferring data, the rest is waiting
+ *  for the server and can be slept with power save */
+static const float TRANSFER_SHARE = 0.3f;
+
+/*! Radio on time per beacon and beacon interval */
+static const float BEACON_WAKE_MS = 3.0f;
+static const float BEACON_INTERVAL_MS = 102.4f;
+
+
+/*!
+ * @brief
+ *   Get TX power for a signal strength.
+ *   With adaptive TX power the power is lowered by the access point's
+ *   signal strength above TARGET_RSSI.
+ *
+ * @param profile (IN)
+ *   Radio profile.
+ *
+ * @param rssi (IN)
+ *   Signal strength of the access point in dBm.
+ *
+ * @return
+ *   TX power in 0.25 dBm, RADIO_MIN_TX_POWER to RADIO_MAX_TX_POWER.
+ */
+int8_t radio_tx_power(const RadioProfile &profile, int rssi)
+{
+    if (!profile.adaptive_tx_power || (rssi <= TARGET_RSSI))
+    {
+        return RADIO_MAX_TX_POWER;
+    }
+
+    int power = RADIO_MAX_TX_POWER - 4 * (rssi - TARGET_RSSI);
+
+    return static_cast<int8_t>((power > RADIO_MIN_TX_POWER) ? power : RADIO_MIN_TX_POWER);
+}
+
+
+/*!
+ * @brief
+ *   Get radio on time of a wake.
+ *
+ * @param usage (IN)
+ *   Radio use.
+ *
+ * @return
+ *   Time from radio start to stop in milliseconds.
+ */
+uint32_t radio_on_air_ms(const RadioUsage &usage)
+{
+    return usage.connect_ms + usage.connected_ms;
+}
+
+
+/*!
+ * @brief
+ *   Estimate radio energy of a wake.
+ *   Connecting keeps the radio active. While connected the radio is active
+ *   for TRANSFER_SHARE of the time and otherwise listens with the power save
+ *   of the profile: always, at every beacon or at every listen interval.
+ *   Active current rises with TX power for the TX_DUTY share.
+ *
+ * @param profile (IN)
+ *   Radio profile of the wake.
+ *
+ * @param usage (IN)
+ *   Radio use of the wake.
+ *
+ * @return
+ *   Energy in millijoules.
+ */
+float radio_energy_mj(const RadioProfile &profile, const RadioUsage &usage)
+{
+    float power_share = static_cast<float>(usage.tx_power - RADIO_MIN_TX_POWER) /
+                        (RADIO_MAX_TX_POWER - RADIO_MIN_TX_POWER);
+    float tx_ma = TX_MIN_MA + power_share * (TX_MAX_MA - TX_MIN_MA);
+    float active_ma = RX_MA + TX_DUTY * (tx_ma - RX_MA);
+    float idle_ma = RX_MA;
+
+    if (profile.power_save != POWER_SAVE_NONE)
+    {
+        float beacons = (profile.power_save == POWER_SAVE_MAX_MODEM) ? profile.listen_interval : 1.0f;
+        float wake_share = BEACON_WAKE_MS / (BEACON_INTERVAL_MS * ((beacons > 1.0f) ? beacons : 1.0f));
+        idle_ma = MODEM_SLEEP_MA + wake_share * (RX_MA - MODEM_SLEEP_MA);
+    }
+
+    float connected_ma = TRANSFER_SHARE * active_ma + (1.0f - TRANSFER_SHARE) * idle_ma;
+    float charge_uc = usage.connect_ms * active_ma + usage.connected_ms * connected_ma;
+
+    return charge_uc * SUPPLY_V / 1000.0f;
+}
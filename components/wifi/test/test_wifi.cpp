@@ -36,4 +36,18 @@ TEST_CASE("Connect to WiFi", "[wifi]")
 }
 
 
+TEST_CASE("Provisioned access points", "[wifi]")
+{
+    nvs_flash_init();
+    Wifi wifi;
+    TEST_ASSERT_EQUAL(true, wifi.set_access_points({{"attic", "secret1"}, {"garage", "secret2"}}));
+    std::vector<AccessPoint> access_points = wifi.access_points();
+    TEST_ASSERT_EQUAL(2, access_points.size());
+    TEST_ASSERT_EQUAL(true, access_points[1].ssid == "garage");
+    TEST_ASSERT_EQUAL(true, access_points[1].password == "secret2");
+    TEST_ASSERT_EQUAL(true, wifi.set_access_points({}));
+    TEST_ASSERT_EQUAL(true, wifi.access_points()[0].ssid == CONFIG_ESP_WIFI_SSID);
+}
+
+
 
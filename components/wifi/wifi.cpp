@@ -22,18 +22,74 @@
  * SOFTWARE.
 */
 
+#include <cstring>
 #include "esp_wifi.h"
 #include "esp_event_loop.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "nvs.h"
 #include "wifi.h"
 
 #pragma GCC diagnostic ignored "-Wmissing-field-initializers"
 
 
+/*! Marks valid radio use in RTC memory */
+static const uint32_t USAGE_MAGIC = 0x52414431;
+
+/*! Radio use of the previous wake, kept over deep sleep */
+RTC_DATA_ATTR static RadioUsage rtc_usage;
+RTC_DATA_ATTR static uint32_t rtc_usage_magic;
+
+/*! Connection history of the access points, kept over deep sleep */
+RTC_DATA_ATTR static ApCache rtc_ap_cache;
+
+/*! NVS namespace of access point credentials */
+static const char NVS_NAMESPACE[] = "wifi_aps";
+
+/*! NVS key of number of access points */
+static const char NVS_COUNT_KEY[] = "count";
+
+
+/*!
+ * @brief
+ *   Get radio profile selected in "Example Configuration".
+ *
+ * @return
+ *   Radio profile.
+ */
+static RadioProfile configured_profile()
+{
+#if CONFIG_WIFI_RADIO_PROFILE_LOW_POWER
+    RadioProfile radio_profile = RADIO_PROFILE_LOW_POWER;
+    radio_profile.listen_interval = CONFIG_WIFI_LISTEN_INTERVAL;
+#elif CONFIG_WIFI_RADIO_PROFILE_BALANCED
+    RadioProfile radio_profile = RADIO_PROFILE_BALANCED;
+#else
+    RadioProfile radio_profile = RADIO_PROFILE_PERFORMANCE;
+#endif
+
+    return radio_profile;
+}
+
+
+/*!
+ * @brief
+ *   WiFi class constructor with radio profile selected in
+ *   "Example Configuration".
+ */
+Wifi::Wifi() : Wifi(configured_profile())
+{
+}
+
+
 /*!
  * @brief
  *   WiFi class constructor.
+ *
+ * @param radio_profile (IN)
+ *   Radio settings of the connections.
  */
-Wifi::Wifi()
+Wifi::Wifi(const RadioProfile &radio_profile) : profile(radio_profile), usage(), start_us(0), connected_us(0)
 {
 }
 
@@ -50,6 +106,12 @@ Wifi::~Wifi()
 /*! WiFi event group for event_handler */
 EventGroupHandle_t wifi_event_group;
 
+/*! TCP/IP adapter and event loop can be initialized only once per boot */
+static bool network_initialized = false;
+
+/*! Reconnections to the current access point */
+static int retry_num = 0;
+
 
 /*!
  * @brief
@@ -66,8 +128,6 @@ EventGroupHandle_t wifi_event_group;
  */
 static esp_err_t event_handler(void *ctx, system_event_t *event)
 {
-    static int retry_num = 0;
-
     switch(event->event_id)
     {
         case SYSTEM_EVENT_STA_START:
@@ -84,6 +144,10 @@ static esp_err_t event_handler(void *ctx, system_event_t *event)
                 xEventGroupClearBits(wifi_event_group, Wifi::WIFI_CONNECTED_BIT);
                 retry_num++;
             }
+            else
+            {
+                xEventGroupSetBits(wifi_event_group, Wifi::WIFI_FAIL_BIT);
+            }
             break;
         default:
             break;
@@ -94,40 +158,308 @@ static esp_err_t event_handler(void *ctx, system_event_t *event)
 
 /*!
  * @brief
- *   Connect to WiFi.
+ *   Apply power save and TX power of the radio profile to a connection.
+ *   Power save is set only after connecting so that it does not slow down
+ *   association and DHCP. TX power is lowered by the signal strength of the
+ *   access point if the profile adapts it.
+ */
+void Wifi::apply_profile()
+{
+    wifi_ap_record_t ap_info;
+    int rssi = (esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK) ? ap_info.rssi : -127;
+    wifi_ps_type_t power_save = WIFI_PS_NONE;
+
+    if (profile.power_save == POWER_SAVE_MIN_MODEM)
+    {
+        power_save = WIFI_PS_MIN_MODEM;
+    }
+    else if (profile.power_save == POWER_SAVE_MAX_MODEM)
+    {
+        power_save = WIFI_PS_MAX_MODEM;
+    }
+
+    esp_wifi_set_ps(power_save);
+    usage.rssi = static_cast<int8_t>(rssi);
+    usage.tx_power = radio_tx_power(profile, rssi);
+    esp_wifi_set_max_tx_power(usage.tx_power);
+}
+
+
+/*!
+ * @brief
+ *   Try to connect to one access point.
+ *   An access point with a known channel is scanned on that channel first
+ *   and joined at the first match instead of after a full scan.
+ *
+ * @param access_point (IN)
+ *   Credentials of the access point.
+ *
+ * @param record (IN)
+ *   History of the access point, nullptr if none.
+ *
+ * @param wait_ms (IN)
+ *   Longest time to wait for an IP address.
  *
  * @return
  *   True if connected, false otherwise.
  */
-bool Wifi::connect() const
+bool Wifi::try_access_point(const AccessPoint &access_point, const ApRecord *record, int wait_ms)
 {
-    tcpip_adapter_init();
-    wifi_event_group = xEventGroupCreate();
-    ESP_ERROR_CHECK(esp_event_loop_init(event_handler, NULL));
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-    ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
-    wifi_config_t wifi_config = {CONFIG_ESP_WIFI_SSID, CONFIG_ESP_WIFI_PASSWORD};
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    wifi_config_t wifi_config = {};
+    strncpy(reinterpret_cast<char *>(wifi_config.sta.ssid), access_point.ssid.c_str(),
+            sizeof(wifi_config.sta.ssid));
+    strncpy(reinterpret_cast<char *>(wifi_config.sta.password), access_point.password.c_str(),
+            sizeof(wifi_config.sta.password));
+    wifi_config.sta.listen_interval = profile.listen_interval;
+
+    if ((record != nullptr) && (record->channel != 0))
+    {
+        wifi_config.sta.channel = record->channel;
+        wifi_config.sta.scan_method = WIFI_FAST_SCAN;
+    }
+
+    // Stop an earlier failed attempt, does nothing on the first attempt
+    esp_wifi_stop();
+    retry_num = 0;
+    xEventGroupClearBits(wifi_event_group, WIFI_CONNECTED_BIT | WIFI_FAIL_BIT);
     ESP_ERROR_CHECK(esp_wifi_set_config(ESP_IF_WIFI_STA, &wifi_config));
     ESP_ERROR_CHECK(esp_wifi_start());
 
-    // Wait until WiFi is connected or timeout or retried maximum times
+    // Wait until connected, retried maximum times or timeout
     EventBits_t uxBits = xEventGroupWaitBits(
-            wifi_event_group, WIFI_CONNECTED_BIT, false, true, WIFI_WAIT_TIME_MS / portTICK_RATE_MS);
+            wifi_event_group, WIFI_CONNECTED_BIT | WIFI_FAIL_BIT, false, false, wait_ms / portTICK_RATE_MS);
 
-    // Return true if connected, false otherwise
     return ((uxBits & WIFI_CONNECTED_BIT) != 0);
 }
 
 
+/*!
+ * @brief
+ *   Connect to WiFi with the radio profile.
+ *   The access points are tried fastest first by their connection history
+ *   in RTC memory. All but the last get AP_WAIT_TIME_MS, so a weak or
+ *   missing access point does not take the full timeout.
+ *   802.11b is left out of the protocols if the profile does not allow it,
+ *   and the listen interval is set for the access point.
+ *   Can be called again after disconnect() to reconnect without reboot.
+ *
+ * @return
+ *   True if connected, false otherwise.
+ */
+bool Wifi::connect()
+{
+    start_us = esp_timer_get_time();
+    usage = RadioUsage();
+    usage.tx_power = RADIO_MAX_TX_POWER;
+
+    if (!network_initialized)
+    {
+        tcpip_adapter_init();
+        wifi_event_group = xEventGroupCreate();
+        ESP_ERROR_CHECK(esp_event_loop_init(event_handler, NULL));
+        network_initialized = true;
+    }
+
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+    ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
+    uint8_t protocols = WIFI_PROTOCOL_11G | WIFI_PROTOCOL_11N | (profile.allow_11b ? WIFI_PROTOCOL_11B : 0);
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    ESP_ERROR_CHECK(esp_wifi_set_protocol(ESP_IF_WIFI_STA, protocols));
+
+    std::vector<AccessPoint> candidates = access_points();
+    std::vector<std::string> ssids;
+
+    for (const AccessPoint &candidate : candidates)
+    {
+        ssids.push_back(candidate.ssid);
+    }
+
+    ApHistory history(rtc_ap_cache);
+    std::vector<int> order = history.rank(ssids);
+    bool connected = false;
+
+    for (size_t n = 0; (n < order.size()) && !connected; n++)
+    {
+        const AccessPoint &candidate = candidates[order[n]];
+        int wait_ms = (n + 1 < order.size()) ? AP_WAIT_TIME_MS : WIFI_WAIT_TIME_MS;
+        int64_t attempt_us = esp_timer_get_time();
+        connected = try_access_point(candidate, history.find(candidate.ssid), wait_ms);
+        wifi_ap_record_t ap_info = {};
+
+        if (connected)
+        {
+            esp_wifi_sta_get_ap_info(&ap_info);
+        }
+
+        history.record(candidate.ssid, connected, static_cast<uint32_t>((esp_timer_get_time() - attempt_us) / 1000),
+                       ap_info.primary, ap_info.rssi);
+    }
+
+    connected_us = esp_timer_get_time();
+    usage.connect_ms = static_cast<uint32_t>((connected_us - start_us) / 1000);
+
+    if (!connected)
+    {
+        return false;
+    }
+
+    apply_profile();
+
+    return true;
+}
+
+
 /*!
  * @brief
  *   Disconnect from WiFi.
+ *   The radio use of the connection is kept in RTC memory for
+ *   previous_usage().
  */
-void Wifi::disconnect() const
+void Wifi::disconnect()
 {
+    xEventGroupClearBits(wifi_event_group, WIFI_CONNECTED_BIT);
     ESP_ERROR_CHECK(esp_wifi_disconnect());
     ESP_ERROR_CHECK(esp_wifi_stop());
     ESP_ERROR_CHECK(esp_wifi_deinit());
+
+    usage.connected_ms = static_cast<uint32_t>((esp_timer_get_time() - connected_us) / 1000);
+    rtc_usage = usage;
+    rtc_usage_magic = USAGE_MAGIC;
+}
+
+
+/*!
+ * @brief
+ *   Get radio profile of the connections.
+ */
+const RadioProfile &Wifi::radio_profile() const
+{
+    return profile;
+}
+
+
+/*!
+ * @brief
+ *   Get radio use of the previous connection, also over deep sleep. The
+ *   use of the current connection is known only after disconnect(), so
+ *   telemetry posted while connected reports the previous wake.
+ *
+ * @param radio_usage (OUT)
+ *   Radio use of the previous connection.
+ *
+ * @return
+ *   True if there was a previous connection since power on, false otherwise.
+ */
+bool Wifi::previous_usage(RadioUsage &radio_usage) const
+{
+    if (rtc_usage_magic != USAGE_MAGIC)
+    {
+        return false;
+    }
+
+    radio_usage = rtc_usage;
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Get credentials of the access points in priority order.
+ *   Uses the list provisioned in NVS, or the SSID and password set in
+ *   "Example Configuration" if no list is provisioned.
+ *
+ * @return
+ *   Access points.
+ */
+std::vector<AccessPoint> Wifi::access_points() const
+{
+    std::vector<AccessPoint> list;
+    nvs_handle handle;
+
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK)
+    {
+        uint8_t count = 0;
+        nvs_get_u8(handle, NVS_COUNT_KEY, &count);
+
+        for (int i = 0; (i < count) && (i < MAX_ACCESS_POINTS); i++)
+        {
+            char ssid[sizeof(wifi_sta_config_t::ssid) + 1];
+            char password[sizeof(wifi_sta_config_t::password) + 1];
+            size_t ssid_length = sizeof(ssid);
+            size_t password_length = sizeof(password);
+            std::string index = std::to_string(i);
+
+            if ((nvs_get_str(handle, ("ssid" + index).c_str(), ssid, &ssid_length) == ESP_OK) &&
+                (nvs_get_str(handle, ("pass" + index).c_str(), password, &password_length) == ESP_OK))
+            {
+                list.push_back({ssid, password});
+            }
+        }
+
+        nvs_close(handle);
+    }
+
+    if (list.empty())
+    {
+        list.push_back({CONFIG_ESP_WIFI_SSID, CONFIG_ESP_WIFI_PASSWORD});
+    }
+
+    return list;
+}
+
+
+/*!
+ * @brief
+ *   Provision credentials of the access points to NVS.
+ *   The order is the priority of access points without connection history.
+ *
+ * @param access_points (IN)
+ *   At most MAX_ACCESS_POINTS access points. Empty list returns to the SSID
+ *   and password set in "Example Configuration".
+ *
+ * @return
+ *   True if stored, false otherwise.
+ */
+bool Wifi::set_access_points(const std::vector<AccessPoint> &access_points) const
+{
+    if (access_points.size() > MAX_ACCESS_POINTS)
+    {
+        return false;
+    }
+
+    nvs_handle handle;
+
+    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK)
+    {
+        return false;
+    }
+
+    esp_err_t err = nvs_erase_all(handle);
+
+    for (size_t i = 0; (i < access_points.size()) && (err == ESP_OK); i++)
+    {
+        std::string index = std::to_string(i);
+        err = nvs_set_str(handle, ("ssid" + index).c_str(), access_points[i].ssid.c_str());
+
+        if (err == ESP_OK)
+        {
+            err = nvs_set_str(handle, ("pass" + index).c_str(), access_points[i].password.c_str());
+        }
+    }
+
+    if (err == ESP_OK)
+    {
+        err = nvs_set_u8(handle, NVS_COUNT_KEY, static_cast<uint8_t>(access_points.size()));
+    }
+
+    if (err == ESP_OK)
+    {
+        err = nvs_commit(handle);
+    }
+
+    nvs_close(handle);
+
+    return (err == ESP_OK);
 }
@@ -0,0 +1,356 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include "battery_model.h"
+
+/*! Names of the phases in a model */
+static const char *const PHASE_NAMES[PHASE_COUNT] = {"boot", "led", "wifi", "tls", "request", "sensor", "idle",
+                                                     "light_sleep", "deep_sleep"};
+
+/*! Energy and time of one upload cycle */
+struct Cycle
+{
+    double charge_mc;
+    double time_s;
+    double awake_s;
+    bool failed;
+};
+
+
+/*!
+ * @brief
+ *   Get the name of a phase in a model.
+ */
+const char *wake_phase_name(WakePhase phase)
+{
+    return PHASE_NAMES[phase];
+}
+
+
+/*!
+ * @brief
+ *   Parse a number that fills the whole token.
+ */
+static bool parse_number(const std::string &token, double &value)
+{
+    char *end;
+    value = strtod(token.c_str(), &end);
+
+    return !token.empty() && (*end == '\0') && std::isfinite(value);
+}
+
+
+/*!
+ * @brief
+ *   Parse a wake model, see battery_model.h. Lines of the same phase add
+ *   up to a trace to draw from.
+ *
+ * @param text (IN)
+ *   Model text.
+ *
+ * @param model (OUT)
+ *   Wake model.
+ *
+ * @param error (OUT)
+ *   Line number and text of the first invalid line.
+ *
+ * @return
+ *   True if valid, false otherwise.
+ */
+bool parse_wake_model(const std::string &text, WakeModel &model, std::string &error)
+{
+    std::istringstream lines(text);
+    std::string line;
+    int line_number = 0;
+    model = WakeModel();
+
+    while (std::getline(lines, line))
+    {
+        line_number++;
+        std::istringstream tokens(line.substr(0, line.find('#')));
+        std::vector<std::string> fields;
+        std::string field;
+
+        while (tokens >> field)
+        {
+            fields.push_back(field);
+        }
+
+        if (fields.empty())
+        {
+            continue;
+        }
+
+        std::vector<double> values(fields.size() - 1);
+        bool valid = true;
+
+        for (size_t i = 1; i < fields.size(); i++)
+        {
+            valid = valid && parse_number(fields[i], values[i - 1]) && (values[i - 1] >= 0);
+        }
+
+        const char *const *name = std::find(PHASE_NAMES, PHASE_NAMES + PHASE_COUNT, fields[0]);
+
+        if (valid && (name != PHASE_NAMES + PHASE_COUNT) && ((values.size() == 2) || (values.size() == 3)))
+        {
+            PhaseCost cost = {static_cast<float>(values[0]), static_cast<float>(values[1]),
+                              (values.size() == 3) ? static_cast<float>(values[2]) : 0.0f};
+            model.phases[name - PHASE_NAMES].push_back(cost);
+        }
+        else if (valid && (fields[0] == "wifi_fail") && (values.size() == 1) && (values[0] <= 1))
+        {
+            model.wifi_fail = values[0];
+        }
+        else if (valid && (fields[0] == "upload_fail") && (values.size() == 1) && (values[0] <= 1))
+        {
+            model.upload_fail = values[0];
+        }
+        else
+        {
+            error = "line " + std::to_string(line_number) + ": " + line;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Draw a phase of a wake and add its charge and time.
+ *
+ * @param model (IN)
+ *   Wake model.
+ *
+ * @param phase (IN)
+ *   Phase to draw, nothing if the model does not have it.
+ *
+ * @param random (IN/OUT)
+ *   Random number generator.
+ *
+ * @param cycle (IN/OUT)
+ *   Cycle to add to.
+ */
+static void add_phase(const WakeModel &model, WakePhase phase, std::mt19937 &random, Cycle &cycle)
+{
+    const std::vector<PhaseCost> &costs = model.phases[phase];
+
+    if (costs.empty())
+    {
+        return;
+    }
+
+    const PhaseCost &cost = (costs.size() > 1) ? costs[random() % costs.size()] : costs.front();
+    double duration_ms = cost.duration_ms;
+
+    if ((costs.size() == 1) && (cost.spread_ms > 0))
+    {
+        duration_ms = std::max(0.0, std::normal_distribution<double>(cost.duration_ms, cost.spread_ms)(random));
+    }
+
+    cycle.charge_mc += duration_ms / 1000 * cost.current_ma;
+    cycle.time_s += duration_ms / 1000;
+    cycle.awake_s += duration_ms / 1000;
+}
+
+
+/*!
+ * @brief
+ *   Add time in a phase with only a current, like sleep.
+ */
+static void add_wait(const WakeModel &model, WakePhase phase, double time_s, Cycle &cycle)
+{
+    const std::vector<PhaseCost> &costs = model.phases[phase];
+    cycle.charge_mc += costs.empty() ? 0 : time_s * costs.front().current_ma;
+    cycle.time_s += time_s;
+}
+
+
+/*!
+ * @brief
+ *   Run one upload cycle as measure() does after the WiFi has connected:
+ *   upload attempts with a jittered backoff between them, then deep sleep
+ *   until the next wake, or a light sleep sample window for a short
+ *   interval.
+ *
+ * @param model (IN)
+ *   Wake model.
+ *
+ * @param settings (IN)
+ *   Station settings.
+ *
+ * @param random (IN/OUT)
+ *   Random number generator.
+ *
+ * @return
+ *   Charge and time of the cycle.
+ */
+static Cycle run_cycle(const WakeModel &model, const BatterySettings &settings, std::mt19937 &random)
+{
+    std::uniform_real_distribution<double> unit(0, 1);
+    bool deep_sleep = (settings.interval_min > settings.light_sleep_max_min);
+    Cycle cycle = {0, 0, 0, true};
+
+    if (deep_sleep)
+    {
+        add_phase(model, PHASE_BOOT, random, cycle);
+        add_phase(model, PHASE_LED, random, cycle);
+    }
+
+    add_phase(model, PHASE_WIFI, random, cycle);
+
+    for (int attempt = 0; (attempt < BATTERY_MEASUREMENT_RETRIES) && cycle.failed; attempt++)
+    {
+        if (attempt > 0)
+        {
+            double backoff_s = BATTERY_RETRY_BACKOFF_MS / 1000 * (1 << (attempt - 1)) * (0.5 + unit(random));
+            add_wait(model, PHASE_IDLE, backoff_s, cycle);
+            cycle.awake_s += backoff_s;
+        }
+
+        add_phase(model, PHASE_TLS, random, cycle);
+        cycle.failed = (unit(random) < model.upload_fail);
+
+        for (int request = 0; request < (cycle.failed ? 1 : settings.requests); request++)
+        {
+            add_phase(model, PHASE_REQUEST, random, cycle);
+        }
+
+        if (!cycle.failed)
+        {
+            add_phase(model, PHASE_SENSOR, random, cycle);
+        }
+    }
+
+    if (deep_sleep)
+    {
+        add_wait(model, PHASE_DEEP_SLEEP, std::max(settings.interval_min * 60 - cycle.time_s, BATTERY_MIN_SLEEP_S),
+                 cycle);
+        return cycle;
+    }
+
+    double awake_s = cycle.awake_s;
+
+    for (int sample = 0; sample < std::max(1, settings.interval_min * 60 / BATTERY_SAMPLE_PERIOD_S); sample++)
+    {
+        add_wait(model, PHASE_LIGHT_SLEEP, BATTERY_SAMPLE_PERIOD_S, cycle);
+        add_phase(model, PHASE_SENSOR, random, cycle);
+    }
+
+    // The window is spent asleep, the sensor reads in it are not part of the wake
+    cycle.awake_s = awake_s;
+
+    return cycle;
+}
+
+
+/*!
+ * @brief
+ *   Project the battery life of a station.
+ *
+ * @param model (IN)
+ *   Wake model.
+ *
+ * @param settings (IN)
+ *   Station settings.
+ *
+ * @param cycles (IN)
+ *   Upload cycles to draw.
+ *
+ * @param trials (IN)
+ *   Battery trials over the drawn cycles.
+ *
+ * @param random (IN/OUT)
+ *   Random number generator.
+ *
+ * @return
+ *   Average current, failures and the spread of battery life.
+ */
+BatteryLife battery_life(const WakeModel &model, const BatterySettings &settings, int cycles, int trials,
+                         std::mt19937 &random)
+{
+    double charge_mc = 0;
+    double charge_squares = 0;
+    double time_s = 0;
+    double awake_s = 0;
+    int failed = 0;
+
+    for (int i = 0; i < cycles; i++)
+    {
+        Cycle cycle = run_cycle(model, settings, random);
+        charge_mc += cycle.charge_mc;
+        charge_squares += cycle.charge_mc * cycle.charge_mc;
+        time_s += cycle.time_s;
+        awake_s += cycle.awake_s;
+        failed += cycle.failed ? 1 : 0;
+    }
+
+    BatteryLife life = {};
+    double mean_mc = charge_mc / cycles;
+    double sd_mc = sqrt(std::max(0.0, charge_squares / cycles - mean_mc * mean_mc));
+    double cycle_s = time_s / cycles;
+    life.mean_ma = charge_mc / time_s;
+    life.awake_s = awake_s / cycles;
+    life.failed_uploads = static_cast<double>(failed) / cycles;
+
+    // The charge of many cycles is normal around its mean
+    double capacity_mc = settings.capacity_mah * 3600;
+    double empty_cycles = capacity_mc / mean_mc;
+    std::normal_distribution<double> empty_at(empty_cycles, sd_mc * sqrt(empty_cycles) / mean_mc);
+    std::uniform_real_distribution<double> unit(0, 1);
+    std::vector<double> days(static_cast<size_t>(trials));
+    int stranded = 0;
+
+    for (double &trial_days : days)
+    {
+        double trial_cycles = std::max(0.0, empty_at(random));
+
+        // Cycles before the first failed connect, geometric
+        if (model.wifi_fail > 0)
+        {
+            double connected = floor(log(1 - unit(random)) / log1p(-model.wifi_fail));
+
+            if (connected < trial_cycles)
+            {
+                trial_cycles = connected;
+                stranded++;
+            }
+        }
+
+        trial_days = trial_cycles * cycle_s / 86400;
+    }
+
+    std::sort(days.begin(), days.end());
+    life.stranded = static_cast<double>(stranded) / trials;
+    life.p10_days = days[days.size() / 10];
+    life.p50_days = days[days.size() / 2];
+    life.p90_days = days[days.size() * 9 / 10];
+
+    return life;
+}
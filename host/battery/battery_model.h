@@ -0,0 +1,145 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Battery life model of a station.
+ *
+ * A wake model gives the duration and current of each phase of a wake,
+ * as in measure() of weather_main.cpp, and the chances that the WiFi
+ * connection or an upload attempt fails. A phase with several lines in the
+ * model is drawn from them, so a phase can be given as the durations of a
+ * measured trace; a phase with one line varies by its spread:
+ *
+ *   # phase  duration_ms  current_ma  [spread_ms]
+ *   boot         5600       40
+ *   wifi         1500      120      400
+ *   wifi         4100      120
+ *   deep_sleep      0        0.01
+ *   wifi_fail   0.0005
+ *   upload_fail 0.02
+ *
+ * battery_life() runs upload cycles of the model with the retries of
+ * measure(), and then Monte-Carlo trials of the battery over the cycles:
+ * the cycle where it is empty, or the cycle where the WiFi connection
+ * fails first, as measure() then only blinks the LED and the station
+ * uploads no more. The cycles are drawn once per setting and each trial
+ * costs a few random numbers, so a sweep of thousands of settings takes
+ * seconds.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+/*! Phases of a wake */
+enum WakePhase
+{
+    PHASE_BOOT,         // Reset to app_main
+    PHASE_LED,          // Status LED blink at boot
+    PHASE_WIFI,         // Association and IP address
+    PHASE_TLS,          // TLS handshake of each upload attempt, none for HTTP, MQTT and CoAP
+    PHASE_REQUEST,      // One request and its response
+    PHASE_SENSOR,       // Sensor read with its waits
+    PHASE_IDLE,         // Awake with WiFi connected while waiting to retry, current only
+    PHASE_LIGHT_SLEEP,  // Between samples of a light sleep window, current only
+    PHASE_DEEP_SLEEP,   // Between wakes, current only
+    PHASE_COUNT
+};
+
+/*! Duration and current of a phase */
+struct PhaseCost
+{
+    float duration_ms;
+    float current_ma;
+    float spread_ms;
+};
+
+/*! Phases and failures of a station */
+struct WakeModel
+{
+    /*! Measured or configured costs of each phase */
+    std::vector<PhaseCost> phases[PHASE_COUNT];
+
+    /*! Chance that the WiFi connection of a wake fails */
+    double wifi_fail;
+
+    /*! Chance that an upload attempt fails */
+    double upload_fail;
+};
+
+/*! Station settings to project */
+struct BatterySettings
+{
+    /*! Measurement interval in minutes */
+    int interval_min;
+
+    /*! Longest interval sampled in light sleep, LIGHT_SLEEP_MAX_INTERVAL_MIN */
+    int light_sleep_max_min;
+
+    /*! Requests of an upload: interval, samples of each sensor and telemetry */
+    int requests;
+
+    /*! Battery capacity in mAh */
+    double capacity_mah;
+};
+
+/*! Projected battery life */
+struct BatteryLife
+{
+    /*! Average current in mA */
+    double mean_ma;
+
+    /*! Awake time per upload in seconds */
+    double awake_s;
+
+    /*! Share of uploads that failed all retries */
+    double failed_uploads;
+
+    /*! Share of trials where the WiFi failed before the battery was empty.
+     *  Their life ends at the failure. */
+    double stranded;
+
+    /*! 10th, 50th and 90th percentile of battery life in days */
+    double p10_days;
+    double p50_days;
+    double p90_days;
+};
+
+/*! Retries of measure() in weather_main.cpp */
+static const int BATTERY_MEASUREMENT_RETRIES = 3;
+static const float BATTERY_RETRY_BACKOFF_MS = 2000;
+
+/*! Time between samples in light sleep in seconds, SAMPLE_PERIOD_S */
+static const int BATTERY_SAMPLE_PERIOD_S = 30;
+
+/*! Shortest deep sleep in seconds, Sleep::MIN_SLEEP_US */
+static const double BATTERY_MIN_SLEEP_S = 1.0;
+
+const char *wake_phase_name(WakePhase phase);
+bool parse_wake_model(const std::string &text, WakeModel &model, std::string &error);
+BatteryLife battery_life(const WakeModel &model, const BatterySettings &settings, int cycles, int trials,
+                         std::mt19937 &random);
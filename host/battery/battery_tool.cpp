@@ -0,0 +1,211 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Battery life projection of station settings.
+ *
+ *   battery_tool [-i intervals] [-u upload_fails] [-w wifi_fails] [-c capacity_mah]
+ *                [-r requests] [-n trials] <model.txt>...
+ *
+ * Sweeps every combination of the comma separated measurement intervals in
+ * minutes, upload and WiFi failure chances and wake models, for example
+ * one model per radio profile or site, and prints a line for each with
+ * the average current, awake time per upload, failed uploads, the share of
+ * stations stranded by a failed connect and the 10th, 50th and 90th
+ * percentile of battery life. Failure chances not given on the command
+ * line are those of the model. See battery_model.h for the model format.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "battery_model.h"
+
+/*! Default battery, 3 AA lithium cells */
+static const double DEFAULT_CAPACITY_MAH = 3000;
+
+/*! Upload cycles drawn for each setting */
+static const int CYCLES = 2000;
+
+/*! Default battery trials for each setting */
+static const int DEFAULT_TRIALS = 1000;
+
+/*! Requests of an upload with one sensor: interval, sample and telemetry */
+static const int DEFAULT_REQUESTS = 3;
+
+/*! LIGHT_SLEEP_MAX_INTERVAL_MIN of weather_main.cpp */
+static const int LIGHT_SLEEP_MAX_INTERVAL_MIN = 15;
+
+
+/*!
+ * @brief
+ *   Parse a comma separated list of numbers.
+ */
+static bool parse_list(const char *text, std::vector<double> &values)
+{
+    std::istringstream items(text);
+    std::string item;
+    values.clear();
+
+    while (std::getline(items, item, ','))
+    {
+        char *end;
+        values.push_back(strtod(item.c_str(), &end));
+
+        if (item.empty() || (*end != '\0') || (values.back() < 0))
+        {
+            return false;
+        }
+    }
+
+    return !values.empty();
+}
+
+
+/*!
+ * @brief
+ *   Read and parse a wake model file.
+ */
+static bool read_model(const char *path, WakeModel &model)
+{
+    std::ifstream file(path);
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    std::string error;
+
+    if (!file)
+    {
+        fprintf(stderr, "Cannot read %s\n", path);
+        return false;
+    }
+
+    if (!parse_wake_model(contents.str(), model, error))
+    {
+        fprintf(stderr, "Invalid wake model %s %s\n", path, error.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+    std::vector<double> intervals = {5, 10, 15, 20, 30, 60};
+    std::vector<double> upload_fails;
+    std::vector<double> wifi_fails;
+    BatterySettings settings = {0, LIGHT_SLEEP_MAX_INTERVAL_MIN, DEFAULT_REQUESTS, DEFAULT_CAPACITY_MAH};
+    int trials = DEFAULT_TRIALS;
+    bool ok = true;
+    int option;
+
+    while (ok && ((option = getopt(argc, argv, "i:u:w:c:r:n:")) != -1))
+    {
+        switch (option)
+        {
+            case 'i':
+                ok = parse_list(optarg, intervals);
+                break;
+            case 'u':
+                ok = parse_list(optarg, upload_fails);
+                break;
+            case 'w':
+                ok = parse_list(optarg, wifi_fails);
+                break;
+            case 'c':
+                settings.capacity_mah = atof(optarg);
+                break;
+            case 'r':
+                settings.requests = atoi(optarg);
+                break;
+            case 'n':
+                trials = atoi(optarg);
+                break;
+            default:
+                ok = false;
+                break;
+        }
+    }
+
+    if (!ok || (optind >= argc) || (settings.capacity_mah <= 0) || (settings.requests <= 0) || (trials <= 0))
+    {
+        fprintf(stderr, "Usage: %s [-i intervals] [-u upload_fails] [-w wifi_fails] [-c capacity_mah] "
+                        "[-r requests] [-n trials] <model.txt>...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::vector<WakeModel> models(static_cast<size_t>(argc - optind));
+
+    for (size_t i = 0; i < models.size(); i++)
+    {
+        if (!read_model(argv[optind + static_cast<int>(i)], models[i]))
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::mt19937 random(1);
+    int count = 0;
+    printf("# model interval_min upload_fail wifi_fail mean_ma awake_s failed_uploads stranded "
+           "p10_days p50_days p90_days\n");
+
+    for (size_t i = 0; i < models.size(); i++)
+    {
+        WakeModel model = models[i];
+        std::vector<double> model_upload_fails = upload_fails.empty() ? std::vector<double>{model.upload_fail}
+                                                                      : upload_fails;
+        std::vector<double> model_wifi_fails = wifi_fails.empty() ? std::vector<double>{model.wifi_fail}
+                                                                  : wifi_fails;
+
+        for (double interval_min : intervals)
+        {
+            for (double upload_fail : model_upload_fails)
+            {
+                for (double wifi_fail : model_wifi_fails)
+                {
+                    settings.interval_min = static_cast<int>(interval_min);
+                    model.upload_fail = std::min(upload_fail, 1.0);
+                    model.wifi_fail = std::min(wifi_fail, 1.0);
+                    BatteryLife life = battery_life(model, settings, CYCLES, trials, random);
+                    printf("%s %d %g %g %.4f %.2f %.4f %.3f %.0f %.0f %.0f\n", argv[optind + static_cast<int>(i)],
+                           settings.interval_min, model.upload_fail, model.wifi_fail, life.mean_ma, life.awake_s,
+                           life.failed_uploads, life.stranded, life.p10_days, life.p50_days, life.p90_days);
+                    count++;
+                }
+            }
+        }
+    }
+
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "%d settings in %.0f ms\n", count, elapsed_ms);
+
+    return EXIT_SUCCESS;
+}
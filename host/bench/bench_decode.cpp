@@ -0,0 +1,181 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Benchmark of the sensor decoders per model.
+ *
+ * Decodes one simulated capture of several sensors over and over with the
+ * decoder instantiated for each single-wire model, and converts SHT3x
+ * measurement bytes, reporting the time per capture, per sensor and per
+ * data bit.
+ *
+ * Usage: bench_decode [-n iterations] [-s sensors]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <unistd.h>
+#include "dht_sim.h"
+#include "sensor_model.h"
+
+typedef std::chrono::steady_clock Clock;
+
+/*! ESP32 CPU cycles per microsecond, the capture clock */
+static const uint32_t TICKS_PER_US = 240;
+
+/*! Time between input register polls of the capture loop */
+static const uint32_t SAMPLE_PERIOD_NS = 100;
+
+/*! Sum of all decoded values, printed so that decoding is not optimised out */
+static double checksum = 0;
+
+
+/*!
+ * @brief
+ *   Benchmark the decoder of one model and print its results.
+ *
+ * @param encode (IN)
+ *   Data encoder of the model for the simulator.
+ *
+ * @param sensors (IN)
+ *   Number of sensors in the capture.
+ *
+ * @param iterations (IN)
+ *   Number of decodes.
+ */
+template <class Model>
+static void bench_model(DhtEncoder encode, int sensors, size_t iterations)
+{
+    std::vector<DhtSensorModel> models(static_cast<size_t>(sensors));
+    std::vector<int> bits;
+
+    for (int i = 0; i < sensors; i++)
+    {
+        models[i].encode = encode;
+        models[i].bit = 4 + i;
+        models[i].temperature = 20.0f + i;
+        models[i].humidity = 40.0f + i;
+        models[i].response_delay_ns = 20000 + 3000 * i;
+        models[i].clock_scale = 0.95 + 0.02 * i;
+        models[i].jitter_ns = 3000;
+        bits.push_back(models[i].bit);
+    }
+
+    uint32_t initial_levels;
+    std::vector<DhtEdge> edges = dht_simulate(models, SAMPLE_PERIOD_NS, TICKS_PER_US, initial_levels, 1);
+    std::vector<DhtReading> readings(models.size());
+    Clock::time_point start = Clock::now();
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        dht_decode_channels<Model>(edges.data(), edges.size(), initial_levels, bits.data(), sensors, TICKS_PER_US,
+                                   readings.data());
+        checksum += readings[i % readings.size()].temperature;
+    }
+
+    double elapsed_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    double capture_ns = elapsed_ns / static_cast<double>(iterations);
+
+    for (const DhtReading &reading : readings)
+    {
+        if (reading.status != DHT_OK)
+        {
+            fprintf(stderr, "%s decode failed\n", Model::NAME);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    printf("%s_edges %zu\n", Model::NAME, edges.size());
+    printf("%s_ns_per_capture %.0f\n", Model::NAME, capture_ns);
+    printf("%s_ns_per_sensor %.0f\n", Model::NAME, capture_ns / sensors);
+    printf("%s_ns_per_bit %.2f\n", Model::NAME, capture_ns / sensors / Model::DATA_BITS);
+}
+
+
+/*!
+ * @brief
+ *   Benchmark SHT3x conversion and print its results.
+ *
+ * @param iterations (IN)
+ *   Number of conversions.
+ */
+static void bench_sht3x(size_t iterations)
+{
+    uint8_t data[Sht3x::DATA_BYTES];
+    sht3x_encode(21.5f, 40.0f, data);
+    DhtReading reading;
+    Clock::time_point start = Clock::now();
+
+    for (size_t i = 0; i < iterations; i++)
+    {
+        // Vary the data so that the conversion cannot be hoisted
+        data[1] = static_cast<uint8_t>(i);
+        checksum += Sht3x::convert(data, reading) + reading.temperature;
+    }
+
+    double elapsed_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    printf("%s_ns_per_sensor %.1f\n", Sht3x::NAME, elapsed_ns / static_cast<double>(iterations));
+}
+
+
+int main(int argc, char *argv[])
+{
+    size_t iterations = 100000;
+    int sensors = 4;
+    int option;
+
+    while ((option = getopt(argc, argv, "n:s:")) != -1)
+    {
+        switch (option)
+        {
+            case 'n':
+                iterations = strtoul(optarg, nullptr, 10);
+                break;
+            case 's':
+                sensors = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-n iterations] [-s sensors]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if ((iterations == 0) || (sensors < 1) || (sensors > DHT_MAX_CHANNELS - 4))
+    {
+        fprintf(stderr, "Need 1 or more iterations and 1-%d sensors\n", DHT_MAX_CHANNELS - 4);
+        return EXIT_FAILURE;
+    }
+
+    printf("sensors %d\n", sensors);
+    printf("iterations %zu\n", iterations);
+    bench_model<Dht22>(dht22_encode, sensors, iterations);
+    bench_model<Am2302>(dht22_encode, sensors, iterations);
+    bench_model<Dht11>(dht11_encode, sensors, iterations);
+    bench_sht3x(iterations);
+    printf("checksum %.1f\n", checksum);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,154 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Benchmark of delta firmware updates.
+ *
+ * Makes a simulated firmware image and a new version of it with a few
+ * changed functions and one new function, or reads two real images, and
+ * reports the full image and patch sizes, the time to make and apply the
+ * patch, the RAM used by the patcher on the station and the download time
+ * of the full image and the patch at the given link rate.
+ *
+ * Usage: bench_delta [-f functions] [-c changed] [-r link_kbit_s] [old.bin new.bin]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unistd.h>
+#include "delta_diff.h"
+#include "delta_patcher.h"
+#include "firmware_sim.h"
+#include "ota_update.h"
+
+typedef std::chrono::steady_clock Clock;
+
+
+/*!
+ * @brief
+ *   Read a file.
+ *
+ * @param path (IN)
+ *   File path.
+ *
+ * @param data (OUT)
+ *   File contents.
+ *
+ * @return
+ *   True if read, false otherwise.
+ */
+static bool read_file(const char *path, std::string &data)
+{
+    std::ifstream file(path, std::ios::binary);
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+    return !file.bad() && file.is_open();
+}
+
+
+int main(int argc, char *argv[])
+{
+    size_t functions = 6000;
+    size_t changed = 10;
+    double link_kbit_s = 1000;
+    int option;
+
+    while ((option = getopt(argc, argv, "f:c:r:")) != -1)
+    {
+        switch (option)
+        {
+            case 'f':
+                functions = strtoul(optarg, nullptr, 10);
+                break;
+            case 'c':
+                changed = strtoul(optarg, nullptr, 10);
+                break;
+            case 'r':
+                link_kbit_s = atof(optarg);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-f functions] [-c changed] [-r link_kbit_s] [old.bin new.bin]\n",
+                        argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    std::string old_image;
+    std::string new_image;
+
+    if (argc - optind == 2)
+    {
+        if (!read_file(argv[optind], old_image) || !read_file(argv[optind + 1], new_image))
+        {
+            fprintf(stderr, "Cannot read images\n");
+            return EXIT_FAILURE;
+        }
+    }
+    else if ((functions > 0) && (link_kbit_s > 0))
+    {
+        FirmwareProgram program(functions, 1);
+        old_image = program.render();
+        program.edit_functions(changed);
+        program.insert_function();
+        new_image = program.render();
+    }
+    else
+    {
+        fprintf(stderr, "Need 1 or more functions and a positive link rate\n");
+        return EXIT_FAILURE;
+    }
+
+    Clock::time_point start = Clock::now();
+    std::string patch = delta_diff(old_image, new_image);
+    double diff_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    std::string result;
+    std::string error;
+    start = Clock::now();
+    bool applied = delta_apply(old_image, patch, result, OtaUpdate::DOWNLOAD_BUFFER_SIZE, error);
+    double apply_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    if (!applied || (result != new_image))
+    {
+        fprintf(stderr, "Patch failed: %s\n", error.c_str());
+        return EXIT_FAILURE;
+    }
+
+    double bytes_per_s = link_kbit_s * 1000 / 8;
+    printf("old_bytes %zu\n", old_image.size());
+    printf("full_bytes %zu\n", new_image.size());
+    printf("patch_bytes %zu\n", patch.size());
+    printf("patch_ratio %.4f\n", static_cast<double>(patch.size()) / static_cast<double>(new_image.size()));
+    printf("diff_ms %.1f\n", diff_ms);
+    printf("apply_ms %.1f\n", apply_ms);
+    printf("station_ram_bytes %zu\n", sizeof(DeltaPatcher) + OtaUpdate::DOWNLOAD_BUFFER_SIZE);
+    printf("full_download_s %.2f\n", static_cast<double>(new_image.size()) / bytes_per_s);
+    printf("patch_download_s %.2f\n", static_cast<double>(patch.size()) / bytes_per_s);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,91 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Robustness of the DHT decoder against waveform faults.
+ *
+ * Decodes simulated DHT22 captures of each fault scenario of dht_faults.h
+ * and reports the shares of good reads, checksum errors, timeouts and
+ * wrong values that passed the checksum, and for a wake the reads, the
+ * time spent waiting for retries and the share of wakes left without a
+ * reading, with NUM_SENSOR_READ_RETRIES reads paced like on the station.
+ *
+ * Usage: bench_dht_faults [-n captures] [-w wakes]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include "dht_faults.h"
+#include "sensor_model.h"
+
+
+int main(int argc, char *argv[])
+{
+    size_t captures = 2000;
+    size_t wakes = 100000;
+    int option;
+
+    while ((option = getopt(argc, argv, "n:w:")) != -1)
+    {
+        switch (option)
+        {
+            case 'n':
+                captures = strtoul(optarg, nullptr, 10);
+                break;
+            case 'w':
+                wakes = strtoul(optarg, nullptr, 10);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-n captures] [-w wakes]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if ((captures == 0) || (wakes == 0))
+    {
+        fprintf(stderr, "Need 1 or more captures and wakes\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("captures %zu\n", captures);
+    printf("read_retries %d\n", DHT_FAULT_READ_RETRIES);
+    printf("min_interval_ms %d\n", Dht22::MIN_INTERVAL_MS);
+
+    for (const DhtFaultScenario &scenario : dht_fault_scenarios())
+    {
+        DhtFaultStats stats = dht_fault_run(scenario, captures, 1);
+        DhtRetryCost cost = dht_retry_cost(stats, DHT_FAULT_READ_RETRIES, Dht22::MIN_INTERVAL_MS, wakes, 1);
+        double count = static_cast<double>(stats.captures);
+        printf("%s_ok_rate %.4f\n", scenario.name, stats.ok / count);
+        printf("%s_checksum_rate %.4f\n", scenario.name, stats.checksum_errors / count);
+        printf("%s_timeout_rate %.4f\n", scenario.name, stats.timeouts / count);
+        printf("%s_wrong_rate %.4f\n", scenario.name, stats.wrong_values / count);
+        printf("%s_reads_per_wake %.3f\n", scenario.name, cost.reads);
+        printf("%s_retry_ms_per_wake %.1f\n", scenario.name, cost.retry_ms);
+        printf("%s_failed_wakes %.5f\n", scenario.name, cost.failed);
+    }
+
+    return EXIT_SUCCESS;
+}
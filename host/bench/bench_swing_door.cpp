@@ -0,0 +1,305 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Compression and reconstruction error of swing-door trends.
+ *
+ * Splits a series of temperature and humidity samples into light sleep
+ * windows, compresses each window with swing-door trends like the station
+ * and reconstructs it from the points rounded to one decimal like the
+ * collector. Reports the samples per trend point and per stored sample,
+ * the posted trend bytes per sample, and the largest reconstruction error
+ * against the largest error of storing only the window mean.
+ *
+ * The series is a recorded station exported from the collector as CSV
+ * (GET /export?station=<id>), or without -f a simulated week of DHT22
+ * readings every 30 s: daily cycles, a random walk of the weather and the
+ * sensor's 0.1 resolution and noise.
+ *
+ * Usage: bench_swing_door [-f export.csv] [-t temperature_deviation] [-u humidity_deviation] [-w window_samples]
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "swing_door.h"
+
+/*! Sample period of the simulated series, as on the station */
+static const int SAMPLE_PERIOD_S = 30;
+
+/*! Simulated days */
+static const int SIMULATED_DAYS = 7;
+
+/*! One recorded or simulated reading */
+struct Reading
+{
+    int64_t time_s;
+    float temperature;
+    float humidity;
+};
+
+/*! Totals over all windows of one series */
+struct TrendResult
+{
+    size_t samples;
+    size_t windows;
+    size_t temperature_points;
+    size_t humidity_points;
+    size_t stored_samples;
+    size_t trend_bytes;
+    size_t incomplete;
+    double temperature_error;
+    double humidity_error;
+    double temperature_mean_error;
+    double humidity_mean_error;
+};
+
+
+/*!
+ * @brief
+ *   Read a station exported as CSV: time,temperature,humidity,sequence.
+ *
+ * @return
+ *   True if the file has readings, false otherwise.
+ */
+static bool read_export(const std::string &path, std::vector<Reading> &readings)
+{
+    std::ifstream file(path);
+    std::string line;
+
+    while (std::getline(file, line))
+    {
+        long long time_s;
+        Reading reading;
+
+        if (sscanf(line.c_str(), "%lld,%f,%f", &time_s, &reading.temperature, &reading.humidity) == 3)
+        {
+            reading.time_s = time_s;
+            readings.push_back(reading);
+        }
+    }
+
+    return !readings.empty();
+}
+
+
+/*!
+ * @brief
+ *   Simulate a week of DHT22 readings.
+ */
+static void simulate(std::vector<Reading> &readings)
+{
+    std::mt19937 random(1);
+    std::normal_distribution<float> noise(0.0f, 0.05f);
+    std::normal_distribution<float> weather(0.0f, 0.01f);
+    float drift = 0.0f;
+
+    for (int i = 0; i < SIMULATED_DAYS * 86400 / SAMPLE_PERIOD_S; i++)
+    {
+        double day = static_cast<double>(i) * SAMPLE_PERIOD_S / 86400.0;
+        drift = 0.999f * drift + weather(random);
+        float temperature = static_cast<float>(12.0 + 6.0 * sin(2 * M_PI * (day - 0.375))) + 5.0f * drift;
+        float humidity = static_cast<float>(70.0 - 15.0 * sin(2 * M_PI * (day - 0.375))) - 20.0f * drift;
+        Reading reading = {i * SAMPLE_PERIOD_S, roundf((temperature + noise(random)) * 10.0f) / 10.0f,
+                           roundf((humidity + 4.0f * noise(random)) * 10.0f) / 10.0f};
+        readings.push_back(reading);
+    }
+}
+
+
+/*!
+ * @brief
+ *   Round trend points to one decimal as posted.
+ */
+static std::vector<TrendPoint> posted_points(const SwingDoor &trend, size_t &bytes)
+{
+    std::vector<TrendPoint> points(trend.points(), trend.points() + trend.count());
+    int32_t end_s = points.back().time_s;
+
+    for (TrendPoint &point : points)
+    {
+        char text[32];
+        point.value = roundf(point.value * 10.0f) / 10.0f;
+        bytes += static_cast<size_t>(snprintf(text, sizeof(text), ",%d:%.1f", end_s - point.time_s, point.value));
+    }
+
+    return points;
+}
+
+
+/*!
+ * @brief
+ *   Compress the series in windows and reconstruct it.
+ */
+static TrendResult run_trends(const std::vector<Reading> &readings, float temperature_deviation,
+                              float humidity_deviation, size_t window_samples)
+{
+    TrendResult result = {};
+    SwingDoor temperature_trend;
+    SwingDoor humidity_trend;
+
+    for (size_t begin = 0; begin < readings.size(); begin += window_samples)
+    {
+        size_t end = std::min(readings.size(), begin + window_samples);
+        int64_t start_s = readings[begin].time_s;
+        double temperature_sum = 0.0;
+        double humidity_sum = 0.0;
+        temperature_trend.start(temperature_deviation);
+        humidity_trend.start(humidity_deviation);
+
+        for (size_t i = begin; i < end; i++)
+        {
+            temperature_trend.add(static_cast<int32_t>(readings[i].time_s - start_s), readings[i].temperature);
+            humidity_trend.add(static_cast<int32_t>(readings[i].time_s - start_s), readings[i].humidity);
+            temperature_sum += readings[i].temperature;
+            humidity_sum += readings[i].humidity;
+        }
+
+        temperature_trend.finish();
+        humidity_trend.finish();
+        result.windows++;
+        result.samples += end - begin;
+
+        // The station posts a window that does not fit as its means
+        if (!temperature_trend.complete() || !humidity_trend.complete())
+        {
+            result.incomplete++;
+            result.stored_samples++;
+            continue;
+        }
+
+        std::vector<TrendPoint> temperature = posted_points(temperature_trend, result.trend_bytes);
+        std::vector<TrendPoint> humidity = posted_points(humidity_trend, result.trend_bytes);
+        std::vector<int32_t> times;
+
+        for (const std::vector<TrendPoint> *trend : {&temperature, &humidity})
+        {
+            for (const TrendPoint &point : *trend)
+            {
+                times.push_back(point.time_s);
+            }
+        }
+
+        std::sort(times.begin(), times.end());
+        result.stored_samples += static_cast<size_t>(std::unique(times.begin(), times.end()) - times.begin());
+        result.temperature_points += temperature.size();
+        result.humidity_points += humidity.size();
+        double temperature_mean = temperature_sum / static_cast<double>(end - begin);
+        double humidity_mean = humidity_sum / static_cast<double>(end - begin);
+
+        for (size_t i = begin; i < end; i++)
+        {
+            int32_t time_s = static_cast<int32_t>(readings[i].time_s - start_s);
+            float temperature_value = trend_value(temperature.data(), static_cast<int>(temperature.size()), time_s);
+            float humidity_value = trend_value(humidity.data(), static_cast<int>(humidity.size()), time_s);
+            result.temperature_error = std::max(result.temperature_error,
+                                                fabs(static_cast<double>(temperature_value - readings[i].temperature)));
+            result.humidity_error = std::max(result.humidity_error,
+                                             fabs(static_cast<double>(humidity_value - readings[i].humidity)));
+            result.temperature_mean_error = std::max(result.temperature_mean_error,
+                                                     fabs(temperature_mean - readings[i].temperature));
+            result.humidity_mean_error = std::max(result.humidity_mean_error,
+                                                  fabs(humidity_mean - readings[i].humidity));
+        }
+    }
+
+    return result;
+}
+
+
+int main(int argc, char *argv[])
+{
+    std::string path;
+    float temperature_deviation = 0.5f;
+    float humidity_deviation = 2.0f;
+    size_t window_samples = 30;
+    int option;
+
+    while ((option = getopt(argc, argv, "f:t:u:w:")) != -1)
+    {
+        switch (option)
+        {
+            case 'f':
+                path = optarg;
+                break;
+            case 't':
+                temperature_deviation = strtof(optarg, nullptr);
+                break;
+            case 'u':
+                humidity_deviation = strtof(optarg, nullptr);
+                break;
+            case 'w':
+                window_samples = strtoul(optarg, nullptr, 10);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-f export.csv] [-t temperature_deviation] [-u humidity_deviation] "
+                        "[-w window_samples]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<Reading> readings;
+
+    if (path.empty())
+    {
+        simulate(readings);
+    }
+    else if (!read_export(path, readings))
+    {
+        fprintf(stderr, "No samples in %s\n", path.c_str());
+        return EXIT_FAILURE;
+    }
+
+    if ((window_samples == 0) || (temperature_deviation <= 0) || (humidity_deviation <= 0))
+    {
+        fprintf(stderr, "Need 1 or more window samples and deviations over 0\n");
+        return EXIT_FAILURE;
+    }
+
+    TrendResult result = run_trends(readings, temperature_deviation, humidity_deviation, window_samples);
+    double samples = static_cast<double>(result.samples);
+
+    printf("series %s\n", path.empty() ? "simulated" : path.c_str());
+    printf("samples %zu\n", result.samples);
+    printf("windows %zu\n", result.windows);
+    printf("incomplete_windows %zu\n", result.incomplete);
+    printf("temperature_deviation %.2f\n", temperature_deviation);
+    printf("humidity_deviation %.2f\n", humidity_deviation);
+    printf("temperature_samples_per_point %.2f\n", samples / std::max<size_t>(result.temperature_points, 1));
+    printf("humidity_samples_per_point %.2f\n", samples / std::max<size_t>(result.humidity_points, 1));
+    printf("compression_ratio %.2f\n", samples / std::max<size_t>(result.stored_samples, 1));
+    printf("trend_bytes_per_sample %.2f\n", static_cast<double>(result.trend_bytes) / samples);
+    printf("temperature_max_error %.3f\n", result.temperature_error);
+    printf("humidity_max_error %.3f\n", result.humidity_error);
+    printf("temperature_mean_max_error %.3f\n", result.temperature_mean_error);
+    printf("humidity_mean_max_error %.3f\n", result.humidity_mean_error);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,287 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <cstring>
+#include <vector>
+#include "delta_diff.h"
+#include "delta_format.h"
+#include "delta_patcher.h"
+
+/*! Marks an empty hash table slot */
+static const uint32_t EMPTY_SLOT = UINT32_MAX;
+
+
+/*!
+ * @brief
+ *   Hash of DELTA_MATCH_SIZE bytes (FNV-1a).
+ */
+static uint32_t match_hash(const uint8_t *data)
+{
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < DELTA_MATCH_SIZE; i++)
+    {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+
+/*! Index of the old image positions by hash. The first position of each
+ *  hash is kept, so runs of equal bytes do not fill the table. */
+class MatchIndex
+{
+public:
+    MatchIndex(const std::string &image) : data(reinterpret_cast<const uint8_t *>(image.data())), size(image.size())
+    {
+        size_t slots = 1;
+
+        while (slots < 2 * size)
+        {
+            slots <<= 1;
+        }
+
+        mask = slots - 1;
+        table.assign(slots, EMPTY_SLOT);
+
+        for (size_t i = 0; i + DELTA_MATCH_SIZE <= size; i++)
+        {
+            uint32_t &slot = table[match_hash(data + i) & mask];
+
+            if (slot == EMPTY_SLOT)
+            {
+                slot = static_cast<uint32_t>(i);
+            }
+        }
+    }
+
+    /*! Position of DELTA_MATCH_SIZE bytes in the image, EMPTY_SLOT if none */
+    uint32_t find(const uint8_t *bytes) const
+    {
+        uint32_t position = table[match_hash(bytes) & mask];
+
+        if ((position != EMPTY_SLOT) && (memcmp(data + position, bytes, DELTA_MATCH_SIZE) != 0))
+        {
+            position = EMPTY_SLOT;
+        }
+
+        return position;
+    }
+
+private:
+    const uint8_t *data;
+    size_t size;
+    size_t mask;
+    std::vector<uint32_t> table;
+};
+
+
+/*!
+ * @brief
+ *   Append ADD of new image bytes to a patch.
+ */
+static void append_add(std::string &patch, const std::string &new_image, size_t from, size_t to)
+{
+    if (to > from)
+    {
+        patch += static_cast<char>(DELTA_ADD);
+        delta_append_varint(patch, static_cast<uint32_t>(to - from));
+        patch.append(new_image, from, to - from);
+    }
+}
+
+
+/*!
+ * @brief
+ *   Make a delta patch from an old image to a new one.
+ *
+ * @param old_image (IN)
+ *   Image on the station.
+ *
+ * @param new_image (IN)
+ *   Image to install.
+ *
+ * @return
+ *   Patch.
+ */
+std::string delta_diff(const std::string &old_image, const std::string &new_image)
+{
+    const uint8_t *old_data = reinterpret_cast<const uint8_t *>(old_image.data());
+    const uint8_t *new_data = reinterpret_cast<const uint8_t *>(new_image.data());
+    size_t old_size = old_image.size();
+    size_t new_size = new_image.size();
+    DeltaHeader header = {static_cast<uint32_t>(old_size), delta_crc32(0, old_data, old_size),
+                          static_cast<uint32_t>(new_size), delta_crc32(0, new_data, new_size)};
+    std::string patch(DELTA_HEADER_SIZE, 0);
+    delta_encode_header(header, reinterpret_cast<uint8_t *>(&patch[0]));
+
+    MatchIndex index(old_image);
+    size_t cursor = 0;
+    size_t added = 0;
+    size_t position = 0;
+
+    while (position + DELTA_MATCH_SIZE <= new_size)
+    {
+        size_t match = EMPTY_SLOT;
+
+        if ((cursor + DELTA_CURSOR_MATCH_SIZE <= old_size) &&
+            (memcmp(old_data + cursor, new_data + position, DELTA_CURSOR_MATCH_SIZE) == 0))
+        {
+            match = cursor;
+        }
+        else
+        {
+            match = index.find(new_data + position);
+        }
+
+        if (match == EMPTY_SLOT)
+        {
+            position++;
+            continue;
+        }
+
+        // Extend back over the bytes that would be added, then forward
+        while ((position > added) && (match > 0) && (new_data[position - 1] == old_data[match - 1]))
+        {
+            position--;
+            match--;
+        }
+
+        size_t length = 0;
+
+        while ((position + length < new_size) && (match + length < old_size) &&
+               (new_data[position + length] == old_data[match + length]))
+        {
+            length++;
+        }
+
+        append_add(patch, new_image, added, position);
+        patch += static_cast<char>(DELTA_COPY);
+        delta_append_varint(patch, delta_zigzag(static_cast<int32_t>(match - cursor)));
+        delta_append_varint(patch, static_cast<uint32_t>(length));
+        position += length;
+        cursor = match + length;
+        added = position;
+    }
+
+    append_add(patch, new_image, added, new_size);
+
+    return patch;
+}
+
+
+/*! Old image in memory */
+class MemorySource : public DeltaSource
+{
+public:
+    MemorySource(const std::string &image) : data(image)
+    {
+    }
+
+    bool read(uint32_t offset, uint8_t *buffer, size_t size)
+    {
+        if (offset + size > data.size())
+        {
+            return false;
+        }
+
+        memcpy(buffer, data.data() + offset, size);
+        return true;
+    }
+
+private:
+    const std::string &data;
+};
+
+
+/*! New image in memory */
+class MemorySink : public DeltaSink
+{
+public:
+    MemorySink(std::string &image) : data(image)
+    {
+    }
+
+    bool begin(uint32_t size)
+    {
+        data.clear();
+        data.reserve(size);
+        return true;
+    }
+
+    bool write(const uint8_t *buffer, size_t size)
+    {
+        data.append(reinterpret_cast<const char *>(buffer), size);
+        return true;
+    }
+
+private:
+    std::string &data;
+};
+
+
+/*!
+ * @brief
+ *   Apply a patch with the station's patcher, feeding it in pieces as a
+ *   download would.
+ *
+ * @param old_image (IN)
+ *   Image the patch was made against.
+ *
+ * @param patch (IN)
+ *   Patch.
+ *
+ * @param new_image (OUT)
+ *   Patched image.
+ *
+ * @param piece_size (IN)
+ *   Size of the pieces fed to the patcher.
+ *
+ * @param error (OUT)
+ *   Reason of failure.
+ *
+ * @return
+ *   True if the patch applied and the new image has the CRC of the patch,
+ *   false otherwise.
+ */
+bool delta_apply(const std::string &old_image, const std::string &patch, std::string &new_image,
+                 size_t piece_size, std::string &error)
+{
+    MemorySource source(old_image);
+    MemorySink sink(new_image);
+    DeltaPatcher patcher(source, sink);
+    bool ok = true;
+
+    for (size_t offset = 0; ok && (offset < patch.size()); offset += piece_size)
+    {
+        size_t length = (patch.size() - offset < piece_size) ? patch.size() - offset : piece_size;
+        ok = patcher.feed(reinterpret_cast<const uint8_t *>(patch.data()) + offset, length);
+    }
+
+    ok = ok && patcher.finish();
+    error = (patcher.error() != nullptr) ? patcher.error() : "";
+
+    return ok;
+}
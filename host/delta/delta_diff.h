@@ -0,0 +1,47 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Delta patch generator for firmware updates, see delta_format.h.
+ *
+ * Every position of the old image is indexed by a hash of the MATCH_SIZE
+ * bytes from it. The new image is scanned left to right: a match at the
+ * old cursor is preferred, since unchanged code follows changed code at
+ * the same distance, and otherwise the hash finds the match. Matches are
+ * extended both ways and the bytes between them are added as they are.
+ */
+
+#pragma once
+
+#include <string>
+
+/*! Shortest match found by hash */
+static const size_t DELTA_MATCH_SIZE = 16;
+
+/*! Shortest match continued at the old cursor, where a copy costs 3 bytes */
+static const size_t DELTA_CURSOR_MATCH_SIZE = 8;
+
+std::string delta_diff(const std::string &old_image, const std::string &new_image);
+bool delta_apply(const std::string &old_image, const std::string &patch, std::string &new_image,
+                 size_t piece_size, std::string &error);
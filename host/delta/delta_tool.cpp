@@ -0,0 +1,156 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Delta patch tool for firmware updates over the air.
+ *
+ *   delta_tool diff <old.bin> <new.bin> <patch.wsd>
+ *   delta_tool verify <old.bin> <new.bin> <patch.wsd>
+ *   delta_tool apply <old.bin> <patch.wsd> <new.bin>
+ *
+ * diff makes a patch and verifies it. verify applies a patch with the
+ * station's patcher, fed in download sized pieces, and compares the result
+ * with the new image. Stations download "<from>-<to>.wsd", for example
+ * 2-3.wsd from firmware 2 to 3.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "delta_diff.h"
+#include "delta_format.h"
+#include "ota_update.h"
+
+
+/*!
+ * @brief
+ *   Read a whole file.
+ */
+static bool read_file(const char *path, std::string &data)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    data = contents.str();
+
+    if (!file)
+    {
+        fprintf(stderr, "Cannot read %s\n", path);
+        return false;
+    }
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Write a whole file.
+ */
+static bool write_file(const char *path, const std::string &data)
+{
+    std::ofstream file(path, std::ios::binary);
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+
+    if (!file)
+    {
+        fprintf(stderr, "Cannot write %s\n", path);
+        return false;
+    }
+
+    return true;
+}
+
+
+/*!
+ * @brief
+ *   Apply a patch as the station does and compare the result.
+ */
+static bool verify(const std::string &old_image, const std::string &new_image, const std::string &patch)
+{
+    std::string patched;
+    std::string error;
+
+    if (!delta_apply(old_image, patch, patched, OtaUpdate::DOWNLOAD_BUFFER_SIZE, error))
+    {
+        fprintf(stderr, "Patch does not apply: %s\n", error.c_str());
+        return false;
+    }
+
+    if (patched != new_image)
+    {
+        fprintf(stderr, "Patched image differs from new image\n");
+        return false;
+    }
+
+    printf("old %zu bytes, new %zu bytes, patch %zu bytes (%.1f %% of new)\n", old_image.size(), new_image.size(),
+           patch.size(), 100.0 * static_cast<double>(patch.size()) / static_cast<double>(new_image.size()));
+
+    return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+    std::string old_image;
+    std::string new_image;
+    std::string patch;
+
+    if ((argc == 5) && (strcmp(argv[1], "diff") == 0))
+    {
+        bool ok = read_file(argv[2], old_image) && read_file(argv[3], new_image);
+        patch = delta_diff(old_image, new_image);
+        ok = ok && verify(old_image, new_image, patch) && write_file(argv[4], patch);
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    else if ((argc == 5) && (strcmp(argv[1], "verify") == 0))
+    {
+        bool ok = read_file(argv[2], old_image) && read_file(argv[3], new_image) && read_file(argv[4], patch) &&
+                  verify(old_image, new_image, patch);
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    else if ((argc == 5) && (strcmp(argv[1], "apply") == 0))
+    {
+        std::string error;
+        bool ok = read_file(argv[2], old_image) && read_file(argv[3], patch);
+
+        if (ok && !delta_apply(old_image, patch, new_image, OtaUpdate::DOWNLOAD_BUFFER_SIZE, error))
+        {
+            fprintf(stderr, "Patch does not apply: %s\n", error.c_str());
+            ok = false;
+        }
+
+        ok = ok && write_file(argv[4], new_image);
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    fprintf(stderr, "Usage: %s diff <old.bin> <new.bin> <patch.wsd>\n"
+                    "       %s verify <old.bin> <new.bin> <patch.wsd>\n"
+                    "       %s apply <old.bin> <patch.wsd> <new.bin>\n", argv[0], argv[0], argv[0]);
+
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,110 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Robustness of the DHT decoder against waveform faults.
+ *
+ * A scenario is a DHT22 with one kind of fault, see dht_sim.h: pulse
+ * jitter, glitches, pulses held longer, a slow or fast sensor clock, lost
+ * level changes, and stalls of the capture loop. dht_fault_run() decodes
+ * many captures of a scenario with dht_decode_channels() and counts the
+ * outcomes, including wrong values that passed the checksum.
+ *
+ * dht_retry_cost() turns the outcomes into the cost of a wake: the reads
+ * of read_sensor_data() in weather_main.cpp, retried up to
+ * NUM_SENSOR_READ_RETRIES times and paced by SensorTiming, with the
+ * minimum read interval after a checksum error and a growing wait after
+ * timeouts.
+ *
+ * DHT_FAULT_BASELINE holds the shares of good reads and of wrong values of
+ * each scenario with the current decoder. The host tests check that a
+ * decoder change neither reads less nor passes more wrong values.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "dht_sim.h"
+
+/*! One kind of fault */
+struct DhtFaultScenario
+{
+    const char *name;
+    DhtSensorModel sensor;
+    DhtCaptureGaps gaps;
+};
+
+/*! Outcomes of the captures of a scenario */
+struct DhtFaultStats
+{
+    size_t captures;
+    size_t ok;
+    size_t checksum_errors;
+    size_t timeouts;
+
+    /*! Reads that passed the checksum with wrong values */
+    size_t wrong_values;
+};
+
+/*! Cost of the sensor reads of a wake */
+struct DhtRetryCost
+{
+    /*! Reads per wake */
+    double reads;
+
+    /*! Time spent waiting for retries per wake in ms */
+    double retry_ms;
+
+    /*! Share of wakes without a valid reading */
+    double failed;
+};
+
+/*! Outcomes of a scenario with the current decoder */
+struct DhtFaultBaseline
+{
+    const char *name;
+    double min_ok_rate;
+    double max_wrong_rate;
+};
+
+/*! ESP32 CPU cycles per microsecond, the capture clock */
+static const uint32_t DHT_FAULT_TICKS_PER_US = 240;
+
+/*! Time between input register polls of the capture loop */
+static const uint32_t DHT_FAULT_SAMPLE_PERIOD_NS = 100;
+
+/*! NUM_SENSOR_READ_RETRIES of weather_main.cpp */
+static const int DHT_FAULT_READ_RETRIES = 5;
+
+/*! Time of one capture: start signal and transmission */
+static const int DHT_FAULT_CAPTURE_MS = 8;
+
+extern const DhtFaultBaseline DHT_FAULT_BASELINE[];
+extern const size_t DHT_FAULT_BASELINE_COUNT;
+
+std::vector<DhtFaultScenario> dht_fault_scenarios();
+DhtFaultStats dht_fault_run(const DhtFaultScenario &scenario, size_t captures, unsigned seed);
+DhtRetryCost dht_retry_cost(const DhtFaultStats &stats, int retries, int min_interval_ms, size_t wakes,
+                            unsigned seed);
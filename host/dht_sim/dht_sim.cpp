@@ -0,0 +1,334 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include "dht_sim.h"
+#include "sensor_model.h"
+
+/*! Nominal DHT timing in ns */
+static const uint32_t RESPONSE_LOW_NS = 80000;
+static const uint32_t RESPONSE_HIGH_NS = 80000;
+static const uint32_t BIT_LOW_NS = 50000;
+static const uint32_t ZERO_HIGH_NS = 27000;
+static const uint32_t ONE_HIGH_NS = 70000;
+static const uint32_t END_LOW_NS = 50000;
+
+/*! Data bits in a transmission, same for all single-wire models */
+static const int DATA_BITS = 40;
+
+
+/*!
+ * @brief
+ *   Encode temperature and humidity as DHT22 and AM2302 data bytes.
+ *
+ * @param temperature (IN)
+ *   Temperature in degrees Celsius.
+ *
+ * @param humidity (IN)
+ *   Humidity in percent.
+ *
+ * @param data (OUT)
+ *   5 bytes: humidity, temperature with sign bit, checksum.
+ */
+void dht22_encode(float temperature, float humidity, uint8_t *data)
+{
+    int humidity_tenths = static_cast<int>(lround(humidity * 10));
+    int temperature_tenths = static_cast<int>(lround(fabs(temperature) * 10));
+    data[0] = static_cast<uint8_t>(humidity_tenths >> 8);
+    data[1] = static_cast<uint8_t>(humidity_tenths);
+    data[2] = static_cast<uint8_t>(((temperature_tenths >> 8) & 0x7F) | ((temperature < 0) ? 0x80 : 0));
+    data[3] = static_cast<uint8_t>(temperature_tenths);
+    data[4] = static_cast<uint8_t>(data[0] + data[1] + data[2] + data[3]);
+}
+
+
+/*!
+ * @brief
+ *   Encode temperature and humidity as DHT11 data bytes, with tenths and
+ *   temperature sign like newer DHT11 parts.
+ *
+ * @param temperature (IN)
+ *   Temperature in degrees Celsius.
+ *
+ * @param humidity (IN)
+ *   Humidity in percent.
+ *
+ * @param data (OUT)
+ *   5 bytes: humidity integer and tenths, temperature integer and tenths
+ *   with sign bit, checksum.
+ */
+void dht11_encode(float temperature, float humidity, uint8_t *data)
+{
+    int humidity_tenths = static_cast<int>(lround(humidity * 10));
+    int temperature_tenths = static_cast<int>(lround(fabs(temperature) * 10));
+    data[0] = static_cast<uint8_t>(humidity_tenths / 10);
+    data[1] = static_cast<uint8_t>(humidity_tenths % 10);
+    data[2] = static_cast<uint8_t>(temperature_tenths / 10);
+    data[3] = static_cast<uint8_t>((temperature_tenths % 10) | ((temperature < 0) ? 0x80 : 0));
+    data[4] = static_cast<uint8_t>(data[0] + data[1] + data[2] + data[3]);
+}
+
+
+/*!
+ * @brief
+ *   Encode temperature and humidity as SHT3x measurement bytes.
+ *
+ * @param temperature (IN)
+ *   Temperature in degrees Celsius, -45 to 130.
+ *
+ * @param humidity (IN)
+ *   Humidity in percent.
+ *
+ * @param data (OUT)
+ *   6 bytes: temperature, CRC, humidity, CRC.
+ */
+void sht3x_encode(float temperature, float humidity, uint8_t *data)
+{
+    long temperature_raw = lround((temperature + 45.0) * 65535 / 175);
+    long humidity_raw = lround(humidity * 65535.0 / 100);
+    data[0] = static_cast<uint8_t>(temperature_raw >> 8);
+    data[1] = static_cast<uint8_t>(temperature_raw);
+    data[2] = Sht3x::crc8(data, 2);
+    data[3] = static_cast<uint8_t>(humidity_raw >> 8);
+    data[4] = static_cast<uint8_t>(humidity_raw);
+    data[5] = Sht3x::crc8(data + 3, 2);
+}
+
+
+/*!
+ * @brief
+ *   Generate the line level changes of one sensor.
+ *   The line is high at time 0, when the start signal is released.
+ *   Faults are drawn only when their chance is set, so a sensor without
+ *   faults draws the same jitter for a seed.
+ *
+ * @param sensor (IN)
+ *   Sensor model.
+ *
+ * @param random (IN/OUT)
+ *   Random generator for jitter and faults.
+ *
+ * @return
+ *   Level changes in time order.
+ */
+std::vector<DhtTransition> dht_waveform(const DhtSensorModel &sensor, std::mt19937 &random)
+{
+    std::vector<DhtTransition> transitions;
+
+    if (!sensor.present)
+    {
+        return transitions;
+    }
+
+    std::uniform_int_distribution<int64_t> jitter(-static_cast<int64_t>(sensor.jitter_ns), sensor.jitter_ns);
+    std::uniform_real_distribution<double> unit(0, 1);
+    uint64_t time_ns = sensor.response_delay_ns;
+    bool level = false;
+
+    auto happens = [&](double rate)
+    {
+        return (rate > 0) && (unit(random) < rate);
+    };
+
+    auto pulse = [&](uint32_t nominal_ns)
+    {
+        if (!happens(sensor.drop_rate))
+        {
+            transitions.push_back({time_ns, sensor.bit, level});
+        }
+
+        int64_t width = static_cast<int64_t>(nominal_ns / sensor.clock_scale) + jitter(random);
+        width += happens(sensor.stretch_rate) ? sensor.stretch_ns : 0;
+        width = std::max<int64_t>(width, 1);
+
+        if (happens(sensor.glitch_rate))
+        {
+            uint64_t spike_ns = time_ns + static_cast<uint64_t>(width) / 2;
+            transitions.push_back({spike_ns, sensor.bit, !level});
+            transitions.push_back({spike_ns + sensor.glitch_ns, sensor.bit, level});
+        }
+
+        time_ns += static_cast<uint64_t>(width);
+        level = !level;
+    };
+
+    uint8_t data[5];
+    sensor.encode(sensor.temperature, sensor.humidity, data);
+
+    if (sensor.corrupt_bit >= 0)
+    {
+        data[sensor.corrupt_bit / 8] ^= static_cast<uint8_t>(0x80 >> (sensor.corrupt_bit % 8));
+    }
+
+    pulse(RESPONSE_LOW_NS);
+    pulse(RESPONSE_HIGH_NS);
+
+    for (int i = 0; i < DATA_BITS; i++)
+    {
+        pulse(BIT_LOW_NS);
+        pulse((data[i / 8] & (0x80 >> (i % 8))) ? ONE_HIGH_NS : ZERO_HIGH_NS);
+    }
+
+    pulse(END_LOW_NS);
+    transitions.push_back({time_ns, sensor.bit, true});
+
+    return transitions;
+}
+
+
+/*!
+ * @brief
+ *   Sample level changes like a polling loop reading the input register.
+ *   A change is seen at the first poll after it, and changes between two
+ *   polls show up as one edge. No poll is made during a gap, so a pulse
+ *   shorter than the gap is lost.
+ *
+ * @param transitions (IN)
+ *   Level changes of all sensors, any order.
+ *
+ * @param idle_levels (IN)
+ *   Register levels at time 0.
+ *
+ * @param sample_period_ns (IN)
+ *   Time between polls.
+ *
+ * @param ticks_per_us (IN)
+ *   Capture clock ticks per microsecond.
+ *
+ * @param initial_levels (OUT)
+ *   Register levels at first poll.
+ *
+ * @param gaps (IN)
+ *   Stalls of the polling loop in time order.
+ *
+ * @return
+ *   Edge timeline.
+ */
+std::vector<DhtEdge> dht_sample(std::vector<DhtTransition> transitions, uint32_t idle_levels,
+                                uint32_t sample_period_ns, uint32_t ticks_per_us, uint32_t &initial_levels,
+                                const std::vector<DhtGap> &gaps)
+{
+    std::stable_sort(transitions.begin(), transitions.end(),
+                     [](const DhtTransition &a, const DhtTransition &b) { return a.time_ns < b.time_ns; });
+
+    std::vector<DhtEdge> edges;
+    uint32_t levels = idle_levels;
+    initial_levels = idle_levels;
+    size_t i = 0;
+    size_t gap = 0;
+
+    while (i < transitions.size())
+    {
+        uint64_t poll_ns = (transitions[i].time_ns / sample_period_ns + 1) * sample_period_ns;
+
+        while ((gap < gaps.size()) && (gaps[gap].start_ns + gaps[gap].length_ns <= poll_ns) &&
+               (gaps[gap].start_ns + gaps[gap].length_ns <= transitions[i].time_ns))
+        {
+            gap++;
+        }
+
+        if ((gap < gaps.size()) && (gaps[gap].start_ns < poll_ns))
+        {
+            poll_ns = std::max(poll_ns, gaps[gap].start_ns + gaps[gap].length_ns);
+        }
+
+        while ((i < transitions.size()) && (transitions[i].time_ns < poll_ns))
+        {
+            uint32_t bit = 1u << transitions[i].bit;
+            levels = transitions[i].level ? (levels | bit) : (levels & ~bit);
+            i++;
+        }
+
+        if (edges.empty() ? (levels != initial_levels) : (levels != edges.back().levels))
+        {
+            edges.push_back({static_cast<uint32_t>(poll_ns * ticks_per_us / 1000), levels});
+        }
+    }
+
+    return edges;
+}
+
+
+/*!
+ * @brief
+ *   Simulate one capture of several sensors.
+ *
+ * @param sensors (IN)
+ *   Sensor models.
+ *
+ * @param sample_period_ns (IN)
+ *   Time between register polls.
+ *
+ * @param ticks_per_us (IN)
+ *   Capture clock ticks per microsecond.
+ *
+ * @param initial_levels (OUT)
+ *   Register levels at start of capture.
+ *
+ * @param seed (IN)
+ *   Random seed for jitter, faults and gaps.
+ *
+ * @param gaps (IN)
+ *   Stalls of the capture loop, none by default.
+ *
+ * @return
+ *   Edge timeline.
+ */
+std::vector<DhtEdge> dht_simulate(const std::vector<DhtSensorModel> &sensors, uint32_t sample_period_ns,
+                                  uint32_t ticks_per_us, uint32_t &initial_levels, unsigned seed,
+                                  const DhtCaptureGaps &gaps)
+{
+    std::mt19937 random(seed);
+    std::vector<DhtTransition> transitions;
+    uint32_t idle_levels = 0;
+
+    for (const DhtSensorModel &sensor : sensors)
+    {
+        std::vector<DhtTransition> waveform = dht_waveform(sensor, random);
+        transitions.insert(transitions.end(), waveform.begin(), waveform.end());
+        idle_levels |= 1u << sensor.bit;
+    }
+
+    // Gaps come at random times over the capture, a Poisson process
+    std::vector<DhtGap> stalls;
+    uint64_t end_ns = 0;
+
+    for (const DhtTransition &transition : transitions)
+    {
+        end_ns = std::max(end_ns, transition.time_ns);
+    }
+
+    if (gaps.per_ms > 0)
+    {
+        std::exponential_distribution<double> between_ns(gaps.per_ms / 1e6);
+
+        for (double time_ns = between_ns(random); time_ns < end_ns; time_ns += gaps.length_ns + between_ns(random))
+        {
+            stalls.push_back({static_cast<uint64_t>(time_ns), gaps.length_ns});
+        }
+    }
+
+    return dht_sample(transitions, idle_levels, sample_period_ns, ticks_per_us, initial_levels, stalls);
+}
@@ -0,0 +1,134 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * DHT waveform simulator.
+ *
+ * Generates the line levels of DHT sensors answering one start signal and
+ * samples them the way DHTMulti polls the GPIO input register, giving the
+ * edge timeline that dht_decode_channels() decodes. Each sensor has its own
+ * response delay, clock skew and pulse jitter, so the sensors' edges drift
+ * apart over a transmission like they do with real parts.
+ *
+ * Faults can be injected into the waveform of a sensor: glitches, pulses
+ * held longer, lost level changes, and into the capture: gaps where the
+ * polling loop stalls, see dht_faults.h.
+ *
+ * DHT11, DHT22 and AM2302 share the waveform and differ in the data bytes,
+ * which come from the sensor's encoder. sht3x_encode() gives the bytes of
+ * an SHT3x measurement for the I2C conversion.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "dht_decode.h"
+
+/*! Encoder of temperature and humidity into the data bytes of a model */
+typedef void (*DhtEncoder)(float temperature, float humidity, uint8_t *data);
+
+void dht22_encode(float temperature, float humidity, uint8_t *data);
+void dht11_encode(float temperature, float humidity, uint8_t *data);
+void sht3x_encode(float temperature, float humidity, uint8_t *data);
+
+/*! One simulated sensor */
+struct DhtSensorModel
+{
+    /*! Data encoder of the sensor model */
+    DhtEncoder encode = dht22_encode;
+
+    /*! GPIO input register bit */
+    int bit = 0;
+
+    /*! Temperature to send in degrees Celsius */
+    float temperature = 21.5f;
+
+    /*! Humidity to send in percent */
+    float humidity = 40.0f;
+
+    /*! Time from release of the start signal to the response in ns */
+    uint32_t response_delay_ns = 30000;
+
+    /*! Sensor clock relative to nominal, pulse widths are divided by it */
+    double clock_scale = 1.0;
+
+    /*! Maximum random change of each pulse width in ns */
+    uint32_t jitter_ns = 0;
+
+    /*! False for a sensor that does not answer */
+    bool present = true;
+
+    /*! Flip this data bit after the checksum is computed, -1 for none */
+    int corrupt_bit = -1;
+
+    /*! Chance of a spike of the other level in the middle of each pulse,
+     *  like noise picked up by a long cable */
+    double glitch_rate = 0;
+
+    /*! Width of a spike in ns */
+    uint32_t glitch_ns = 1000;
+
+    /*! Chance that the sensor holds a pulse longer, by stretch_ns */
+    double stretch_rate = 0;
+    uint32_t stretch_ns = 0;
+
+    /*! Chance that a level change is lost, merging two pulses into one */
+    double drop_rate = 0;
+};
+
+/*! Stall of the capture loop, when no poll is made */
+struct DhtGap
+{
+    uint64_t start_ns;
+    uint32_t length_ns;
+};
+
+/*! Stalls of the capture loop: flash cache misses, the other core on the
+ *  bus or a capture without the critical section */
+struct DhtCaptureGaps
+{
+    /*! Mean number of gaps per millisecond of capture */
+    double per_ms = 0;
+
+    /*! Length of each gap in ns */
+    uint32_t length_ns = 0;
+};
+
+/*! Line level change of one sensor */
+struct DhtTransition
+{
+    uint64_t time_ns;
+    int bit;
+    bool level;
+};
+
+std::vector<DhtTransition> dht_waveform(const DhtSensorModel &sensor, std::mt19937 &random);
+std::vector<DhtEdge> dht_sample(std::vector<DhtTransition> transitions, uint32_t idle_levels,
+                                uint32_t sample_period_ns, uint32_t ticks_per_us, uint32_t &initial_levels,
+                                const std::vector<DhtGap> &gaps = std::vector<DhtGap>());
+std::vector<DhtEdge> dht_simulate(const std::vector<DhtSensorModel> &sensors, uint32_t sample_period_ns,
+                                  uint32_t ticks_per_us, uint32_t &initial_levels, unsigned seed,
+                                  const DhtCaptureGaps &gaps = DhtCaptureGaps());
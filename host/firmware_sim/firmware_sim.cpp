@@ -0,0 +1,180 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include "firmware_sim.h"
+
+/*! Number of distinct plain instructions, real code repeats a lot */
+static const uint32_t OPCODES = 512;
+
+
+/*!
+ * @brief
+ *   Firmware program class constructor.
+ *
+ * @param function_count (IN)
+ *   Number of functions, about 150 bytes each.
+ *
+ * @param seed (IN)
+ *   Random seed.
+ */
+FirmwareProgram::FirmwareProgram(size_t function_count, unsigned seed) : random(seed)
+{
+    for (size_t i = 0; i < function_count; i++)
+    {
+        functions.push_back(make_function());
+    }
+}
+
+
+/*!
+ * @brief
+ *   Lay out the functions and encode the image.
+ *
+ * @return
+ *   Image bytes.
+ */
+std::string FirmwareProgram::render() const
+{
+    std::vector<uint32_t> addresses;
+    uint32_t address = FLASH_BASE;
+
+    for (const FirmwareFunction &function : functions)
+    {
+        addresses.push_back(address);
+        address += static_cast<uint32_t>(3 * function.code.size());
+    }
+
+    std::string image;
+
+    for (size_t f = 0; f < functions.size(); f++)
+    {
+        uint32_t pc = addresses[f];
+        std::string literals;
+
+        for (const FirmwareInstruction &instruction : functions[f].code)
+        {
+            uint32_t word = instruction.value;
+
+            if (instruction.kind == FirmwareInstruction::CALL)
+            {
+                word = 0x05 | ((addresses[instruction.value % addresses.size()] - pc) << 6);
+            }
+            else if (instruction.kind == FirmwareInstruction::LITERAL)
+            {
+                // l32r of the literal, the literal itself goes to the pool
+                uint32_t target = addresses[instruction.value % addresses.size()];
+                word = 0x01 | (static_cast<uint32_t>(literals.size() / 4) << 8);
+                literals.append(reinterpret_cast<const char *>(&target), 4);
+            }
+
+            image.append(reinterpret_cast<const char *>(&word), 3);
+            pc += 3;
+        }
+
+        image += literals.substr(0, literals.size() - literals.size() % 3);
+    }
+
+    return image;
+}
+
+
+/*!
+ * @brief
+ *   Change some functions like a code change: instructions are replaced,
+ *   added and removed.
+ *
+ * @param count (IN)
+ *   Number of functions to change.
+ */
+void FirmwareProgram::edit_functions(size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        FirmwareFunction &function = functions[random() % functions.size()];
+        size_t at = random() % function.code.size();
+        function.code[at] = make_instruction();
+        function.code.insert(function.code.begin() + static_cast<long>(at), make_instruction());
+
+        if (function.code.size() > 4)
+        {
+            function.code.erase(function.code.begin() + static_cast<long>(random() % function.code.size()));
+            function.code.insert(function.code.begin() + static_cast<long>(random() % function.code.size()),
+                                 make_instruction());
+            function.code.insert(function.code.begin() + static_cast<long>(random() % function.code.size()),
+                                 make_instruction());
+        }
+    }
+}
+
+
+/*!
+ * @brief
+ *   Add a new function in the middle of the image and call it.
+ */
+void FirmwareProgram::insert_function()
+{
+    size_t at = functions.size() / 2;
+    functions.insert(functions.begin() + static_cast<long>(at), make_function());
+    FirmwareFunction &caller = functions[random() % functions.size()];
+    caller.code.insert(caller.code.begin(), {FirmwareInstruction::CALL, static_cast<uint32_t>(at)});
+}
+
+
+/*!
+ * @brief
+ *   Make a function of 20 to 80 instructions.
+ */
+FirmwareFunction FirmwareProgram::make_function()
+{
+    FirmwareFunction function;
+    size_t length = 20 + random() % 61;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        function.code.push_back(make_instruction());
+    }
+
+    return function;
+}
+
+
+/*!
+ * @brief
+ *   Make an instruction: mostly plain, some calls and literal loads.
+ */
+FirmwareInstruction FirmwareProgram::make_instruction()
+{
+    uint32_t kind = random() % 16;
+
+    if (kind == 0)
+    {
+        return {FirmwareInstruction::CALL, static_cast<uint32_t>(random())};
+    }
+    else if (kind == 1)
+    {
+        return {FirmwareInstruction::LITERAL, static_cast<uint32_t>(random())};
+    }
+
+    return {FirmwareInstruction::PLAIN, static_cast<uint32_t>(((random() % OPCODES) * 0x9E3779B1u) & 0xFFFFFF)};
+}
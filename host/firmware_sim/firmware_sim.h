@@ -0,0 +1,81 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Firmware image simulator for delta patch tests and benchmarks.
+ *
+ * A program is a list of functions of 3-byte instructions. Calls are
+ * PC-relative and each function ends with a literal pool of absolute
+ * addresses, like Xtensa code. Rendering lays the functions out from the
+ * flash base address, so a change in one function moves every function
+ * after it and changes the call offsets and literals that point across
+ * the change, as a rebuild does.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+/*! One instruction */
+struct FirmwareInstruction
+{
+    enum Kind
+    {
+        PLAIN,
+        CALL,
+        LITERAL
+    };
+
+    Kind kind;
+
+    /*! Opcode bytes for PLAIN, called or addressed function otherwise */
+    uint32_t value;
+};
+
+struct FirmwareFunction
+{
+    std::vector<FirmwareInstruction> code;
+};
+
+class FirmwareProgram
+{
+public:
+    FirmwareProgram(size_t function_count, unsigned seed);
+    std::string render() const;
+    void edit_functions(size_t count);
+    void insert_function();
+
+    /*! Address of the first function */
+    static const uint32_t FLASH_BASE = 0x400D0020;
+
+private:
+    FirmwareFunction make_function();
+    FirmwareInstruction make_instruction();
+
+    std::mt19937 random;
+    std::vector<FirmwareFunction> functions;
+};
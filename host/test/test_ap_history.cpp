@@ -0,0 +1,113 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include "unity.h"
+#include "ap_history.h"
+
+
+TEST_CASE("Access points without history keep configured order", "[ap_history]")
+{
+    ApCache cache = {};
+    ApHistory history(cache);
+    std::vector<int> order = history.rank({"attic", "garage", "shed"});
+    TEST_ASSERT_EQUAL(3, order.size());
+    TEST_ASSERT_EQUAL(0, order[0]);
+    TEST_ASSERT_EQUAL(1, order[1]);
+    TEST_ASSERT_EQUAL(2, order[2]);
+    TEST_ASSERT_TRUE(history.find("attic") == nullptr);
+}
+
+
+TEST_CASE("Fastest reliable access point is tried first", "[ap_history]")
+{
+    ApCache cache = {};
+    ApHistory history(cache);
+    history.record("attic", true, 2500, 6, -80);
+    history.record("garage", true, 900, 11, -55);
+    history.record("garage", true, 1300, 11, -57);
+
+    std::vector<int> order = history.rank({"attic", "garage", "shed"});
+    TEST_ASSERT_EQUAL(1, order[0]);
+    TEST_ASSERT_EQUAL(0, order[1]);
+    TEST_ASSERT_EQUAL(2, order[2]);
+
+    const ApRecord *garage = history.find("garage");
+    TEST_ASSERT_TRUE(garage != nullptr);
+    TEST_ASSERT_EQUAL(11, garage->channel);
+    TEST_ASSERT_EQUAL(1000, garage->connect_ms);
+    TEST_ASSERT_EQUAL(-55, garage->rssi);
+    TEST_ASSERT_EQUAL(2, garage->successes);
+}
+
+
+TEST_CASE("Failing access point loses its rank", "[ap_history]")
+{
+    ApCache cache = {};
+    ApHistory history(cache);
+    history.record("attic", true, 2500, 6, -70);
+    history.record("garage", true, 900, 11, -55);
+    TEST_ASSERT_EQUAL(1, history.rank({"attic", "garage"})[0]);
+
+    history.record("garage", false, 5000, 0, 0);
+    history.record("garage", false, 5000, 0, 0);
+    TEST_ASSERT_EQUAL(0, history.rank({"attic", "garage"})[0]);
+    TEST_ASSERT_EQUAL(11, history.find("garage")->channel);
+
+    // Old attempts fade out, so a recovered access point wins again
+    for (int i = 0; i < 3 * ApHistory::MAX_ATTEMPTS; i++)
+    {
+        history.record("garage", true, 900, 11, -55);
+    }
+
+    TEST_ASSERT_EQUAL(1, history.rank({"attic", "garage"})[0]);
+}
+
+
+TEST_CASE("History is kept in a valid cache and replaced when full", "[ap_history]")
+{
+    ApCache cache = {};
+    {
+        ApHistory history(cache);
+
+        for (int i = 0; i < MAX_ACCESS_POINTS; i++)
+        {
+            history.record("ap" + std::to_string(i), true, 1000, 1, -60);
+        }
+
+        history.record("ap0", true, 1000, 1, -60);
+    }
+
+    ApHistory history(cache);
+    TEST_ASSERT_EQUAL(ApHistory::MAGIC, cache.magic);
+    TEST_ASSERT_EQUAL(2, history.find("ap0")->successes);
+
+    history.record("new", true, 1000, 1, -60);
+    TEST_ASSERT_TRUE(history.find("new") != nullptr);
+    TEST_ASSERT_TRUE(history.find("ap0") != nullptr);
+    TEST_ASSERT_TRUE(history.find("ap1") == nullptr);
+
+    cache.magic = 0;
+    ApHistory cleared(cache);
+    TEST_ASSERT_TRUE(cleared.find("ap0") == nullptr);
+}
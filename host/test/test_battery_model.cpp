@@ -0,0 +1,142 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+
+#include <string>
+#include "unity.h"
+#include "battery_model.h"
+
+/*! Wake without spread: 1 s boot and 1 s connect at 100 mA, three 100 ms
+ *  requests at 100 mA and 0.1 mA asleep */
+static const char *const FIXED_MODEL = "boot 1000 100\n"
+                                       "wifi 1000 100\n"
+                                       "request 100 100\n"
+                                       "idle 0 50\n"
+                                       "light_sleep 0 1\n"
+                                       "deep_sleep 0 0.1\n";
+
+/*! Settings of a 1000 mAh battery with a deep sleep every 20 minutes */
+static const BatterySettings SETTINGS = {20, 15, 3, 1000};
+
+
+TEST_CASE("Wake model is parsed from phases and traces", "[battery]")
+{
+    WakeModel model;
+    std::string error;
+    TEST_ASSERT_TRUE(parse_wake_model("# phase duration current\n"
+                                      "wifi 1500 120 400\n"
+                                      "tls 900 100   # measured\n"
+                                      "tls 1300 100\n"
+                                      "\n"
+                                      "wifi_fail 0.001\n"
+                                      "upload_fail 0.05\n", model, error));
+    TEST_ASSERT_EQUAL(1u, model.phases[PHASE_WIFI].size());
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 400, model.phases[PHASE_WIFI][0].spread_ms);
+    TEST_ASSERT_EQUAL(2u, model.phases[PHASE_TLS].size());
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 1300, model.phases[PHASE_TLS][1].duration_ms);
+    TEST_ASSERT_EQUAL(0u, model.phases[PHASE_BOOT].size());
+    TEST_ASSERT_FLOAT_WITHIN(1e-9, 0.001, model.wifi_fail);
+    TEST_ASSERT_FLOAT_WITHIN(1e-9, 0.05, model.upload_fail);
+    TEST_ASSERT_EQUAL_STRING("light_sleep", wake_phase_name(PHASE_LIGHT_SLEEP));
+
+    TEST_ASSERT_FALSE(parse_wake_model("boot 100 40\nradio 100 40\n", model, error));
+    TEST_ASSERT_EQUAL_STRING("line 2: radio 100 40", error.c_str());
+    TEST_ASSERT_FALSE(parse_wake_model("boot 100\n", model, error));
+    TEST_ASSERT_FALSE(parse_wake_model("boot -100 40\n", model, error));
+    TEST_ASSERT_FALSE(parse_wake_model("boot 100 40mA\n", model, error));
+    TEST_ASSERT_FALSE(parse_wake_model("wifi_fail 2\n", model, error));
+}
+
+
+TEST_CASE("Battery life of a fixed wake is exact", "[battery]")
+{
+    WakeModel model;
+    std::string error;
+    TEST_ASSERT_TRUE(parse_wake_model(FIXED_MODEL, model, error));
+    std::mt19937 random(1);
+    BatteryLife life = battery_life(model, SETTINGS, 100, 100, random);
+
+    // 230 mC awake and 1197.7 s at 0.1 mA per 1200 s
+    double cycle_mc = 230 + 119.77;
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, cycle_mc / 1200, life.mean_ma);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 2.3, life.awake_s);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 1000 * 3600 / cycle_mc * 1200 / 86400, life.p50_days);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, life.p50_days, life.p10_days);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, life.p50_days, life.p90_days);
+    TEST_ASSERT_EQUAL(0, life.failed_uploads);
+    TEST_ASSERT_EQUAL(0, life.stranded);
+}
+
+
+TEST_CASE("Failed uploads are retried after a backoff", "[battery]")
+{
+    WakeModel model;
+    std::string error;
+    TEST_ASSERT_TRUE(parse_wake_model(FIXED_MODEL, model, error));
+    model.upload_fail = 1;
+    std::mt19937 random(1);
+    BatteryLife life = battery_life(model, SETTINGS, 2000, 100, random);
+
+    // Three attempts of one request, with 2 s and 4 s backoffs on average
+    TEST_ASSERT_FLOAT_WITHIN(1e-9, 1, life.failed_uploads);
+    TEST_ASSERT_FLOAT_WITHIN(0.1, 2 + 0.3 + 6, life.awake_s);
+
+    model.upload_fail = 0.5;
+    life = battery_life(model, SETTINGS, 2000, 100, random);
+    TEST_ASSERT_FLOAT_WITHIN(0.03, 0.125, life.failed_uploads);
+}
+
+
+TEST_CASE("A failed connect ends the battery life", "[battery]")
+{
+    WakeModel model;
+    std::string error;
+    TEST_ASSERT_TRUE(parse_wake_model(FIXED_MODEL, model, error));
+    std::mt19937 random(1);
+    BatteryLife full = battery_life(model, SETTINGS, 100, 1000, random);
+
+    // Half of the stations fail to connect within ln 2 / 0.001 wakes
+    model.wifi_fail = 0.001;
+    BatteryLife life = battery_life(model, SETTINGS, 100, 1000, random);
+    TEST_ASSERT_TRUE(life.stranded > 0.95);
+    TEST_ASSERT_FLOAT_WITHIN(0.1 * 693 / 72, 693.0 / 72, life.p50_days);
+    TEST_ASSERT_TRUE(life.p10_days < life.p50_days);
+    TEST_ASSERT_TRUE(life.p90_days < full.p50_days);
+}
+
+
+TEST_CASE("Short intervals are sampled in light sleep without booting", "[battery]")
+{
+    WakeModel model;
+    std::string error;
+    TEST_ASSERT_TRUE(parse_wake_model(FIXED_MODEL, model, error));
+    BatterySettings settings = SETTINGS;
+    settings.interval_min = 10;
+    std::mt19937 random(1);
+    BatteryLife life = battery_life(model, settings, 100, 100, random);
+
+    // 130 mC awake and 600 s at 1 mA per 601.3 s
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 1.3, life.awake_s);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, (130 + 600) / 601.3, life.mean_ma);
+}
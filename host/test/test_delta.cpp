@@ -0,0 +1,175 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <string>
+#include "unity.h"
+#include "delta_diff.h"
+#include "delta_patcher.h"
+#include "firmware_sim.h"
+#include "station_config.h"
+
+
+/*! Patch with a header for old_image and the given operations */
+static std::string make_patch(const std::string &old_image, const std::string &new_image,
+                              const std::string &operations)
+{
+    DeltaHeader header = {static_cast<uint32_t>(old_image.size()),
+                          delta_crc32(0, reinterpret_cast<const uint8_t *>(old_image.data()), old_image.size()),
+                          static_cast<uint32_t>(new_image.size()),
+                          delta_crc32(0, reinterpret_cast<const uint8_t *>(new_image.data()), new_image.size())};
+    uint8_t data[DELTA_HEADER_SIZE];
+    delta_encode_header(header, data);
+
+    return std::string(reinterpret_cast<const char *>(data), sizeof(data)) + operations;
+}
+
+
+TEST_CASE("Delta patch rebuilds a changed firmware in any piece size", "[delta]")
+{
+    FirmwareProgram program(400, 1);
+    std::string old_image = program.render();
+    program.edit_functions(5);
+    program.insert_function();
+    std::string new_image = program.render();
+    TEST_ASSERT_TRUE(old_image != new_image);
+
+    // Moved code changes every call and literal across the move
+    std::string patch = delta_diff(old_image, new_image);
+    TEST_ASSERT_TRUE(patch.size() * 3 < new_image.size());
+
+    for (size_t piece_size : {static_cast<size_t>(1), static_cast<size_t>(7), static_cast<size_t>(512)})
+    {
+        std::string result;
+        std::string error;
+        TEST_ASSERT_TRUE(delta_apply(old_image, patch, result, piece_size, error));
+        TEST_ASSERT_TRUE(result == new_image);
+    }
+}
+
+
+TEST_CASE("Delta patch of unrelated images adds everything", "[delta]")
+{
+    std::string old_image = FirmwareProgram(50, 1).render();
+    std::string new_image = FirmwareProgram(60, 2).render();
+    std::string result;
+    std::string error;
+    TEST_ASSERT_TRUE(delta_apply(old_image, delta_diff(old_image, new_image), result, 512, error));
+    TEST_ASSERT_TRUE(result == new_image);
+    TEST_ASSERT_TRUE(delta_apply(old_image, delta_diff(old_image, ""), result, 512, error));
+    TEST_ASSERT_TRUE(result.empty());
+}
+
+
+TEST_CASE("Delta patch is refused for another old image", "[delta]")
+{
+    FirmwareProgram program(100, 3);
+    std::string old_image = program.render();
+    program.edit_functions(2);
+    std::string patch = delta_diff(old_image, program.render());
+
+    std::string other_image = old_image;
+    other_image[100] ^= 1;
+    std::string result;
+    std::string error;
+    TEST_ASSERT_FALSE(delta_apply(other_image, patch, result, 512, error));
+    TEST_ASSERT_FALSE(error.empty());
+    TEST_ASSERT_TRUE(result.empty());
+}
+
+
+TEST_CASE("Malformed delta patches fail", "[delta]")
+{
+    std::string old_image = FirmwareProgram(20, 4).render();
+    std::string new_image = old_image.substr(100, 200);
+    std::string patch = delta_diff(old_image, new_image);
+    std::string result;
+    std::string error;
+
+    std::string bad_magic = patch;
+    bad_magic[0] = 'X';
+    TEST_ASSERT_FALSE(delta_apply(old_image, bad_magic, result, 512, error));
+    TEST_ASSERT_FALSE(delta_apply(old_image, patch.substr(0, patch.size() - 1), result, 512, error));
+    TEST_ASSERT_FALSE(delta_apply(old_image, patch.substr(0, 10), result, 512, error));
+
+    // Copy past the end of the old image
+    std::string operations(1, static_cast<char>(DELTA_COPY));
+    delta_append_varint(operations, delta_zigzag(static_cast<int32_t>(old_image.size()) - 10));
+    delta_append_varint(operations, 200);
+    TEST_ASSERT_FALSE(delta_apply(old_image, make_patch(old_image, new_image, operations), result, 512, error));
+
+    // Right length, wrong bytes
+    operations = std::string(1, static_cast<char>(DELTA_COPY));
+    delta_append_varint(operations, delta_zigzag(101));
+    delta_append_varint(operations, 200);
+    TEST_ASSERT_FALSE(delta_apply(old_image, make_patch(old_image, new_image, operations), result, 512, error));
+
+    // More bytes than the new image
+    operations = std::string(1, static_cast<char>(DELTA_ADD));
+    delta_append_varint(operations, 201);
+    operations += std::string(201, 'x');
+    TEST_ASSERT_FALSE(delta_apply(old_image, make_patch(old_image, new_image, operations), result, 512, error));
+
+    // Unknown operation
+    TEST_ASSERT_FALSE(delta_apply(old_image, make_patch(old_image, new_image, "\x07"), result, 512, error));
+}
+
+
+TEST_CASE("Delta varints and the patcher stay small", "[delta]")
+{
+    std::string data;
+    delta_append_varint(data, 127);
+    TEST_ASSERT_EQUAL(1, static_cast<int>(data.size()));
+    delta_append_varint(data, 0xFFFFFFFF);
+    TEST_ASSERT_EQUAL(1 + DELTA_MAX_VARINT_SIZE, data.size());
+    TEST_ASSERT_EQUAL(-5, delta_unzigzag(delta_zigzag(-5)));
+    TEST_ASSERT_EQUAL(9u, delta_zigzag(-5));
+    TEST_ASSERT_TRUE(sizeof(DeltaPatcher) < 1024);
+}
+
+
+TEST_CASE("Station configuration keeps the interval first", "[delta]")
+{
+    StationConfig config;
+    parse_station_config("15", config);
+    TEST_ASSERT_EQUAL(15, config.interval_min);
+    TEST_ASSERT_EQUAL(0, config.firmware_version);
+
+    parse_station_config("5\nunknown 1\nfirmware 3 https://example.com/firmware\n", config);
+    TEST_ASSERT_EQUAL(5, config.interval_min);
+    TEST_ASSERT_EQUAL(3, config.firmware_version);
+    TEST_ASSERT_EQUAL_STRING("https://example.com/firmware", config.firmware_url.c_str());
+
+    parse_station_config("5\r\nfirmware x\n", config);
+    TEST_ASSERT_EQUAL(5, config.interval_min);
+    TEST_ASSERT_EQUAL(0, config.firmware_version);
+    TEST_ASSERT_EQUAL(0, config.offset_s);
+
+    // The upload offset stays within half an interval
+    parse_station_config("10\noffset -42\n", config);
+    TEST_ASSERT_EQUAL(-42, config.offset_s);
+    parse_station_config("10\noffset 300\n", config);
+    TEST_ASSERT_EQUAL(300, config.offset_s);
+    parse_station_config("10\noffset 301\n", config);
+    TEST_ASSERT_EQUAL(0, config.offset_s);
+}
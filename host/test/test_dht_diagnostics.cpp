@@ -0,0 +1,187 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <cstring>
+#include <vector>
+#include "unity.h"
+#include "dht_diagnostics.h"
+#include "dht_sim.h"
+#include "sensor_model.h"
+
+/*! ESP32 CPU cycles per microsecond, the capture clock */
+static const uint32_t TICKS_PER_US = 240;
+
+/*! Time between input register polls of the capture loop */
+static const uint32_t SAMPLE_PERIOD_NS = 100;
+
+
+/*!
+ * @brief
+ *   Decode simulated captures of one sensor and count them into
+ *   diagnostics.
+ */
+static DhtDiagnostics record(const DhtSensorModel &sensor, int captures)
+{
+    DhtDiagnostics diagnostics;
+    dht_diagnostics_clear(diagnostics);
+    const int bit = sensor.bit;
+
+    for (int i = 0; i < captures; i++)
+    {
+        uint32_t initial_levels;
+        std::vector<DhtEdge> edges = dht_simulate({sensor}, SAMPLE_PERIOD_NS, TICKS_PER_US, initial_levels,
+                                                  static_cast<unsigned>(i + 1));
+        DhtReading reading;
+        dht_decode_channels<Dht22>(edges.data(), edges.size(), initial_levels, &bit, 1, TICKS_PER_US, &reading);
+        dht_diagnostics_record<Dht22>(edges.data(), edges.size(), initial_levels, &bit, 1, TICKS_PER_US, &reading,
+                                      diagnostics);
+    }
+
+    return diagnostics;
+}
+
+
+/*!
+ * @brief
+ *   Sum the bins of a histogram from first to last.
+ */
+static int sum(const uint16_t *bins, int first, int last)
+{
+    int total = 0;
+
+    for (int i = first; i <= last; i++)
+    {
+        total += bins[i];
+    }
+
+    return total;
+}
+
+
+TEST_CASE("Clean reads fill the nominal pulse width bins", "[dht_diagnostics]")
+{
+    DhtSensorModel sensor;
+    sensor.bit = 25;
+    sensor.jitter_ns = 1000;
+    DhtDiagnostics diagnostics = record(sensor, 10);
+
+    TEST_ASSERT_EQUAL(10, diagnostics.reads);
+    TEST_ASSERT_EQUAL(0, diagnostics.checksum_errors);
+    TEST_ASSERT_EQUAL(0, diagnostics.timeouts);
+    TEST_ASSERT_EQUAL(400, sum(diagnostics.low, 0, DHT_DIAGNOSTICS_BINS - 1));
+    TEST_ASSERT_EQUAL(400, sum(diagnostics.high, 0, DHT_DIAGNOSTICS_BINS - 1));
+    TEST_ASSERT_EQUAL(400, sum(diagnostics.margin, 0, DHT_DIAGNOSTICS_BINS - 1));
+
+    // 50 us low, 26-28 us zeros and 70 us ones, all about 20 us from 48 us
+    TEST_ASSERT_EQUAL(400, diagnostics.low[6]);
+    TEST_ASSERT_EQUAL(400, diagnostics.high[3] + diagnostics.high[8]);
+    TEST_ASSERT_EQUAL(400, sum(diagnostics.margin, 4, 5));
+}
+
+
+TEST_CASE("Noise and a drifting clock show in different bins", "[dht_diagnostics]")
+{
+    DhtSensorModel noisy;
+    noisy.glitch_rate = 0.02;
+    noisy.glitch_ns = 1500;
+    DhtDiagnostics diagnostics = record(noisy, 20);
+    TEST_ASSERT_TRUE(diagnostics.low[0] + diagnostics.high[0] > 0);
+    TEST_ASSERT_TRUE(diagnostics.checksum_errors + diagnostics.timeouts > 0);
+
+    // A fast clock moves the ones towards the threshold without failures
+    DhtSensorModel marginal;
+    marginal.clock_scale = 1.25;
+    diagnostics = record(marginal, 20);
+    TEST_ASSERT_EQUAL(0, diagnostics.checksum_errors + diagnostics.timeouts);
+    TEST_ASSERT_EQUAL(0, diagnostics.low[0] + diagnostics.high[0]);
+    TEST_ASSERT_TRUE(sum(diagnostics.margin, 0, 2) > 0);
+
+    // A missing sensor is a timeout with no pulses
+    DhtSensorModel missing;
+    missing.present = false;
+    diagnostics = record(missing, 3);
+    TEST_ASSERT_EQUAL(3, diagnostics.timeouts);
+    TEST_ASSERT_EQUAL(0, sum(diagnostics.high, 0, DHT_DIAGNOSTICS_BINS - 1));
+}
+
+
+TEST_CASE("Diagnostics are kept only when valid", "[dht_diagnostics]")
+{
+    DhtDiagnostics diagnostics;
+    memset(&diagnostics, 0xA5, sizeof(diagnostics));
+    dht_diagnostics_start(diagnostics);
+    TEST_ASSERT_EQUAL(DHT_DIAGNOSTICS_MAGIC, diagnostics.magic);
+    TEST_ASSERT_EQUAL(0, diagnostics.reads);
+    TEST_ASSERT_EQUAL(0, diagnostics.margin[DHT_DIAGNOSTICS_BINS - 1]);
+
+    diagnostics.reads = 7;
+    diagnostics.high[3] = 12;
+    dht_diagnostics_start(diagnostics);
+    TEST_ASSERT_EQUAL(7, diagnostics.reads);
+    TEST_ASSERT_EQUAL(12, diagnostics.high[3]);
+}
+
+
+TEST_CASE("Histograms are compact telemetry values", "[dht_diagnostics]")
+{
+    uint16_t bins[DHT_DIAGNOSTICS_BINS] = {};
+    TEST_ASSERT_EQUAL_STRING("0_0", dht_histogram_text(bins).c_str());
+
+    // A two bin histogram must not look like a decimal number
+    bins[0] = 3;
+    bins[1] = 7;
+    TEST_ASSERT_EQUAL_STRING("3_7", dht_histogram_text(bins).c_str());
+    bins[1] = 0;
+    TEST_ASSERT_EQUAL_STRING("3_0", dht_histogram_text(bins).c_str());
+
+    bins[0] = 0;
+    bins[2] = 3;
+    bins[5] = 812;
+    TEST_ASSERT_EQUAL_STRING("0_0_3_0_0_812", dht_histogram_text(bins).c_str());
+
+    // Full bins still fit the 64 characters the collector accepts
+    DhtDiagnostics diagnostics;
+    dht_diagnostics_clear(diagnostics);
+    DhtSensorModel sensor;
+    const int bit = sensor.bit;
+    uint32_t initial_levels;
+    std::vector<DhtEdge> edges = dht_simulate({sensor}, SAMPLE_PERIOD_NS, TICKS_PER_US, initial_levels, 1);
+    DhtReading reading = {DHT_CHECKSUM_ERROR, 0, 0};
+
+    for (int i = 0; i < 300; i++)
+    {
+        dht_diagnostics_record<Dht22>(edges.data(), edges.size(), initial_levels, &bit, 1, TICKS_PER_US, &reading,
+                                      diagnostics);
+    }
+
+    TEST_ASSERT_EQUAL(DHT_DIAGNOSTICS_MAX_COUNT, diagnostics.low[6]);
+    TEST_ASSERT_EQUAL(300, diagnostics.checksum_errors);
+
+    for (uint16_t &bin : bins)
+    {
+        bin = DHT_DIAGNOSTICS_MAX_COUNT;
+    }
+
+    TEST_ASSERT_TRUE(dht_histogram_text(bins).size() <= 64);
+}
@@ -0,0 +1,139 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+
+#include <cstring>
+#include <vector>
+#include "unity.h"
+#include "dht_faults.h"
+#include "sensor_model.h"
+
+/*! Captures of each scenario, as measured for the baseline */
+static const size_t CAPTURES = 500;
+
+
+/*!
+ * @brief
+ *   Find a scenario by name.
+ */
+static DhtFaultScenario find_scenario(const char *name)
+{
+    for (const DhtFaultScenario &scenario : dht_fault_scenarios())
+    {
+        if (strcmp(scenario.name, name) == 0)
+        {
+            return scenario;
+        }
+    }
+
+    TEST_FAIL_MESSAGE("Unknown scenario");
+    return DhtFaultScenario();
+}
+
+
+TEST_CASE("Decoder keeps its robustness baseline", "[dht_faults]")
+{
+    std::vector<DhtFaultScenario> scenarios = dht_fault_scenarios();
+    TEST_ASSERT_EQUAL(scenarios.size(), DHT_FAULT_BASELINE_COUNT);
+
+    for (size_t i = 0; i < DHT_FAULT_BASELINE_COUNT; i++)
+    {
+        const DhtFaultBaseline &baseline = DHT_FAULT_BASELINE[i];
+        DhtFaultStats stats = dht_fault_run(find_scenario(baseline.name), CAPTURES, 1);
+        double ok_rate = static_cast<double>(stats.ok) / stats.captures;
+        double wrong_rate = static_cast<double>(stats.wrong_values) / stats.captures;
+        TEST_ASSERT_EQUAL(CAPTURES, stats.ok + stats.checksum_errors + stats.timeouts + stats.wrong_values);
+        if ((ok_rate < baseline.min_ok_rate) || (wrong_rate > baseline.max_wrong_rate))
+        {
+            TEST_FAIL_MESSAGE(baseline.name);
+        }
+    }
+}
+
+
+TEST_CASE("Faults are injected only when set", "[dht_faults]")
+{
+    DhtSensorModel sensor;
+    sensor.jitter_ns = 3000;
+    std::mt19937 random(5);
+    std::vector<DhtTransition> plain = dht_waveform(sensor, random);
+    TEST_ASSERT_EQUAL(2u + 2 * 40 + 2, plain.size());
+
+    // A spike adds two changes, a lost change removes one
+    sensor.glitch_rate = 1;
+    random.seed(5);
+    TEST_ASSERT_EQUAL(3 * plain.size() - 2, dht_waveform(sensor, random).size());
+    sensor.glitch_rate = 0;
+    sensor.drop_rate = 1;
+    TEST_ASSERT_EQUAL(1u, dht_waveform(sensor, random).size());
+
+    // Every pulse held 10 us longer
+    sensor.drop_rate = 0;
+    sensor.jitter_ns = 0;
+    std::vector<DhtTransition> nominal = dht_waveform(sensor, random);
+    sensor.stretch_rate = 1;
+    sensor.stretch_ns = 10000;
+    std::vector<DhtTransition> stretched = dht_waveform(sensor, random);
+    TEST_ASSERT_EQUAL(nominal.back().time_ns + 10000 * (nominal.size() - 1), stretched.back().time_ns);
+}
+
+
+TEST_CASE("Capture gaps lose pulses shorter than the gap", "[dht_faults]")
+{
+    // A 30 us high pulse inside a 40 us stall is not seen
+    std::vector<DhtTransition> transitions = {{50000, 4, true}, {80000, 4, false}, {200000, 4, true}};
+    uint32_t initial_levels;
+    std::vector<DhtEdge> edges = dht_sample(transitions, 0, 100, 1, initial_levels, {{45000, 40000}});
+    TEST_ASSERT_EQUAL(1u, edges.size());
+    TEST_ASSERT_EQUAL(200u, edges[0].time);
+
+    // A stall between changes only delays the next one
+    edges = dht_sample(transitions, 0, 100, 1, initial_levels, {{100000, 40000}});
+    TEST_ASSERT_EQUAL(3u, edges.size());
+    TEST_ASSERT_EQUAL(50u, edges[0].time);
+    TEST_ASSERT_EQUAL(80u, edges[1].time);
+}
+
+
+TEST_CASE("Retry cost follows the read pacing", "[dht_faults]")
+{
+    DhtFaultStats clean = {100, 100, 0, 0, 0};
+    DhtRetryCost cost = dht_retry_cost(clean, DHT_FAULT_READ_RETRIES, Dht22::MIN_INTERVAL_MS, 100, 1);
+    TEST_ASSERT_FLOAT_WITHIN(1e-9, 1.0, cost.reads);
+    TEST_ASSERT_FLOAT_WITHIN(1e-9, 0.0, cost.retry_ms);
+    TEST_ASSERT_FLOAT_WITHIN(1e-9, 0.0, cost.failed);
+
+    // Checksum errors are retried after the read interval, all five times
+    DhtFaultStats garbled = {100, 0, 100, 0, 0};
+    cost = dht_retry_cost(garbled, DHT_FAULT_READ_RETRIES, Dht22::MIN_INTERVAL_MS, 10, 1);
+    TEST_ASSERT_FLOAT_WITHIN(1e-9, 5.0, cost.reads);
+    TEST_ASSERT_FLOAT_WITHIN(1, 4 * Dht22::MIN_INTERVAL_MS, cost.retry_ms);
+    TEST_ASSERT_FLOAT_WITHIN(1e-9, 1.0, cost.failed);
+
+    // A silent sensor is given up after two timeouts, the second after a doubled wait
+    DhtFaultStats silent = {100, 0, 0, 100, 0};
+    cost = dht_retry_cost(silent, DHT_FAULT_READ_RETRIES, Dht22::MIN_INTERVAL_MS, 10, 1);
+    TEST_ASSERT_FLOAT_WITHIN(1e-9, 2.0, cost.reads);
+    TEST_ASSERT_FLOAT_WITHIN(1, 2 * Dht22::MIN_INTERVAL_MS, cost.retry_ms);
+}
@@ -0,0 +1,185 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <vector>
+#include "unity.h"
+#include "dht_sim.h"
+#include "sensor_model.h"
+
+/*! ESP32 CPU cycles per microsecond, the capture clock */
+static const uint32_t TICKS_PER_US = 240;
+
+/*! Time between input register polls of the capture loop */
+static const uint32_t SAMPLE_PERIOD_NS = 100;
+
+
+/*!
+ * @brief
+ *   Make four sensors with different responses and clocks.
+ */
+static std::vector<DhtSensorModel> make_sensors()
+{
+    std::vector<DhtSensorModel> sensors(4);
+    const int bits[] = {25, 26, 27, 4};
+    const float temperatures[] = {21.5f, -12.3f, 35.0f, 8.8f};
+    const float humidities[] = {40.0f, 95.5f, 12.1f, 60.0f};
+    const uint32_t delays_ns[] = {20000, 35000, 28000, 40000};
+    const double clocks[] = {1.0, 0.9, 1.12, 0.95};
+
+    for (size_t i = 0; i < sensors.size(); i++)
+    {
+        sensors[i].bit = bits[i];
+        sensors[i].temperature = temperatures[i];
+        sensors[i].humidity = humidities[i];
+        sensors[i].response_delay_ns = delays_ns[i];
+        sensors[i].clock_scale = clocks[i];
+        sensors[i].jitter_ns = 3000;
+    }
+
+    return sensors;
+}
+
+
+/*!
+ * @brief
+ *   Decode a simulated capture.
+ */
+static std::vector<DhtReading> decode(const std::vector<DhtSensorModel> &sensors, unsigned seed)
+{
+    uint32_t initial_levels;
+    std::vector<DhtEdge> edges = dht_simulate(sensors, SAMPLE_PERIOD_NS, TICKS_PER_US, initial_levels, seed);
+    std::vector<int> bits;
+
+    for (const DhtSensorModel &sensor : sensors)
+    {
+        bits.push_back(sensor.bit);
+    }
+
+    std::vector<DhtReading> readings(sensors.size());
+    dht_decode_channels<Dht22>(edges.data(), edges.size(), initial_levels, bits.data(),
+                               static_cast<int>(bits.size()), TICKS_PER_US, readings.data());
+
+    return readings;
+}
+
+
+TEST_CASE("Decode skewed sensors from one capture", "[dht_multi]")
+{
+    std::vector<DhtSensorModel> sensors = make_sensors();
+
+    for (unsigned seed = 0; seed < 100; seed++)
+    {
+        std::vector<DhtReading> readings = decode(sensors, seed);
+
+        for (size_t i = 0; i < sensors.size(); i++)
+        {
+            TEST_ASSERT_EQUAL(DHT_OK, readings[i].status);
+            TEST_ASSERT_FLOAT_WITHIN(0.01, sensors[i].temperature, readings[i].temperature);
+            TEST_ASSERT_FLOAT_WITHIN(0.01, sensors[i].humidity, readings[i].humidity);
+        }
+    }
+}
+
+
+TEST_CASE("Single sensor decodes like the sequential reader", "[dht_multi]")
+{
+    std::vector<DhtSensorModel> sensors(1);
+    sensors[0].bit = 25;
+    sensors[0].temperature = 0.1f;
+    sensors[0].humidity = 100.0f;
+    std::vector<DhtReading> readings = decode(sensors, 1);
+    TEST_ASSERT_EQUAL(DHT_OK, readings[0].status);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 0.1, readings[0].temperature);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 100.0, readings[0].humidity);
+}
+
+
+TEST_CASE("Failing sensor does not disturb the others", "[dht_multi]")
+{
+    std::vector<DhtSensorModel> sensors = make_sensors();
+    sensors[1].present = false;
+    sensors[2].corrupt_bit = 17;
+    std::vector<DhtReading> readings = decode(sensors, 7);
+    TEST_ASSERT_EQUAL(DHT_OK, readings[0].status);
+    TEST_ASSERT_EQUAL(DHT_TIMEOUT_ERROR, readings[1].status);
+    TEST_ASSERT_EQUAL(DHT_CHECKSUM_ERROR, readings[2].status);
+    TEST_ASSERT_EQUAL(DHT_OK, readings[3].status);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, sensors[3].temperature, readings[3].temperature);
+}
+
+
+TEST_CASE("Stalled sensor times out", "[dht_multi]")
+{
+    std::vector<DhtSensorModel> sensors = make_sensors();
+    // A sensor clock this slow stretches the response low past the limit
+    sensors[0].clock_scale = 0.6;
+    std::vector<DhtReading> readings = decode(sensors, 3);
+    TEST_ASSERT_EQUAL(DHT_TIMEOUT_ERROR, readings[0].status);
+    TEST_ASSERT_EQUAL(DHT_OK, readings[1].status);
+}
+
+
+TEST_CASE("Capture of all sensors takes one transmission", "[dht_multi]")
+{
+    std::vector<DhtSensorModel> sensors = make_sensors();
+    std::vector<DhtSensorModel> one(sensors.begin(), sensors.begin() + 1);
+    uint32_t initial_levels;
+    std::vector<DhtEdge> single = dht_simulate(one, SAMPLE_PERIOD_NS, TICKS_PER_US, initial_levels, 1);
+    std::vector<DhtEdge> all = dht_simulate(sensors, SAMPLE_PERIOD_NS, TICKS_PER_US, initial_levels, 1);
+
+    // Four sensors take less than 1.5 times one sensor, not four times
+    TEST_ASSERT_TRUE(all.back().time * 2 < single.back().time * 3);
+    TEST_ASSERT_TRUE(all.size() <= 4 * single.size());
+}
+
+
+TEST_CASE("One bits are high pulses longer than 48 us", "[dht_multi]")
+{
+    // Humidity 65.2 %, temperature 35.1 degrees and checksum
+    const uint8_t data[] = {0x02, 0x8c, 0x01, 0x5f, 0xee};
+    std::vector<DhtEdge> edges;
+    uint32_t time_us = 10;
+
+    // Response low and high, then the low before the first bit
+    edges.push_back({time_us * TICKS_PER_US, 0});
+    time_us += 80;
+    edges.push_back({time_us * TICKS_PER_US, 1});
+    time_us += 80;
+    edges.push_back({time_us * TICKS_PER_US, 0});
+
+    for (int i = 0; i < 40; i++)
+    {
+        time_us += 50;
+        edges.push_back({time_us * TICKS_PER_US, 1});
+        time_us += ((data[i / 8] >> (7 - i % 8)) & 1) ? Dht22::ONE_THRESHOLD_US + 1 : Dht22::ONE_THRESHOLD_US;
+        edges.push_back({time_us * TICKS_PER_US, 0});
+    }
+
+    int bit = 0;
+    DhtReading reading;
+    dht_decode_channels<Dht22>(edges.data(), edges.size(), 1, &bit, 1, TICKS_PER_US, &reading);
+    TEST_ASSERT_EQUAL(DHT_OK, reading.status);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 65.2, reading.humidity);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 35.1, reading.temperature);
+}
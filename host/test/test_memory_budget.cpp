@@ -0,0 +1,173 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <cstring>
+#include <string>
+#include "unity.h"
+#include "alloc_counter.h"
+#include "memory_profile.h"
+#include "server.h"
+
+/*! Allocation budget of the upload of one wake: connect, interval, one
+ *  sample, telemetry with radio and memory fields, disconnect. Measured 26
+ *  allocations of 3 kB with libstdc++; lower it when the upload allocates
+ *  less, so that it does not creep back. */
+static const MemoryBudget UPLOAD_BUDGET = {0, 0, 32, 3584, 0};
+
+/*! Station ID as posted, a MAC address */
+static const char *const STATION_ID = "240ac4123456";
+
+
+/*! Transport that accepts everything and keeps nothing */
+class NullTransport : public Transport
+{
+public:
+    bool open()
+    {
+        return true;
+    }
+
+    void close()
+    {
+    }
+
+    bool get_config(std::string &config)
+    {
+        config = "10";
+        return true;
+    }
+
+    bool send(Channel channel, const std::string &data)
+    {
+        traffic.bytes_sent += static_cast<uint32_t>(data.size());
+        return true;
+    }
+};
+
+
+/*!
+ * @brief
+ *   Run the upload of a wake as weather_main.cpp does and count its
+ *   allocations.
+ */
+static MemoryProfile profile_upload(bool statistics)
+{
+    NullTransport transport;
+    MemoryProfile profile = {};
+    alloc_counter_reset();
+
+    {
+        Server server(transport, STATION_ID);
+        int interval_min;
+        server.connect();
+        server.get_interval(interval_min);
+
+        if (statistics)
+        {
+            RunningStats temperature;
+            RunningStats humidity;
+            temperature.add(21.5f);
+            humidity.add(40.0f);
+            server.post_sensor_statistics(temperature, humidity, 1234);
+        }
+        else
+        {
+            server.post_sensor_data(21.5f, 40, 1234);
+        }
+
+        Telemetry telemetry;
+        telemetry.add("RadioProfile", std::string("balanced"));
+        telemetry.add("Rssi", -67);
+        telemetry.add("TxPower", 15.5f, 2);
+        telemetry.add("RadioOnMs", 1830u);
+        telemetry.add("RadioConnectMs", 1500u);
+        telemetry.add("RadioEnergyMj", 812.3f, 1);
+        telemetry.add("HeapFree", 180000u);
+        telemetry.add("HeapMin", 150000u);
+        telemetry.add("HeapBlock", 110000u);
+        telemetry.add("Allocs", 50u);
+        telemetry.add("AllocBytes", 3000u);
+
+        for (const char *task : {"main", "Tmr Svc", "wifi", "tiT", "esp_timer", "eventTask", "IDLE0", "IDLE1"})
+        {
+            telemetry.add(memory_task_key(task), 1000u);
+        }
+
+        server.set_station_id(STATION_ID);
+        server.post_telemetry(telemetry);
+        server.disconnect();
+    }
+
+    AllocStats stats = alloc_counter_stats();
+    profile.allocations = stats.allocations;
+    profile.frees = stats.frees;
+    profile.allocated_bytes = stats.bytes;
+
+    return profile;
+}
+
+
+TEST_CASE("Upload of a wake stays within allocation budget", "[memory]")
+{
+    for (bool statistics : {false, true})
+    {
+        MemoryProfile profile = profile_upload(statistics);
+        std::string violations;
+        TEST_ASSERT_TRUE(profile.allocations > 0);
+        TEST_ASSERT_EQUAL(profile.allocations, profile.frees);
+        TEST_ASSERT_TRUE(memory_within_budget(profile, UPLOAD_BUDGET, violations));
+        TEST_ASSERT_EQUAL_STRING("", violations.c_str());
+    }
+}
+
+
+TEST_CASE("Memory profile is checked against budget", "[memory]")
+{
+    MemoryProfile profile = {180000, 30000, 20000, 10, 10, 800, 2, {{"main", 400}, {"wifi", 2000}}};
+    MemoryBudget budget = {32768, 16384, 0, 1024, 512};
+    std::string violations;
+    TEST_ASSERT_FALSE(memory_within_budget(profile, budget, violations));
+    TEST_ASSERT_EQUAL_STRING("min_free_heap 30000 < 32768\nstack main 400 < 512\n", violations.c_str());
+
+    profile.min_free_heap = 40000;
+    profile.tasks[0].free_bytes = 600;
+    TEST_ASSERT_TRUE(memory_within_budget(profile, budget, violations));
+    TEST_ASSERT_TRUE(violations.empty());
+
+    budget.max_allocations = 5;
+    TEST_ASSERT_FALSE(memory_within_budget(profile, budget, violations));
+    TEST_ASSERT_EQUAL_STRING("allocations 10 > 5\n", violations.c_str());
+}
+
+
+TEST_CASE("Task names become valid telemetry names", "[memory]")
+{
+    TEST_ASSERT_EQUAL_STRING("Stack_main", memory_task_key("main").c_str());
+    TEST_ASSERT_EQUAL_STRING("Stack_Tmr_Svc", memory_task_key("Tmr Svc").c_str());
+    TEST_ASSERT_EQUAL_STRING("Stack_esp_timer", memory_task_key("esp_timer").c_str());
+
+    char unterminated[MEMORY_TASK_NAME_LENGTH];
+    memset(unterminated, 'x', sizeof(unterminated));
+    TEST_ASSERT_EQUAL(6u + MEMORY_TASK_NAME_LENGTH, memory_task_key(unterminated).size());
+}
@@ -0,0 +1,68 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include "unity.h"
+#include "radio_profile.h"
+#include "telemetry.h"
+
+
+TEST_CASE("TX power adapts to access point signal strength", "[radio_profile]")
+{
+    TEST_ASSERT_EQUAL(RADIO_MAX_TX_POWER, radio_tx_power(RADIO_PROFILE_PERFORMANCE, -30));
+    TEST_ASSERT_EQUAL(RADIO_MAX_TX_POWER, radio_tx_power(RADIO_PROFILE_BALANCED, -75));
+    TEST_ASSERT_EQUAL(RADIO_MAX_TX_POWER, radio_tx_power(RADIO_PROFILE_BALANCED, -60));
+    TEST_ASSERT_EQUAL(RADIO_MAX_TX_POWER - 40, radio_tx_power(RADIO_PROFILE_BALANCED, -50));
+    TEST_ASSERT_EQUAL(RADIO_MIN_TX_POWER, radio_tx_power(RADIO_PROFILE_LOW_POWER, -20));
+}
+
+
+TEST_CASE("Power save and TX power lower radio energy", "[radio_profile]")
+{
+    RadioUsage usage = {1500, 800, RADIO_MAX_TX_POWER, -50};
+    float performance = radio_energy_mj(RADIO_PROFILE_PERFORMANCE, usage);
+    float balanced = radio_energy_mj(RADIO_PROFILE_BALANCED, usage);
+    float low_power = radio_energy_mj(RADIO_PROFILE_LOW_POWER, usage);
+
+    // Full TX power without power save: 114 mA connecting, 104.2 mA connected
+    TEST_ASSERT_EQUAL(2300u, radio_on_air_ms(usage));
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, (1500 * 114 + 800 * 104.2f) * 3.3f / 1000, performance);
+    TEST_ASSERT_TRUE(balanced < performance);
+    TEST_ASSERT_TRUE(low_power < balanced);
+
+    usage.tx_power = radio_tx_power(RADIO_PROFILE_BALANCED, usage.rssi);
+    TEST_ASSERT_TRUE(radio_energy_mj(RADIO_PROFILE_BALANCED, usage) < balanced);
+}
+
+
+TEST_CASE("Telemetry fields are form encoded", "[radio_profile]")
+{
+    Telemetry telemetry;
+    TEST_ASSERT_TRUE(telemetry.empty());
+    telemetry.add("RadioProfile", "balanced");
+    telemetry.add("Rssi", -67);
+    telemetry.add("RadioOnMs", 2300u);
+    telemetry.add("TxPower", 9.5f, 2);
+    TEST_ASSERT_EQUAL_STRING("&RadioProfile=balanced&Rssi=-67&RadioOnMs=2300&TxPower=9.50",
+                             telemetry.fields().c_str());
+}
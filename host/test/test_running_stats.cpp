@@ -0,0 +1,106 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <cmath>
+#include <random>
+#include <vector>
+#include "unity.h"
+#include "running_stats.h"
+
+
+TEST_CASE("Window statistics match two-pass computation", "[running_stats]")
+{
+    std::mt19937 random(1);
+    std::normal_distribution<double> temperature(21.5, 3.0);
+    std::vector<double> values;
+    RunningStats stats;
+
+    for (int i = 0; i < 1000; i++)
+    {
+        values.push_back(static_cast<float>(temperature(random)));
+        stats.add(static_cast<float>(values.back()));
+    }
+
+    double sum = 0;
+    double minimum = values[0];
+    double maximum = values[0];
+
+    for (double value : values)
+    {
+        sum += value;
+        minimum = std::min(minimum, value);
+        maximum = std::max(maximum, value);
+    }
+
+    double mean = sum / values.size();
+    double squares = 0;
+
+    for (double value : values)
+    {
+        squares += (value - mean) * (value - mean);
+    }
+
+    TEST_ASSERT_EQUAL(1000, stats.count());
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, minimum, stats.min());
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, maximum, stats.max());
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, mean, stats.mean());
+    TEST_ASSERT_FLOAT_WITHIN(1e-3, squares / (values.size() - 1), stats.variance());
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, sqrt(squares / (values.size() - 1)), stats.stddev());
+}
+
+
+TEST_CASE("Small variance on a large offset stays accurate", "[running_stats]")
+{
+    RunningStats stats;
+
+    // Sum of squares in single precision would lose all of the variance
+    for (int i = 0; i < 100000; i++)
+    {
+        stats.add((i % 2) ? 1000.1f : 1000.0f);
+    }
+
+    TEST_ASSERT_FLOAT_WITHIN(1e-3, 1000.05, stats.mean());
+    TEST_ASSERT_FLOAT_WITHIN(1e-3, 0.05, stats.stddev());
+}
+
+
+TEST_CASE("Empty and single sample windows", "[running_stats]")
+{
+    RunningStats stats;
+    TEST_ASSERT_EQUAL(0, stats.count());
+    TEST_ASSERT_FLOAT_WITHIN(0, 0, stats.variance());
+
+    stats.add(-5.0f);
+    TEST_ASSERT_FLOAT_WITHIN(0, -5.0, stats.min());
+    TEST_ASSERT_FLOAT_WITHIN(0, -5.0, stats.max());
+    TEST_ASSERT_FLOAT_WITHIN(0, -5.0, stats.mean());
+    TEST_ASSERT_FLOAT_WITHIN(0, 0, stats.variance());
+
+    stats.clear();
+    TEST_ASSERT_EQUAL(0, stats.count());
+    stats.add(3.0f);
+    stats.add(5.0f);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 4.0, stats.mean());
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 2.0, stats.variance());
+}
@@ -0,0 +1,151 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <vector>
+#include "unity.h"
+#include "dht_sim.h"
+#include "sensor_model.h"
+
+/*! ESP32 CPU cycles per microsecond, the capture clock */
+static const uint32_t TICKS_PER_US = 240;
+
+/*! Time between input register polls of the capture loop */
+static const uint32_t SAMPLE_PERIOD_NS = 100;
+
+// Timings come from the datasheets and are fixed at compile time
+static_assert(Dht11::START_LOW_US >= 18000, "DHT11 needs at least 18 ms start signal");
+static_assert(Dht22::START_LOW_US >= 1000, "DHT22 needs at least 1 ms start signal");
+static_assert(Am2302::ONE_THRESHOLD_US == Dht22::ONE_THRESHOLD_US, "AM2302 is a wired DHT22");
+
+
+/*!
+ * @brief
+ *   Make two sensors of a model with different responses and clocks.
+ */
+static std::vector<DhtSensorModel> make_sensors(DhtEncoder encode, float temperature, float humidity)
+{
+    std::vector<DhtSensorModel> sensors(2);
+    sensors[0].bit = 25;
+    sensors[1].bit = 26;
+    sensors[1].response_delay_ns = 38000;
+    sensors[1].clock_scale = 0.92;
+
+    for (DhtSensorModel &sensor : sensors)
+    {
+        sensor.encode = encode;
+        sensor.temperature = temperature;
+        sensor.humidity = humidity;
+        sensor.jitter_ns = 3000;
+    }
+
+    return sensors;
+}
+
+
+/*!
+ * @brief
+ *   Decode a simulated capture with the decoder of a model.
+ */
+template <class Model>
+static std::vector<DhtReading> decode(const std::vector<DhtSensorModel> &sensors, unsigned seed)
+{
+    uint32_t initial_levels;
+    std::vector<DhtEdge> edges = dht_simulate(sensors, SAMPLE_PERIOD_NS, TICKS_PER_US, initial_levels, seed);
+    std::vector<int> bits;
+
+    for (const DhtSensorModel &sensor : sensors)
+    {
+        bits.push_back(sensor.bit);
+    }
+
+    std::vector<DhtReading> readings(sensors.size());
+    dht_decode_channels<Model>(edges.data(), edges.size(), initial_levels, bits.data(),
+                               static_cast<int>(bits.size()), TICKS_PER_US, readings.data());
+
+    return readings;
+}
+
+
+TEST_CASE("DHT11 decodes integer and tenths", "[sensor_model]")
+{
+    const float temperatures[] = {23.0f, 4.7f, -8.2f};
+    const float humidities[] = {55.0f, 81.3f, 20.0f};
+
+    for (int i = 0; i < 3; i++)
+    {
+        std::vector<DhtReading> readings = decode<Dht11>(make_sensors(dht11_encode, temperatures[i],
+                                                                      humidities[i]), i);
+
+        for (const DhtReading &reading : readings)
+        {
+            TEST_ASSERT_EQUAL(DHT_OK, reading.status);
+            TEST_ASSERT_FLOAT_WITHIN(0.01, temperatures[i], reading.temperature);
+            TEST_ASSERT_FLOAT_WITHIN(0.01, humidities[i], reading.humidity);
+        }
+    }
+}
+
+
+TEST_CASE("AM2302 decodes like DHT22", "[sensor_model]")
+{
+    std::vector<DhtSensorModel> sensors = make_sensors(dht22_encode, -21.4f, 67.8f);
+    std::vector<DhtReading> am2302 = decode<Am2302>(sensors, 5);
+    std::vector<DhtReading> dht22 = decode<Dht22>(sensors, 5);
+
+    for (size_t i = 0; i < sensors.size(); i++)
+    {
+        TEST_ASSERT_EQUAL(DHT_OK, am2302[i].status);
+        TEST_ASSERT_FLOAT_WITHIN(0.01, -21.4, am2302[i].temperature);
+        TEST_ASSERT_FLOAT_WITHIN(0.01, dht22[i].humidity, am2302[i].humidity);
+    }
+}
+
+
+TEST_CASE("Checksum is checked per model", "[sensor_model]")
+{
+    std::vector<DhtSensorModel> sensors = make_sensors(dht11_encode, 20.0f, 50.0f);
+    sensors[1].corrupt_bit = 3;
+    std::vector<DhtReading> readings = decode<Dht11>(sensors, 2);
+    TEST_ASSERT_EQUAL(DHT_OK, readings[0].status);
+    TEST_ASSERT_EQUAL(DHT_CHECKSUM_ERROR, readings[1].status);
+}
+
+
+TEST_CASE("SHT3x conversion and CRC", "[sensor_model]")
+{
+    uint8_t data[Sht3x::DATA_BYTES];
+    DhtReading reading;
+
+    // Example from the Sensirion CRC application note
+    const uint8_t beef[] = {0xBE, 0xEF};
+    TEST_ASSERT_EQUAL(0x92, Sht3x::crc8(beef, 2));
+
+    sht3x_encode(-12.5f, 63.2f, data);
+    TEST_ASSERT_EQUAL(DHT_OK, Sht3x::convert(data, reading));
+    TEST_ASSERT_FLOAT_WITHIN(0.01, -12.5, reading.temperature);
+    TEST_ASSERT_FLOAT_WITHIN(0.01, 63.2, reading.humidity);
+
+    data[4] ^= 0x01;
+    TEST_ASSERT_EQUAL(DHT_CHECKSUM_ERROR, Sht3x::convert(data, reading));
+}
@@ -0,0 +1,115 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include "unity.h"
+#include "dht_decode.h"
+#include "sensor_model.h"
+#include "sensor_timing.h"
+
+/*! Microseconds per second */
+static const uint64_t S = 1000000;
+
+
+TEST_CASE("First read waits only for the rest of power-up", "[sensor_timing]")
+{
+    SensorClock clock = {};
+    SensorTiming timing(clock, Dht22::POWER_UP_MS, Dht22::MIN_INTERVAL_MS);
+
+    // Powered on at time 0, WiFi took 0.7 s
+    timing.start(700000, true);
+    TEST_ASSERT_EQUAL(300, timing.wait_ms(700000));
+    TEST_ASSERT_EQUAL(0, timing.wait_ms(1 * S));
+
+    // A reset that is not a power on gives no power-up history
+    SensorClock unknown = {};
+    SensorTiming reset(unknown, Dht22::POWER_UP_MS, Dht22::MIN_INTERVAL_MS);
+    reset.start(5 * S, false);
+    TEST_ASSERT_EQUAL(1000, reset.wait_ms(5 * S));
+}
+
+
+TEST_CASE("Read interval holds over deep sleep", "[sensor_timing]")
+{
+    SensorClock clock = {};
+    SensorTiming timing(clock, Dht22::POWER_UP_MS, Dht22::MIN_INTERVAL_MS);
+    timing.start(2 * S, true);
+    TEST_ASSERT_TRUE(timing.record(2 * S, DHT_OK));
+
+    // Next boot a second later, the clock was kept in RTC memory
+    SensorTiming next(clock, Dht22::POWER_UP_MS, Dht22::MIN_INTERVAL_MS);
+    next.start(3 * S, false);
+    TEST_ASSERT_EQUAL(1000, next.wait_ms(3 * S));
+
+    // After a 10 minute sleep there is nothing to wait
+    next.start(600 * S, false);
+    TEST_ASSERT_EQUAL(0, next.wait_ms(600 * S));
+
+    // A clock behind the last read is not valid
+    next.start(1 * S, false);
+    TEST_ASSERT_EQUAL(1000, next.wait_ms(1 * S));
+}
+
+
+TEST_CASE("Checksum error retries after the read interval", "[sensor_timing]")
+{
+    SensorClock clock = {};
+    SensorTiming timing(clock, Dht11::POWER_UP_MS, Dht11::MIN_INTERVAL_MS);
+    timing.start(10 * S, true);
+
+    for (int i = 0; i < 5; i++)
+    {
+        TEST_ASSERT_TRUE(timing.record(10 * S, DHT_CHECKSUM_ERROR));
+        TEST_ASSERT_EQUAL(Dht11::MIN_INTERVAL_MS, timing.wait_ms(10 * S));
+    }
+
+    TEST_ASSERT_TRUE(timing.responding());
+}
+
+
+TEST_CASE("Timeouts back off and give up", "[sensor_timing]")
+{
+    SensorClock clock = {};
+    SensorTiming timing(clock, Dht22::POWER_UP_MS, Dht22::MIN_INTERVAL_MS);
+    timing.start(10 * S, true);
+
+    TEST_ASSERT_TRUE(timing.record(10 * S, DHT_TIMEOUT_ERROR));
+    TEST_ASSERT_EQUAL(2 * Dht22::MIN_INTERVAL_MS, timing.wait_ms(10 * S));
+
+    // An answer resets the backoff
+    TEST_ASSERT_TRUE(timing.record(20 * S, DHT_CHECKSUM_ERROR));
+    TEST_ASSERT_EQUAL(Dht22::MIN_INTERVAL_MS, timing.wait_ms(20 * S));
+
+    TEST_ASSERT_TRUE(timing.record(30 * S, DHT_TIMEOUT_ERROR));
+    TEST_ASSERT_FALSE(timing.record(40 * S, DHT_TIMEOUT_ERROR));
+    TEST_ASSERT_FALSE(timing.responding());
+    TEST_ASSERT_EQUAL(Dht22::MIN_INTERVAL_MS + 6000, timing.wait_ms(40 * S));
+
+    // Backoff is capped
+    for (int i = 0; i < 100; i++)
+    {
+        timing.record(50 * S, DHT_TIMEOUT_ERROR);
+    }
+
+    TEST_ASSERT_EQUAL(Dht22::MIN_INTERVAL_MS + SensorTiming::MAX_BACKOFF_MS, timing.wait_ms(50 * S));
+}
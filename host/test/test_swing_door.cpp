@@ -0,0 +1,169 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+#include "unity.h"
+#include "server.h"
+#include "swing_door.h"
+
+
+/*! Transport that keeps the last post */
+class RecordingTransport : public Transport
+{
+public:
+    bool open()
+    {
+        return true;
+    }
+
+    void close()
+    {
+    }
+
+    bool get_config(std::string &config)
+    {
+        return false;
+    }
+
+    bool send(Channel channel, const std::string &data)
+    {
+        sent = data;
+        return true;
+    }
+
+    std::string sent;
+};
+
+
+TEST_CASE("Samples on a line are kept as its end points", "[swing_door]")
+{
+    SwingDoor trend;
+    trend.start(0.5f);
+
+    for (int i = 0; i < 30; i++)
+    {
+        TEST_ASSERT_TRUE(trend.add(i * 30, 20.0f + i * 0.1f));
+    }
+
+    trend.finish();
+    TEST_ASSERT_TRUE(trend.complete());
+    TEST_ASSERT_EQUAL(2, trend.count());
+    TEST_ASSERT_EQUAL(0, trend.points()[0].time_s);
+    TEST_ASSERT_EQUAL(870, trend.points()[1].time_s);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, 22.9, trend.points()[1].value);
+    TEST_ASSERT_FALSE(trend.add(870, 23.0f));
+}
+
+
+TEST_CASE("Trend is within deviation of every sample", "[swing_door]")
+{
+    std::mt19937 random(3);
+    std::normal_distribution<float> noise(0.0f, 0.15f);
+
+    for (float deviation : {0.1f, 0.5f, 2.0f})
+    {
+        SwingDoor trend;
+        trend.start(deviation);
+        std::vector<float> values;
+
+        // A sample of a minute for half an hour, warming up and turning back
+        for (int i = 0; i < 30; i++)
+        {
+            values.push_back(18.0f + 3.0f * sinf(i / 10.0f) + noise(random));
+            TEST_ASSERT_TRUE(trend.add(i * 60, values.back()));
+        }
+
+        trend.finish();
+        TEST_ASSERT_TRUE(trend.complete());
+        TEST_ASSERT_EQUAL(0, trend.points()[0].time_s);
+        TEST_ASSERT_EQUAL(29 * 60, trend.points()[trend.count() - 1].time_s);
+
+        for (int i = 0; i < 30; i++)
+        {
+            TEST_ASSERT_FLOAT_WITHIN(deviation + 1e-4f, values[i], trend_value(trend.points(), trend.count(), i * 60));
+        }
+
+        if (deviation >= 0.5f)
+        {
+            TEST_ASSERT_TRUE(trend.count() < 10);
+        }
+    }
+}
+
+
+TEST_CASE("Trend that does not fit is incomplete", "[swing_door]")
+{
+    SwingDoor trend;
+    trend.start(0.1f);
+
+    for (int i = 0; i < SwingDoor::MAX_POINTS + 10; i++)
+    {
+        trend.add(i, (i % 2) ? 1.0f : 0.0f);
+    }
+
+    trend.finish();
+    TEST_ASSERT_FALSE(trend.complete());
+    TEST_ASSERT_EQUAL(SwingDoor::MAX_POINTS, trend.count());
+
+    trend.start(0.1f);
+    TEST_ASSERT_TRUE(trend.complete());
+    TEST_ASSERT_EQUAL(0, trend.count());
+}
+
+
+TEST_CASE("Window trends are posted as ages and values", "[swing_door]")
+{
+    RecordingTransport transport;
+    Server server(transport, "attic");
+    RunningStats temperature;
+    RunningStats humidity;
+    SwingDoor temperature_trend;
+    SwingDoor humidity_trend;
+    temperature_trend.start(0.5f);
+    humidity_trend.start(2.0f);
+
+    for (int i = 0; i < 4; i++)
+    {
+        float value = (i < 2) ? 20.0f : 20.0f + (i - 1) * 2.0f;
+        temperature.add(value);
+        humidity.add(40.0f);
+        temperature_trend.add(i * 30, value);
+        humidity_trend.add(i * 30, 40.0f);
+    }
+
+    temperature_trend.finish();
+    humidity_trend.finish();
+    TEST_ASSERT_TRUE(server.post_sensor_trend(temperature, humidity, temperature_trend, humidity_trend, 7));
+    TEST_ASSERT_TRUE(transport.sent.find("Station=attic&Temperature=21.5&Humidity=40&Sequence=7&Samples=4") == 0);
+    std::string trends = transport.sent.substr(transport.sent.find("&TemperatureTrend="));
+    TEST_ASSERT_EQUAL_STRING("&TemperatureTrend=90:20.0,60:20.0,0:24.0&HumidityTrend=90:40.0,0:40.0", trends.c_str());
+
+    // The epoch of the sequence counter follows the sequence number
+    server.set_sequence_epoch(42);
+    TEST_ASSERT_TRUE(server.post_sensor_trend(temperature, humidity, temperature_trend, humidity_trend, 7));
+    TEST_ASSERT_TRUE(transport.sent.find("&Sequence=7&Epoch=42&Samples=4") != std::string::npos);
+}
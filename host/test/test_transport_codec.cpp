@@ -0,0 +1,123 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+#include <string>
+#include "unity.h"
+#include "coap_codec.h"
+#include "mqtt_codec.h"
+
+
+TEST_CASE("MQTT publish is parsed from partial input", "[transport]")
+{
+    std::string data = mqtt_publish("weather/collect", "Temperature=21.5", 1, 0x0102, false, false);
+    TEST_ASSERT_EQUAL(2 + 2 + 15 + 2 + 16, static_cast<int>(data.size()));
+    TEST_ASSERT_EQUAL(0x32, static_cast<uint8_t>(data[0]));
+
+    MqttPacket packet;
+    TEST_ASSERT_EQUAL(MQTT_INCOMPLETE, mqtt_parse(data.substr(0, 10), packet));
+    TEST_ASSERT_EQUAL(static_cast<int>(data.size()), mqtt_parse(data + mqtt_pingresp(), packet));
+
+    std::string topic;
+    std::string payload;
+    uint16_t packet_id;
+    TEST_ASSERT_TRUE(mqtt_parse_publish(packet, topic, payload, packet_id));
+    TEST_ASSERT_EQUAL_STRING("weather/collect", topic.c_str());
+    TEST_ASSERT_EQUAL_STRING("Temperature=21.5", payload.c_str());
+    TEST_ASSERT_EQUAL(0x0102, packet_id);
+}
+
+
+TEST_CASE("MQTT long remaining length and malformed packets", "[transport]")
+{
+    std::string data = mqtt_publish("t", std::string(200, 'x'), 0, 0, true, false);
+    TEST_ASSERT_EQUAL(0x31, static_cast<uint8_t>(data[0]));
+    TEST_ASSERT_EQUAL(0xCB, static_cast<uint8_t>(data[1]));
+    TEST_ASSERT_EQUAL(0x01, static_cast<uint8_t>(data[2]));
+
+    MqttPacket packet;
+    TEST_ASSERT_EQUAL(static_cast<int>(data.size()), mqtt_parse(data, packet));
+    TEST_ASSERT_EQUAL(MQTT_MALFORMED, mqtt_parse(std::string("\x30\xFF\xFF\xFF\xFF", 5), packet));
+    TEST_ASSERT_EQUAL(MQTT_MALFORMED, mqtt_parse(std::string("\x30\x80\x80\x02", 4), packet));
+
+    std::string client_id;
+    TEST_ASSERT_EQUAL(static_cast<int>(mqtt_connect("attic", 0).size()), mqtt_parse(mqtt_connect("attic", 0), packet));
+    TEST_ASSERT_TRUE(mqtt_parse_connect(packet, client_id));
+    TEST_ASSERT_EQUAL_STRING("attic", client_id.c_str());
+}
+
+
+TEST_CASE("CoAP request is encoded with Uri-Path options", "[transport]")
+{
+    CoapMessage request = {COAP_CONFIRMABLE, COAP_POST, 0x1234, "ab", {"collect"}, {}, 0, "Humidity=40"};
+    std::string data = coap_encode(request);
+    TEST_ASSERT_EQUAL(0x42, static_cast<uint8_t>(data[0]));
+    TEST_ASSERT_EQUAL(COAP_POST, static_cast<uint8_t>(data[1]));
+    TEST_ASSERT_EQUAL(0xB7, static_cast<uint8_t>(data[6]));
+    TEST_ASSERT_EQUAL(4 + 2 + 1 + 7 + 1 + 11, static_cast<int>(data.size()));
+
+    CoapMessage decoded;
+    TEST_ASSERT_TRUE(coap_decode(data, decoded));
+    TEST_ASSERT_EQUAL(COAP_CONFIRMABLE, decoded.type);
+    TEST_ASSERT_EQUAL(0x1234, decoded.message_id);
+    TEST_ASSERT_EQUAL_STRING("ab", decoded.token.c_str());
+    TEST_ASSERT_EQUAL(1u, decoded.uri_path.size());
+    TEST_ASSERT_EQUAL_STRING("collect", decoded.uri_path[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("Humidity=40", decoded.payload.c_str());
+
+    request.uri_path = {std::string(20, 'p'), "x"};
+    TEST_ASSERT_TRUE(coap_decode(coap_encode(request), decoded));
+    TEST_ASSERT_EQUAL(2u, decoded.uri_path.size());
+    TEST_ASSERT_EQUAL(20u, decoded.uri_path[0].size());
+
+    // Uri-Query follows Uri-Path with delta 4
+    request.uri_path = {"interval"};
+    request.uri_query = {"Station=attic"};
+    request.payload.clear();
+    std::string query = coap_encode(request);
+    TEST_ASSERT_EQUAL(0x4D, static_cast<uint8_t>(query[4 + 2 + 1 + 8]));
+    TEST_ASSERT_TRUE(coap_decode(query, decoded));
+    TEST_ASSERT_EQUAL(1u, decoded.uri_query.size());
+    TEST_ASSERT_EQUAL_STRING("Station=attic", decoded.uri_query[0].c_str());
+    TEST_ASSERT_TRUE(decoded.payload.empty());
+    TEST_ASSERT_EQUAL(0u, decoded.max_age);
+
+    // Max-Age of 5.03 in two bytes, option 14 takes an extended delta
+    CoapMessage unavailable = {COAP_ACKNOWLEDGEMENT, COAP_SERVICE_UNAVAILABLE, 0x1234, "ab", {}, {}, 300, ""};
+    std::string retry = coap_encode(unavailable);
+    TEST_ASSERT_EQUAL(4 + 2 + 2 + 2, static_cast<int>(retry.size()));
+    TEST_ASSERT_EQUAL(0xD2, static_cast<uint8_t>(retry[6]));
+    TEST_ASSERT_EQUAL(1, static_cast<uint8_t>(retry[7]));
+    TEST_ASSERT_TRUE(coap_decode(retry, decoded));
+    TEST_ASSERT_EQUAL(300u, decoded.max_age);
+    request.max_age = 70000;
+    TEST_ASSERT_TRUE(coap_decode(coap_encode(request), decoded));
+    TEST_ASSERT_EQUAL(70000u, decoded.max_age);
+    TEST_ASSERT_EQUAL_STRING("interval", decoded.uri_path[0].c_str());
+    TEST_ASSERT_EQUAL_STRING("Station=attic", decoded.uri_query[0].c_str());
+
+    TEST_ASSERT_FALSE(coap_decode(data.substr(0, 5), decoded));
+    TEST_ASSERT_FALSE(coap_decode(data.substr(0, 8), decoded));
+    TEST_ASSERT_TRUE(coap_success(COAP_CHANGED));
+    TEST_ASSERT_FALSE(coap_success(COAP_BAD_REQUEST));
+}
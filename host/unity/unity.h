@@ -0,0 +1,186 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2019 Matti Paakko
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+*/
+
+/*! @file
+ * Minimal host stand-in for the ESP-IDF Unity test runner.
+ *
+ * Host tests use the same TEST_CASE("name", "[tag]") and TEST_ASSERT_* macros
+ * as the on-target tests in components/x/test, so a test reads the same
+ * whether it runs on the ESP32 or on the build machine.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct UnityTestCase
+{
+    const char *name;
+    const char *tag;
+    void (*function)();
+};
+
+struct UnityFailure
+{
+    const char *file;
+    int line;
+    std::string message;
+};
+
+inline std::vector<UnityTestCase> &unity_test_cases()
+{
+    static std::vector<UnityTestCase> test_cases;
+    return test_cases;
+}
+
+inline int &unity_failure_count()
+{
+    static int failures = 0;
+    return failures;
+}
+
+inline int &unity_test_count()
+{
+    static int tests = 0;
+    return tests;
+}
+
+struct UnityRegistrar
+{
+    UnityRegistrar(const char *name, const char *tag, void (*function)())
+    {
+        unity_test_cases().push_back({name, tag, function});
+    }
+};
+
+inline void unity_fail(const char *file, int line, const std::string &message)
+{
+    throw UnityFailure{file, line, message};
+}
+
+/*!
+ * @brief
+ *   Run all registered test cases whose tag contains the filter.
+ *
+ * @param filter (IN)
+ *   Tag filter such as "[store]", or nullptr to run all test cases.
+ */
+inline void unity_run_tests_by_tag(const char *filter)
+{
+    for (const UnityTestCase &test_case : unity_test_cases())
+    {
+        if ((filter != nullptr) && (strstr(test_case.tag, filter) == nullptr))
+        {
+            continue;
+        }
+
+        unity_test_count()++;
+
+        try
+        {
+            test_case.function();
+            printf("%s %s:PASS\n", test_case.tag, test_case.name);
+        }
+        catch (const UnityFailure &failure)
+        {
+            unity_failure_count()++;
+            printf("%s:%d:%s %s:FAIL: %s\n", failure.file, failure.line,
+                   test_case.tag, test_case.name, failure.message.c_str());
+        }
+    }
+}
+
+inline void unity_run_all_tests()
+{
+    unity_run_tests_by_tag(nullptr);
+}
+
+#define UNITY_BEGIN() (unity_failure_count() = 0, unity_test_count() = 0)
+#define UNITY_END() \
+    (printf("\n%d Tests %d Failures\n", unity_test_count(), unity_failure_count()), unity_failure_count())
+
+#define UNITY_CONCAT_(a, b) a##b
+#define UNITY_CONCAT(a, b) UNITY_CONCAT_(a, b)
+
+#define TEST_CASE(name, tag)                                                        \
+    static void UNITY_CONCAT(unity_test_, __LINE__)();                              \
+    static UnityRegistrar UNITY_CONCAT(unity_registrar_, __LINE__)(                  \
+        name, tag, UNITY_CONCAT(unity_test_, __LINE__));                            \
+    static void UNITY_CONCAT(unity_test_, __LINE__)()
+
+#define TEST_FAIL_MESSAGE(message) unity_fail(__FILE__, __LINE__, message)
+
+#define TEST_ASSERT_TRUE(condition)                                                 \
+    do { if (!(condition)) unity_fail(__FILE__, __LINE__, "Expected TRUE: " #condition); } while (0)
+
+#define TEST_ASSERT_FALSE(condition)                                                \
+    do { if (condition) unity_fail(__FILE__, __LINE__, "Expected FALSE: " #condition); } while (0)
+
+#define TEST_ASSERT_EQUAL(expected, actual)                                         \
+    do {                                                                            \
+        if (!((expected) == (actual)))                                              \
+        {                                                                           \
+            unity_fail(__FILE__, __LINE__, "Expected " #expected " == " #actual);   \
+        }                                                                           \
+    } while (0)
+
+#define TEST_ASSERT_EQUAL_STRING(expected, actual)                                  \
+    do {                                                                            \
+        std::string unity_expected(expected);                                       \
+        std::string unity_actual(actual);                                           \
+        if (unity_expected != unity_actual)                                         \
+        {                                                                           \
+            unity_fail(__FILE__, __LINE__,                                          \
+                       "Expected \"" + unity_expected + "\" was \"" + unity_actual + "\""); \
+        }                                                                           \
+    } while (0)
+
+#define TEST_ASSERT_INT_WITHIN(delta, expected, actual)                             \
+    do {                                                                            \
+        long long unity_difference = (long long)(actual) - (long long)(expected);   \
+        if (llabs(unity_difference) > (long long)(delta))                           \
+        {                                                                           \
+            unity_fail(__FILE__, __LINE__,                                          \
+                       "Expected " + std::to_string((long long)(expected)) +         \
+                       " +/- " + std::to_string((long long)(delta)) +               \
+                       " was " + std::to_string((long long)(actual)));              \
+        }                                                                           \
+    } while (0)
+
+#define TEST_ASSERT_FLOAT_WITHIN(delta, expected, actual)                           \
+    do {                                                                            \
+        double unity_difference = (double)(actual) - (double)(expected);            \
+        if (!(std::fabs(unity_difference) <= (double)(delta)))                      \
+        {                                                                           \
+            unity_fail(__FILE__, __LINE__,                                          \
+                       "Expected " + std::to_string((double)(expected)) +           \
+                       " +/- " + std::to_string((double)(delta)) +                  \
+                       " was " + std::to_string((double)(actual)));                 \
+        }                                                                           \
+    } while (0)
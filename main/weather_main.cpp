@@ -1,10 +1,12 @@
 /*
- * Weather station for ESP32 using DHT22 temperature and humidity sensor.
+ * Weather station for ESP32 using DHT22, DHT11 or SHT3x temperature and
+ * humidity sensors.
  *
  * - Reads measurement interval from web server.
- * - Measures temperature and humidity with DHT22.
+ * - Measures temperature and humidity.
  * - Sends measured data to web server via WiFi.
- * - Goes to deep sleep for the interval and reboots to repeat the above.
+ * - Goes to deep sleep for the interval and reboots to repeat the above, or
+ *   for short intervals samples in light sleep and uploads the statistics.
  * - Web server shows temperature and humidity history graphically.
  *
  * Uses DHT22 driver from https://github.com/gosouth/DHT22-cpp.
@@ -34,21 +36,71 @@
 
 /*! @file */
 
+#include <cstdio>
 #include <string>
 #include "freertos/FreeRTOS.h"
+#include "esp_attr.h"
+#include "esp_system.h"
 #include "nvs_flash.h"
-#include "dht.h"
+#include "sdkconfig.h"
+#include "alloc_counter.h"
+#include "dht_diagnostics.h"
+#include "dht_multi.h"
+#include "sensor_pacer.h"
+#include "sht_sensor.h"
+#include "coap_transport.h"
+#include "http_transport.h"
 #include "led.h"
+#include "memory_monitor.h"
+#include "mqtt_transport.h"
+#include "ota_update.h"
+#include "running_stats.h"
 #include "wifi.h"
 #include "server.h"
 #include "sleep.h"
+#include "station.h"
+#include "swing_door.h"
+#include "telemetry.h"
 
 
 /*! HOW TO CONFIGURE WEATHER STATION:
  * - Set WiFi SSID, password and number of connection retries with ESP-IDF
- *   "make menuconfig" in "Example Configuration".
+ *   "make menuconfig" in "Example Configuration". Sites with several access
+ *   points provision a prioritised list to NVS with Wifi::set_access_points().
  * - Set SERVER_ADDRESS below and copy the files from /server_files
- *   to SERVER_ADDRESS.
+ *   to SERVER_ADDRESS. Run /collector on the server (see README.md).
+ * - Each station posts its ID with the data: the WiFi MAC address, or an ID
+ *   provisioned to NVS with Station::set_id().
+ * - Select the WiFi radio profile in "Example Configuration": performance
+ *   (default), balanced or low power. The radio use and estimated radio
+ *   energy of each wake are posted as telemetry with the next upload.
+ *   Every upload also posts the memory profile of its wake: heap
+ *   watermarks, counted allocations and task stack high-water marks.
+ * - Select the upload transport in "Example Configuration": HTTP(S)
+ *   (default) to SERVER_ADDRESS, or MQTT or CoAP to the collector host.
+ * - Select the sensor model in "Example Configuration": DHT22 (default),
+ *   AM2302, DHT11 or SHT3x. For SHT3x also set the I2C GPIO numbers there.
+ * - Turn on "DHT bit timing diagnostics" in "Example Configuration" to
+ *   post histograms of the sensors' pulse widths with each upload. They
+ *   tell a failing cable or a marginal sensor from capture timing problems.
+ * - List the GPIO ports of DHT sensors in DHT_PORTS. All sensors are read
+ *   in one pass. The first sensor posts with the station ID, the others as
+ *   stations "<station ID>-<sensor number>".
+ * - Run the collector with -s to give each station its own upload phase
+ *   of the interval, and with -r to turn wakes away when it is overloaded.
+ *   A failed upload is retried after a jittered backoff, or after the time
+ *   the collector asks for: in place up to RETRY_WAIT_MAX_S, in deep sleep
+ *   when longer.
+ * - Uploads at most LIGHT_SLEEP_MAX_INTERVAL_MIN apart are sampled every
+ *   SAMPLE_PERIOD_S in light sleep and post the window statistics. Longer
+ *   intervals deep sleep and post one sample per wake.
+ * - Set the trend deviations in "Example Configuration" to post the
+ *   samples of a light sleep window as swing-door trends, from which the
+ *   collector stores the samples within the deviations.
+ * - Set the firmware version in "Example Configuration". To update the
+ *   stations over the air, use a partition table with two OTA partitions,
+ *   put delta patches made with host/delta_tool on the server and offer the
+ *   version with a "firmware <version> <base URL>" line in interval.txt.
  * - Copy PHP graphics library from http://www.goat1000.com/svggraph.php
  *   to SERVER_ADDRESS/SVGGraph/.
  * - You can view temperature/humidity history in SERVER_ADDRESS/weather.php.
@@ -63,12 +115,12 @@ static const std::string GET_ADDRESS = SERVER_ADDRESS + "interval.txt";
 /*! Server file address to collect sensor data */
 static const std::string POST_ADDRESS = SERVER_ADDRESS + "collect.php";
 
+/*! Server address to collect station telemetry */
+static const std::string TELEMETRY_ADDRESS = SERVER_ADDRESS + "telemetry";
+
 /*! Default measurement interval in minutes */
 static const int DEFAULT_INTERVAL_MIN = 10;
 
-/*! DHT22 delay time in milliseconds */
-static const int DHT_DELAY_MS = 1000;
-
 /*! LED blink time in milliseconds */
 static const int LED_BLINK_TIME_MS = 300;
 
@@ -78,86 +130,363 @@ static const int NUM_SENSOR_READ_RETRIES = 5;
 /*! Number of measurement retries */
 static const int NUM_MEASUREMENT_RETRIES = 3;
 
-/*! GPIO port for DHT22 temperature and humidity sensor */
-static const gpio_num_t DHT_PORT = GPIO_NUM_25;
+/*! Wait before the first measurement retry in milliseconds, doubled for
+ *  each further retry. Each wait is drawn from 0.5 to 1.5 times this, so
+ *  stations failing together do not retry together. */
+static const int RETRY_BACKOFF_MS = 2000;
+
+/*! Longest time to retry after that the station waits awake in seconds.
+ *  It deep sleeps over a longer time asked by the collector. */
+static const int RETRY_WAIT_MAX_S = 10;
+
+/*! Time between samples in light sleep in seconds */
+static const int SAMPLE_PERIOD_S = 30;
+
+/*! Longest upload interval sampled in light sleep in minutes. The station
+ *  deep sleeps over longer intervals. */
+static const int LIGHT_SLEEP_MAX_INTERVAL_MIN = 15;
+
+/*! GPIO ports for DHT temperature and humidity sensors, GPIO 0-31 */
+static const gpio_num_t DHT_PORTS[] = {GPIO_NUM_25};
+
+/*! Number of DHT sensors */
+static const int NUM_SENSORS = sizeof(DHT_PORTS) / sizeof(DHT_PORTS[0]);
+
+static_assert(NUM_SENSORS < 100, "Sensor numbers must fit Station::SENSOR_SUFFIX_LENGTH");
+
+/*! DHT sensor model selected in "Example Configuration" */
+#if CONFIG_SENSOR_MODEL_DHT11
+typedef Dht11 DhtModel;
+#elif CONFIG_SENSOR_MODEL_AM2302
+typedef Am2302 DhtModel;
+#else
+typedef Dht22 DhtModel;
+#endif
+
+#if CONFIG_DHT_DIAGNOSTICS
+/*! Bit timing of the DHT reads since the last upload, kept over deep sleep */
+RTC_DATA_ATTR static DhtDiagnostics rtc_dht_diagnostics;
+#endif
+
+#if CONFIG_TREND_COMPRESSION
+/*! Swing-door trends of the light sleep window of each sensor, posted with
+ *  the window statistics. Static as they are too large for the main task
+ *  stack. */
+static SwingDoor temperature_trend[Sensor::MAX_SENSORS];
+static SwingDoor humidity_trend[Sensor::MAX_SENSORS];
+#endif
 
 /*! GPIO port for status LED */
 static const gpio_num_t LED_PORT = GPIO_NUM_16;
 
 
+/*! Sensor data of one upload. Kept over measurement retries so that a
+ *  resent sample has the same sequence number and the server can drop
+ *  duplicates. With light sleep sampling the windows hold the samples since
+ *  the previous upload and the sensor data are their means. Telemetry is
+ *  posted once with the sensor data. */
+struct Measurement
+{
+    uint32_t sequence;
+    uint32_t sequence_epoch;
+    float temperature[Sensor::MAX_SENSORS];
+    int humidity[Sensor::MAX_SENSORS];
+    bool valid[Sensor::MAX_SENSORS];
+    bool posted[Sensor::MAX_SENSORS];
+    RunningStats temperature_window[Sensor::MAX_SENSORS];
+    RunningStats humidity_window[Sensor::MAX_SENSORS];
+    Telemetry telemetry;
+    bool telemetry_posted;
+};
+
+
 /*!
  * @brief
- *   Read temperature and humidity from DHT22 sensor.
- *   Retry sensor reading if fails.
+ *   Read all sensors when they are ready and pace the next read by the
+ *   result of the sensors still needed.
+ *
+ * @param sensor (IN)
+ *   Sensors.
+ *
+ * @param pacer (IN/OUT)
+ *   Read pacing of the sensors.
+ *
+ * @param needed (IN)
+ *   True for each sensor whose failure paces the next read.
+ *
+ * @param readings (OUT)
+ *   Result of each sensor.
+ */
+static void read_sensors(const Sensor &sensor, SensorPacer &pacer, const bool *needed, DhtReading *readings)
+{
+    pacer.wait();
+    sensor.read(readings);
+    int status = DHT_OK;
+
+    for (int i = 0; i < sensor.count(); i++)
+    {
+        // A checksum error shows that the sensors answer
+        if (needed[i] && (readings[i].status != DHT_OK) && (status != DHT_CHECKSUM_ERROR))
+        {
+            status = readings[i].status;
+        }
+    }
+
+    pacer.record(status);
+}
+
+
+/*!
+ * @brief
+ *   Read temperature and humidity from the sensors that have not been read
+ *   yet. All sensors are read together, so the time taken does not grow
+ *   with the number of sensors.
+ *   Each read waits only for what is left of the sensor's power-up time and
+ *   read interval. Retry sensor reading if fails, paced by the failure:
+ *   checksum errors are retried after the read interval, timeouts after a
+ *   growing wait, and a sensor that keeps timing out is given up.
  *   Round humidity value to integer as humidity accuracy is +/- 2 %.
  *
- * @param temperature (OUT)
- *   Measured temperature in degrees Celsius.
+ * @param sensor (IN)
+ *   Sensors.
  *
- * @param humidity (OUT)
- *   Measured humidity in percent.
+ * @param pacer (IN/OUT)
+ *   Read pacing of the sensors.
+ *
+ * @param measurement (IN/OUT)
+ *   Sensor data of this wake.
  *
  * @return
- *   True if sensor reading succeeds, false otherwise.
+ *   True if all sensors have been read, false otherwise.
  */
-static bool read_sensor_data(float &temperature, int &humidity)
+static bool read_sensor_data(const Sensor &sensor, SensorPacer &pacer, Measurement &measurement)
 {
-    DHT dht;
-    dht.setDHTgpio(DHT_PORT);
+    DhtReading readings[Sensor::MAX_SENSORS];
+    bool needed[Sensor::MAX_SENSORS];
     int counter = 0;
-    int dht_status = DHT_TIMEOUT_ERROR;
+    bool all_valid = true;
 
-    while ((dht_status != DHT_OK) && (counter < NUM_SENSOR_READ_RETRIES))
+    for (int i = 0; i < sensor.count(); i++)
     {
-        vTaskDelay(DHT_DELAY_MS / portTICK_RATE_MS);
-        dht_status = dht.readDHT();
+        all_valid = all_valid && measurement.valid[i];
+    }
+
+    while (!all_valid && pacer.responding() && (counter < NUM_SENSOR_READ_RETRIES))
+    {
+        for (int i = 0; i < sensor.count(); i++)
+        {
+            needed[i] = !measurement.valid[i];
+        }
+
+        read_sensors(sensor, pacer, needed, readings);
+        all_valid = true;
+
+        for (int i = 0; i < sensor.count(); i++)
+        {
+            if (needed[i] && (readings[i].status == DHT_OK))
+            {
+                measurement.temperature[i] = readings[i].temperature;
+                measurement.humidity[i] = static_cast<int>(readings[i].humidity + 0.5);
+                measurement.valid[i] = true;
+            }
+
+            all_valid = all_valid && measurement.valid[i];
+        }
+
         counter++;
     }
 
-    temperature = dht.getTemperature();
-    humidity = static_cast<int>(dht.getHumidity() + 0.5);
+    return all_valid;
+}
+
+
+/*!
+ * @brief
+ *   Get station ID of a sensor.
+ *
+ * @param station_id (IN)
+ *   Station ID.
+ *
+ * @param sensor (IN)
+ *   Index of sensor.
+ *
+ * @return
+ *   Station ID for the first sensor, "<station ID>-<sensor number>" for the
+ *   others. Station::set_id() leaves room for the sensor number within the
+ *   collector's ID length.
+ */
+static std::string sensor_station_id(const std::string &station_id, int sensor)
+{
+    return (sensor == 0) ? station_id : station_id + "-" + std::to_string(sensor + 1);
+}
+
+
+/*!
+ * @brief
+ *   Add the memory profile of this wake to telemetry: free heap, lowest
+ *   free heap, largest free block, counted allocations and the stack
+ *   high-water marks of the tasks with the least free stack.
+ *
+ * @param telemetry (IN/OUT)
+ *   Telemetry of the upload.
+ */
+static void add_memory_telemetry(Telemetry &telemetry)
+{
+    MemoryProfile profile;
+    memory_profile_read(profile);
+
+    telemetry.add("HeapFree", static_cast<unsigned>(profile.free_heap));
+    telemetry.add("HeapMin", static_cast<unsigned>(profile.min_free_heap));
+    telemetry.add("HeapBlock", static_cast<unsigned>(profile.largest_free_block));
+    telemetry.add("Allocs", static_cast<unsigned>(profile.allocations));
+    telemetry.add("AllocBytes", static_cast<unsigned>(profile.allocated_bytes));
+
+    for (int i = 0; i < profile.task_count; i++)
+    {
+        telemetry.add(memory_task_key(profile.tasks[i].name), static_cast<unsigned>(profile.tasks[i].free_bytes));
+    }
+}
+
+#if CONFIG_DHT_DIAGNOSTICS
 
-    return (dht_status == DHT_OK);
+/*!
+ * @brief
+ *   Add the bit timing of the DHT reads since the last upload to
+ *   telemetry: reads, failures and the pulse width and margin histograms.
+ *
+ * @param telemetry (IN/OUT)
+ *   Telemetry of the upload.
+ */
+static void add_dht_telemetry(Telemetry &telemetry)
+{
+    telemetry.add("DhtReads", static_cast<unsigned>(rtc_dht_diagnostics.reads));
+    telemetry.add("DhtChecksumErrors", static_cast<unsigned>(rtc_dht_diagnostics.checksum_errors));
+    telemetry.add("DhtTimeouts", static_cast<unsigned>(rtc_dht_diagnostics.timeouts));
+    telemetry.add("DhtLowUs", dht_histogram_text(rtc_dht_diagnostics.low));
+    telemetry.add("DhtHighUs", dht_histogram_text(rtc_dht_diagnostics.high));
+    telemetry.add("DhtMarginUs", dht_histogram_text(rtc_dht_diagnostics.margin));
 }
 
+#endif
+
 
 /*!
  * @brief
- *   Read interval from server, read sensor data and send it to server.
+ *   Read station configuration from server, read sensor data and send it
+ *   to server.
+ *   Sensors are read and data posted only if an earlier retry has not done
+ *   it already.
+ *
+ * @param station_id (IN)
+ *   Station ID to send with sensor data.
+ *
+ * @param sensor (IN)
+ *   Sensors.
+ *
+ * @param pacer (IN/OUT)
+ *   Read pacing of the sensors, its total wait is posted as telemetry.
+ *
+ * @param measurement (IN/OUT)
+ *   Sensor data of this wake.
+ *
+ * @param config (OUT)
+ *   Station configuration from server file: measurement interval, upload
+ *   offset and offered firmware.
  *
- * @param interval_min (OUT)
- *   Measurement interval from server file in minutes.
+ * @param retry_after_s (OUT)
+ *   Seconds the collector asked to wait before retrying, 0 if it did not
+ *   ask.
  *
  * @return
  *   True if sensor reading and data sending succeeds, false otherwise.
  */
-static bool read_send(int &interval_min)
+static bool read_send(const std::string &station_id, const Sensor &sensor, SensorPacer &pacer,
+                      Measurement &measurement, StationConfig &config, int &retry_after_s)
 {
     bool data_ok = false;
-    Server server(GET_ADDRESS, POST_ADDRESS);
+#if CONFIG_TRANSPORT_MQTT
+    MqttTransport transport(CONFIG_COLLECTOR_HOST, CONFIG_MQTT_PORT, station_id);
+#elif CONFIG_TRANSPORT_COAP
+    CoapTransport transport(CONFIG_COLLECTOR_HOST, CONFIG_COAP_PORT, station_id);
+#else
+    // The collector gives each station its own interval, a web server ignores the query
+    HttpTransport transport(GET_ADDRESS + "?Station=" + station_id, POST_ADDRESS, TELEMETRY_ADDRESS);
+#endif
+    Server server(transport, station_id);
+    server.set_sequence_epoch(measurement.sequence_epoch);
     bool server_ok = server.connect();
 
     if (server_ok)
     {
-        server_ok = server.get_interval(interval_min);
+        server_ok = server.get_config(config);
 
         if (server_ok)
         {
-            float temperature;
-            int humidity;
-            data_ok = read_sensor_data(temperature, humidity);
+            data_ok = read_sensor_data(sensor, pacer, measurement);
 
-            if (data_ok)
+            for (int i = 0; i < sensor.count(); i++)
             {
-                server_ok = server.post_sensor_data(temperature, humidity);
+                if (measurement.valid[i] && !measurement.posted[i])
+                {
+                    server.set_station_id(sensor_station_id(station_id, i));
+
+#if CONFIG_TREND_COMPRESSION
+                    // A window whose trends did not fit is posted as statistics only
+                    if ((measurement.temperature_window[i].count() > 0) && temperature_trend[i].complete() &&
+                        humidity_trend[i].complete())
+                    {
+                        measurement.posted[i] = server.post_sensor_trend(measurement.temperature_window[i],
+                                                                         measurement.humidity_window[i],
+                                                                         temperature_trend[i], humidity_trend[i],
+                                                                         measurement.sequence);
+                    }
+                    else
+#endif
+                    if (measurement.temperature_window[i].count() > 0)
+                    {
+                        measurement.posted[i] = server.post_sensor_statistics(measurement.temperature_window[i],
+                                                                              measurement.humidity_window[i],
+                                                                              measurement.sequence);
+                    }
+                    else
+                    {
+                        measurement.posted[i] = server.post_sensor_data(measurement.temperature[i],
+                                                                        measurement.humidity[i],
+                                                                        measurement.sequence);
+                    }
+                }
+
+                server_ok = server_ok && (measurement.posted[i] || !measurement.valid[i]);
+            }
+
+            // Telemetry is best effort and does not fail the upload. The
+            // memory profile is read last, after the sensor data were posted.
+            if (!measurement.telemetry_posted)
+            {
+                Telemetry telemetry = measurement.telemetry;
+                add_memory_telemetry(telemetry);
+                telemetry.add("SensorWaitMs", static_cast<unsigned>(pacer.waited_ms()));
+#if CONFIG_DHT_DIAGNOSTICS
+                add_dht_telemetry(telemetry);
+#endif
+                server.set_station_id(station_id);
+                measurement.telemetry_posted = server.post_telemetry(telemetry);
+#if CONFIG_DHT_DIAGNOSTICS
+                // Reads after this upload count towards the next one
+                if (measurement.telemetry_posted)
+                {
+                    dht_diagnostics_clear(rtc_dht_diagnostics);
+                }
+#endif
             }
         }
         else
         {
-            interval_min = DEFAULT_INTERVAL_MIN;
+            config.interval_min = DEFAULT_INTERVAL_MIN;
         }
     }
 
+    retry_after_s = transport.retry_after_s();
     server.disconnect();
 
     return (data_ok && server_ok);
@@ -166,8 +495,150 @@ static bool read_send(int &interval_min)
 
 /*!
  * @brief
- *   Connect to WiFi, do measurement and go to deep sleep to conserve power.
- *   Retry measurement if fails.
+ *   Sample the sensors every SAMPLE_PERIOD_S in light sleep over an upload
+ *   interval, keeping window statistics and trends of each sensor. CPU and
+ *   radio are off between samples but the station does not reboot. The
+ *   sensor data of the next upload are the window means.
+ *
+ * @param sensor (IN)
+ *   Sensors.
+ *
+ * @param pacer (IN/OUT)
+ *   Read pacing of the sensors.
+ *
+ * @param sleep (IN)
+ *   Sleep control.
+ *
+ * @param interval_min (IN)
+ *   Upload interval in minutes.
+ *
+ * @param offset_s (IN)
+ *   Seconds to move the next upload by.
+ *
+ * @param measurement (OUT)
+ *   Sensor data of the next upload, cleared by the caller.
+ */
+static void sample_window(const Sensor &sensor, SensorPacer &pacer, const Sleep &sleep, int interval_min,
+                          int offset_s, Measurement &measurement)
+{
+    DhtReading readings[Sensor::MAX_SENSORS];
+    bool needed[Sensor::MAX_SENSORS];
+    int samples = (interval_min > 0) ? (interval_min * 60 + offset_s) / SAMPLE_PERIOD_S : 1;
+    samples = (samples > 0) ? samples : 1;
+
+    for (int i = 0; i < sensor.count(); i++)
+    {
+        needed[i] = true;
+#if CONFIG_TREND_COMPRESSION
+        temperature_trend[i].start(CONFIG_TREND_TEMPERATURE_DEVIATION / 10.0f);
+        humidity_trend[i].start(CONFIG_TREND_HUMIDITY_DEVIATION);
+#endif
+    }
+
+    for (int n = 0; n < samples; n++)
+    {
+        if (!sleep.light_sleep(SAMPLE_PERIOD_S * 1000))
+        {
+            vTaskDelay(SAMPLE_PERIOD_S * 1000 / portTICK_RATE_MS);
+        }
+
+        read_sensors(sensor, pacer, needed, readings);
+
+        for (int i = 0; i < sensor.count(); i++)
+        {
+            if (readings[i].status == DHT_OK)
+            {
+                measurement.temperature_window[i].add(readings[i].temperature);
+                measurement.humidity_window[i].add(readings[i].humidity);
+#if CONFIG_TREND_COMPRESSION
+                temperature_trend[i].add(n * SAMPLE_PERIOD_S, readings[i].temperature);
+                humidity_trend[i].add(n * SAMPLE_PERIOD_S, readings[i].humidity);
+#endif
+            }
+        }
+    }
+
+    for (int i = 0; i < sensor.count(); i++)
+    {
+#if CONFIG_TREND_COMPRESSION
+        temperature_trend[i].finish();
+        humidity_trend[i].finish();
+#endif
+
+        if (measurement.temperature_window[i].count() > 0)
+        {
+            measurement.temperature[i] = measurement.temperature_window[i].mean();
+            measurement.humidity[i] = static_cast<int>(measurement.humidity_window[i].mean() + 0.5);
+            measurement.valid[i] = true;
+        }
+    }
+}
+
+
+/*!
+ * @brief
+ *   Add radio use of the previous wake to telemetry: radio profile, signal
+ *   strength, TX power, radio on and connect times and estimated radio
+ *   energy.
+ *
+ * @param wifi (IN)
+ *   WiFi connection.
+ *
+ * @param telemetry (IN/OUT)
+ *   Telemetry of the upload.
+ */
+static void add_radio_telemetry(const Wifi &wifi, Telemetry &telemetry)
+{
+    RadioUsage usage;
+
+    if (!wifi.previous_usage(usage))
+    {
+        return;
+    }
+
+    telemetry.add("RadioProfile", wifi.radio_profile().name);
+    telemetry.add("Rssi", static_cast<int>(usage.rssi));
+    telemetry.add("TxPower", usage.tx_power / 4.0f, 2);
+    telemetry.add("RadioOnMs", static_cast<unsigned>(radio_on_air_ms(usage)));
+    telemetry.add("RadioConnectMs", static_cast<unsigned>(usage.connect_ms));
+    telemetry.add("RadioEnergyMj", radio_energy_mj(wifi.radio_profile(), usage), 1);
+}
+
+
+/*!
+ * @brief
+ *   Wait before retrying a failed measurement: the time asked by the
+ *   collector, or a jittered exponential backoff if it did not ask.
+ *
+ * @param retry (IN)
+ *   Number of the retry, 0 for the first.
+ *
+ * @param retry_after_s (IN)
+ *   Seconds the collector asked to wait, 0 if it did not ask.
+ */
+static void retry_wait(int retry, int retry_after_s)
+{
+    uint32_t wait_ms = static_cast<uint32_t>(retry_after_s) * 1000;
+
+    if (retry_after_s == 0)
+    {
+        uint32_t backoff_ms = static_cast<uint32_t>(RETRY_BACKOFF_MS) << retry;
+        wait_ms = backoff_ms / 2 + esp_random() % (backoff_ms + 1);
+    }
+
+    vTaskDelay(wait_ms / portTICK_RATE_MS);
+}
+
+
+/*!
+ * @brief
+ *   Connect to WiFi, do measurement and upload it.
+ *   Retry measurement if fails, after a backoff or the time asked by the
+ *   collector. Deep sleep over a long time asked by the collector.
+ *   Update the firmware if the server offers a newer version.
+ *   Sample the next upload in light sleep if it is due in at most
+ *   LIGHT_SLEEP_MAX_INTERVAL_MIN, and go to deep sleep to conserve power
+ *   otherwise.
  *   Blink status LED once at boot and continuously if WiFi connection fails.
  */
 static void measure(void)
@@ -176,26 +647,77 @@ static void measure(void)
     Led status_led(LED_PORT, LED_BLINK_TIME_MS);
     status_led.blink_once();
     Wifi wifi;
-
-    if (wifi.connect())
+#if CONFIG_SENSOR_MODEL_SHT3X
+    SHTSensor sensor(static_cast<gpio_num_t>(CONFIG_SHT3X_SDA_GPIO), static_cast<gpio_num_t>(CONFIG_SHT3X_SCL_GPIO));
+#else
+    DHTMulti<DhtModel> sensor(DHT_PORTS, NUM_SENSORS);
+#if CONFIG_DHT_DIAGNOSTICS
+    dht_diagnostics_start(rtc_dht_diagnostics);
+    sensor.set_diagnostics(&rtc_dht_diagnostics);
+#endif
+#endif
+    SensorPacer pacer(sensor);
+    Station station;
+    Measurement measurement = {};
+    StationConfig config = {DEFAULT_INTERVAL_MIN, 0, 0, ""};
+    OtaUpdate ota(CONFIG_FIRMWARE_VERSION);
+
+    while (wifi.connect())
     {
-        int interval_min;
+        std::string station_id = station.get_id();
+        measurement.sequence = station.next_sequence();
+        measurement.sequence_epoch = station.sequence_epoch();
+        add_radio_telemetry(wifi, measurement.telemetry);
         bool ok = false;
         int counter = 0;
+        int retry_after_s = 0;
+
+        // The offset moves one wake only, a failed upload keeps the phase
+        config.offset_s = 0;
 
-        while (!ok && (counter < NUM_MEASUREMENT_RETRIES))
+        while (!ok && (counter < NUM_MEASUREMENT_RETRIES) && (retry_after_s <= RETRY_WAIT_MAX_S))
         {
-            ok = read_send(interval_min);
+            if (counter > 0)
+            {
+                retry_wait(counter - 1, retry_after_s);
+            }
+
+            ok = read_send(station_id, sensor, pacer, measurement, config, retry_after_s);
             counter++;
         }
 
+        // An overloaded collector gets the station back when it asked
+        if (!ok && (retry_after_s > RETRY_WAIT_MAX_S))
+        {
+            wifi.disconnect();
+            sleep.start_interval();
+            sleep.deep_sleep(0, retry_after_s);
+        }
+
+        // The samples of this wake are posted before updating
+        if (!config.firmware_url.empty() && ota.wanted(config.firmware_version) &&
+            ota.apply(config.firmware_url, config.firmware_version))
+        {
+            wifi.disconnect();
+            esp_restart();
+        }
+
         wifi.disconnect();
-        sleep.deep_sleep(interval_min);
-    }
-    else
-    {
-        status_led.blink_continuously();
+
+        if (config.interval_min > LIGHT_SLEEP_MAX_INTERVAL_MIN)
+        {
+            sleep.deep_sleep(config.interval_min, config.offset_s);
+        }
+
+        measurement = Measurement();
+        sample_window(sensor, pacer, sleep, config.interval_min, config.offset_s, measurement);
+        sleep.start_interval();
+
+        // The next wake counts its allocations from here
+        alloc_counter_reset();
     }
+
+    status_led.blink_continuously();
 }
 
 
@@ -203,7 +725,7 @@ static void measure(void)
  * @brief
  *   Application start.
  *   Initialize non-volatile storage.
- *   Perform one temperature/humidity measurement.
+ *   Measure and upload temperature/humidity until deep sleep.
  */
 extern "C" void app_main()
 {
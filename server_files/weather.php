@@ -1,125 +1,184 @@
-<html>
-<title> Helsinki Weather </title>
-
-<?php
-    // Set automatic refresh
-    echo("<meta http-equiv='refresh' content='30'>");
-
-    // Set measurement interval to file interval.txt
-    $path = $_SERVER['DOCUMENT_ROOT'] . '/interval.txt';
-    if (isset($_POST['1']))
-    {
-        file_put_contents($path, "1");
-    }
-    if (isset($_POST['10']))
-    {
-        file_put_contents($path, "10");
-    }
-    if (isset($_POST['60']))
-    {
-        file_put_contents($path, "60");
-    }
-    $setting = file_get_contents($path);
-
-    // Get measurement data from file raw.html
-    $path = $_SERVER['DOCUMENT_ROOT'] . '/raw.html';
-    $data = file_get_contents($path);
-    $num_last = 16;
-    $pos1 = strpos($data, "<p>", 0);
-    $pos2 = strpos($data, "<p>", $pos1 + 1);
-    $length = $pos2 - $pos1;
-    $first = strpos($data, "<p>", strlen($data) - $length - 1);	
-    $act_num = 1;
-
-    // Get position of first data for graphics
-    for ($i = 0; $i < $num_last - 1; $i++)
-    {	
-        if ($first < $length)
-        {
-            break;
-        }
-	
-        $first = strpos($data, "<p>", $first - $length - 1);
-        $act_num++;
-    }
-    $temp_str = "Temperature:";
-    $hum_str = "Humidity:";
-    $temp_length = strlen($temp_str);
-    $hum_length = strlen($hum_str);	
-
-    // Get data for graphics
-    for ($i = 0; $i < $act_num; $i++)
-    {
-        $pos = $first;
-        $time[$i] = substr($data, $pos + 14, 5);
-        $pos = strpos($data, $temp_str, $pos);
-        $pos2 = strpos($data, " ", $pos + $temp_length + 1);
-        $temperature[$i] = substr($data, $pos + $temp_length + 1, $pos2 - $pos - $temp_length - 1);
-        $pos = strpos($data, $hum_str, $pos);
-        $pos2 = strpos($data, "<", $pos);
-        $humidity[$i] = substr($data, $pos + $hum_length + 1, $pos2 - $pos - $hum_length - 1);
-        $first = strpos($data, "<p>", $first + $length - 1);
-    }
-
-    $temp_min = min($temperature);
-    $temp_max = max($temperature);
-    $temp_axis_min = 5 * round($temp_min / 5 - 0.25) - 5;
-    $temp_axis_max = 5 * round($temp_max / 5 + 0.25) + 5;
-    $temperatures = array_combine($time, $temperature);
-    $humidities = array_combine($time, $humidity);
-?>
-
-    <body>
-    <header>
-         <h3><font face="verdana" color="blue">Weather in Helsinki at <?php printf('%s', $time[$act_num - 1]); ?></font></h3>
-             <p><font face="verdana">Temperature: <?php printf('<b>%s &deg;C</b>', $temperature[$act_num - 1]); ?></font></p>
-            <p><font face="verdana">Humidity: <?php printf('<b>%s &percnt;</b>', $humidity[$act_num - 1]); ?></font></p>
-    </header>
-    <header>
-        <h4><font face="verdana" color="blue">Temperature [&deg;C]</font></h4>
-    </header>
-
-<?php
-    // Create graphics for temperature history
-    require_once($_SERVER['DOCUMENT_ROOT'] . '/SVGGraph/SVGGraph.php');
-    $settings = array(
-        'axis_min_v'       => $temp_axis_min,
-        'axis_max_v'       => $temp_axis_max,
-	    'axis_font_size'   => 12,
-    );
-    $graph = new SVGGraph(700, 300, $settings);
-    $graph->Values($temperatures);
-    echo $graph->Fetch('LineGraph', false);
-?>
-
-    <header>
-        <h4><font face="verdana" color="blue">Humidity [%]</font></h4>
-    </header>
-
-<?php
-    // Create graphics for humidity history
-    $settings = array(
-        'axis_min_v'       => 0,
-        'axis_max_v'       => 100,
-	    'axis_font_size'   => 12,
-    );
-    $graph = new SVGGraph(700, 300, $settings);
-    $graph->Values($humidities);
-    echo $graph->Fetch('LineGraph', false);
-?>
-
-    <header>
-        <h4><font face="verdana" color="blue">Measurement interval: <?php echo $setting?> min</font></h4>
-    </header>
-        <form action="weather.php" method="post">
-            <input style="width: 5%; margin-right: 32px; font-family: sans-serif; font-size: 14px; font-weight: bold;" input type="submit" name="1" value="1" <?php if ($setting == '1'){ ?> disabled <?php } ?>>
-            <input style="width: 5%; margin-right: 32px; font-family: sans-serif; font-size: 14px; font-weight: bold;" input type="submit" name="10" value="10" <?php if ($setting == '10'){ ?> disabled <?php } ?>>
-            <input style="width: 5%; font-family: sans-serif; font-size: 14px; font-weight: bold;" input type="submit" name="60" value="60" <?php if ($setting == '60'){ ?> disabled <?php } ?>>
-        </form>
-
-<?php
-    echo $graph->FetchJavascript();
-?>
-
-    </body>
-</html>
+<html>
+<title> Helsinki Weather </title>
+
+<?php
+    // Collector event stream, new samples are added to the page in place
+    // and the graphs are redrawn at most once per measurement interval
+    $events_address = '/events';
+
+    // Set measurement interval to file interval.txt
+    $path = $_SERVER['DOCUMENT_ROOT'] . '/interval.txt';
+    if (isset($_POST['1']))
+    {
+        file_put_contents($path, "1");
+    }
+    if (isset($_POST['10']))
+    {
+        file_put_contents($path, "10");
+    }
+    if (isset($_POST['60']))
+    {
+        file_put_contents($path, "60");
+    }
+    $setting = file_get_contents($path);
+
+    // Get last measurements of the selected station, or averages of all
+    // stations over the measurement interval, from the collector
+    $collector_address = 'http://localhost:8080';
+    $num_last = 16;
+    $station = isset($_GET['station']) ? preg_replace('/[^A-Za-z0-9_-]/', '', $_GET['station']) : '';
+    $query = $collector_address . '/query?last=' . $num_last;
+    if ($station != '')
+    {
+        $query .= '&station=' . urlencode($station);
+    }
+    else
+    {
+        $query .= '&step=' . (60 * intval($setting));
+    }
+    $samples = json_decode(file_get_contents($query), true);
+    $stations = json_decode(file_get_contents($collector_address . '/stations'), true);
+    $act_num = count($samples);
+
+    // Get data for graphics
+    for ($i = 0; $i < $act_num; $i++)
+    {
+        $time[$i] = date("H:i", $samples[$i]['time']);
+        $temperature[$i] = sprintf("%.1f", $samples[$i]['temperature']);
+        $humidity[$i] = $samples[$i]['humidity'];
+    }
+
+    $temp_min = min($temperature);
+    $temp_max = max($temperature);
+    $temp_axis_min = 5 * round($temp_min / 5 - 0.25) - 5;
+    $temp_axis_max = 5 * round($temp_max / 5 + 0.25) + 5;
+    $temperatures = array_combine($time, $temperature);
+    $humidities = array_combine($time, $humidity);
+?>
+
+    <body>
+    <header>
+         <h3><font face="verdana" color="blue">Weather in Helsinki at <span id="last_time"><?php printf('%s', $time[$act_num - 1]); ?></span></font></h3>
+             <p><font face="verdana">Temperature: <?php printf('<b id="last_temperature">%s &deg;C</b>', $temperature[$act_num - 1]); ?></font></p>
+            <p><font face="verdana">Humidity: <?php printf('<b id="last_humidity">%s &percnt;</b>', $humidity[$act_num - 1]); ?></font></p>
+    </header>
+    <header>
+        <h4><font face="verdana" color="blue">Temperature [&deg;C]</font></h4>
+    </header>
+
+<?php
+    // Create graphics for temperature history
+    require_once($_SERVER['DOCUMENT_ROOT'] . '/SVGGraph/SVGGraph.php');
+    $settings = array(
+        'axis_min_v'       => $temp_axis_min,
+        'axis_max_v'       => $temp_axis_max,
+	    'axis_font_size'   => 12,
+    );
+    $graph = new SVGGraph(700, 300, $settings);
+    $graph->Values($temperatures);
+    echo $graph->Fetch('LineGraph', false);
+?>
+
+    <header>
+        <h4><font face="verdana" color="blue">Humidity [%]</font></h4>
+    </header>
+
+<?php
+    // Create graphics for humidity history
+    $settings = array(
+        'axis_min_v'       => 0,
+        'axis_max_v'       => 100,
+	    'axis_font_size'   => 12,
+    );
+    $graph = new SVGGraph(700, 300, $settings);
+    $graph->Values($humidities);
+    echo $graph->Fetch('LineGraph', false);
+?>
+
+    <header>
+        <h4><font face="verdana" color="blue">Latest measurements</font></h4>
+    </header>
+        <table id="samples" style="font-family: verdana; font-size: 14px;">
+            <tr><th>Time</th><th>Temperature [&deg;C]</th><th>Humidity [%]</th></tr>
+<?php
+    for ($i = $act_num - 1; $i >= 0; $i--)
+    {
+        printf('            <tr><td>%s</td><td>%s</td><td>%s</td></tr>' . "\n", $time[$i], $temperature[$i], $humidity[$i]);
+    }
+?>
+        </table>
+
+    <header>
+        <h4><font face="verdana" color="blue">Measurement interval: <?php echo $setting?> min</font></h4>
+    </header>
+        <form action="weather.php" method="get">
+            <select name="station" onchange="this.form.submit()">
+                <option value="">All stations</option>
+<?php
+    foreach ($stations as $entry)
+    {
+        $selected = ($entry['station'] == $station) ? ' selected' : '';
+        printf('                <option value="%s"%s>%s</option>' . "\n", $entry['station'], $selected, $entry['station']);
+    }
+?>
+            </select>
+        </form>
+        <form action="weather.php<?php if ($station != '') { echo '?station=' . urlencode($station); } ?>" method="post">
+            <input style="width: 5%; margin-right: 32px; font-family: sans-serif; font-size: 14px; font-weight: bold;" input type="submit" name="1" value="1" <?php if ($setting == '1'){ ?> disabled <?php } ?>>
+            <input style="width: 5%; margin-right: 32px; font-family: sans-serif; font-size: 14px; font-weight: bold;" input type="submit" name="10" value="10" <?php if ($setting == '10'){ ?> disabled <?php } ?>>
+            <input style="width: 5%; font-family: sans-serif; font-size: 14px; font-weight: bold;" input type="submit" name="60" value="60" <?php if ($setting == '60'){ ?> disabled <?php } ?>>
+        </form>
+
+<?php
+    echo $graph->FetchJavascript();
+?>
+
+    <script>
+        var events = new EventSource('<?php echo $events_address; ?>');
+        var station = '<?php echo $station; ?>';
+        var num_last = <?php echo $num_last; ?>;
+        var redraw_ms = <?php echo 60000 * intval($setting); ?>;
+        var redraw = null;
+
+        // Show a sample of the viewed station at the top of the table
+        function show_sample(sample) {
+            var date = new Date(sample.time * 1000);
+            var time = ('0' + date.getHours()).slice(-2) + ':' + ('0' + date.getMinutes()).slice(-2);
+            var temperature = sample.temperature.toFixed(1);
+            document.getElementById('last_time').textContent = time;
+            document.getElementById('last_temperature').innerHTML = temperature + ' &deg;C';
+            document.getElementById('last_humidity').innerHTML = sample.humidity + ' &percnt;';
+
+            var table = document.getElementById('samples');
+            var row = table.insertRow(1);
+            row.insertCell(0).textContent = time;
+            row.insertCell(1).textContent = temperature;
+            row.insertCell(2).textContent = sample.humidity;
+            while (table.rows.length > num_last + 1) {
+                table.deleteRow(-1);
+            }
+        }
+
+        // The graphs are drawn by the server, so reload the page for them
+        // once per measurement interval however many samples arrive
+        function schedule_redraw() {
+            if (redraw == null) {
+                redraw = setTimeout(function() { location.reload(); }, redraw_ms);
+            }
+        }
+
+        events.addEventListener('sample', function(event) {
+            var sample = JSON.parse(event.data);
+            if (station == '') {
+                // The averages of all stations change once per interval
+                schedule_redraw();
+            }
+            else if (sample.station == station) {
+                show_sample(sample);
+                schedule_redraw();
+            }
+        });
+    </script>
+
+    </body>
+</html>